@@ -0,0 +1,425 @@
+#include "ragdollpch.h"
+#include "AccessorDecode.h"
+
+#include "Profiler.h"
+#include "Ragdoll/AssetManager.h"
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define RD_ACCESSOR_DECODE_SSE 1
+#include <immintrin.h>
+#endif
+
+namespace
+{
+	//gltf component types
+	constexpr int ComponentByte = 5120;
+	constexpr int ComponentUnsignedByte = 5121;
+	constexpr int ComponentShort = 5122;
+	constexpr int ComponentUnsignedShort = 5123;
+	constexpr int ComponentUnsignedInt = 5125;
+	constexpr int ComponentFloat = 5126;
+
+	//buffers come straight out of mapped files, nothing is aligned
+	template<typename T>
+	T Load(const uint8_t* p)
+	{
+		T Value;
+		memcpy(&Value, p, sizeof(T));
+		return Value;
+	}
+
+	template<typename T, bool Normalized>
+	float ToFloat(T value)
+	{
+		if constexpr (!Normalized || std::is_same_v<T, float>)
+			return static_cast<float>(value);
+		else if constexpr (std::is_signed_v<T>)
+			//the most negative value would land past -1, gltf clamps it
+			return std::max(static_cast<float>(value) / static_cast<float>(std::numeric_limits<T>::max()), -1.f);
+		else
+			return static_cast<float>(value) / static_cast<float>(std::numeric_limits<T>::max());
+	}
+
+	//targets is null for a plain gather, otherwise element i goes to element targets[i] of dst
+	template<typename T, bool Normalized, uint32_t N>
+	void GatherKernel(const AccessorView& view, const uint32_t* targets, uint8_t* dst, size_t dstStride, size_t dstCount)
+	{
+		const uint8_t* Src = view.Data;
+		for (size_t i = 0; i < view.Count; ++i, Src += view.Stride)
+		{
+			const size_t Target = targets ? targets[i] : i;
+			if (Target >= dstCount)
+				continue;
+			float Values[N];
+			for (uint32_t k = 0; k < N; ++k)
+				Values[k] = ToFloat<T, Normalized>(Load<T>(Src + k * sizeof(T)));
+			memcpy(dst + Target * dstStride, Values, sizeof(Values));
+		}
+	}
+
+	template<typename T, bool Normalized>
+	void GatherComponents(const AccessorView& view, const uint32_t* targets, uint8_t* dst, size_t dstStride, uint32_t componentCount, size_t dstCount)
+	{
+		switch (componentCount)
+		{
+		case 1: GatherKernel<T, Normalized, 1>(view, targets, dst, dstStride, dstCount); break;
+		case 2: GatherKernel<T, Normalized, 2>(view, targets, dst, dstStride, dstCount); break;
+		case 3: GatherKernel<T, Normalized, 3>(view, targets, dst, dstStride, dstCount); break;
+		case 4: GatherKernel<T, Normalized, 4>(view, targets, dst, dstStride, dstCount); break;
+		}
+	}
+
+	template<typename T>
+	void GatherIntegers(const AccessorView& view, const uint32_t* targets, uint8_t* dst, size_t dstStride, uint32_t componentCount, size_t dstCount)
+	{
+		if (view.bNormalized)
+			GatherComponents<T, true>(view, targets, dst, dstStride, componentCount, dstCount);
+		else
+			GatherComponents<T, false>(view, targets, dst, dstStride, componentCount, dstCount);
+	}
+
+	bool Gather(const AccessorView& view, const uint32_t* targets, float* dst, size_t dstStride, uint32_t dstComponents, size_t dstCount)
+	{
+		//attributes are at most 4 wide, matrices are not vertex attributes
+		const uint32_t ComponentCount = std::min({ view.ComponentCount, dstComponents, 4u });
+		uint8_t* Dst = reinterpret_cast<uint8_t*>(dst);
+		if (view.ComponentType == ComponentUnsignedInt)
+			return false;
+		if (!view.Data)
+		{
+			for (size_t i = 0; i < view.Count; ++i)
+			{
+				const size_t Target = targets ? targets[i] : i;
+				if (Target < dstCount)
+					memset(Dst + Target * dstStride, 0, ComponentCount * sizeof(float));
+			}
+			return true;
+		}
+		switch (view.ComponentType)
+		{
+		case ComponentFloat: GatherComponents<float, false>(view, targets, Dst, dstStride, ComponentCount, dstCount); break;
+		case ComponentByte: GatherIntegers<int8_t>(view, targets, Dst, dstStride, ComponentCount, dstCount); break;
+		case ComponentUnsignedByte: GatherIntegers<uint8_t>(view, targets, Dst, dstStride, ComponentCount, dstCount); break;
+		case ComponentShort: GatherIntegers<int16_t>(view, targets, Dst, dstStride, ComponentCount, dstCount); break;
+		case ComponentUnsignedShort: GatherIntegers<uint16_t>(view, targets, Dst, dstStride, ComponentCount, dstCount); break;
+		default: return false;
+		}
+		return true;
+	}
+
+	template<typename T>
+	void WidenKernel(const AccessorView& view, uint32_t* dst)
+	{
+		size_t i = 0;
+		if (view.Stride == sizeof(T))
+		{
+			if constexpr (std::is_same_v<T, uint32_t>)
+			{
+				memcpy(dst, view.Data, view.Count * sizeof(uint32_t));
+				return;
+			}
+#if RD_ACCESSOR_DECODE_SSE
+			//interleave with zeros until every index fills a dword
+			const __m128i Zero = _mm_setzero_si128();
+			if constexpr (std::is_same_v<T, uint8_t>)
+			{
+				for (; i + 16 <= view.Count; i += 16)
+				{
+					__m128i Bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(view.Data + i));
+					__m128i Low = _mm_unpacklo_epi8(Bytes, Zero);
+					__m128i High = _mm_unpackhi_epi8(Bytes, Zero);
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_unpacklo_epi16(Low, Zero));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 4), _mm_unpackhi_epi16(Low, Zero));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 8), _mm_unpacklo_epi16(High, Zero));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 12), _mm_unpackhi_epi16(High, Zero));
+				}
+			}
+			else if constexpr (std::is_same_v<T, uint16_t>)
+			{
+				for (; i + 8 <= view.Count; i += 8)
+				{
+					__m128i Shorts = _mm_loadu_si128(reinterpret_cast<const __m128i*>(view.Data + i * sizeof(uint16_t)));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_unpacklo_epi16(Shorts, Zero));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 4), _mm_unpackhi_epi16(Shorts, Zero));
+				}
+			}
+#endif
+		}
+		//strided views and whatever is left of the simd loop
+		for (; i < view.Count; ++i)
+			dst[i] = Load<T>(view.Data + i * view.Stride);
+	}
+
+	template<typename T>
+	void ScatterIndexKernel(const AccessorView& values, const uint32_t* targets, uint32_t* dst, size_t dstCount)
+	{
+		for (size_t i = 0; i < values.Count; ++i)
+		{
+			if (targets[i] < dstCount)
+				dst[targets[i]] = values.Data ? Load<T>(values.Data + i * values.Stride) : 0u;
+		}
+	}
+
+	//what the loader did before, a switch and a size lookup for every element, also the reference the kernels are checked against
+	uint32_t GetComponentSize(int componentType)
+	{
+		switch (componentType)
+		{
+		case ComponentByte: case ComponentUnsignedByte: return 1;
+		case ComponentShort: case ComponentUnsignedShort: return 2;
+		default: return 4;
+		}
+	}
+
+	float GetReferenceComponent(const uint8_t* p, int componentType, bool bNormalized)
+	{
+		switch (componentType)
+		{
+		case ComponentByte: return bNormalized ? std::max(*reinterpret_cast<const int8_t*>(p) / 127.f, -1.f) : *reinterpret_cast<const int8_t*>(p);
+		case ComponentUnsignedByte: return bNormalized ? *p / 255.f : *p;
+		case ComponentShort: return bNormalized ? std::max(Load<int16_t>(p) / 32767.f, -1.f) : Load<int16_t>(p);
+		case ComponentUnsignedShort: return bNormalized ? Load<uint16_t>(p) / 65535.f : Load<uint16_t>(p);
+		default: return Load<float>(p);
+		}
+	}
+
+	uint32_t GetReferenceIndex(const uint8_t* p, int componentType)
+	{
+		switch (componentType)
+		{
+		case ComponentUnsignedByte: return *p;
+		case ComponentUnsignedShort: return Load<uint16_t>(p);
+		default: return Load<uint32_t>(p);
+		}
+	}
+
+	//bytes the verification and the benchmark decode from, floats start at offset and are kept finite so comparisons work
+	void FillSource(std::vector<uint8_t>& bytes, size_t offset, size_t size, int componentType, uint32_t seed)
+	{
+		std::mt19937 Random(seed);
+		bytes.resize(size);
+		for (uint8_t& Byte : bytes)
+			Byte = static_cast<uint8_t>(Random());
+		if (componentType == ComponentFloat)
+		{
+			std::uniform_real_distribution<float> Distribution(-1000.f, 1000.f);
+			for (size_t i = offset; i + sizeof(float) <= size; i += sizeof(float))
+			{
+				const float Value = Distribution(Random);
+				memcpy(bytes.data() + i, &Value, sizeof(float));
+			}
+		}
+	}
+}
+
+bool WidenIndices(const AccessorView& view, uint32_t* dst)
+{
+	if (!view.Data)
+	{
+		std::fill(dst, dst + view.Count, 0u);
+		return true;
+	}
+	switch (view.ComponentType)
+	{
+	case ComponentUnsignedByte: WidenKernel<uint8_t>(view, dst); break;
+	case ComponentUnsignedShort: WidenKernel<uint16_t>(view, dst); break;
+	case ComponentUnsignedInt: WidenKernel<uint32_t>(view, dst); break;
+	default: return false;
+	}
+	return true;
+}
+
+bool GatherAttribute(const AccessorView& view, float* dst, size_t dstStride, uint32_t dstComponents)
+{
+	return Gather(view, nullptr, dst, dstStride, dstComponents, view.Count);
+}
+
+bool ScatterIndices(const AccessorView& values, const uint32_t* targets, uint32_t* dst, size_t dstCount)
+{
+	switch (values.ComponentType)
+	{
+	case ComponentUnsignedByte: ScatterIndexKernel<uint8_t>(values, targets, dst, dstCount); break;
+	case ComponentUnsignedShort: ScatterIndexKernel<uint16_t>(values, targets, dst, dstCount); break;
+	case ComponentUnsignedInt: ScatterIndexKernel<uint32_t>(values, targets, dst, dstCount); break;
+	default: return false;
+	}
+	return true;
+}
+
+bool ScatterAttribute(const AccessorView& values, const uint32_t* targets, float* dst, size_t dstStride, uint32_t dstComponents, size_t dstCount)
+{
+	return Gather(values, targets, dst, dstStride, dstComponents, dstCount);
+}
+
+bool VerifyAccessorDecoding()
+{
+	RD_SCOPE(Load, Verify Accessor Decoding);
+	uint32_t Failures{};
+	//odd counts leave a tail after the simd loops, the offset makes every load unaligned
+	constexpr size_t Count = 1003;
+	constexpr size_t Offset = 1;
+	std::vector<uint8_t> Source;
+
+	for (int ComponentType : { ComponentUnsignedByte, ComponentUnsignedShort, ComponentUnsignedInt })
+	{
+		const uint32_t Size = GetComponentSize(ComponentType);
+		//tight like every index buffer should be, and strided which the spec does not allow but costs nothing to handle
+		for (size_t Stride : { size_t(Size), size_t(Size) + 4 })
+		{
+			FillSource(Source, Offset, Offset + Count * Stride, ComponentType, ComponentType);
+			AccessorView View{ Source.data() + Offset, Count, Stride, ComponentType, 1, false };
+			std::vector<uint32_t> Indices(Count);
+			bool bSupported = WidenIndices(View, Indices.data());
+			uint32_t Mismatches{};
+			for (size_t i = 0; i < Count; ++i)
+				Mismatches += Indices[i] != GetReferenceIndex(View.Data + i * Stride, ComponentType);
+			if (!bSupported || Mismatches)
+			{
+				RD_CORE_ERROR("Accessor decoding: {} of {} indices of component type {} with stride {} are wrong", Mismatches, Count, ComponentType, Stride);
+				++Failures;
+			}
+		}
+	}
+
+	constexpr size_t DstStride = 48;
+	for (int ComponentType : { ComponentByte, ComponentUnsignedByte, ComponentShort, ComponentUnsignedShort, ComponentFloat })
+	{
+		const uint32_t Size = GetComponentSize(ComponentType);
+		for (bool bNormalized : { false, true })
+		{
+			if (bNormalized && ComponentType == ComponentFloat)
+				continue;
+			for (uint32_t Components = 1; Components <= 4; ++Components)
+			{
+				//gltf pads every element to 4 bytes, the second stride is an interleaved buffer
+				const size_t Tight = (Components * Size + 3) & ~size_t(3);
+				for (size_t Stride : { Tight, Tight + 12 })
+				{
+					FillSource(Source, Offset, Offset + Count * Stride, ComponentType, ComponentType * 16 + Components);
+					AccessorView View{ Source.data() + Offset, Count, Stride, ComponentType, Components, bNormalized };
+					//one component more than the accessor has, which has to be left alone
+					std::vector<float> Dst(Count * DstStride / sizeof(float), -2.f);
+					bool bSupported = GatherAttribute(View, Dst.data(), DstStride, std::min(Components + 1, 4u));
+					uint32_t Mismatches{};
+					for (size_t i = 0; i < Count; ++i)
+					{
+						const float* Element = Dst.data() + i * DstStride / sizeof(float);
+						for (uint32_t k = 0; k < Components; ++k)
+							Mismatches += Element[k] != GetReferenceComponent(View.Data + i * Stride + k * Size, ComponentType, bNormalized);
+						if (Components < 4)
+							Mismatches += Element[Components] != -2.f;
+					}
+					if (!bSupported || Mismatches)
+					{
+						RD_CORE_ERROR("Accessor decoding: {} mismatches gathering {} x {} component type {}{} with stride {}",
+							Mismatches, Count, Components, ComponentType, bNormalized ? " normalized" : "", Stride);
+						++Failures;
+					}
+				}
+			}
+		}
+	}
+
+	//sparse substitution on top of a gather, including targets past the end and an accessor without data
+	{
+		std::vector<float> Dst(Count * 3, 1.f);
+		const std::vector<uint32_t> Targets = { 0, 7, 1002, 5000 };
+		const float Values[] = { 10.f, 11.f, 12.f, 20.f, 21.f, 22.f, 30.f, 31.f, 32.f, 40.f, 41.f, 42.f };
+		AccessorView View{ reinterpret_cast<const uint8_t*>(Values), Targets.size(), 3 * sizeof(float), ComponentFloat, 3, false };
+		ScatterAttribute(View, Targets.data(), Dst.data(), 3 * sizeof(float), 3, Count);
+		const bool bAttributes = Dst[0] == 10.f && Dst[7 * 3 + 1] == 21.f && Dst[1002 * 3 + 2] == 32.f && Dst[3] == 1.f;
+		std::vector<float> Zeros(Count * 3, 1.f);
+		ScatterAttribute({ nullptr, 2, 0, ComponentFloat, 3, false }, Targets.data(), Zeros.data(), 3 * sizeof(float), 3, Count);
+		const bool bZeros = Zeros[0] == 0.f && Zeros[7 * 3] == 0.f && Zeros[3] == 1.f;
+		std::vector<uint32_t> Indices(Count, 1);
+		const uint16_t IndexValues[] = { 100, 200, 300, 400 };
+		ScatterIndices({ reinterpret_cast<const uint8_t*>(IndexValues), Targets.size(), sizeof(uint16_t), ComponentUnsignedShort, 1, false }, Targets.data(), Indices.data(), Count);
+		const bool bIndices = Indices[0] == 100 && Indices[7] == 200 && Indices[1002] == 300 && Indices[1] == 1;
+		if (!bAttributes || !bZeros || !bIndices)
+		{
+			RD_CORE_ERROR("Accessor decoding: sparse substitution is wrong, attributes {}, zeros {}, indices {}", bAttributes, bZeros, bIndices);
+			++Failures;
+		}
+	}
+
+	if (Failures)
+		RD_CORE_ERROR("Accessor decoding: {} checks failed", Failures);
+	else
+		RD_CORE_INFO("Accessor decoding: all component types match the reference");
+	return Failures == 0;
+}
+
+void BenchmarkAccessorDecoding()
+{
+	RD_SCOPE(Load, Benchmark Accessor Decoding);
+	//about the size of the largest sample meshes
+	constexpr size_t VertexCount = 1 << 20;
+	constexpr size_t IndexCount = VertexCount * 6;
+	constexpr uint32_t RunCount = 5;
+	auto Time = [](auto&& method) {
+		double Best = std::numeric_limits<double>::max();
+		for (uint32_t Run = 0; Run < RunCount; ++Run)
+		{
+			auto Start = std::chrono::high_resolution_clock::now();
+			method();
+			std::chrono::duration<double> Duration = std::chrono::high_resolution_clock::now() - Start;
+			Best = std::min(Best, Duration.count());
+		}
+		return Best;
+	};
+	constexpr double GB = 1024.0 * 1024.0 * 1024.0;
+	std::vector<uint8_t> Source;
+
+	std::vector<uint32_t> Indices(IndexCount);
+	for (int ComponentType : { ComponentUnsignedByte, ComponentUnsignedShort, ComponentUnsignedInt })
+	{
+		const uint32_t Size = GetComponentSize(ComponentType);
+		FillSource(Source, 0, IndexCount * Size, ComponentType, ComponentType);
+		AccessorView View{ Source.data(), IndexCount, Size, ComponentType, 1, false };
+		const double Kernel = Time([&]() { WidenIndices(View, Indices.data()); });
+		const double Reference = Time([&]() {
+			for (size_t i = 0; i < IndexCount; ++i)
+				Indices[i] = GetReferenceIndex(View.Data + i * GetComponentSize(ComponentType), ComponentType);
+		});
+		//written bytes, the same for every source type
+		const double Bytes = IndexCount * sizeof(uint32_t) / GB;
+		RD_CORE_INFO("Accessor decoding: {}M indices of component type {}, {:.2f}GB/s, per element switch {:.2f}GB/s",
+			IndexCount >> 20, ComponentType, Bytes / Kernel, Bytes / Reference);
+	}
+
+	//the attributes a typical mesh has, gathered into the Vertex layout
+	struct AttributeCase
+	{
+		const char* Name;
+		int ComponentType;
+		uint32_t Components;
+		bool bNormalized;
+	};
+	constexpr AttributeCase Cases[] = {
+		{ "float3 position", ComponentFloat, 3, false },
+		{ "float4 tangent", ComponentFloat, 4, false },
+		{ "snorm8 normal", ComponentByte, 3, true },
+		{ "unorm16 texcoord", ComponentUnsignedShort, 2, true },
+		{ "int16 position", ComponentShort, 3, false },
+	};
+	std::vector<Vertex> Vertices(VertexCount);
+	for (const AttributeCase& Case : Cases)
+	{
+		const uint32_t Size = GetComponentSize(Case.ComponentType);
+		const size_t Stride = (Case.Components * Size + 3) & ~size_t(3);
+		FillSource(Source, 0, VertexCount * Stride, Case.ComponentType, Case.ComponentType);
+		AccessorView View{ Source.data(), VertexCount, Stride, Case.ComponentType, Case.Components, Case.bNormalized };
+		float* Dst = &Vertices[0].tangent.x;
+		const double Kernel = Time([&]() { GatherAttribute(View, Dst, sizeof(Vertex), Case.Components); });
+		const double Reference = Time([&]() {
+			for (size_t i = 0; i < VertexCount; ++i)
+			{
+				float* Element = reinterpret_cast<float*>(reinterpret_cast<uint8_t*>(Dst) + i * sizeof(Vertex));
+				for (uint32_t k = 0; k < Case.Components; ++k)
+					Element[k] = GetReferenceComponent(View.Data + i * Stride + k * GetComponentSize(Case.ComponentType), Case.ComponentType, Case.bNormalized);
+			}
+		});
+		const double Bytes = VertexCount * Case.Components * sizeof(float) / GB;
+		RD_CORE_INFO("Accessor decoding: {}M {}, {:.2f}GB/s, per element switch {:.2f}GB/s", VertexCount >> 20, Case.Name, Bytes / Kernel, Bytes / Reference);
+	}
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+//a strided run of gltf accessor elements, component types are the gltf ones (5120 byte to 5126 float)
+//data can be unaligned, null data reads as zeros which is what an accessor without a buffer view holds
+struct AccessorView
+{
+	const uint8_t* Data{};
+	size_t Count{};
+	size_t Stride{};
+	int ComponentType{};
+	uint32_t ComponentCount{};
+	bool bNormalized{};
+};
+
+//widens u8, u16 and u32 indices to u32, returns false for any other component type
+bool WidenIndices(const AccessorView& view, uint32_t* dst);
+//converts the first dstComponents components of every element to float, the rest of every dst element is left alone
+//normalized integers map to [0, 1] or [-1, 1], the others are converted as they are which is what KHR_mesh_quantization wants
+//returns false for component types gltf does not allow on attributes
+bool GatherAttribute(const AccessorView& view, float* dst, size_t dstStride, uint32_t dstComponents);
+//sparse substitution, element i of values replaces element targets[i] of dst, targets past dstCount are skipped
+bool ScatterIndices(const AccessorView& values, const uint32_t* targets, uint32_t* dst, size_t dstCount);
+bool ScatterAttribute(const AccessorView& values, const uint32_t* targets, float* dst, size_t dstStride, uint32_t dstComponents, size_t dstCount);
+
+//checks every kernel against a plain per element conversion for each component type, normalization and stride, returns false on any mismatch
+bool VerifyAccessorDecoding();
+//logs the GB/s of the index widening and attribute gathers on synthetic buffers the size of a large mesh
+void BenchmarkAccessorDecoding();
@@ -49,7 +49,14 @@ ________________________________________________________________________________
 
 #include "DirectXDevice.h"
 #include "GLTFLoader.h"
+#include "VertexPacking.h"
+#include "ClusterLod.h"
+#include "MeshletBounds.h"
+#include "TangentSpace.h"
+#include "TextureStreamer.h"
+#include "Executor.h"
 #include "NVSDK.h"
+#include <Psapi.h>
 
 MICROPROFILE_DEFINE(MAIN, "MAIN", "Main", MP_AUTO);
 
@@ -58,8 +65,48 @@ MICROPROFILE_DEFINE(MAIN, "MAIN", "Main", MP_AUTO);
 #include "Components/TransformComp.h"
 #include "AssetManager.h"
 
+namespace
+{
+	//checks that need the loaded scene, the headless ones are dispatched by the entry point
+	struct SceneCheck
+	{
+		const char* Name;
+		bool bVerifies;
+		bool bTimes;
+	};
+	constexpr SceneCheck SceneChecks[] = {
+		{ "load", false, true },
+		{ "meshDecode", true, false },
+		{ "vertexPacking", true, true },
+		{ "clusterLod", true, false },
+		{ "meshletBounds", true, true },
+		{ "tangents", true, true },
+	};
+}
+
 namespace ragdoll
 {
+	bool Application::HasSceneCheck(const std::string& name, bool bBenchmark)
+	{
+		for (const SceneCheck& Check : SceneChecks)
+		{
+			if (name == Check.Name)
+				return bBenchmark ? Check.bTimes : Check.bVerifies;
+		}
+		return false;
+	}
+
+	std::string Application::GetSceneCheckNames(bool bBenchmark)
+	{
+		std::string Names;
+		for (const SceneCheck& Check : SceneChecks)
+		{
+			if (bBenchmark ? Check.bTimes : Check.bVerifies)
+				Names += std::string(Names.empty() ? "" : ", ") + Check.Name;
+		}
+		return Names;
+	}
+
 	void Application::Init(const ApplicationConfig& config)
 	{
 		Config = config;
@@ -99,7 +146,12 @@ namespace ragdoll
 				MICROPROFILE_SCOPEI("App", "Filemanager Init", MP_AUTO);
 				//create the file manager
 				m_FileManager = std::make_shared<FileManager>();
-				m_FileManager->Init();
+				FileManager::Settings fileSettings;
+				fileSettings.m_WorkerCount = Config.IOWorkerCount;
+				fileSettings.m_Backend = Config.bStreamIO ? IOBackend::Type::Stream : IOBackend::NativeType;
+				m_FileManager->Init(fileSettings);
+				if (!Config.ArchivePath.empty() && !m_FileManager->Mount(Config.ArchivePath))
+					RD_CORE_WARN("Unable to mount {}, reading loose files", Config.ArchivePath);
 			}
 			{
 				MICROPROFILE_SCOPEI("App", "D3D12 Device creation", MP_AUTO);
@@ -124,7 +176,19 @@ namespace ragdoll
 			MicroProfileGpuInitD3D12(device->m_Device12, 1, (void**)&queues);
 			MicroProfileSetCurrentNodeD3D12(0);
 
+			AssetManager::GetInstance()->bQuantizedVertices = Config.bQuantizedVertices;
 			AssetManager::GetInstance()->Init(m_FileManager);
+			//the pipelines compile on the executor while the scene loads, the first frame waits for them below
+			if (Config.bUsePipelineManifest && AssetManager::GetInstance()->Manifest.Load(m_FileManager->GetRoot() / "cache" / "pipelines.rdpso"))
+				AssetManager::GetInstance()->Manifest.BeginReplay(SExecutor::Executor);
+			TextureStreamer::Settings StreamSettings;
+			StreamSettings.GpuBudgetBytes = size_t(Config.TextureBudgetMB) << 20;
+			StreamSettings.CpuBudgetBytes = size_t(Config.TextureCpuBudgetMB) << 20;
+			StreamSettings.bCompress = Config.bCompressTextures;
+			StreamSettings.Quality = Config.bFastTextureCompression ? TextureEncodeQuality::Fast : TextureEncodeQuality::High;
+			if (Config.bUseTextureCache)
+				StreamSettings.CacheRoot = m_FileManager->GetRoot() / "cache" / "textures";
+			TextureStreamer::GetInstance()->Init(StreamSettings);
 
 			m_Scene = std::make_shared<Scene>(this);
 		}
@@ -132,8 +196,21 @@ namespace ragdoll
 
 		{
 			MICROPROFILE_SCOPEI("App", "Load", MP_AUTO);
+			auto LoadStart = std::chrono::high_resolution_clock::now();
 			GLTFLoader loader;
 			loader.Init(m_FileManager->GetRoot(), m_FileManager, m_EntityManager, m_Scene);
+			loader.bUseMappedFiles = !Config.bLegacyGLTFLoad;
+			loader.bVerifyMeshDecode = Config.CheckName == "meshDecode";
+			//stats only exist when the meshes actually go through the import
+			loader.bUseMeshCache = Config.bUseMeshCache && !Config.bMeshImportStats;
+			if (!Config.bOptimizeMeshes)
+			{
+				loader.ImportSettings.bRemap = false;
+				loader.ImportSettings.bOptimizeVertexCache = false;
+				loader.ImportSettings.bOptimizeOverdraw = false;
+				loader.ImportSettings.bOptimizeVertexFetch = false;
+			}
+			loader.ImportSettings.LodCount = Config.LodCount;
 			if (!Config.glTfSampleSceneToLoad.empty())
 			{
 				std::string sceneName = Config.glTfSampleSceneToLoad;
@@ -145,6 +222,71 @@ namespace ragdoll
 			{
 				loader.LoadAndCreateModel(Config.glTfSceneToLoad);
 			}
+			//the first frame only waits for the mip tails, finer mips keep streaming in while it runs
+			{
+				auto TailStart = std::chrono::high_resolution_clock::now();
+				bool bTails = TextureStreamer::GetInstance()->WaitForTails(Config.FirstFrameTextureMs);
+				std::chrono::duration<double, std::milli> TailTime = std::chrono::high_resolution_clock::now() - TailStart;
+				if (bTails)
+					RD_CORE_INFO("Texture mip tails resident in {:.2f}ms", TailTime.count());
+				else
+					RD_CORE_WARN("Texture mip tails not resident after {:.2f}ms, starting with default textures", TailTime.count());
+			}
+			//the import already logged everything
+			if (Config.bMeshImportStats)
+				m_Running = false;
+			if (!Config.CheckName.empty())
+			{
+				bool bPassed = true;
+				if (Config.CheckName == "load")
+				{
+					std::chrono::duration<double, std::milli> LoadTime = std::chrono::high_resolution_clock::now() - LoadStart;
+					PROCESS_MEMORY_COUNTERS Counters{};
+					GetProcessMemoryInfo(GetCurrentProcess(), &Counters, sizeof(Counters));
+					RD_CORE_INFO("Load benchmark ({} path, {}): {:.2f}ms, peak working set {:.2f}MB",
+						Config.bLegacyGLTFLoad ? "legacy" : "mapped", loader.bMeshCacheHit ? "warm mesh cache" : "cold mesh cache",
+						LoadTime.count(), Counters.PeakWorkingSetSize / (1024.0 * 1024.0));
+					//only there for EXT_meshopt_compression models that went through the decode, a warm mesh cache skips it
+					if (loader.CompressionStats.BufferViews > 0)
+						RD_CORE_INFO("Load benchmark meshopt: {} buffer views, {:.2f}MB on disk for {:.2f}MB decoded ({:.1f}% smaller), {:.2f}ms, {:.2f}GB/s",
+							loader.CompressionStats.BufferViews, loader.CompressionStats.CompressedBytes / (1024.0 * 1024.0), loader.CompressionStats.DecodedBytes / (1024.0 * 1024.0),
+							100.0 * (1.0 - double(loader.CompressionStats.CompressedBytes) / std::max<size_t>(loader.CompressionStats.DecodedBytes, 1)),
+							loader.CompressionStats.DecodeMs, loader.CompressionStats.DecodedBytes / (loader.CompressionStats.DecodeMs * 1e6));
+					auto SettleStart = std::chrono::high_resolution_clock::now();
+					TextureStreamer::GetInstance()->WaitForSettled();
+					std::chrono::duration<double, std::milli> SettleTime = std::chrono::high_resolution_clock::now() - SettleStart;
+					const TextureStreamer::Stats& StreamStats = TextureStreamer::GetInstance()->GetStats();
+					const TextureResidencyScheduler& Residency = TextureStreamer::GetInstance()->GetScheduler();
+					RD_CORE_INFO("Load benchmark textures: settled {:.2f}ms after the first frame, {:.2f}MB resident, {:.2f}MB uploaded, {} decodes ({} again, {} failed), peak cpu {:.2f}MB, {} evictions, {} rebinds",
+						SettleTime.count(), Residency.GetResidentBytes() / (1024.0 * 1024.0), StreamStats.UploadedBytes / (1024.0 * 1024.0),
+						StreamStats.Decodes, StreamStats.Redecodes, StreamStats.FailedDecodes, StreamStats.PeakCpuBytes / (1024.0 * 1024.0),
+						Residency.GetStats().Evictions, StreamStats.Rebinds);
+					if (StreamStats.Compressed > 0 || StreamStats.CacheHits > 0)
+						RD_CORE_INFO("Load benchmark texture compression: {} images compressed in {:.2f}ms, {} from the texture cache",
+							StreamStats.Compressed, StreamStats.CompressMs, StreamStats.CacheHits);
+				}
+				else if (Config.CheckName == "meshDecode")
+					bPassed = loader.bVerifyPassed;
+				else if (Config.CheckName == "vertexPacking")
+					bPassed = BenchmarkVertexPacking(AssetManager::GetInstance()->Vertices, AssetManager::GetInstance()->VertexBufferInfos);
+				else if (Config.CheckName == "clusterLod")
+				{
+					std::vector<ClusterDag> ClusterDags;
+					BuildClusterDags(*AssetManager::GetInstance(), ClusterDags);
+					bPassed = VerifyClusterDags(*AssetManager::GetInstance(), ClusterDags);
+				}
+				else if (Config.CheckName == "meshletBounds")
+					bPassed = BenchmarkMeshletBounds(*AssetManager::GetInstance());
+				else if (Config.CheckName == "tangents")
+				{
+					bPassed = VerifyTangents();
+					if (bPassed && Config.bRunBenchmark)
+						BenchmarkTangents(*AssetManager::GetInstance());
+				}
+				m_ExitCode = bPassed ? 0 : 1;
+				//only care about the check, do not enter the main loop
+				m_Running = false;
+			}
 		}
 
 		//scenes are always static now so update the gpu scene instance buffer once
@@ -153,6 +295,16 @@ namespace ragdoll
 		m_Scene->GPUScene->UpdateBuffers(m_Scene.get());
 		m_Scene->GPUScene->CreateLightGrid(m_Scene.get());
 		m_Scene->ResetTransformDirtyFlags();
+
+		{
+			MICROPROFILE_SCOPEI("App", "Pipeline Warmup", MP_AUTO);
+			auto WaitStart = std::chrono::high_resolution_clock::now();
+			const PipelineManifest::ReplayStats Stats = AssetManager::GetInstance()->Manifest.WaitForReplay();
+			std::chrono::duration<double, std::milli> WaitTime = std::chrono::high_resolution_clock::now() - WaitStart;
+			if (Stats.Entries > 0)
+				RD_CORE_INFO("Pipeline warmup: {} of {} pipelines and binding layouts created in {:.2f}ms next to the load, {} stale, the first frame waited {:.2f}ms for them",
+					Stats.Replayed, Stats.Entries, Stats.Ms, Stats.Stale, WaitTime.count());
+		}
 	}
 
 	void Application::Run()
@@ -164,6 +316,7 @@ namespace ragdoll
 				MICROPROFILE_SCOPE(MAIN);
 				//m_InputHandler->Update(m_PrimaryWindow->GetDeltaTime());
 				m_FileManager->Update();
+				TextureStreamer::GetInstance()->Update();
 				{
 					MICROPROFILE_SCOPEI("Update", "Wait", MP_YELLOW);
 					while (m_Frametime < m_TargetFrametime) {
@@ -191,6 +344,9 @@ namespace ragdoll
 
 	void Application::Shutdown()
 	{
+		if (Config.bUsePipelineManifest)
+			AssetManager::GetInstance()->Manifest.Save(m_FileManager->GetRoot() / "cache" / "pipelines.rdpso");
+		TextureStreamer::Release();
 		AssetManager::GetInstance()->Release();
 		m_Scene->Shutdown();
 		DirectXDevice::GetInstance()->Release();
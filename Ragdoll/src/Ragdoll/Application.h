@@ -61,6 +61,30 @@ namespace ragdoll
 			bool bCreateCustomMeshes{ false };
 			bool bDrawDebugBoundingBoxes{ false };
 			bool bInitDLSS{ false };
+			bool bLegacyGLTFLoad{ false };
+			//scene check run after the load by --verify/--bench, the application exits with its result instead of entering the main loop
+			std::string CheckName;
+			//also time the check once it passes
+			bool bRunBenchmark{ false };
+			bool bUseMeshCache{ true };
+			bool bQuantizedVertices{ false };
+			bool bOptimizeMeshes{ true };
+			bool bMeshImportStats{ false };
+			uint32_t LodCount{ 3 };
+			uint32_t TextureBudgetMB{ 1024 };
+			uint32_t TextureCpuBudgetMB{ 512 };
+			//how long the first frame waits for the texture mip tails
+			double FirstFrameTextureMs{ 2000.0 };
+			bool bCompressTextures{ true };
+			bool bFastTextureCompression{ false };
+			bool bUseTextureCache{ true };
+			//threads of the file manager blocking on reads
+			uint32_t IOWorkerCount{ 4 };
+			bool bStreamIO{ false };
+			//packed asset archive mounted over the root, relative to the root or absolute, empty reads loose files only
+			std::string ArchivePath;
+			//create the pipelines of the last run during the load and record this run's for the next one
+			bool bUsePipelineManifest{ true };
 		};
 
 		std::shared_ptr<Window> m_PrimaryWindow;
@@ -76,6 +100,11 @@ namespace ragdoll
 		virtual void Init(const ApplicationConfig& config);
 		void Run();
 		virtual void Shutdown();
+		//0 unless a scene check failed
+		int GetExitCode() const { return m_ExitCode; }
+		//whether the named check needs the loaded scene, and has a check or a benchmark for the mode it was asked for
+		static bool HasSceneCheck(const std::string& name, bool bBenchmark);
+		static std::string GetSceneCheckNames(bool bBenchmark);
 
 		void OnEvent(Event& event);
 
@@ -94,6 +123,7 @@ namespace ragdoll
 
 	protected:
 		bool m_Running{ true };
+		int m_ExitCode{ 0 };
 
 		GuidGenerator m_GuidGenerator{};
 
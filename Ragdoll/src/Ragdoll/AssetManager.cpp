@@ -5,6 +5,9 @@
 
 #include "AssetManager.h"
 #include "DirectXDevice.h"
+#include "Executor.h"
+#include "MeshletBounds.h"
+#include "VertexPacking.h"
 #include "stb_image.h"
 
 AssetManager* AssetManager::GetInstance()
@@ -23,152 +26,43 @@ size_t AssetManager::AddImage(Image img)
 	return Images.size() - 1;
 }
 
-size_t HashString(const std::string& str) {
-	return hash(std::make_pair(str.c_str(), str.length()));
-}
-
-size_t Hash(const nvrhi::GraphicsPipelineDesc& desc) {
-	struct GraphicsPipelineAbstraction
-	{
-		//5 shaders debug name hashes
-		size_t VSHash{}, HSHash{}, DSHash{}, GSHash{}, PSHash{};
-		//hash the states
-		size_t RenderStateHash{};
-		size_t PrimTypeHash{};
-		size_t ShadingRateStateHash{};
-		//hash the bindings
-		size_t BindingsHash[nvrhi::c_MaxBindingLayouts]{ {}, };
-		//no need for the input layout as everyone uses the same due to the instance pass
-	}obj;
-	//hashing all the shaders debug name
-	if (desc.VS)
-		obj.VSHash = HashString(desc.VS->getDesc().debugName);
-	if (desc.HS)
-		obj.HSHash = HashString(desc.HS->getDesc().debugName);
-	if (desc.DS)
-		obj.DSHash = HashString(desc.DS->getDesc().debugName);
-	if (desc.GS)
-		obj.GSHash = HashString(desc.GS->getDesc().debugName);
-	if (desc.PS)
-		obj.PSHash = HashString(desc.PS->getDesc().debugName);
-	//hash the states
-	obj.RenderStateHash = HashBytes(&desc.renderState);
-	obj.PrimTypeHash = HashBytes(&desc.primType);
-	obj.ShadingRateStateHash = HashBytes(&desc.shadingRateState);
-	//hash the bindings
-	for (int i = 0; i < nvrhi::c_MaxBindingLayouts; ++i) {
-		obj.BindingsHash[i] = HashBytes(&desc.bindingLayouts);
-	}
-	return HashBytes(&obj);
-}
-
-size_t Hash(const nvrhi::ComputePipelineDesc& desc) {
-	struct ComputePipelineAbstraction {
-		//shader
-		size_t CSHash{};
-		//binding hash
-		size_t BindingsHash[nvrhi::c_MaxBindingLayouts]{ {}, };
-	}obj;
-	if (desc.CS)
-		obj.CSHash = HashString(desc.CS->getDesc().debugName);
-	for (int i = 0; i < nvrhi::c_MaxBindingLayouts; ++i) {
-		obj.BindingsHash[i] = HashBytes(&desc.bindingLayouts);
-	}
-	return HashBytes(&obj);
-}
-
-size_t Hash(const nvrhi::rt::PipelineDesc& desc) {
-	struct RaytracePipelineAbstraction {
-		//shader
-		size_t ShaderHashes[16];
-		//binding hash
-		size_t BindingsHash[nvrhi::c_MaxBindingLayouts]{ {}, };
-		//values
-		uint32_t MaxPayloadSize;
-		uint32_t MaxAttributeSize; // typical case: float2 uv;
-		uint32_t MaxRecursionDepth;
-	}obj;
-	RD_ASSERT(desc.shaders.size() > 16, "Exceed max number of shaders in a rt pipeline, consider increase size");
-	for (int i = 0; i < desc.shaders.size(); ++i) {
-		obj.ShaderHashes[i] = HashString(desc.shaders[i].exportName);
-	}
-	for (int i = 0; i < nvrhi::c_MaxBindingLayouts; ++i) {
-		obj.BindingsHash[i] = HashBytes(&desc.globalBindingLayouts);
-	}
-	obj.MaxPayloadSize = HashBytes(&desc.maxPayloadSize);
-	obj.MaxAttributeSize = HashBytes(&desc.maxAttributeSize);
-	obj.MaxRecursionDepth = HashBytes(&desc.maxRecursionDepth);
-	return HashBytes(&obj);
-}
-
-size_t Hash(const nvrhi::MeshletPipelineDesc& desc) {
-	struct MeshletPipelineAbstraction {
-		size_t ASHash{};
-		size_t MSHash{};
-		size_t PSHash{};
-
-		size_t RenderStateHash{};
-		size_t PrimTypeHash{};
-		size_t BindingsHash[nvrhi::c_MaxBindingLayouts]{ {}, };
-	}obj;
-	if (desc.AS)
-		obj.ASHash = HashString(desc.AS->getDesc().debugName);
-	if (desc.MS)
-		obj.MSHash = HashString(desc.MS->getDesc().debugName);
-	if (desc.PS)
-		obj.PSHash = HashString(desc.PS->getDesc().debugName);
-	obj.RenderStateHash = HashBytes(&desc.renderState);
-	obj.PrimTypeHash = HashBytes(&desc.primType);
-	for (int i = 0; i < nvrhi::c_MaxBindingLayouts; ++i) {
-		obj.BindingsHash[i] = HashBytes(&desc.bindingLayouts);
-	}
-	return HashBytes(&obj);
-}
-
 nvrhi::GraphicsPipelineHandle AssetManager::GetGraphicsPipeline(const nvrhi::GraphicsPipelineDesc& desc, const nvrhi::FramebufferHandle& fb)
 {
-	std::lock_guard<std::mutex> LockGuard(Mutex);
-	size_t hash = Hash(desc);
-	if (GPSOs.contains(hash))
-		return GPSOs.at(hash);
-	RD_CORE_INFO("GPSO created");
-	return GPSOs[hash] = DirectXDevice::GetNativeDevice()->createGraphicsPipeline(desc, fb);
+	//nvrhi locks its root signature cache, different pipelines compile in parallel
+	const GraphicsPipelineLookup Lookup = MakePipelineLookup(desc, fb->getFramebufferInfo(), ShaderHashes);
+	return GPSOs.Get(Lookup, [&]() {
+		Manifest.Record(Lookup);
+		RD_CORE_INFO("GPSO created");
+		return DirectXDevice::GetNativeDevice()->createGraphicsPipeline(desc, fb);
+	});
 }
 
 nvrhi::ComputePipelineHandle AssetManager::GetComputePipeline(const nvrhi::ComputePipelineDesc& desc)
 {
-	size_t hash = Hash(desc);
-	if (CPSOs.contains(hash))
-		return CPSOs.at(hash);
-	{
-		std::lock_guard<std::mutex> LockGuard(Mutex);
+	const ComputePipelineLookup Lookup = MakePipelineLookup(desc, ShaderHashes);
+	return CPSOs.Get(Lookup, [&]() {
+		Manifest.Record(Lookup);
 		RD_CORE_INFO("CPSO created");
-		return CPSOs[hash] = DirectXDevice::GetNativeDevice()->createComputePipeline(desc);
-	}
+		return DirectXDevice::GetNativeDevice()->createComputePipeline(desc);
+	});
 }
 
 nvrhi::rt::PipelineHandle AssetManager::GetRaytracePipeline(const nvrhi::rt::PipelineDesc& desc)
 {
-	size_t hash = Hash(desc);
-	if (RTSOs.contains(hash))
-		return RTSOs.at(hash);
-	{
-		std::lock_guard<std::mutex> LockGuard(Mutex);
+	return RTSOs.Get(MakePipelineLookup(desc, ShaderHashes), [&]() {
 		RD_CORE_INFO("RTSO created");
-		return RTSOs[hash] = DirectXDevice::GetNativeDevice()->createRayTracingPipeline(desc);
-	}
+		return DirectXDevice::GetNativeDevice()->createRayTracingPipeline(desc);
+	});
 }
 
 nvrhi::MeshletPipelineHandle AssetManager::GetMeshletPipeline(const nvrhi::MeshletPipelineDesc& desc, const nvrhi::FramebufferHandle& fb)
 {
-	size_t hash = Hash(desc);
-	if (MPSOs.contains(hash))
-		return MPSOs.at(hash);
-	{
-		std::lock_guard<std::mutex> LockGuard(Mutex);
+	const MeshletPipelineLookup Lookup = MakePipelineLookup(desc, fb->getFramebufferInfo(), ShaderHashes);
+	return MPSOs.Get(Lookup, [&]() {
+		Manifest.Record(Lookup);
 		RD_CORE_INFO("MPSO created");
-		return MPSOs[hash] = DirectXDevice::GetNativeDevice()->createMeshletPipeline(desc, fb);
-	}
+		return DirectXDevice::GetNativeDevice()->createMeshletPipeline(desc, fb);
+	});
 }
 
 nvrhi::BindingLayoutHandle AssetManager::GetBindingLayout(const nvrhi::BindingSetDesc& desc)
@@ -189,25 +83,102 @@ nvrhi::BindingLayoutHandle AssetManager::GetBindingLayout(const nvrhi::BindingSe
 	nvrhi::BindingLayoutDesc layoutDesc;
 	layoutDesc.visibility = nvrhi::ShaderType::All;
 	ConvertSetToLayout(desc.bindings, layoutDesc.bindings);
-	size_t hash = HashBytes(&layoutDesc);
-	if (BindingLayouts.contains(hash))
-		return BindingLayouts.at(hash);
-	{
-		std::lock_guard<std::mutex> LockGuard(Mutex);
+	return GetBindingLayout(layoutDesc);
+}
+
+nvrhi::BindingLayoutHandle AssetManager::GetBindingLayout(const nvrhi::BindingLayoutDesc& layoutDesc)
+{
+	const BindingLayoutLookup Lookup = MakeBindingLayoutLookup(layoutDesc);
+	return BindingLayouts.Get(Lookup, [&]() {
+		Manifest.Record(Lookup);
 		RD_CORE_INFO("Binding Layout created");
-		return BindingLayouts[hash] = DirectXDevice::GetNativeDevice()->createBindingLayout(layoutDesc);
+		return DirectXDevice::GetNativeDevice()->createBindingLayout(layoutDesc);
+	});
+}
+
+nvrhi::FramebufferHandle AssetManager::CreateFormatFramebuffer(const nvrhi::FramebufferInfo& info)
+{
+	nvrhi::DeviceHandle Device = DirectXDevice::GetNativeDevice();
+	nvrhi::TextureDesc TexDesc;
+	TexDesc.width = 1;
+	TexDesc.height = 1;
+	TexDesc.sampleCount = info.sampleCount;
+	TexDesc.sampleQuality = info.sampleQuality;
+	TexDesc.dimension = info.sampleCount > 1 ? nvrhi::TextureDimension::Texture2DMS : nvrhi::TextureDimension::Texture2D;
+	TexDesc.isRenderTarget = true;
+	TexDesc.keepInitialState = true;
+	TexDesc.debugName = "Pipeline warmup target";
+	nvrhi::FramebufferDesc FramebufferDesc;
+	//the desc only points at the textures, the framebuffer holds on to them once it is created
+	std::vector<nvrhi::TextureHandle> Textures;
+	for (nvrhi::Format Format : info.colorFormats)
+	{
+		TexDesc.format = Format;
+		TexDesc.initialState = nvrhi::ResourceStates::RenderTarget;
+		FramebufferDesc.addColorAttachment(Textures.emplace_back(Device->createTexture(TexDesc)));
+	}
+	if (info.depthFormat != nvrhi::Format::UNKNOWN)
+	{
+		TexDesc.format = info.depthFormat;
+		TexDesc.initialState = nvrhi::ResourceStates::DepthWrite;
+		FramebufferDesc.setDepthAttachment(Textures.emplace_back(Device->createTexture(TexDesc)));
 	}
+	return Device->createFramebuffer(FramebufferDesc);
 }
 
 void AssetManager::RecompileShaders()
 {
-	std::filesystem::path Path = "\"" + (FileManagerRef->GetRoot().parent_path() / "Tools\\compileShader.bat\" < NUL").string();
-	system(("call " + Path.string()).c_str());
-	Shaders.clear();
-	ShaderLibraries.clear();
-	GPSOs.clear();
-	CPSOs.clear();
-	RTSOs.clear();
+	RD_SCOPE(Asset, RecompileShaders);
+	if (!Dxc)
+		Dxc = ShaderCompiler::CreateDxc();
+	if (!Dxc)
+	{
+		RD_CORE_ERROR("dxcompiler could not be loaded, shaders are not rebuilt");
+		return;
+	}
+	const std::filesystem::path Root = FileManagerRef->GetRoot();
+	ShaderBuild Build(Root / "shaders.cfg", Root / "cso", Root / "cache" / "shaders");
+	if (!Build.LoadConfig())
+		return;
+	const ShaderBuild::Result Result = Build.Build(*Dxc);
+	RD_CORE_INFO("Shaders rebuilt in {:.2f}ms, {} of {} compiled, {} from the store, {} failed, {} changed",
+		Result.TotalMs, Result.Compiled, Result.Permutations, Result.Reused, Result.Failed, Result.Changed.size());
+	if (Result.Changed.empty())
+		return;
+
+	const std::unordered_set<std::string> Changed(Result.Changed.begin(), Result.Changed.end());
+	auto IsChanged = [&Changed](nvrhi::IShader* shader) { return shader && Changed.contains(shader->getDesc().debugName); };
+	//only called between frames, the caches can only be touched while no pass is looking anything up
+	std::lock_guard<std::mutex> LockGuard(Mutex);
+	bool bLibraryChanged{ false };
+	for (const std::string& Name : Result.Changed)
+	{
+		Shaders.erase(Name);
+		bLibraryChanged |= ShaderLibraries.erase(Name) > 0;
+	}
+	ShaderHashes.EraseIf(IsChanged);
+	//the keys hold the old shaders so they could never match the new ones, this just lets the old pipelines go
+	GPSOs.EraseIf([&IsChanged](const GraphicsPipelineKey& key, const nvrhi::GraphicsPipelineHandle&) {
+		return IsChanged(key.Desc.VS) || IsChanged(key.Desc.HS) || IsChanged(key.Desc.DS) || IsChanged(key.Desc.GS) || IsChanged(key.Desc.PS);
+	});
+	CPSOs.EraseIf([&IsChanged](const ComputePipelineKey& key, const nvrhi::ComputePipelineHandle&) { return IsChanged(key.Desc.CS); });
+	MPSOs.EraseIf([&IsChanged](const MeshletPipelineKey& key, const nvrhi::MeshletPipelineHandle&) {
+		return IsChanged(key.Desc.AS) || IsChanged(key.Desc.MS) || IsChanged(key.Desc.PS);
+	});
+	//raytracing pipelines are made of library exports, which carry no file name, a rebuilt library drops all of them
+	if (bLibraryChanged)
+		RTSOs.Clear();
+}
+
+void AssetManager::RequestShaderReload()
+{
+	bShaderReloadRequested.store(true, std::memory_order_relaxed);
+}
+
+void AssetManager::ProcessShaderReload()
+{
+	if (bShaderReloadRequested.exchange(false, std::memory_order_relaxed))
+		RecompileShaders();
 }
 
 void AssetManager::Init(std::shared_ptr<ragdoll::FileManager> fm)
@@ -232,12 +203,25 @@ void AssetManager::Init(std::shared_ptr<ragdoll::FileManager> fm)
 	vTangentAttrib.name = "TANGENT";
 	vTangentAttrib.offset = offsetof(Vertex, tangent);
 	vTangentAttrib.elementStride = sizeof(Vertex);
-	vTangentAttrib.format = nvrhi::Format::RGB32_FLOAT;
+	vTangentAttrib.format = nvrhi::Format::RGBA32_FLOAT;
 	nvrhi::VertexAttributeDesc vTexcoordAttrib;
 	vTexcoordAttrib.name = "TEXCOORD";
 	vTexcoordAttrib.offset = offsetof(Vertex, texcoord);
 	vTexcoordAttrib.elementStride = sizeof(Vertex);
 	vTexcoordAttrib.format = nvrhi::Format::RG32_FLOAT;
+	if (bQuantizedVertices)
+	{
+		//same attributes out of the packed layout, the shaders decode the normals and rebuild the position from the mesh box
+		vPositionAttrib.offset = offsetof(PackedVertex, position);
+		vPositionAttrib.format = nvrhi::Format::RGBA16_UNORM;
+		vNormalAttrib.offset = offsetof(PackedVertex, normal);
+		vNormalAttrib.format = nvrhi::Format::RG16_SNORM;
+		vTangentAttrib.offset = offsetof(PackedVertex, tangent);
+		vTangentAttrib.format = nvrhi::Format::RG16_SNORM;
+		vTexcoordAttrib.offset = offsetof(PackedVertex, texcoord);
+		vTexcoordAttrib.format = nvrhi::Format::RG16_FLOAT;
+		vPositionAttrib.elementStride = vNormalAttrib.elementStride = vTangentAttrib.elementStride = vTexcoordAttrib.elementStride = sizeof(PackedVertex);
+	}
 	//second buffer for the vertex shader for instance id
 	nvrhi::VertexAttributeDesc InstanceIdAttrib;
 	InstanceIdAttrib.bufferIndex = 1;
@@ -291,23 +275,20 @@ void AssetManager::Init(std::shared_ptr<ragdoll::FileManager> fm)
 	for (int i = 0; i < 64; ++i)
 	{
 		RD_SCOPE(Load, Load File);
-		std::filesystem::path modelPath = FileManagerRef->GetRoot() / "bluenoise" / NoisePath;
+		std::filesystem::path modelPath = std::filesystem::path("bluenoise") / NoisePath;
 		modelPath += std::to_string(i) + ".png";
-		//load raw bytes, do not use stbi load
-		std::ifstream file(modelPath, std::ios::binary | std::ios::ate);
-		RD_ASSERT(!file, "Unable to open file {}:{}", strerror(errno), modelPath.string());
-		uint32_t size = static_cast<int32_t>(file.tellg());
-		file.seekg(0, std::ios::beg);
-		std::vector<uint8_t> data(size);
-		RD_ASSERT(!file.read((char*)data.data(), size), "Failed to read file {}", modelPath.string());
+		//load raw bytes through the file manager so a mounted archive can serve them, do not use stbi load
+		uint32_t size = 0;
+		const uint8_t* data = FileManagerRef->ImmediateLoad(modelPath, size);
+		RD_ASSERT(size == 0, "Unable to read file {}", modelPath.string());
 		//use stbi_info_from_memory to check header on info for how to load
 		int w = -1, h = -1, comp = -1, req_comp = 0;
-		RD_ASSERT(!stbi_info_from_memory(data.data(), size, &w, &h, &comp), "stb unable to read image {}", modelPath.string());
+		RD_ASSERT(!stbi_info_from_memory(data, size, &w, &h, &comp), "stb unable to read image {}", modelPath.string());
 		if (comp == 3)
 			req_comp = 4;
 		//dont support hdr images
 		//use stbi_load_from_memory to load the image data, set up all the desc with that info
-		uint8_t* raw = stbi_load_from_memory(data.data(), size, &w, &h, &comp, req_comp);
+		uint8_t* raw = stbi_load_from_memory(data, size, &w, &h, &comp, req_comp);
 		RD_ASSERT(!raw, "Issue loading {}", modelPath.string());
 
 		if (!BlueNoise2D)
@@ -426,6 +407,19 @@ void AssetManager::Init(std::shared_ptr<ragdoll::FileManager> fm)
 	//TODO: not sure why i am forced to resize
 	Device->resizeDescriptorTable(DescriptorTable, bindlessDesc.maxCapacity, true);
 
+	//the manifest brings pipelines back through the same lookups the passes use, so the replayed ones are the ones they find
+	PipelineManifest::Target ManifestTarget;
+	ManifestTarget.GetShader = [this](const std::string& name) { return GetShader(name); };
+	ManifestTarget.GetBindingLayout = [this](const nvrhi::BindingLayoutDesc& layoutDesc) { return GetBindingLayout(layoutDesc); };
+	ManifestTarget.GetFramebuffer = [this](const nvrhi::FramebufferInfo& info) { return CreateFormatFramebuffer(info); };
+	ManifestTarget.CreateGraphicsPipeline = [this](const nvrhi::GraphicsPipelineDesc& desc, const nvrhi::FramebufferHandle& fb) { GetGraphicsPipeline(desc, fb); };
+	ManifestTarget.CreateComputePipeline = [this](const nvrhi::ComputePipelineDesc& desc) { GetComputePipeline(desc); };
+	ManifestTarget.CreateMeshletPipeline = [this](const nvrhi::MeshletPipelineDesc& desc, const nvrhi::FramebufferHandle& fb) { GetMeshletPipeline(desc, fb); };
+	ManifestTarget.BindlessLayout = BindlessLayoutHandle;
+	ManifestTarget.InputLayout = InstancedInputLayoutHandle;
+	ManifestTarget.ShaderHashes = &ShaderHashes;
+	Manifest.Init(std::move(ManifestTarget));
+
 	CommandList->close();
 	Device->executeCommandList(CommandList);
 }
@@ -448,6 +442,49 @@ size_t AssetManager::AddVertices(const std::vector<Vertex>& newVertices, const s
 	return VertexBufferInfos.size() - 1;
 }
 
+size_t AssetManager::AddLod(size_t baseVertexBufferIndex, const std::vector<uint32_t>& newIndices, float error)
+{
+	uint32_t iCurrOffset = (uint32_t)Indices.size();
+	Indices.resize(Indices.size() + newIndices.size());
+	memcpy(Indices.data() + iCurrOffset, newIndices.data(), newIndices.size() * sizeof(uint32_t));
+	const size_t lodIndex = VertexBufferInfos.size();
+	VertexBufferInfo& base = VertexBufferInfos[baseVertexBufferIndex];
+	if (base.LodCount == 0)
+		base.FirstLodIndex = (uint32_t)lodIndex;
+	RD_ASSERT(base.FirstLodIndex + base.LodCount != lodIndex, "Lods of vertex buffer {} are not contiguous", baseVertexBufferIndex);
+	++base.LodCount;
+	//same vertices and bounds, only the index range and meshlets differ
+	VertexBufferInfo info;
+	info.VerticesOffset = base.VerticesOffset;
+	info.VerticesCount = base.VerticesCount;
+	info.IndicesOffset = iCurrOffset;
+	info.IndicesCount = (uint32_t)newIndices.size();
+	info.LodError = error;
+	info.BestFitBox = base.BestFitBox;
+	VertexBufferInfos.emplace_back(info);
+	return lodIndex;
+}
+
+//the global buffers are append only, grow them geometrically when the data no longer fits and otherwise only upload what was added
+void UploadGrowingBuffer(nvrhi::CommandListHandle commandList, nvrhi::BufferHandle& buffer, nvrhi::BufferDesc desc, const void* data, size_t byteSize, size_t& uploadedByteSize)
+{
+	if (byteSize == 0)
+		return;
+	if (!buffer || buffer->getDesc().byteSize < byteSize)
+	{
+		//new buffer, everything has to go up again
+		desc.byteSize = buffer ? std::max<size_t>(byteSize, buffer->getDesc().byteSize * 2) : byteSize;
+		buffer = DirectXDevice::GetInstance()->m_NvrhiDevice->createBuffer(desc);
+		uploadedByteSize = 0;
+	}
+	//the cpu side was cleared and refilled, nothing on the gpu can be trusted
+	if (byteSize < uploadedByteSize)
+		uploadedByteSize = 0;
+	if (byteSize > uploadedByteSize)
+		commandList->writeBuffer(buffer, static_cast<const uint8_t*>(data) + uploadedByteSize, byteSize - uploadedByteSize, uploadedByteSize);
+	uploadedByteSize = byteSize;
+}
+
 void AssetManager::UpdateMeshBuffers()
 {
 	CommandList->open();
@@ -457,220 +494,278 @@ void AssetManager::UpdateMeshBuffers()
 		//MICROPROFILE_SCOPEGPUI("Create VBO IBO", MP_LIGHTYELLOW1);
 		CommandList->beginMarker("Update global buffer");
 
+		//the buffers keep their resting state, nvrhi moves them to copy dest for the writes and back when the command list closes
 		nvrhi::BufferDesc vertexBufDesc;
-		vertexBufDesc.byteSize = Vertices.size() * sizeof(Vertex);	//the offset is already the size of the vb
 		vertexBufDesc.isVertexBuffer = true;
-		vertexBufDesc.structStride = sizeof(Vertex);
+		vertexBufDesc.structStride = bQuantizedVertices ? sizeof(PackedVertex) : sizeof(Vertex);
 		vertexBufDesc.debugName = "Global vertex buffer";
-		vertexBufDesc.initialState = nvrhi::ResourceStates::CopyDest;	//set as copy dest to copy over data
+		vertexBufDesc.initialState = nvrhi::ResourceStates::VertexBuffer | nvrhi::ResourceStates::AccelStructBuildInput | nvrhi::ResourceStates::ShaderResource;
+		vertexBufDesc.keepInitialState = true;
 		vertexBufDesc.canHaveRawViews = true;
 		vertexBufDesc.isAccelStructBuildInput = true;
-		//smth smth syncrhonization need to be this state to be written
-
-		VBO = DirectXDevice::GetInstance()->m_NvrhiDevice->createBuffer(vertexBufDesc);
-		//copy data over
-		CommandList->beginTrackingBufferState(VBO, nvrhi::ResourceStates::CopyDest);	//i tink this is to update nvrhi resource manager state tracker
-		CommandList->writeBuffer(VBO, Vertices.data(), vertexBufDesc.byteSize);
-		CommandList->setPermanentBufferState(VBO, nvrhi::ResourceStates::VertexBuffer | nvrhi::ResourceStates::AccelStructBuildInput | nvrhi::ResourceStates::ShaderResource);	//now its a vb
+		if (bQuantizedVertices)
+		{
+			UpdatePackedVertices();
+			UploadGrowingBuffer(CommandList, VBO, vertexBufDesc, PackedVertices.data(), PackedVertices.size() * sizeof(PackedVertex), UploadedBytes.Vertices);
+		}
+		else
+			UploadGrowingBuffer(CommandList, VBO, vertexBufDesc, Vertices.data(), Vertices.size() * sizeof(Vertex), UploadedBytes.Vertices);
 
 		nvrhi::BufferDesc indexBufDesc;
-		indexBufDesc.byteSize = Indices.size() * sizeof(uint32_t);
 		indexBufDesc.isIndexBuffer = true;
 		indexBufDesc.debugName = "Global index buffer";
-		indexBufDesc.initialState = nvrhi::ResourceStates::CopyDest;
+		indexBufDesc.initialState = nvrhi::ResourceStates::IndexBuffer | nvrhi::ResourceStates::AccelStructBuildInput | nvrhi::ResourceStates::ShaderResource;
+		indexBufDesc.keepInitialState = true;
 		indexBufDesc.canHaveRawViews = true;
 		indexBufDesc.isAccelStructBuildInput = true;
-
-		IBO = DirectXDevice::GetInstance()->m_NvrhiDevice->createBuffer(indexBufDesc);
-		CommandList->beginTrackingBufferState(IBO, nvrhi::ResourceStates::CopyDest);
-		CommandList->writeBuffer(IBO, Indices.data(), indexBufDesc.byteSize);
-		CommandList->setPermanentBufferState(IBO, nvrhi::ResourceStates::IndexBuffer | nvrhi::ResourceStates::AccelStructBuildInput | nvrhi::ResourceStates::ShaderResource);
+		UploadGrowingBuffer(CommandList, IBO, indexBufDesc, Indices.data(), Indices.size() * sizeof(uint32_t), UploadedBytes.Indices);
 
 		CommandList->endMarker();
 	}
 
 	{
 		nvrhi::BufferDesc meshletBufDesc;
-		meshletBufDesc.byteSize = Meshlets.size() * sizeof(meshopt_Meshlet);
 		meshletBufDesc.debugName = "Meshlet Buffer";
 		meshletBufDesc.canHaveTypedViews = true;
 		meshletBufDesc.structStride = sizeof(meshopt_Meshlet);
-		MeshletBuffer = DirectXDevice::GetInstance()->m_NvrhiDevice->createBuffer(meshletBufDesc);
-		CommandList->beginTrackingBufferState(MeshletBuffer, nvrhi::ResourceStates::CopyDest);
-		CommandList->writeBuffer(MeshletBuffer, Meshlets.data(), meshletBufDesc.byteSize);
-		CommandList->setPermanentBufferState(MeshletBuffer, nvrhi::ResourceStates::ShaderResource);
+		meshletBufDesc.initialState = nvrhi::ResourceStates::ShaderResource;
+		meshletBufDesc.keepInitialState = true;
+		UploadGrowingBuffer(CommandList, MeshletBuffer, meshletBufDesc, Meshlets.data(), Meshlets.size() * sizeof(meshopt_Meshlet), UploadedBytes.Meshlets);
 
 		nvrhi::BufferDesc meshletVertexBufDesc;
-		meshletVertexBufDesc.byteSize = MeshletVertices.size() * sizeof(uint32_t);
 		meshletVertexBufDesc.debugName = "Meshlet Vertex Buffer";
 		meshletVertexBufDesc.canHaveTypedViews = true;
 		meshletVertexBufDesc.structStride = sizeof(uint32_t);
-		MeshletVertexBuffer = DirectXDevice::GetInstance()->m_NvrhiDevice->createBuffer(meshletVertexBufDesc);
-		CommandList->beginTrackingBufferState(MeshletVertexBuffer, nvrhi::ResourceStates::CopyDest);
-		CommandList->writeBuffer(MeshletVertexBuffer, MeshletVertices.data(), meshletVertexBufDesc.byteSize);
-		CommandList->setPermanentBufferState(MeshletVertexBuffer, nvrhi::ResourceStates::ShaderResource);
+		meshletVertexBufDesc.initialState = nvrhi::ResourceStates::ShaderResource;
+		meshletVertexBufDesc.keepInitialState = true;
+		UploadGrowingBuffer(CommandList, MeshletVertexBuffer, meshletVertexBufDesc, MeshletVertices.data(), MeshletVertices.size() * sizeof(uint32_t), UploadedBytes.MeshletVertices);
 
 		nvrhi::BufferDesc meshletTriangleBufDesc;
-		meshletTriangleBufDesc.byteSize = MeshletTrianglesPacked.size() * sizeof(uint32_t);
 		meshletTriangleBufDesc.debugName = "Meshlet Triangle Buffer";
 		meshletTriangleBufDesc.canHaveTypedViews = true;
 		meshletTriangleBufDesc.structStride = sizeof(uint32_t);
-		MeshletPrimitiveBuffer = DirectXDevice::GetInstance()->m_NvrhiDevice->createBuffer(meshletTriangleBufDesc);
-		CommandList->beginTrackingBufferState(MeshletPrimitiveBuffer, nvrhi::ResourceStates::CopyDest);
-		CommandList->writeBuffer(MeshletPrimitiveBuffer, MeshletTrianglesPacked.data(), meshletTriangleBufDesc.byteSize);
-		CommandList->setPermanentBufferState(MeshletPrimitiveBuffer, nvrhi::ResourceStates::ShaderResource);
+		meshletTriangleBufDesc.initialState = nvrhi::ResourceStates::ShaderResource;
+		meshletTriangleBufDesc.keepInitialState = true;
+		UploadGrowingBuffer(CommandList, MeshletPrimitiveBuffer, meshletTriangleBufDesc, MeshletTrianglesPacked.data(), MeshletTrianglesPacked.size() * sizeof(uint32_t), UploadedBytes.MeshletTriangles);
 
 		nvrhi::BufferDesc meshletBoundingSphereBufDesc;
-		meshletBoundingSphereBufDesc.byteSize = MeshletBounds.size() * sizeof(FMeshletBounds);
 		meshletBoundingSphereBufDesc.debugName = "Meshlet Bounds Buffer";
 		meshletBoundingSphereBufDesc.canHaveTypedViews = true;
 		meshletBoundingSphereBufDesc.structStride = sizeof(FMeshletBounds);
-		MeshletBoundingSphereBuffer = DirectXDevice::GetInstance()->m_NvrhiDevice->createBuffer(meshletBoundingSphereBufDesc);
-		CommandList->beginTrackingBufferState(MeshletBoundingSphereBuffer, nvrhi::ResourceStates::CopyDest);
-		CommandList->writeBuffer(MeshletBoundingSphereBuffer, MeshletBounds.data(), meshletBoundingSphereBufDesc.byteSize);
-		CommandList->setPermanentBufferState(MeshletBoundingSphereBuffer, nvrhi::ResourceStates::ShaderResource);
+		meshletBoundingSphereBufDesc.initialState = nvrhi::ResourceStates::ShaderResource;
+		meshletBoundingSphereBufDesc.keepInitialState = true;
+		UploadGrowingBuffer(CommandList, MeshletBoundingSphereBuffer, meshletBoundingSphereBufDesc, MeshletBounds.data(), MeshletBounds.size() * sizeof(FMeshletBounds), UploadedBytes.MeshletBounds);
 	}
 	CommandList->close();
 	DirectXDevice::GetInstance()->m_NvrhiDevice->executeCommandList(CommandList);
 }
 
-//get the furthest point within the meshlet
-Vector3 GetFurthestPoint(
-	const Vector3& point,
-	const std::vector<Vertex>& vertices,
-	uint32_t vertexOffset,
-	const meshopt_Meshlet& meshlet,
-	const std::vector<uint32_t>& meshletVertices,
-	uint32_t globalMeshletVertexOffset
-)
+void AssetManager::UpdatePackedVertices()
 {
-	float FurthestDistSqred = 0;
-	Vector3 FurthestPoint = point;
-	for (size_t i = 0; i < meshlet.vertex_count; i++)
+	RD_SCOPE(Load, Pack Vertices);
+	//the cpu side was cleared and refilled, repack everything
+	if (PackedVertices.size() > Vertices.size())
+		PackedVertices.clear();
+	const size_t PackedCount = PackedVertices.size();
+	if (PackedCount == Vertices.size())
+		return;
+	PackedVertices.resize(Vertices.size());
+
+	//every mesh is quantized against its own box, so the new infos can be packed independently
+	//lods point back at vertices that were already covered, skip them
+	tf::Taskflow TaskFlow;
+	size_t NextVertexOffset = PackedCount;
+	for (const VertexBufferInfo& Info : VertexBufferInfos)
 	{
-		uint32_t vertIndex = meshletVertices[globalMeshletVertexOffset + meshlet.vertex_offset + i] + vertexOffset;
-		Vector3 p = vertices[vertIndex].position;
-		Vector3 v = p - point;
-		float distSqred = v.LengthSquared();
-		if (distSqred > FurthestDistSqred)
-		{
-			FurthestDistSqred = distSqred;
-			FurthestPoint = p;
-		}
+		if (Info.VerticesOffset < NextVertexOffset || Info.VerticesCount == 0)
+			continue;
+		NextVertexOffset = Info.VerticesOffset + Info.VerticesCount;
+		TaskFlow.emplace([this, &Info]() {
+			PackVertices(&Vertices[Info.VerticesOffset], Info.VerticesCount, Info.BestFitBox, &PackedVertices[Info.VerticesOffset]);
+		});
 	}
-	return FurthestPoint;
+	SExecutor::Run(TaskFlow);
 }
 
-Vector4 GetRitterSphere(
-	const std::vector<Vertex>& vertices,	//global vertices
-	uint32_t vertexOffset,					//offset to where the mesh vertices start
-	const meshopt_Meshlet& meshlet,			//the meshlet to calculate the sphere for
-	const std::vector<uint32_t>& meshletVertices,	//the meshlet vertex indices
-	uint32_t globalMeshletVertexOffset
-)
+//meshlets of a chunk of a vertex buffer info, offsets local to the chunk and vertices local to the mesh
+struct MeshletBuildResult
+{
+	std::vector<meshopt_Meshlet> Meshlets;
+	std::vector<uint32_t> Vertices;
+	std::vector<uint32_t> TrianglesPacked;
+	std::vector<FMeshletBounds> Bounds;
+	//where the chunk lands in the global buffers
+	uint32_t MeshletOffset{};
+	uint32_t VerticesOffset{};
+	uint32_t TrianglesOffset{};
+};
+
+//a range of the index buffer of one of the meshes being built
+struct MeshletChunk
+{
+	size_t Mesh{};
+	uint32_t FirstIndex{};
+	uint32_t IndexCount{};
+};
+
+void BuildMeshletsForChunk(const Vertex* VertexStart, const uint32_t* IndexStart, uint32_t IndexCount, MeshletBuildResult& Result)
 {
-	//mesh vertex offset in the global buffer + meshlet vertex offset to get the index for the global vertex
-	uint32_t firstMeshletVertexIndex = meshletVertices[globalMeshletVertexOffset + meshlet.vertex_offset] + vertexOffset;
-	Vector3 first = vertices[firstMeshletVertexIndex].position;
-	Vector3 p0 = GetFurthestPoint(first, vertices, vertexOffset, meshlet, meshletVertices, globalMeshletVertexOffset);
-	Vector3 p1 = GetFurthestPoint(p0, vertices, vertexOffset, meshlet, meshletVertices, globalMeshletVertexOffset);
-	Vector3 center = (p0 + p1) * 0.5f;
-	float radiusSqred = (p1 - center).LengthSquared();
-	//check if the sphere is big enough to contain all the points, otherwise update
-	for (size_t i = 0; i < meshlet.vertex_count; i++)
+	const float ConeWeight = 0.f;	//not using cone weight, it is used for culling
+	//meshopt keeps scratch for every vertex it is given, only hand it the vertices the chunk uses
+	//after the vertex fetch optimization those are close to a contiguous range
+	const auto [MinIndex, MaxIndex] = std::minmax_element(IndexStart, IndexStart + IndexCount);
+	const uint32_t FirstVertex = *MinIndex;
+	std::vector<uint32_t> LocalIndices(IndexStart, IndexStart + IndexCount);
+	for (uint32_t& Index : LocalIndices)
+		Index -= FirstVertex;
+	VertexStart += FirstVertex;
+
+	//worst case of this chunk only, the scratch is gone once the chunk is done
+	size_t MaxMeshletsCount = meshopt_buildMeshletsBound(IndexCount, max_vertices, max_triangles);
+	Result.Meshlets.resize(MaxMeshletsCount);
+	Result.Vertices.resize(MaxMeshletsCount * max_vertices);
+	std::vector<uint8_t> TrianglesUnpacked(MaxMeshletsCount * max_triangles * 3);
+
+	size_t MeshletCount = meshopt_buildMeshlets(Result.Meshlets.data(), Result.Vertices.data(), TrianglesUnpacked.data(), LocalIndices.data(), IndexCount, (float*)VertexStart, *MaxIndex - FirstVertex + 1, sizeof(Vertex), max_vertices, max_triangles, ConeWeight);
+	Result.Meshlets.resize(MeshletCount);
+	Result.Meshlets.shrink_to_fit();
+	if (MeshletCount == 0)
 	{
-		uint32_t vertIndex = meshletVertices[globalMeshletVertexOffset + meshlet.vertex_offset + i] + vertexOffset;
-		Vector3 p = vertices[vertIndex].position;
-		Vector3 v = p - center;
-		float distSqred = v.LengthSquared();
-		if (distSqred > radiusSqred)
+		Result.Vertices = {};
+		return;
+	}
+	const meshopt_Meshlet& Last = Result.Meshlets.back();
+	Result.Vertices.resize(Last.vertex_offset + Last.vertex_count);
+	Result.Vertices.shrink_to_fit();
+
+	uint32_t TriangleCount{};
+	for (const meshopt_Meshlet& Meshlet : Result.Meshlets)
+		TriangleCount += Meshlet.triangle_count;
+
+	//pack the primitive indices, the meshlet triangle offset becomes the offset in terms of packed triangles
+	Result.TrianglesPacked.resize(TriangleCount);
+	uint32_t PackedTriangleLocalOffset{};
+	for (meshopt_Meshlet& Meshlet : Result.Meshlets)
+	{
+		//offset value of indiv indices in the local unpacked triangle buffer
+		uint32_t UnpackedTriangleOffset = Meshlet.triangle_offset;
+		Meshlet.triangle_offset = PackedTriangleLocalOffset;
+		for (size_t k = UnpackedTriangleOffset; k < UnpackedTriangleOffset + Meshlet.triangle_count * 3; k += 3)
 		{
-			//just expand the sphere to be conservative
-			radiusSqred = distSqred;
+			uint32_t packed = 0;
+			packed |= uint32_t(TrianglesUnpacked[k + 0]) << 0;
+			packed |= uint32_t(TrianglesUnpacked[k + 1]) << 8;
+			packed |= uint32_t(TrianglesUnpacked[k + 2]) << 16;
+			Result.TrianglesPacked[PackedTriangleLocalOffset++] = packed;
 		}
 	}
-	return Vector4(center.x, center.y, center.z, sqrtf(radiusSqred));
+
+	//bounds of all the meshlets in simd batches, works off the packed triangles
+	Result.Bounds.resize(MeshletCount);
+	ComputeMeshletBounds(Result.Meshlets.data(), MeshletCount, Result.Vertices.data(), Result.TrianglesPacked.data(), VertexStart, Result.Bounds.data());
+	//back to indices into the whole mesh
+	for (uint32_t& MeshletVertex : Result.Vertices)
+		MeshletVertex += FirstVertex;
 }
 
 void AssetManager::UpdateMeshletsData()
 {
-	Meshlets.clear();
-	MeshletTrianglesPacked.clear();
-	MeshletVertices.clear();
-	MeshletBounds.clear();
-
-	//maximum number of meshlets based on global index buffer containing every mesh
-	size_t GlobalMaxMeshletsCount = meshopt_buildMeshletsBound(Indices.size(), max_vertices, max_triangles);
-	Meshlets.resize(GlobalMaxMeshletsCount);
-	MeshletBounds.resize(GlobalMaxMeshletsCount);
-	MeshletVertices.resize(GlobalMaxMeshletsCount * max_vertices);
-	MeshletTrianglesPacked.resize(GlobalMaxMeshletsCount * max_triangles * 3);
-	//worse case of global, even though the worse case should fit the largest mesh only, TODO: find a way to use the other worst case
-	std::vector<uint8_t > MeshletTrianglesUnpacked(GlobalMaxMeshletsCount * max_triangles * 3);
-	uint32_t MeshletTotalCount{}, MeshletTrianglesPackedTotalCount{}, MeshletVerticesTotalCount{};
-	const float ConeWeight = 0.f;	//not using cone weight, it is used for culling
+	//only meshes without meshlets get built, everything already built keeps its place in the global buffers
+	std::vector<size_t> PendingVertexBuffers;
 	for (size_t i = 0; i < VertexBufferInfos.size(); ++i)
 	{
-		VertexBufferInfo& Info = VertexBufferInfos[i];
-
-		//create the meshlet inplaced at the offsets
-		Vertex* VertexStart = &Vertices[Info.VerticesOffset];
-		uint32_t* IndexStart = &Indices[Info.IndicesOffset];
-		meshopt_Meshlet* MeshletStart = &Meshlets[MeshletTotalCount];
-		uint32_t* MeshletVerticesStart = &MeshletVertices[MeshletVerticesTotalCount];
-		
-		uint32_t MeshletTempCount = meshopt_buildMeshlets(MeshletStart, MeshletVerticesStart, MeshletTrianglesUnpacked.data(), IndexStart, Info.IndicesCount, (float*)VertexStart, Info.VerticesCount, sizeof(Vertex), max_vertices, max_triangles, ConeWeight);
-
-		//generate bounds here before packing the data
-		for (size_t j = 0; j < MeshletTempCount; ++j)
+		if (VertexBufferInfos[i].MeshletCount == 0 && VertexBufferInfos[i].IndicesCount > 0)
+			PendingVertexBuffers.emplace_back(i);
+	}
+	BuildMeshlets(PendingVertexBuffers);
+}
+
+void AssetManager::BuildMeshlets(const std::vector<size_t>& vertexBufferIndices)
+{
+	RD_SCOPE(Load, Build Meshlets);
+	if (vertexBufferIndices.empty())
+		return;
+	const size_t MeshCount = vertexBufferIndices.size();
+
+	//phase one, every mesh builds its meshlets in chunks so a single large mesh is still spread over the workers
+	//no meshlet crosses a chunk, that leaves at most one partly filled meshlet per chunk
+	std::vector<MeshletChunk> Chunks;
+	for (size_t i = 0; i < MeshCount; ++i)
+	{
+		const uint32_t IndicesCount = VertexBufferInfos[vertexBufferIndices[i]].IndicesCount;
+		for (uint32_t FirstIndex = 0; FirstIndex < IndicesCount; FirstIndex += meshlet_chunk_triangles * 3)
+			Chunks.push_back({ i, FirstIndex, std::min<uint32_t>(IndicesCount - FirstIndex, meshlet_chunk_triangles * 3) });
+	}
+	std::vector<MeshletBuildResult> Results(Chunks.size());
+	{
+		tf::Taskflow TaskFlow;
+		for (size_t i = 0; i < Chunks.size(); ++i)
 		{
-			const meshopt_Meshlet& Meshlet = MeshletStart[j];
-			//use meshopt to generate bounds as well
-			meshopt_Bounds bounds = meshopt_computeMeshletBounds(MeshletVerticesStart + Meshlet.vertex_offset, MeshletTrianglesUnpacked.data() + Meshlet.triangle_offset, Meshlet.triangle_count, (float*)VertexStart, Info.VerticesCount, sizeof(Vertex));
-			MeshletBounds[MeshletTotalCount + j] = bounds;
+			TaskFlow.emplace([this, &Results, &Chunks, &vertexBufferIndices, i]() {
+				RD_SCOPE(Load, Build Mesh Meshlets);
+				const MeshletChunk& Chunk = Chunks[i];
+				const VertexBufferInfo& Info = VertexBufferInfos[vertexBufferIndices[Chunk.Mesh]];
+				BuildMeshletsForChunk(&Vertices[Info.VerticesOffset], &Indices[Info.IndicesOffset + Chunk.FirstIndex], Chunk.IndexCount, Results[i]);
+			});
 		}
+		SExecutor::Run(TaskFlow);
+	}
 
-		const meshopt_Meshlet& Last = Meshlets[MeshletTempCount + MeshletTotalCount - 1];
-
-		//pack the primtive indices into the offset of the primitive buffer
-		uint32_t UnpackedTrianglesCount = Last.triangle_offset + ((Last.triangle_count * 3 + 3) & ~3);
-		//offset value in terms of 3 indices representing a triangle within the local packed triangle buffer
-		uint32_t PackedTriangleLocalOffset{};
-		for (size_t j = MeshletTotalCount; j < MeshletTotalCount + MeshletTempCount; ++j)
+	//phase two, prefix sum the counts into the group offsets so the global buffers can be sized exactly
+	//the chunks of a mesh are back to back, the first one starts the group of the mesh
+	uint32_t MeshletTotalCount = static_cast<uint32_t>(Meshlets.size());
+	uint32_t MeshletTrianglesPackedTotalCount = static_cast<uint32_t>(MeshletTrianglesPacked.size());
+	uint32_t MeshletVerticesTotalCount = static_cast<uint32_t>(MeshletVertices.size());
+	for (size_t i = 0; i < Chunks.size(); ++i)
+	{
+		VertexBufferInfo& Info = VertexBufferInfos[vertexBufferIndices[Chunks[i].Mesh]];
+		MeshletBuildResult& Result = Results[i];
+		if (Chunks[i].FirstIndex == 0)
 		{
-			meshopt_Meshlet& Meshlet = Meshlets[j];
-			//offset value of indiv indices in the local unpacked triangle buffer
-			uint32_t UnpackedTriangleOffset = Meshlet.triangle_offset;
-			Meshlet.triangle_offset = PackedTriangleLocalOffset;
-			//iterate through the unpacked meshlet from the original offset to count * 3
-			for (size_t k = UnpackedTriangleOffset; k < UnpackedTriangleOffset + Meshlet.triangle_count * 3; k += 3)
-			{
-				uint32_t packed = 0;
-				packed |= uint32_t(MeshletTrianglesUnpacked[k + 0]) << 0;
-				packed |= uint32_t(MeshletTrianglesUnpacked[k + 1]) << 8;
-				packed |= uint32_t(MeshletTrianglesUnpacked[k + 2]) << 16;
-				//add the packed triangle to the global buffer
-				MeshletTrianglesPacked[MeshletTrianglesPackedTotalCount + PackedTriangleLocalOffset++] = packed;
-			}
+			Info.MeshletCount = 0;
+			Info.MeshletGroupOffset = MeshletTotalCount;
+			Info.MeshletGroupPrimitivesOffset = MeshletTrianglesPackedTotalCount;
+			Info.MeshletGroupVerticesOffset = MeshletVerticesTotalCount;
 		}
-
-		//update the vertex buffer info
-		Info.MeshletCount = MeshletTempCount;
-		Info.MeshletGroupOffset = MeshletTotalCount;
-		Info.MeshletGroupPrimitivesOffset = MeshletTrianglesPackedTotalCount;
-		Info.MeshletGroupVerticesOffset = MeshletVerticesTotalCount;
-
-		//update the counters so we can shrink the global buffers afterwards
-		MeshletTotalCount += MeshletTempCount;
-		MeshletTrianglesPackedTotalCount += PackedTriangleLocalOffset;
-		MeshletVerticesTotalCount += Last.vertex_offset + Last.vertex_count;
+		Info.MeshletCount += static_cast<uint32_t>(Result.Meshlets.size());
+		Result.MeshletOffset = MeshletTotalCount;
+		Result.TrianglesOffset = MeshletTrianglesPackedTotalCount;
+		Result.VerticesOffset = MeshletVerticesTotalCount;
+
+		MeshletTotalCount += static_cast<uint32_t>(Result.Meshlets.size());
+		MeshletTrianglesPackedTotalCount += static_cast<uint32_t>(Result.TrianglesPacked.size());
+		MeshletVerticesTotalCount += static_cast<uint32_t>(Result.Vertices.size());
 	}
-
-	//once done, resize the buffers
 	Meshlets.resize(MeshletTotalCount);
 	MeshletBounds.resize(MeshletTotalCount);
 	MeshletTrianglesPacked.resize(MeshletTrianglesPackedTotalCount);
 	MeshletVertices.resize(MeshletVerticesTotalCount);
+
+	//then every chunk scatters into its own range, its meshlet offsets move from the chunk to the group of its mesh
+	{
+		tf::Taskflow TaskFlow;
+		for (size_t i = 0; i < Chunks.size(); ++i)
+		{
+			TaskFlow.emplace([this, &Results, &Chunks, &vertexBufferIndices, i]() {
+				const VertexBufferInfo& Info = VertexBufferInfos[vertexBufferIndices[Chunks[i].Mesh]];
+				MeshletBuildResult& Result = Results[i];
+				const uint32_t VerticesBase = Result.VerticesOffset - Info.MeshletGroupVerticesOffset;
+				const uint32_t TrianglesBase = Result.TrianglesOffset - Info.MeshletGroupPrimitivesOffset;
+				for (meshopt_Meshlet& Meshlet : Result.Meshlets)
+				{
+					Meshlet.vertex_offset += VerticesBase;
+					Meshlet.triangle_offset += TrianglesBase;
+				}
+				std::copy(Result.Meshlets.begin(), Result.Meshlets.end(), Meshlets.begin() + Result.MeshletOffset);
+				std::copy(Result.Bounds.begin(), Result.Bounds.end(), MeshletBounds.begin() + Result.MeshletOffset);
+				std::copy(Result.TrianglesPacked.begin(), Result.TrianglesPacked.end(), MeshletTrianglesPacked.begin() + Result.TrianglesOffset);
+				std::copy(Result.Vertices.begin(), Result.Vertices.end(), MeshletVertices.begin() + Result.VerticesOffset);
+				//release the per chunk copy as soon as it is in the global buffers
+				Result = MeshletBuildResult();
+			});
+		}
+		SExecutor::Run(TaskFlow);
+	}
 }
 
 nvrhi::ShaderHandle AssetManager::GetShader(const std::string& shaderFilename)
@@ -704,6 +799,8 @@ nvrhi::ShaderHandle AssetManager::GetShader(const std::string& shaderFilename)
 	nvrhi::ShaderHandle shader = DirectXDevice::GetInstance()->m_NvrhiDevice->createShader(
 		desc,
 		data, size);
+	//hash the bytecode now instead of on the first pipeline lookup
+	ShaderHashes.Get(shader);
 	Shaders[shaderFilename] = shader;
 	return shader;
 }
@@ -3,6 +3,8 @@
 #include <nvrhi/nvrhi.h>
 #include <tiny_gltf.h>
 #include "Ragdoll/Math/RagdollMath.h"
+#include "Ragdoll/PipelineManifest.h"
+#include "Ragdoll/ShaderBuild.h"
 #include "meshoptimizer.h"
 
 struct Material {
@@ -25,21 +27,37 @@ struct Material {
 struct Vertex {
 	Vector3 position = Vector3::Zero;
 	Vector3 normal = Vector3::Zero;
-	Vector3 tangent = Vector3::Zero;
+	Vector4 tangent = Vector4::Zero;	//w is the bitangent sign
 	Vector2 texcoord = Vector2::Zero;
 };
 
+//opt in gpu layout of Vertex, 20 bytes instead of 44
+struct PackedVertex {
+	uint16_t position[4]{};	//unorm16 within the mesh BestFitBox, w is the bitangent sign as 0 or 1
+	int16_t normal[2]{};	//octahedral snorm16
+	int16_t tangent[2]{};	//octahedral snorm16
+	uint16_t texcoord[2]{};	//half
+};
+
 struct VertexBufferInfo
 {
-	uint32_t VerticesOffset;
-	uint32_t IndicesOffset;
-	uint32_t IndicesCount;
-	uint32_t VerticesCount;
+	uint32_t VerticesOffset{};
+	uint32_t IndicesOffset{};
+	uint32_t IndicesCount{};
+	uint32_t VerticesCount{};
 
-	uint32_t MeshletCount;
-	uint32_t MeshletGroupOffset;
-	uint32_t MeshletGroupPrimitivesOffset;
-	uint32_t MeshletGroupVerticesOffset;
+	//0 until the meshlets are built
+	uint32_t MeshletCount{};
+	uint32_t MeshletGroupOffset{};
+	uint32_t MeshletGroupPrimitivesOffset{};
+	uint32_t MeshletGroupVerticesOffset{};
+
+	//simplified versions of this mesh are LodCount infos starting at FirstLodIndex, they share its vertices
+	//both stay 0 on the lods themselves
+	uint32_t LodCount{};
+	uint32_t FirstLodIndex{};
+	//geometric error of this lod in mesh space, 0 for the full detail mesh
+	float LodError{};
 
 	//Best fit box for culling
 	DirectX::BoundingBox BestFitBox;
@@ -58,8 +76,6 @@ struct Mesh
 
 struct Image
 {
-	//raw byte data, loaded via stbi
-	uint8_t* RawData{ nullptr };
 	bool bIsDDS{ false };
 	nvrhi::TextureHandle TextureHandle;
 };
@@ -117,24 +133,10 @@ struct FMeshletBounds
 	}
 };
 
-using Bytes = std::pair<const void*, uint32_t>;
-template<>
-struct std::hash<Bytes> {
-	std::size_t operator()(const Bytes& bytes) const noexcept
-	{
-		return std::hash<std::string_view>{}({ reinterpret_cast<const char*>(bytes.first), bytes.second });
-	}
-};
-
-static auto hash = std::hash<Bytes>();
-
-template<typename T>
-size_t HashBytes(T* ptr) {
-	return hash(std::make_pair(ptr, sizeof(T)));
-}
-
 constexpr size_t max_vertices = 64;
 constexpr size_t max_triangles = 124;	//not 126 because they want it divisible by 4
+//meshes are split into chunks of this many triangles to build their meshlets in parallel
+constexpr uint32_t meshlet_chunk_triangles = 16384;
 
 class ForwardRenderer;
 class DirectXDevice;
@@ -159,11 +161,16 @@ public:
 	std::vector<nvrhi::SamplerHandle> Samplers;
 	nvrhi::SamplerHandle ShadowSampler;
 
-	std::unordered_map<size_t, nvrhi::GraphicsPipelineHandle> GPSOs;
-	std::unordered_map<size_t, nvrhi::ComputePipelineHandle> CPSOs;
-	std::unordered_map<size_t, nvrhi::rt::PipelineHandle> RTSOs;
-	std::unordered_map<size_t, nvrhi::MeshletPipelineHandle> MPSOs;
-	std::unordered_map<size_t, nvrhi::BindingLayoutHandle> BindingLayouts;
+	//every pass looks these up every frame from its own task, hits take no lock and a miss is created once while the other passes wait on it
+	ConcurrentCache<GraphicsPipelineKey, nvrhi::GraphicsPipelineHandle> GPSOs;
+	ConcurrentCache<ComputePipelineKey, nvrhi::ComputePipelineHandle> CPSOs;
+	ConcurrentCache<RaytracePipelineKey, nvrhi::rt::PipelineHandle> RTSOs;
+	ConcurrentCache<MeshletPipelineKey, nvrhi::MeshletPipelineHandle> MPSOs;
+	ConcurrentCache<BindingLayoutKey, nvrhi::BindingLayoutHandle> BindingLayouts;
+	//bytecode hashes the pipeline keys are made of, filled in as the shaders are loaded
+	ShaderHashCache ShaderHashes;
+	//every pipeline and binding layout created above, saved on shutdown and replayed before the first frame of the next run
+	PipelineManifest Manifest;
 
 	std::unordered_map<std::string, nvrhi::ShaderHandle> Shaders;
 	std::unordered_map<std::string, nvrhi::ShaderLibraryHandle> ShaderLibraries;
@@ -174,6 +181,10 @@ public:
 	nvrhi::BufferHandle IBO;
 	std::vector<Vertex> Vertices;
 	std::vector<uint32_t> Indices;
+	//gpu copy of Vertices when the packed layout is used, filled in by UpdateMeshBuffers
+	std::vector<PackedVertex> PackedVertices;
+	//upload PackedVertex instead of Vertex, has to be set before Init as the input layout depends on it
+	bool bQuantizedVertices{ false };
 	//meshlet data
 	nvrhi::BufferHandle MeshletBuffer;
 	nvrhi::BufferHandle MeshletVertexBuffer;
@@ -197,21 +208,54 @@ public:
 	nvrhi::rt::PipelineHandle GetRaytracePipeline(const nvrhi::rt::PipelineDesc& desc);
 	nvrhi::MeshletPipelineHandle GetMeshletPipeline(const nvrhi::MeshletPipelineDesc& desc, const nvrhi::FramebufferHandle& fb);
 	nvrhi::BindingLayoutHandle GetBindingLayout(const nvrhi::BindingSetDesc& desc);
+	nvrhi::BindingLayoutHandle GetBindingLayout(const nvrhi::BindingLayoutDesc& layoutDesc);
+	//builds the permutations whose sources changed and drops only the shaders and pipelines made from what was rebuilt
+	//the caches are emptied in place, nothing may be looking a pipeline up while it runs
 	void RecompileShaders();
+	//safe from inside a frame, the rebuild waits for ProcessShaderReload
+	void RequestShaderReload();
+	//runs a requested rebuild, called by the renderer once every pass of the frame has recorded
+	void ProcessShaderReload();
 
 	void Init(std::shared_ptr<ragdoll::FileManager> fm);
 	//this function will just add the vertices and indices, and populate the vector of objects
 	size_t AddVertices(const std::vector<Vertex>& newVertices, const std::vector<uint32_t>& newIndices);
+	//adds a simplified index buffer over the vertices of an existing vertex buffer as its next lod
+	//the lods of one mesh have to be added back to back
+	size_t AddLod(size_t baseVertexBufferIndex, const std::vector<uint32_t>& newIndices, float error);
 	//this function will create the buffer handles and copy the data over
+	//the buffers grow geometrically and only the data appended since the last call is uploaded
 	void UpdateMeshBuffers();
-	//will create the global meshlet vectors, buffers will be created when update mesh buffers is called
+	//builds meshlets for the vertex buffers that do not have any yet and appends them to the global meshlet vectors
+	//buffers will be updated when update mesh buffers is called
 	void UpdateMeshletsData();
 
 	nvrhi::ShaderHandle GetShader(const std::string& shaderFilename);
 	nvrhi::ShaderLibraryHandle GetShaderLibrary(const std::string& shaderFilename);
 private:
+	//builds the meshlets of the given vertex buffer infos in parallel and appends them to the global meshlet vectors
+	void BuildMeshlets(const std::vector<size_t>& vertexBufferIndices);
+	//packs the vertices appended since the last call into PackedVertices
+	void UpdatePackedVertices();
+	//1x1 render targets in the given formats, enough to create the pipelines of a replayed manifest
+	nvrhi::FramebufferHandle CreateFormatFramebuffer(const nvrhi::FramebufferInfo& info);
+
+	//bytes of every global buffer that are already on the gpu, UpdateMeshBuffers only uploads past this
+	struct
+	{
+		size_t Vertices{};
+		size_t Indices{};
+		size_t Meshlets{};
+		size_t MeshletVertices{};
+		size_t MeshletTriangles{};
+		size_t MeshletBounds{};
+	} UploadedBytes;
+
 	nvrhi::CommandListHandle CommandList;	//asset manager commandlist
 	std::shared_ptr<ragdoll::FileManager> FileManagerRef;
+	//loaded on the first shader rebuild, a run that never rebuilds never loads dxc
+	std::unique_ptr<ShaderCompiler> Dxc;
+	std::atomic<bool> bShaderReloadRequested{ false };
 	inline static std::unique_ptr<AssetManager> s_Instance;
 	std::mutex Mutex;
 };
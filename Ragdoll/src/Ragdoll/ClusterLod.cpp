@@ -0,0 +1,393 @@
+#include "ragdollpch.h"
+#include "ClusterLod.h"
+
+#include "Executor.h"
+#include "LodSelection.h"
+#include "Profiler.h"
+#include "Ragdoll/Core/Hash.h"
+#include "meshoptimizer.h"
+
+namespace
+{
+	//maps every vertex onto the first vertex at the same position, seams split what is a single point on the surface
+	void GetPositionRemap(const Vertex* vertices, size_t vertexCount, std::vector<uint32_t>& remap)
+	{
+		std::vector<uint32_t> Order(vertexCount);
+		std::iota(Order.begin(), Order.end(), 0u);
+		//ties are broken by index so the remap does not depend on the sort
+		std::sort(Order.begin(), Order.end(), [vertices](uint32_t a, uint32_t b) {
+			const Vector3& A = vertices[a].position;
+			const Vector3& B = vertices[b].position;
+			if (A.x != B.x)
+				return A.x < B.x;
+			if (A.y != B.y)
+				return A.y < B.y;
+			if (A.z != B.z)
+				return A.z < B.z;
+			return a < b;
+		});
+		remap.resize(vertexCount);
+		for (size_t i = 0; i < vertexCount; ++i)
+		{
+			const bool bSamePosition = i > 0 && vertices[Order[i]].position == vertices[Order[i - 1]].position;
+			remap[Order[i]] = bSamePosition ? remap[Order[i - 1]] : Order[i];
+		}
+	}
+
+	//undirected edges used by a single triangle, welded by position so seams do not count as borders
+	void GetOpenEdges(const uint32_t* indices, size_t indexCount, const std::vector<uint32_t>& remap, std::vector<uint64_t>& openEdges)
+	{
+		std::vector<uint64_t> Edges;
+		Edges.reserve(indexCount);
+		for (size_t i = 0; i + 2 < indexCount; i += 3)
+		{
+			const uint32_t Triangle[3] = { remap[indices[i]], remap[indices[i + 1]], remap[indices[i + 2]] };
+			//the simplifier drops triangles that are degenerate by position, so they cannot count on either side
+			if (Triangle[0] == Triangle[1] || Triangle[1] == Triangle[2] || Triangle[2] == Triangle[0])
+				continue;
+			for (uint32_t k = 0; k < 3; ++k)
+			{
+				const uint32_t A = Triangle[k];
+				const uint32_t B = Triangle[(k + 1) % 3];
+				Edges.emplace_back(uint64_t(std::min(A, B)) << 32 | std::max(A, B));
+			}
+		}
+		std::sort(Edges.begin(), Edges.end());
+		openEdges.clear();
+		for (size_t i = 0; i < Edges.size();)
+		{
+			size_t j = i + 1;
+			while (j < Edges.size() && Edges[j] == Edges[i])
+				++j;
+			if (j - i == 1)
+				openEdges.emplace_back(Edges[i]);
+			i = j;
+		}
+	}
+
+	//splits a simplified group back into meshlet sized clusters
+	//the vertices are compacted first so the cost only depends on the size of the group and not of the mesh
+	void SplitIntoClusters(const Vertex* vertices, const std::vector<uint32_t>& indices, std::vector<uint32_t>& globalToLocal, std::vector<std::vector<uint32_t>>& clusters)
+	{
+		std::vector<uint32_t> LocalToGlobal;
+		std::vector<uint32_t> LocalIndices(indices.size());
+		for (size_t i = 0; i < indices.size(); ++i)
+		{
+			uint32_t& Local = globalToLocal[indices[i]];
+			if (Local == ~0u)
+			{
+				Local = static_cast<uint32_t>(LocalToGlobal.size());
+				LocalToGlobal.emplace_back(indices[i]);
+			}
+			LocalIndices[i] = Local;
+		}
+		std::vector<Vector3> Positions(LocalToGlobal.size());
+		for (size_t i = 0; i < LocalToGlobal.size(); ++i)
+		{
+			Positions[i] = vertices[LocalToGlobal[i]].position;
+			//leave the scratch clean for the next group
+			globalToLocal[LocalToGlobal[i]] = ~0u;
+		}
+
+		const size_t MaxMeshletsCount = meshopt_buildMeshletsBound(LocalIndices.size(), max_vertices, max_triangles);
+		std::vector<meshopt_Meshlet> Meshlets(MaxMeshletsCount);
+		std::vector<uint32_t> MeshletVertices(MaxMeshletsCount * max_vertices);
+		std::vector<uint8_t> MeshletTriangles(MaxMeshletsCount * max_triangles * 3);
+		const size_t MeshletCount = meshopt_buildMeshlets(Meshlets.data(), MeshletVertices.data(), MeshletTriangles.data(), LocalIndices.data(), LocalIndices.size(), &Positions[0].x, Positions.size(), sizeof(Vector3), max_vertices, max_triangles, 0.f);
+		clusters.resize(MeshletCount);
+		for (size_t i = 0; i < MeshletCount; ++i)
+		{
+			const meshopt_Meshlet& Meshlet = Meshlets[i];
+			clusters[i].resize(Meshlet.triangle_count * 3);
+			for (uint32_t j = 0; j < Meshlet.triangle_count * 3; ++j)
+				clusters[i][j] = LocalToGlobal[MeshletVertices[Meshlet.vertex_offset + MeshletTriangles[Meshlet.triangle_offset + j]]];
+		}
+	}
+
+	//the leaves are exact and the roots have nothing above them, everything else is good enough once it projects under the threshold
+	bool IsErrorAcceptable(const Vector3& center, float radius, float error, const Vector3& cameraPosition, float projScale, float maxPixelError)
+	{
+		if (error <= 0.f)
+			return true;
+		if (error == std::numeric_limits<float>::max())
+			return false;
+		//distance to the closest point of the bounds, the error can be anywhere inside them
+		const float Distance = Vector3::Distance(center, cameraPosition) - radius;
+		return GetProjectedError(error, Distance, projScale) <= maxPixelError;
+	}
+}
+
+void ClusterDag::Build(const AssetManager& assets, const VertexBufferInfo& info)
+{
+	RD_SCOPE(Load, Build Cluster Dag);
+	Clusters.clear();
+	LevelSourceTriangleCounts.clear();
+	LevelTriangleCounts.clear();
+	if (info.MeshletCount == 0)
+		return;
+	const Vertex* Vertices = &assets.Vertices[info.VerticesOffset];
+	const size_t VertexCount = info.VerticesCount;
+
+	//the leaves are the meshlets the renderer already draws
+	std::vector<uint32_t> Pending;
+	uint32_t LeafTriangleCount{};
+	for (uint32_t i = 0; i < info.MeshletCount; ++i)
+	{
+		const meshopt_Meshlet& Meshlet = assets.Meshlets[info.MeshletGroupOffset + i];
+		const uint32_t* MeshletVertices = &assets.MeshletVertices[info.MeshletGroupVerticesOffset + Meshlet.vertex_offset];
+		const uint32_t* MeshletTriangles = &assets.MeshletTrianglesPacked[info.MeshletGroupPrimitivesOffset + Meshlet.triangle_offset];
+		Cluster& Leaf = Clusters.emplace_back();
+		Leaf.Indices.resize(Meshlet.triangle_count * 3);
+		for (uint32_t j = 0; j < Meshlet.triangle_count; ++j)
+		{
+			for (uint32_t k = 0; k < 3; ++k)
+				Leaf.Indices[j * 3 + k] = MeshletVertices[(MeshletTriangles[j] >> (k * 8)) & 0xFF];
+		}
+		meshopt_Bounds Bounds = meshopt_computeClusterBounds(Leaf.Indices.data(), Leaf.Indices.size(), &Vertices[0].position.x, VertexCount, sizeof(Vertex));
+		Leaf.Center = Vector3(Bounds.center);
+		Leaf.Radius = Bounds.radius;
+		LeafTriangleCount += Meshlet.triangle_count;
+		Pending.emplace_back(i);
+	}
+	LevelSourceTriangleCounts.emplace_back(LeafTriangleCount);
+	LevelTriangleCounts.emplace_back(LeafTriangleCount);
+
+	std::vector<uint32_t> PositionRemap;
+	GetPositionRemap(Vertices, VertexCount, PositionRemap);
+	std::vector<uint32_t> GlobalToLocal(VertexCount, ~0u);
+	std::vector<uint32_t> ClusterIndices, ClusterIndexCounts, Partition;
+	std::vector<uint32_t> Merged, Simplified;
+	std::vector<std::vector<uint32_t>> Split;
+	for (uint32_t Level = 1; Pending.size() > 1 && Level < MaxLevels; ++Level)
+	{
+		//group the clusters that share the most vertices, welded so both sides of a seam count as neighbours
+		ClusterIndices.clear();
+		ClusterIndexCounts.clear();
+		for (uint32_t ClusterIndex : Pending)
+		{
+			for (uint32_t Index : Clusters[ClusterIndex].Indices)
+				ClusterIndices.emplace_back(PositionRemap[Index]);
+			ClusterIndexCounts.emplace_back(static_cast<uint32_t>(Clusters[ClusterIndex].Indices.size()));
+		}
+		Partition.resize(Pending.size());
+		const size_t GroupCount = meshopt_partitionClusters(Partition.data(), ClusterIndices.data(), ClusterIndices.size(), ClusterIndexCounts.data(), Pending.size(), VertexCount, GroupSize);
+		std::vector<std::vector<uint32_t>> Groups(GroupCount);
+		for (size_t i = 0; i < Pending.size(); ++i)
+			Groups[Partition[i]].emplace_back(Pending[i]);
+
+		std::vector<uint32_t> NextPending;
+		uint32_t SourceTriangleCount{}, TriangleCount{};
+		for (const std::vector<uint32_t>& Group : Groups)
+		{
+			Merged.clear();
+			for (uint32_t ClusterIndex : Group)
+				Merged.insert(Merged.end(), Clusters[ClusterIndex].Indices.begin(), Clusters[ClusterIndex].Indices.end());
+
+			//the border of the group is shared with the neighbouring groups, locking it keeps them watertight whatever level each of them is drawn at
+			Simplified.resize(Merged.size());
+			float SimplifyError{};
+			const size_t TargetCount = Merged.size() / 6 * 3;
+			const size_t Count = meshopt_simplify(Simplified.data(), Merged.data(), Merged.size(), &Vertices[0].position.x, VertexCount, sizeof(Vertex), TargetCount,
+				std::numeric_limits<float>::max(), meshopt_SimplifyLockBorder | meshopt_SimplifySparse | meshopt_SimplifyErrorAbsolute, &SimplifyError);
+			if (Count == 0 || Count > Merged.size() * MinReduction)
+			{
+				//try again next level, different neighbours might free up the border
+				NextPending.insert(NextPending.end(), Group.begin(), Group.end());
+				continue;
+			}
+			Simplified.resize(Count);
+
+			//the group bounds contain every child and its error is never smaller, so the projected error only grows going up the dag
+			DirectX::BoundingSphere GroupBounds(Clusters[Group[0]].Center, Clusters[Group[0]].Radius);
+			float GroupError = SimplifyError;
+			for (uint32_t ClusterIndex : Group)
+			{
+				const Cluster& Child = Clusters[ClusterIndex];
+				DirectX::BoundingSphere Merge;
+				DirectX::BoundingSphere::CreateMerged(Merge, GroupBounds, DirectX::BoundingSphere(Child.Center, Child.Radius));
+				GroupBounds = Merge;
+				GroupError = std::max(GroupError, Child.Error);
+			}
+			for (uint32_t ClusterIndex : Group)
+			{
+				Cluster& Child = Clusters[ClusterIndex];
+				Child.ParentCenter = GroupBounds.Center;
+				Child.ParentRadius = GroupBounds.Radius;
+				Child.ParentError = GroupError;
+			}
+
+			SplitIntoClusters(Vertices, Simplified, GlobalToLocal, Split);
+			for (std::vector<uint32_t>& Indices : Split)
+			{
+				NextPending.emplace_back(static_cast<uint32_t>(Clusters.size()));
+				Cluster& Parent = Clusters.emplace_back();
+				Parent.Indices = std::move(Indices);
+				Parent.Center = GroupBounds.Center;
+				Parent.Radius = GroupBounds.Radius;
+				Parent.Error = GroupError;
+				Parent.Level = Level;
+			}
+			SourceTriangleCount += static_cast<uint32_t>(Merged.size() / 3);
+			TriangleCount += static_cast<uint32_t>(Count / 3);
+		}
+		//nothing simplified, every pending cluster stays a root
+		if (TriangleCount == 0)
+			break;
+		LevelSourceTriangleCounts.emplace_back(SourceTriangleCount);
+		LevelTriangleCounts.emplace_back(TriangleCount);
+		Pending = std::move(NextPending);
+	}
+}
+
+void ClusterDag::SelectCut(const Vector3& cameraPosition, float projScale, float maxPixelError, std::vector<uint32_t>& clusters) const
+{
+	//every cluster of a group shares its parent bounds and error, so a group is either drawn whole or replaced whole
+	for (uint32_t i = 0; i < Clusters.size(); ++i)
+	{
+		const Cluster& Current = Clusters[i];
+		if (IsErrorAcceptable(Current.Center, Current.Radius, Current.Error, cameraPosition, projScale, maxPixelError) &&
+			!IsErrorAcceptable(Current.ParentCenter, Current.ParentRadius, Current.ParentError, cameraPosition, projScale, maxPixelError))
+			clusters.emplace_back(i);
+	}
+}
+
+uint64_t ClusterDag::GetHash() const
+{
+	uint64_t Hash{};
+	for (const Cluster& Current : Clusters)
+	{
+		Hash = ragdoll::Hash64(Current.Indices.data(), Current.Indices.size() * sizeof(uint32_t), Hash);
+		const float Values[] = {
+			Current.Center.x, Current.Center.y, Current.Center.z, Current.Radius, Current.Error,
+			Current.ParentCenter.x, Current.ParentCenter.y, Current.ParentCenter.z, Current.ParentRadius, Current.ParentError,
+		};
+		Hash = ragdoll::Hash64(Values, sizeof(Values), Hash);
+	}
+	return Hash;
+}
+
+void BuildClusterDags(const AssetManager& assets, std::vector<ClusterDag>& dags)
+{
+	RD_SCOPE(Load, Build Cluster Dags);
+	dags.clear();
+	dags.resize(assets.VertexBufferInfos.size());
+	//the lods share the vertices of their base mesh, their dag would only be a worse copy of the base one
+	std::vector<bool> IsLod(assets.VertexBufferInfos.size());
+	for (const VertexBufferInfo& Info : assets.VertexBufferInfos)
+	{
+		for (uint32_t i = 0; i < Info.LodCount; ++i)
+			IsLod[Info.FirstLodIndex + i] = true;
+	}
+	tf::Taskflow TaskFlow;
+	for (size_t i = 0; i < dags.size(); ++i)
+	{
+		if (IsLod[i])
+			continue;
+		TaskFlow.emplace([&assets, &dags, i]() {
+			dags[i].Build(assets, assets.VertexBufferInfos[i]);
+		});
+	}
+	SExecutor::Run(TaskFlow);
+}
+
+bool VerifyClusterDags(const AssetManager& assets, const std::vector<ClusterDag>& dags)
+{
+	RD_SCOPE(Load, Verify Cluster Dags);
+	//a 1080p view with a 60 degree vertical fov and a one pixel threshold
+	const float ProjScale = 0.5f * 1080.f / tanf(DirectX::XMConvertToRadians(30.f));
+	const float MaxPixelError = 1.f;
+	//camera distances from the center of the mesh in mesh radii, from inside the mesh to far away
+	const float Distances[] = { 0.f, 1.5f, 3.f, 6.f, 12.f, 25.f, 50.f, 100.f, 1000.f };
+	constexpr size_t DistanceCount = std::size(Distances);
+	Vector3 Direction(1.f, 1.f, 1.f);
+	Direction.Normalize();
+
+	bool bPassed = true;
+	size_t MeshCount{}, ClusterCount{};
+	uint64_t LeafTriangleCount{}, RootTriangleCount{};
+	uint64_t CutTriangleCounts[DistanceCount]{};
+	std::vector<uint32_t> Remap, Cut, CutIndices;
+	std::vector<uint64_t> MeshOpenEdges, CutOpenEdges, Cracks;
+	for (size_t i = 0; i < dags.size(); ++i)
+	{
+		const ClusterDag& Dag = dags[i];
+		if (Dag.Clusters.empty())
+			continue;
+		const VertexBufferInfo& Info = assets.VertexBufferInfos[i];
+		++MeshCount;
+		ClusterCount += Dag.Clusters.size();
+		LeafTriangleCount += Dag.LevelTriangleCounts[0];
+
+		//errors only grow and parent bounds contain their children, otherwise a cut can overlap itself or leave holes
+		for (const ClusterDag::Cluster& Cluster : Dag.Clusters)
+		{
+			if (Cluster.ParentError == std::numeric_limits<float>::max())
+			{
+				RootTriangleCount += Cluster.Indices.size() / 3;
+				continue;
+			}
+			const bool bNested = Vector3::Distance(Cluster.Center, Cluster.ParentCenter) + Cluster.Radius <= Cluster.ParentRadius * 1.001f + 1e-5f;
+			if (Cluster.ParentError < Cluster.Error || !bNested)
+			{
+				RD_CORE_ERROR("Cluster lod {}: level {} cluster is not contained by its parent, error {} parent error {}", i, Cluster.Level, Cluster.Error, Cluster.ParentError);
+				bPassed = false;
+				break;
+			}
+		}
+		for (size_t Level = 1; Level < Dag.LevelTriangleCounts.size(); ++Level)
+		{
+			if (Dag.LevelTriangleCounts[Level] > Dag.LevelSourceTriangleCounts[Level] * ClusterDag::MinReduction)
+			{
+				RD_CORE_ERROR("Cluster lod {}: level {} only went from {} to {} triangles", i, Level, Dag.LevelSourceTriangleCounts[Level], Dag.LevelTriangleCounts[Level]);
+				bPassed = false;
+			}
+		}
+
+		//a cut may only be open where the source mesh is open, any other border is a crack between clusters of different levels
+		const Vertex* Vertices = &assets.Vertices[Info.VerticesOffset];
+		GetPositionRemap(Vertices, Info.VerticesCount, Remap);
+		GetOpenEdges(&assets.Indices[Info.IndicesOffset], Info.IndicesCount, Remap, MeshOpenEdges);
+		const Vector3 Center = Info.BestFitBox.Center;
+		const float Radius = Vector3(Info.BestFitBox.Extents).Length();
+		for (size_t d = 0; d < DistanceCount; ++d)
+		{
+			Cut.clear();
+			Dag.SelectCut(Center + Direction * Radius * Distances[d], ProjScale, MaxPixelError, Cut);
+			CutIndices.clear();
+			for (uint32_t ClusterIndex : Cut)
+				CutIndices.insert(CutIndices.end(), Dag.Clusters[ClusterIndex].Indices.begin(), Dag.Clusters[ClusterIndex].Indices.end());
+			GetOpenEdges(CutIndices.data(), CutIndices.size(), Remap, CutOpenEdges);
+			Cracks.clear();
+			std::set_difference(CutOpenEdges.begin(), CutOpenEdges.end(), MeshOpenEdges.begin(), MeshOpenEdges.end(), std::back_inserter(Cracks));
+			if (!Cracks.empty())
+			{
+				RD_CORE_ERROR("Cluster lod {}: cut at {} radii has {} open edges that are not open in the source mesh", i, Distances[d], Cracks.size());
+				bPassed = false;
+			}
+			CutTriangleCounts[d] += CutIndices.size() / 3;
+		}
+	}
+
+	//the build is single threaded per mesh, a rebuild has to give the exact same clusters
+	std::vector<ClusterDag> Rebuilt;
+	BuildClusterDags(assets, Rebuilt);
+	for (size_t i = 0; i < dags.size(); ++i)
+	{
+		if (Rebuilt[i].GetHash() != dags[i].GetHash())
+		{
+			RD_CORE_ERROR("Cluster lod {}: rebuilding gave a different dag", i);
+			bPassed = false;
+		}
+	}
+
+	const double ToPercent = LeafTriangleCount ? 100.0 / LeafTriangleCount : 0.0;
+	RD_CORE_INFO("Cluster lod: {} meshes, {} clusters, {} leaf triangles, {} root triangles ({:.1f}%)",
+		MeshCount, ClusterCount, LeafTriangleCount, RootTriangleCount, RootTriangleCount * ToPercent);
+	for (size_t d = 0; d < DistanceCount; ++d)
+		RD_CORE_INFO("Cluster lod: camera at {} radii draws {} triangles ({:.1f}%)", Distances[d], CutTriangleCounts[d], CutTriangleCounts[d] * ToPercent);
+	if (bPassed)
+		RD_CORE_INFO("Cluster lod: all checks passed");
+	else
+		RD_CORE_ERROR("Cluster lod: verification failed");
+	return bPassed;
+}
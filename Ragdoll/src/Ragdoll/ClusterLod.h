@@ -0,0 +1,49 @@
+#pragma once
+#include "Ragdoll/AssetManager.h"
+
+//continuous lod hierarchy of one mesh, the leaves are its meshlets and every level above groups neighbouring clusters,
+//simplifies every group with its border locked and splits it back into clusters
+//a cut that draws every cluster whose own error is small enough while the error of its parent is not is crack free
+struct ClusterDag
+{
+	//target number of clusters merged and simplified together
+	static constexpr uint32_t GroupSize = 8;
+	//a group that keeps more than this fraction of its triangles is not simplified, its clusters become roots
+	static constexpr float MinReduction = 0.85f;
+	//guard against meshes that keep simplifying a few triangles at a time
+	static constexpr uint32_t MaxLevels = 32;
+
+	struct Cluster
+	{
+		//indices into the vertices of the mesh
+		std::vector<uint32_t> Indices;
+		//bounds and error of the group simplification that produced the cluster, error is 0 for the leaves
+		Vector3 Center;
+		float Radius{};
+		float Error{};
+		//bounds and error of the group the cluster was simplified into, shared by every cluster of that group
+		//the error is max float for the roots so they are always drawn once their own error is good enough
+		Vector3 ParentCenter;
+		float ParentRadius{};
+		float ParentError{ std::numeric_limits<float>::max() };
+		uint32_t Level{};
+	};
+	std::vector<Cluster> Clusters;
+	//triangles of the groups that got simplified on every level and the triangles they ended up with, level 0 is the meshlets
+	std::vector<uint32_t> LevelSourceTriangleCounts;
+	std::vector<uint32_t> LevelTriangleCounts;
+
+	//builds the hierarchy over the meshlets of the vertex buffer, UpdateMeshletsData has to have built them already
+	void Build(const AssetManager& assets, const VertexBufferInfo& info);
+	//appends the indices into Clusters of the cut for the camera, everything is in mesh space
+	//projScale is the same as for GetProjectedError, multiply it by the instance scale for scaled instances
+	void SelectCut(const Vector3& cameraPosition, float projScale, float maxPixelError, std::vector<uint32_t>& clusters) const;
+	//changes whenever any cluster or error changes, used to check the build is deterministic
+	uint64_t GetHash() const;
+};
+
+//builds the dag of every full detail mesh in parallel, the lods generated on import get an empty dag
+void BuildClusterDags(const AssetManager& assets, std::vector<ClusterDag>& dags);
+//checks monotonic errors, nested bounds, the reduction of every level, that cuts from a fixed set of distances are crack free
+//and that a rebuild gives the same dags, logs the triangle reduction of the cuts, returns false on any failure
+bool VerifyClusterDags(const AssetManager& assets, const std::vector<ClusterDag>& dags);
@@ -0,0 +1,199 @@
+#pragma once
+#include <atomic>
+#include <type_traits>
+
+//insert only hash map for values that are expensive to create and looked up from many threads, like pipelines
+//hits take no lock, they walk a bucket chain of entries that never change once published
+//a miss publishes a pending entry first, so the value is created exactly once and everyone else asking for it waits on that entry
+//a create that throws or returns null marks the entry failed instead, its waiters get null and the next lookup creates it again
+//the bucket count is fixed, chains just get longer past it, there is no rehash for a reader to race with
+//
+//Lookup is whatever the caller looks up with, it has to provide
+//	uint64_t Hash;
+//	bool Matches(const Key& key) const;
+//	Key MakeKey() const;	only called on a miss
+//so a hit never has to build a Key
+template<typename Key, typename Value>
+class ConcurrentCache
+{
+public:
+	explicit ConcurrentCache(uint32_t bucketCount = 1024)
+	{
+		uint32_t Count = 1;
+		while (Count < bucketCount)
+			Count <<= 1;
+		Buckets = std::make_unique<std::atomic<Entry*>[]>(Count);
+		Mask = Count - 1;
+	}
+	~ConcurrentCache() { Clear(); }
+	ConcurrentCache(const ConcurrentCache&) = delete;
+	ConcurrentCache& operator=(const ConcurrentCache&) = delete;
+
+	//the cached value, or the one create returns if this is the first lookup of it or the last create failed
+	//an exception from create goes to the caller, lookups waiting on that create get null
+	template<typename Lookup, typename Create>
+	Value Get(const Lookup& lookup, Create&& create)
+	{
+		std::atomic<Entry*>& Bucket = Buckets[lookup.Hash & Mask];
+		Entry* Head = Bucket.load(std::memory_order_acquire);
+		if (Entry* Found = Find(Head, nullptr, lookup))
+			return Acquire(*Found, create);
+
+		Entry* Pending = new Entry{ lookup.MakeKey(), lookup.Hash, Head };
+		while (!Bucket.compare_exchange_weak(Pending->Next, Pending, std::memory_order_acq_rel, std::memory_order_acquire))
+		{
+			//someone pushed in the meantime, only their entries have to be searched
+			if (Entry* Found = Find(Pending->Next, Head, lookup))
+			{
+				delete Pending;
+				return Acquire(*Found, create);
+			}
+			Head = Pending->Next;
+		}
+		return Publish(*Pending, create);
+	}
+
+	//only while nothing is looking up, the entries are freed on the spot
+	void Clear()
+	{
+		for (uint32_t i = 0; i <= Mask; ++i)
+		{
+			Entry* Current = Buckets[i].exchange(nullptr, std::memory_order_acquire);
+			while (Current)
+			{
+				Entry* Next = Current->Next;
+				delete Current;
+				Current = Next;
+			}
+		}
+		Size = 0;
+	}
+
+	//only while nothing is looking up, drops every entry pred(key, value) is true for and returns how many there were
+	template<typename Pred>
+	size_t EraseIf(Pred&& pred)
+	{
+		size_t Erased{};
+		for (uint32_t i = 0; i <= Mask; ++i)
+		{
+			Entry* Kept{};
+			Entry* Current = Buckets[i].exchange(nullptr, std::memory_order_acquire);
+			while (Current)
+			{
+				Entry* Next = Current->Next;
+				if (pred(static_cast<const Key&>(Current->EntryKey), static_cast<const Value&>(Current->CachedValue)))
+				{
+					//failed entries were never counted
+					if (Current->State.load(std::memory_order_relaxed) == Ready)
+						++Erased;
+					delete Current;
+				}
+				else
+				{
+					Current->Next = Kept;
+					Kept = Current;
+				}
+				Current = Next;
+			}
+			Buckets[i].store(Kept, std::memory_order_release);
+		}
+		Size.fetch_sub(Erased, std::memory_order_relaxed);
+		return Erased;
+	}
+
+	//values created and cached, failed creations are not in it
+	size_t GetSize() const { return Size.load(std::memory_order_relaxed); }
+	//lookups that created their value or tried to, the rest were hits or waited on someone else's creation
+	size_t GetMisses() const { return Misses.load(std::memory_order_relaxed); }
+	//lookups that found the value still being created and had to wait for it
+	size_t GetWaits() const { return Waits.load(std::memory_order_relaxed); }
+
+private:
+	enum : uint8_t { Creating, Ready, Failed };
+
+	struct Entry
+	{
+		Key EntryKey;
+		uint64_t Hash;
+		Entry* Next{};
+		Value CachedValue{};
+		std::atomic<uint8_t> State{ Creating };
+	};
+
+	//a null handle is a failed create, like a pipeline of a shader that did not compile, numbers are always created
+	static bool IsCreated(const Value& value)
+	{
+		if constexpr (std::is_arithmetic_v<Value>)
+			return true;
+		else
+			return static_cast<bool>(value);
+	}
+
+	//from head up to but not including end, which was searched already
+	template<typename Lookup>
+	static Entry* Find(Entry* head, Entry* end, const Lookup& lookup)
+	{
+		for (Entry* Current = head; Current != end; Current = Current->Next)
+		{
+			if (Current->Hash == lookup.Hash && lookup.Matches(Current->EntryKey))
+				return Current;
+		}
+		return nullptr;
+	}
+
+	//only the lookup that moved the entry to creating calls this, the value is written before anyone can read it
+	template<typename Create>
+	Value Publish(Entry& entry, Create& create)
+	{
+		Misses.fetch_add(1, std::memory_order_relaxed);
+		Value Created{};
+		try
+		{
+			Created = create();
+		}
+		catch (...)
+		{
+			Fail(entry);
+			throw;
+		}
+		if (!IsCreated(Created))
+		{
+			Fail(entry);
+			return Created;
+		}
+		entry.CachedValue = Created;
+		entry.State.store(Ready, std::memory_order_release);
+		entry.State.notify_all();
+		Size.fetch_add(1, std::memory_order_relaxed);
+		return Created;
+	}
+
+	void Fail(Entry& entry)
+	{
+		entry.State.store(Failed, std::memory_order_release);
+		entry.State.notify_all();
+	}
+
+	//a failed entry is created again by whoever claims it first, everyone else waits on that
+	template<typename Create>
+	Value Acquire(Entry& entry, Create& create)
+	{
+		uint8_t State = entry.State.load(std::memory_order_acquire);
+		if (State == Failed && entry.State.compare_exchange_strong(State, Creating, std::memory_order_acquire))
+			return Publish(entry, create);
+		if (State == Creating)
+		{
+			Waits.fetch_add(1, std::memory_order_relaxed);
+			entry.State.wait(Creating, std::memory_order_acquire);
+			State = entry.State.load(std::memory_order_acquire);
+		}
+		//ready never changes again, anything else means the create this lookup waited on failed
+		return State == Ready ? entry.CachedValue : Value{};
+	}
+
+	std::unique_ptr<std::atomic<Entry*>[]> Buckets;
+	uint32_t Mask{};
+	std::atomic<size_t> Size{};
+	std::atomic<size_t> Misses{};
+	std::atomic<size_t> Waits{};
+};
@@ -0,0 +1,141 @@
+﻿/*!
+\file		Hash.cpp
+\date		17/10/2026
+
+\author		Devin Tan
+\email		devintrh@gmail.com
+
+\copyright	MIT License
+
+			Copyright © 2024 Tan Rui Hao Devin
+
+			Permission is hereby granted, free of charge, to any person obtaining a copy
+			of this software and associated documentation files (the "Software"), to deal
+			in the Software without restriction, including without limitation the rights
+			to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+			copies of the Software, and to permit persons to whom the Software is
+			furnished to do so, subject to the following conditions:
+
+			The above copyright notice and this permission notice shall be included in all
+			copies or substantial portions of the Software.
+
+			THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+			IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+			FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+			AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+			LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+			OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+			SOFTWARE.
+__________________________________________________________________________________*/
+
+#include "ragdollpch.h"
+
+#include "Hash.h"
+
+namespace ragdoll
+{
+	namespace
+	{
+		constexpr uint64_t Prime1 = 0x9E3779B185EBCA87ULL;
+		constexpr uint64_t Prime2 = 0xC2B2AE3D27D4EB4FULL;
+		constexpr uint64_t Prime3 = 0x165667B19E3779F9ULL;
+		constexpr uint64_t Prime4 = 0x85EBCA77C2B2AE63ULL;
+		constexpr uint64_t Prime5 = 0x27D4EB2F165667C5ULL;
+
+		inline uint64_t Rotl(uint64_t x, int r)
+		{
+			return (x << r) | (x >> (64 - r));
+		}
+
+		//unaligned reads, the data can come straight out of a mapped file
+		inline uint64_t Read64(const uint8_t* p)
+		{
+			uint64_t v;
+			memcpy(&v, p, sizeof(v));
+			return v;
+		}
+
+		inline uint32_t Read32(const uint8_t* p)
+		{
+			uint32_t v;
+			memcpy(&v, p, sizeof(v));
+			return v;
+		}
+
+		inline uint64_t Round(uint64_t acc, uint64_t input)
+		{
+			acc += input * Prime2;
+			acc = Rotl(acc, 31);
+			return acc * Prime1;
+		}
+
+		inline uint64_t MergeRound(uint64_t acc, uint64_t val)
+		{
+			acc ^= Round(0, val);
+			return acc * Prime1 + Prime4;
+		}
+	}
+
+	uint64_t Hash64(const void* data, size_t size, uint64_t seed)
+	{
+		const uint8_t* p = static_cast<const uint8_t*>(data);
+		const uint8_t* end = p + size;
+		uint64_t h;
+
+		if (size >= 32)
+		{
+			//4 independent lanes over 32 byte stripes
+			uint64_t v1 = seed + Prime1 + Prime2;
+			uint64_t v2 = seed + Prime2;
+			uint64_t v3 = seed;
+			uint64_t v4 = seed - Prime1;
+			const uint8_t* limit = end - 32;
+			do {
+				v1 = Round(v1, Read64(p)); p += 8;
+				v2 = Round(v2, Read64(p)); p += 8;
+				v3 = Round(v3, Read64(p)); p += 8;
+				v4 = Round(v4, Read64(p)); p += 8;
+			} while (p <= limit);
+
+			h = Rotl(v1, 1) + Rotl(v2, 7) + Rotl(v3, 12) + Rotl(v4, 18);
+			h = MergeRound(h, v1);
+			h = MergeRound(h, v2);
+			h = MergeRound(h, v3);
+			h = MergeRound(h, v4);
+		}
+		else
+		{
+			h = seed + Prime5;
+		}
+
+		h += static_cast<uint64_t>(size);
+
+		//remaining tail
+		while (p + 8 <= end)
+		{
+			h ^= Round(0, Read64(p));
+			h = Rotl(h, 27) * Prime1 + Prime4;
+			p += 8;
+		}
+		if (p + 4 <= end)
+		{
+			h ^= static_cast<uint64_t>(Read32(p)) * Prime1;
+			h = Rotl(h, 23) * Prime2 + Prime3;
+			p += 4;
+		}
+		while (p < end)
+		{
+			h ^= (*p) * Prime5;
+			h = Rotl(h, 11) * Prime1;
+			++p;
+		}
+
+		//avalanche
+		h ^= h >> 33;
+		h *= Prime2;
+		h ^= h >> 29;
+		h *= Prime3;
+		h ^= h >> 32;
+		return h;
+	}
+}
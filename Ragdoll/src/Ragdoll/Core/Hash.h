@@ -0,0 +1,37 @@
+﻿/*!
+\file		Hash.h
+\date		17/10/2026
+
+\author		Devin Tan
+\email		devintrh@gmail.com
+
+\copyright	MIT License
+
+			Copyright © 2024 Tan Rui Hao Devin
+
+			Permission is hereby granted, free of charge, to any person obtaining a copy
+			of this software and associated documentation files (the "Software"), to deal
+			in the Software without restriction, including without limitation the rights
+			to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+			copies of the Software, and to permit persons to whom the Software is
+			furnished to do so, subject to the following conditions:
+
+			The above copyright notice and this permission notice shall be included in all
+			copies or substantial portions of the Software.
+
+			THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+			IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+			FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+			AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+			LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+			OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+			SOFTWARE.
+__________________________________________________________________________________*/
+#pragma once
+
+namespace ragdoll
+{
+	//64 bit content hash (xxhash64), stable across runs and machines so it can be used for on disk keys
+	//chain multiple pieces of data by passing the previous result in as the seed
+	uint64_t Hash64(const void* data, size_t size, uint64_t seed = 0);
+}
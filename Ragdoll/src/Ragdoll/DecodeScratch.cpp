@@ -0,0 +1,184 @@
+#include "ragdollpch.h"
+#include "DecodeScratch.h"
+
+#include "Executor.h"
+
+namespace
+{
+	//stb makes lots of small blocks for its huffman tables and rows, those are not worth caching
+	constexpr size_t MinPooledBytes = size_t(64) << 10;
+	constexpr uint32_t BucketCount = 48;
+	constexpr uint32_t Unpooled = UINT32_MAX;
+
+	//in front of every block, 32 bytes so the block itself keeps malloc's 16 byte alignment
+	struct alignas(16) BlockHeader
+	{
+		size_t Capacity;
+		uint32_t Bucket;
+		uint32_t Padding[3];
+	};
+
+	struct WorkerCache
+	{
+		std::vector<BlockHeader*> Free[BucketCount];
+		size_t CachedBytes{};
+	};
+
+	std::atomic<size_t> LiveBytes{};
+	std::atomic<size_t> PeakLiveBytes{};
+	std::atomic<size_t> CachedBytes{};
+	std::atomic<size_t> Allocations{};
+	std::atomic<size_t> Reuses{};
+	std::atomic<size_t> CacheLimit{ size_t(64) << 20 };
+	std::atomic<bool> bPooling{ true };
+
+	//one per worker, only ever touched by its own worker so there is no lock
+	std::vector<WorkerCache>& GetCaches()
+	{
+		static std::vector<WorkerCache> Caches(SExecutor::Executor.num_workers());
+		return Caches;
+	}
+
+	WorkerCache* GetWorkerCache()
+	{
+		const int Worker = SExecutor::Executor.this_worker_id();
+		if (Worker < 0 || !bPooling.load(std::memory_order_relaxed))
+			return nullptr;
+		return &GetCaches()[Worker];
+	}
+
+	uint32_t GetBucket(size_t bytes)
+	{
+		uint32_t Bucket = 0;
+		while ((size_t(1) << Bucket) < bytes)
+			++Bucket;
+		return Bucket;
+	}
+
+	void TrackAllocation(size_t capacity)
+	{
+		const size_t Live = LiveBytes.fetch_add(capacity, std::memory_order_relaxed) + capacity;
+		size_t Peak = PeakLiveBytes.load(std::memory_order_relaxed);
+		while (Live > Peak && !PeakLiveBytes.compare_exchange_weak(Peak, Live, std::memory_order_relaxed))
+			;
+		Allocations.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+void* DecodeScratch::Allocate(size_t size)
+{
+	const size_t Bytes = size + sizeof(BlockHeader);
+	BlockHeader* Header = nullptr;
+	if (size < MinPooledBytes)
+	{
+		Header = static_cast<BlockHeader*>(malloc(Bytes));
+		if (!Header)
+			return nullptr;
+		Header->Capacity = Bytes;
+		Header->Bucket = Unpooled;
+	}
+	else
+	{
+		const uint32_t Bucket = GetBucket(Bytes);
+		if (Bucket >= BucketCount)
+			return nullptr;
+		if (WorkerCache* Cache = GetWorkerCache(); Cache && !Cache->Free[Bucket].empty())
+		{
+			Header = Cache->Free[Bucket].back();
+			Cache->Free[Bucket].pop_back();
+			Cache->CachedBytes -= Header->Capacity;
+			CachedBytes.fetch_sub(Header->Capacity, std::memory_order_relaxed);
+			Reuses.fetch_add(1, std::memory_order_relaxed);
+		}
+		else
+		{
+			Header = static_cast<BlockHeader*>(malloc(size_t(1) << Bucket));
+			if (!Header)
+				return nullptr;
+			Header->Capacity = size_t(1) << Bucket;
+			Header->Bucket = Bucket;
+		}
+	}
+	TrackAllocation(Header->Capacity);
+	return Header + 1;
+}
+
+void* DecodeScratch::Reallocate(void* block, size_t size)
+{
+	if (!block)
+		return Allocate(size);
+	BlockHeader* Header = static_cast<BlockHeader*>(block) - 1;
+	const size_t Usable = Header->Capacity - sizeof(BlockHeader);
+	//the bucket rounding leaves room to grow in place
+	if (size <= Usable)
+		return block;
+	void* Grown = Allocate(size);
+	if (!Grown)
+		return nullptr;
+	memcpy(Grown, block, Usable);
+	Free(block);
+	return Grown;
+}
+
+void DecodeScratch::Free(void* block)
+{
+	if (!block)
+		return;
+	BlockHeader* Header = static_cast<BlockHeader*>(block) - 1;
+	LiveBytes.fetch_sub(Header->Capacity, std::memory_order_relaxed);
+	if (Header->Bucket != Unpooled)
+	{
+		WorkerCache* Cache = GetWorkerCache();
+		if (Cache && Cache->CachedBytes + Header->Capacity <= CacheLimit.load(std::memory_order_relaxed))
+		{
+			Cache->Free[Header->Bucket].push_back(Header);
+			Cache->CachedBytes += Header->Capacity;
+			CachedBytes.fetch_add(Header->Capacity, std::memory_order_relaxed);
+			return;
+		}
+	}
+	free(Header);
+}
+
+void DecodeScratch::SetCacheLimit(size_t bytesPerWorker)
+{
+	CacheLimit = bytesPerWorker;
+}
+
+void DecodeScratch::SetPooling(bool bEnabled)
+{
+	bPooling = bEnabled;
+}
+
+void DecodeScratch::Trim()
+{
+	for (WorkerCache& Cache : GetCaches())
+	{
+		for (std::vector<BlockHeader*>& Bucket : Cache.Free)
+		{
+			for (BlockHeader* Header : Bucket)
+				free(Header);
+			Bucket.clear();
+		}
+		CachedBytes.fetch_sub(Cache.CachedBytes, std::memory_order_relaxed);
+		Cache.CachedBytes = 0;
+	}
+}
+
+DecodeScratch::Stats DecodeScratch::GetStats()
+{
+	Stats Result;
+	Result.LiveBytes = LiveBytes.load(std::memory_order_relaxed);
+	Result.PeakLiveBytes = PeakLiveBytes.load(std::memory_order_relaxed);
+	Result.CachedBytes = CachedBytes.load(std::memory_order_relaxed);
+	Result.Allocations = Allocations.load(std::memory_order_relaxed);
+	Result.Reuses = Reuses.load(std::memory_order_relaxed);
+	return Result;
+}
+
+void DecodeScratch::ResetPeak()
+{
+	PeakLiveBytes = LiveBytes.load(std::memory_order_relaxed);
+	Allocations = 0;
+	Reuses = 0;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+//scratch memory of the image decodes, file bytes, stb output and mip chains
+//every executor worker keeps the large blocks it frees in power of two buckets and hands them to its next decode,
+//so a scene of same sized textures reaches a steady state instead of going back to the heap for every image
+//blocks freed outside the executor and small blocks go straight back to the heap
+namespace DecodeScratch
+{
+	struct Stats
+	{
+		//bytes handed out and not freed yet, block headers and bucket rounding included
+		size_t LiveBytes{};
+		size_t PeakLiveBytes{};
+		//bytes sitting in the worker caches
+		size_t CachedBytes{};
+		size_t Allocations{};
+		//allocations served from a worker cache
+		size_t Reuses{};
+	};
+
+	void* Allocate(size_t size);
+	void* Reallocate(void* block, size_t size);
+	void Free(void* block);
+
+	//bytes every worker may keep around between decodes
+	void SetCacheLimit(size_t bytesPerWorker);
+	//off sends everything straight to the heap, the accounting still runs
+	void SetPooling(bool bEnabled);
+	//frees every cached block, only while no decode is running
+	void Trim();
+	Stats GetStats();
+	void ResetPeak();
+
+	template<typename T>
+	struct Allocator
+	{
+		using value_type = T;
+
+		Allocator() = default;
+		template<typename U>
+		Allocator(const Allocator<U>&) {}
+
+		T* allocate(size_t count)
+		{
+			void* Block = Allocate(count * sizeof(T));
+			if (!Block)
+				throw std::bad_alloc();
+			return static_cast<T*>(Block);
+		}
+		void deallocate(T* block, size_t) { Free(block); }
+
+		template<typename U>
+		bool operator==(const Allocator<U>&) const { return true; }
+		template<typename U>
+		bool operator!=(const Allocator<U>&) const { return false; }
+	};
+
+	template<typename T>
+	using Vector = std::vector<T, Allocator<T>>;
+}
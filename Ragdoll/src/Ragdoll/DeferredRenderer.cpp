@@ -163,184 +163,66 @@ void Renderer::Render(ragdoll::Scene* scene, ragdoll::FGPUScene* GPUScene, float
 	}
 
 	RD_SCOPE(Render, Full Frame)
-	tf::Taskflow Taskflow;
+	if (FrameGraph.GetTaskCount() == 0)
+		BuildFrameGraph();
+	Frame.Scene = scene;
+	Frame.GPUScene = GPUScene;
+	Frame.Dt = _dt;
+	Frame.Imgui = imgui.get();
+	Frame.Exposure = AutomaticExposurePass->AdaptedLuminanceHandle;
+
+	//the graph has a task for every pass, the settings of this frame decide which of them record anything
 	std::vector<nvrhi::ICommandList*> activeList;
-	Taskflow.emplace([this]() {
-		DirectXDevice::GetNativeDevice()->runGarbageCollection();
-	});
-
-	Taskflow.emplace([this]() {
-		BeginFrame();
-	});
-
-	Taskflow.emplace([this, &scene]() {
-		SkyGeneratePass->GenerateSky(scene->SceneInfo, RenderTargets);
-	});
 	activeList.emplace_back(CommandLists[(int)Pass::SKY_GENERATE]);
-
-	uint32_t ProxyCount = scene->StaticProxies.size();
-	Taskflow.emplace([this, &scene, GPUScene, ProxyCount]() {
-		if (!scene->SceneInfo.bEnableMeshletShading)
-		{
-			GBufferPass->Draw(
-				GPUScene,
-				ProxyCount,
-				scene->SceneInfo,
-				scene->DebugInfo,
-				RenderTargets,
-				scene->SceneInfo.bEnableOcclusionCull);
-		}
-		else
-		{
-			GBufferPass->DrawMeshlets(
-				GPUScene,
-				ProxyCount,
-				scene->SceneInfo,
-				scene->DebugInfo,
-				RenderTargets);
-		}
-	});
 	activeList.emplace_back(CommandLists[(int)Pass::GBUFFER]);
 
+	FrameGraph.SetEnabled(FrameTasks.CACAO, scene->SceneInfo.UseCACAO);
 	if (scene->SceneInfo.UseCACAO)
-	{
-		Taskflow.emplace([this, &scene]() {
-			CACAOPass->GenerateAO(scene->SceneInfo, RenderTargets);
-		});
 		activeList.emplace_back(CommandLists[(int)Pass::AO]);
-	}
+	FrameGraph.SetEnabled(FrameTasks.XeGTAO, scene->SceneInfo.UseXeGTAO);
 	if (scene->SceneInfo.UseXeGTAO)
-	{
-		Taskflow.emplace([this, &scene]() {
-			XeGTAOPass->GenerateAO(scene->SceneInfo, RenderTargets);
-		});
 		activeList.emplace_back(CommandLists[(int)Pass::AO]);
-	}
 
+	for (uint32_t Task : FrameTasks.ShadowDepth)
+		FrameGraph.SetEnabled(Task, !scene->SceneInfo.bRaytraceDirectionalLight);
 	if (!scene->SceneInfo.bRaytraceDirectionalLight)
 	{
-		Taskflow.emplace([this, &scene, GPUScene]() {
-			ShadowPass->DrawAllInstances(0, GPUScene, scene->StaticProxies.size(), scene->SceneInfo, RenderTargets);
-		});
-		Taskflow.emplace([this, &scene, GPUScene]() {
-			ShadowPass->DrawAllInstances(1, GPUScene, scene->StaticProxies.size(), scene->SceneInfo, RenderTargets);
-			});
-		Taskflow.emplace([this, &scene, GPUScene]() {
-			ShadowPass->DrawAllInstances(2, GPUScene, scene->StaticProxies.size(), scene->SceneInfo, RenderTargets);
-			});
-		Taskflow.emplace([this, &scene, GPUScene]() {
-			ShadowPass->DrawAllInstances(3, GPUScene, scene->StaticProxies.size(), scene->SceneInfo, RenderTargets);
-			});
 		activeList.emplace_back(CommandLists[(int)Pass::SHADOW_DEPTH0]);
 		activeList.emplace_back(CommandLists[(int)Pass::SHADOW_DEPTH1]);
 		activeList.emplace_back(CommandLists[(int)Pass::SHADOW_DEPTH2]);
 		activeList.emplace_back(CommandLists[(int)Pass::SHADOW_DEPTH3]);
 	}
-
-	Taskflow.emplace([this, &scene, GPUScene]() {
-		if(!scene->SceneInfo.bRaytraceDirectionalLight)
-			ShadowMaskPass->DrawShadowMask(scene->SceneInfo, RenderTargets);
-		else
-			ShadowMaskPass->RaytraceShadowMask(scene->SceneInfo, GPUScene, RenderTargets);
-	});
 	activeList.emplace_back(CommandLists[(int)Pass::SHADOW_MASK]);
-
-	if (scene->DebugInfo.bEnableLightGrid)
-	{
-		Taskflow.emplace([this, &scene, GPUScene]() {
-			DeferredLightPass->LightGridPass(scene->SceneInfo, RenderTargets, GPUScene);
-		});
-	}
-	else 
-	{
-		Taskflow.emplace([this, &scene, GPUScene]() {
-			DeferredLightPass->LightPass(scene->SceneInfo, RenderTargets, GPUScene);
-		});
-	}
 	activeList.emplace_back(CommandLists[(int)Pass::LIGHT]);
-
-	Taskflow.emplace([this, &scene]() {
-		SkyPass->DrawSky(scene->SceneInfo, RenderTargets);
-	});
 	activeList.emplace_back(CommandLists[(int)Pass::SKY]);
 
+	FrameGraph.SetEnabled(FrameTasks.Bloom, scene->SceneInfo.bEnableBloom);
 	if (scene->SceneInfo.bEnableBloom)
-	{
-		Taskflow.emplace([this, &scene]() {
-			BloomPass->Bloom(scene->SceneInfo, RenderTargets);
-			});
 		activeList.emplace_back(CommandLists[(int)Pass::BLOOM]);
-	}
-
-	Taskflow.emplace([this, _dt]() {
-		AutomaticExposurePass->GetAdaptedLuminance(_dt, RenderTargets);
-		});
 	activeList.emplace_back(CommandLists[(int)Pass::EXPOSURE]);
-
-	nvrhi::BufferHandle exposure = AutomaticExposurePass->AdaptedLuminanceHandle;
-	Taskflow.emplace([this, &scene, exposure]() {
-		ToneMapPass->ToneMap(scene->SceneInfo, exposure, RenderTargets);
-		});
-
 	activeList.emplace_back(CommandLists[(int)Pass::TONEMAP]);
 
+	FrameGraph.SetEnabled(FrameTasks.FSR, scene->SceneInfo.bEnableFSR);
 	if (scene->SceneInfo.bEnableFSR)
-	{
-		Taskflow.emplace([this, &scene, _dt]() {
-			FSRPass->Upscale(scene->SceneInfo, RenderTargets, _dt);
-			});
 		activeList.emplace_back(CommandLists[(int)Pass::TAA]);
-	}
-	
+	FrameGraph.SetEnabled(FrameTasks.IntelTAA, scene->SceneInfo.bEnableIntelTAA);
 	if (scene->SceneInfo.bEnableIntelTAA)
-	{
-		Taskflow.emplace([this, &scene, _dt]() {
-			IntelTAAPass->TemporalAA(RenderTargets, scene->SceneInfo, Vector2(scene->JitterOffsetsX[scene->PhaseIndex], scene->JitterOffsetsY[scene->PhaseIndex]));
-			});
 		activeList.emplace_back(CommandLists[(int)Pass::TAA]);
-	}
-
-	Taskflow.emplace([this, &scene]() {
-		DebugPass->DrawDebug(scene->StaticInstanceDebugBufferHandle, scene->StaticDebugInstanceDatas.size(), scene->LineBufferHandle, scene->LineVertices.size(), scene->SceneInfo, RenderTargets);
-	});
 	activeList.emplace_back(CommandLists[(int)Pass::DEBUG]);
 
-	if (scene->DebugInfo.DbgTarget)
-	{
-		Taskflow.emplace([this, &scene, GPUScene]() {
-			FramebufferViewer->DrawTarget(GPUScene, scene->DebugInfo.DbgTarget, scene->DebugInfo.Add, scene->DebugInfo.Mul, scene->DebugInfo.CompCount, RenderTargets);
-		});
-		activeList.emplace_back(CommandLists[(int)Pass::FB_VIEWER]);
-	}
-	else if (scene->DebugInfo.bShowLightGrid)
-	{
-		Taskflow.emplace([this, &scene, GPUScene]() {
-			FramebufferViewer->DrawLightGridHitMap(GPUScene, scene->SceneInfo, scene->DebugInfo, RenderTargets);
-			});
+	const bool bDrawTarget = scene->DebugInfo.DbgTarget;
+	const bool bDrawLightGrid = !bDrawTarget && scene->DebugInfo.bShowLightGrid;
+	//dlss draws the final quad itself after the upscale
+	const bool bDrawFinal = !bDrawTarget && !bDrawLightGrid && (!scene->SceneInfo.bEnableDLSS || scene->SceneInfo.bEnableFSR);
+	FrameGraph.SetEnabled(FrameTasks.TargetView, bDrawTarget);
+	FrameGraph.SetEnabled(FrameTasks.LightGridView, bDrawLightGrid);
+	FrameGraph.SetEnabled(FrameTasks.Final, bDrawFinal);
+	if (bDrawTarget || bDrawLightGrid)
 		activeList.emplace_back(CommandLists[(int)Pass::FB_VIEWER]);
-	}
-	else {
-		if (!scene->SceneInfo.bEnableDLSS && !scene->SceneInfo.bEnableFSR)
-		{
-			Taskflow.emplace([this]() {
-				FinalPass->MeshletPass(RenderTargets, false);
-				});
-			activeList.emplace_back(CommandLists[(int)Pass::FINAL]);
-		}
-		else if (scene->SceneInfo.bEnableFSR)
-		{
-			Taskflow.emplace([this]() {
-				FinalPass->MeshletPass(RenderTargets, true);
-				});
-			activeList.emplace_back(CommandLists[(int)Pass::FINAL]);
-		}
-	}
+	else if (bDrawFinal)
+		activeList.emplace_back(CommandLists[(int)Pass::FINAL]);
 
-	Taskflow.emplace([&imgui]() {
-		imgui->Render();
-	});
-
-	SExecutor::Executor.run(Taskflow).wait();
+	FrameGraph.Run();
 	//submit the logs in the order of executions
 	{
 		RD_SCOPE(Render, ExecuteCommandList);
@@ -364,6 +246,108 @@ void Renderer::Render(ragdoll::Scene* scene, ragdoll::FGPUScene* GPUScene, float
 	DirectXDevice::GetNativeDevice()->executeCommandList(imgui->CommandList);
 
 	EnterCommandListSectionGpu::Reset();
+	//every pass of this frame has recorded, no pipeline lookups until the next frame
+	AssetManager::GetInstance()->ProcessShaderReload();
+}
+
+void Renderer::BuildFrameGraph()
+{
+	//every pass records its own command list, only the ui waits for another pass
+	FrameGraph.Add("Render", "Garbage Collection", []() {
+		DirectXDevice::GetNativeDevice()->runGarbageCollection();
+	});
+	FrameGraph.Add("Render", "Begin Frame", [this]() {
+		BeginFrame();
+	});
+	FrameGraph.Add("Render", "Sky Generate", [this]() {
+		SkyGeneratePass->GenerateSky(Frame.Scene->SceneInfo, RenderTargets);
+	});
+	FrameGraph.Add("Render", "GBuffer", [this]() {
+		ragdoll::Scene* scene = Frame.Scene;
+		const uint32_t ProxyCount = static_cast<uint32_t>(scene->StaticProxies.size());
+		if (!scene->SceneInfo.bEnableMeshletShading)
+		{
+			GBufferPass->Draw(
+				Frame.GPUScene,
+				ProxyCount,
+				scene->SceneInfo,
+				scene->DebugInfo,
+				RenderTargets,
+				scene->SceneInfo.bEnableOcclusionCull);
+		}
+		else
+		{
+			GBufferPass->DrawMeshlets(
+				Frame.GPUScene,
+				ProxyCount,
+				scene->SceneInfo,
+				scene->DebugInfo,
+				RenderTargets);
+		}
+	});
+	FrameTasks.CACAO = FrameGraph.Add("Render", "CACAO", [this]() {
+		CACAOPass->GenerateAO(Frame.Scene->SceneInfo, RenderTargets);
+	});
+	FrameTasks.XeGTAO = FrameGraph.Add("Render", "XeGTAO", [this]() {
+		XeGTAOPass->GenerateAO(Frame.Scene->SceneInfo, RenderTargets);
+	});
+	static const char* ShadowNames[4] = { "Shadow Depth 0", "Shadow Depth 1", "Shadow Depth 2", "Shadow Depth 3" };
+	for (int Cascade = 0; Cascade < 4; ++Cascade)
+	{
+		FrameTasks.ShadowDepth[Cascade] = FrameGraph.Add("Render", ShadowNames[Cascade], [this, Cascade]() {
+			ShadowPass->DrawAllInstances(Cascade, Frame.GPUScene, Frame.Scene->StaticProxies.size(), Frame.Scene->SceneInfo, RenderTargets);
+		});
+	}
+	FrameGraph.Add("Render", "Shadow Mask", [this]() {
+		if (!Frame.Scene->SceneInfo.bRaytraceDirectionalLight)
+			ShadowMaskPass->DrawShadowMask(Frame.Scene->SceneInfo, RenderTargets);
+		else
+			ShadowMaskPass->RaytraceShadowMask(Frame.Scene->SceneInfo, Frame.GPUScene, RenderTargets);
+	});
+	FrameGraph.Add("Render", "Light", [this]() {
+		if (Frame.Scene->DebugInfo.bEnableLightGrid)
+			DeferredLightPass->LightGridPass(Frame.Scene->SceneInfo, RenderTargets, Frame.GPUScene);
+		else
+			DeferredLightPass->LightPass(Frame.Scene->SceneInfo, RenderTargets, Frame.GPUScene);
+	});
+	FrameGraph.Add("Render", "Sky", [this]() {
+		SkyPass->DrawSky(Frame.Scene->SceneInfo, RenderTargets);
+	});
+	FrameTasks.Bloom = FrameGraph.Add("Render", "Bloom", [this]() {
+		BloomPass->Bloom(Frame.Scene->SceneInfo, RenderTargets);
+	});
+	FrameGraph.Add("Render", "Exposure", [this]() {
+		AutomaticExposurePass->GetAdaptedLuminance(Frame.Dt, RenderTargets);
+	});
+	FrameGraph.Add("Render", "Tone Map", [this]() {
+		ToneMapPass->ToneMap(Frame.Scene->SceneInfo, Frame.Exposure, RenderTargets);
+	});
+	FrameTasks.FSR = FrameGraph.Add("Render", "FSR", [this]() {
+		FSRPass->Upscale(Frame.Scene->SceneInfo, RenderTargets, Frame.Dt);
+	});
+	FrameTasks.IntelTAA = FrameGraph.Add("Render", "Intel TAA", [this]() {
+		ragdoll::Scene* scene = Frame.Scene;
+		IntelTAAPass->TemporalAA(RenderTargets, scene->SceneInfo, Vector2(scene->JitterOffsetsX[scene->PhaseIndex], scene->JitterOffsetsY[scene->PhaseIndex]));
+	});
+	FrameGraph.Add("Render", "Debug", [this]() {
+		ragdoll::Scene* scene = Frame.Scene;
+		DebugPass->DrawDebug(scene->StaticInstanceDebugBufferHandle, scene->StaticDebugInstanceDatas.size(), scene->LineBufferHandle, scene->LineVertices.size(), scene->SceneInfo, RenderTargets);
+	});
+	FrameTasks.TargetView = FrameGraph.Add("Render", "Target View", [this]() {
+		ragdoll::Scene* scene = Frame.Scene;
+		FramebufferViewer->DrawTarget(Frame.GPUScene, scene->DebugInfo.DbgTarget, scene->DebugInfo.Add, scene->DebugInfo.Mul, scene->DebugInfo.CompCount, RenderTargets);
+	});
+	FrameTasks.LightGridView = FrameGraph.Add("Render", "Light Grid View", [this]() {
+		FramebufferViewer->DrawLightGridHitMap(Frame.GPUScene, Frame.Scene->SceneInfo, Frame.Scene->DebugInfo, RenderTargets);
+	});
+	FrameTasks.Final = FrameGraph.Add("Render", "Final", [this]() {
+		FinalPass->MeshletPass(RenderTargets, Frame.Scene->SceneInfo.bEnableFSR);
+	});
+	const uint32_t ImGuiTask = FrameGraph.Add("Render", "ImGui", [this]() {
+		Frame.Imgui->Render();
+	});
+	//the ui writes the settings the final pass reads and draws over its output
+	FrameGraph.Precede(FrameTasks.Final, ImGuiTask);
 }
 
 void Renderer::CreateResource()
@@ -1,5 +1,6 @@
 #pragma once
 #include <nvrhi/nvrhi.h>
+#include "Ragdoll/Executor.h"
 
 #include "RenderPasses/SkyGeneratePass.h"
 #include "RenderPasses/GBufferPass.h"
@@ -89,4 +90,30 @@ private:
 	std::shared_ptr<ragdoll::Window> PrimaryWindowRef;
 	//handled at renderer
 	void CreateResource();
+	//a task per pass, built on the first frame and reused by every frame after
+	void BuildFrameGraph();
+
+	//what the pass tasks read, set before the frame graph runs
+	struct
+	{
+		ragdoll::Scene* Scene{};
+		ragdoll::FGPUScene* GPUScene{};
+		float Dt{};
+		ImguiRenderer* Imgui{};
+		nvrhi::BufferHandle Exposure;
+	} Frame;
+	JobGraph FrameGraph;
+	//the tasks a frame switches on and off
+	struct
+	{
+		uint32_t CACAO;
+		uint32_t XeGTAO;
+		uint32_t ShadowDepth[4];
+		uint32_t Bloom;
+		uint32_t FSR;
+		uint32_t IntelTAA;
+		uint32_t TargetView;
+		uint32_t LightGridView;
+		uint32_t Final;
+	} FrameTasks{};
 };
\ No newline at end of file
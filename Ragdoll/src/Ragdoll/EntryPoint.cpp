@@ -30,8 +30,32 @@ ________________________________________________________________________________
 #pragma once
 #include "ragdollpch.h"
 #include "Application.h"
+#include "TextureCompression.h"
+#include "TextureStreamer.h"
+#include "File/FileManager.h"
+#include "PipelineManifest.h"
+#include "ShaderBuild.h"
+#include "Executor.h"
+#include "LodSelection.h"
+#include "AccessorDecode.h"
+#include "TextureResidency.h"
 #include <cxxopts.hpp>
 
+namespace
+{
+	//checks that run without a window, only the logger and the executor are up
+	struct HeadlessCheck
+	{
+		const char* Name;
+		//false on any failure, empty when there is nothing to check
+		std::function<bool()> Verify;
+		//only runs for --bench once the check passed, empty when there is nothing to time
+		std::function<void()> Benchmark;
+		//the benchmark reads --input
+		bool bNeedsInput{ false };
+	};
+}
+
 ragdoll::Application* ragdoll::CreateApplication()
 {
 	return new Application();
@@ -53,18 +77,165 @@ int main(int argc, char* argv[])
 		("dbgOctree", "Draw Octree debug")
 		("dbgBoxes", "Draw Bounding Box")
 		("dlss", "Enable DLSS")
+		("legacyLoad", "Copy glTF buffers and images through tinygltf instead of mapping the files")
+		("noMeshCache", "Always decode meshes and build meshlets instead of using the cooked mesh cache")
+		("quantizeVertices", "Upload the global vertex buffer in the packed 20 byte vertex layout")
+		("noMeshOptimize", "Skip the vertex cache, overdraw and vertex fetch optimization of imported meshes")
+		("meshStats", "Import the scene without the mesh cache, log the ACMR/ATVR of every mesh then exit")
+		("lodCount", "Number of simplified lods generated for every mesh, 0 disables them", cxxopts::value<uint32_t>())
+		("textureBudget", "Gpu memory in MB the streamed textures may use", cxxopts::value<uint32_t>())
+		("textureCpuBudget", "Memory in MB the decoded texture pixels waiting for upload may use", cxxopts::value<uint32_t>())
+		("firstFrameTextureMs", "How long the first frame waits for the texture mip tails", cxxopts::value<double>())
+		("noTextureCompression", "Upload png and jpg textures as rgba8 instead of block compressing them")
+		("fastTextureCompression", "Block compress png and jpg textures to bc1 and bc3 instead of bc7")
+		("noTextureCache", "Always compress textures instead of using the cooked texture cache")
+		("textureReport", "Block compress every png and jpg under the path, report the psnr and throughput of each format then exit without a window", cxxopts::value<std::string>())
+		("ioWorkers", "Threads the file manager reads with", cxxopts::value<uint32_t>())
+		("streamIO", "Read files with blocking stream reads instead of batched overlapped or io_uring reads")
+		("archive", "Mount the packed asset archive at the path over the asset root, relative to the root or absolute", cxxopts::value<std::string>())
+		("packAssets", "Pack every file under the asset root into an archive at the path then exit without a window", cxxopts::value<std::string>())
+		("noPipelineManifest", "Create every pipeline on first use instead of replaying the ones the last run created, and do not record them")
+		("buildShaders", "Compile the permutations of shaders.cfg whose sources changed into cso/ with dxc then exit without a window")
+		("verify", "Run the named check then exit with 1 if it failed. Without a window: jobs, lod, fileIO, archive, pipelineCache, pipelineWarmup, shaderBuild, accessors, textureStreaming. "
+			"After loading the scene: meshDecode, vertexPacking, clusterLod, meshletBounds, tangents", cxxopts::value<std::string>())
+		("bench", "Run the named check and time it once it passes then exit with 1 if it failed, the names of --verify except lod, meshDecode and clusterLod, "
+			"plus decodeMemory without a window and load after loading the scene", cxxopts::value<std::string>())
+		("input", "Path the archive benchmark reads the archive from and the decodeMemory benchmark reads images under", cxxopts::value<std::string>())
 		;
 	auto result = options.parse(argc, argv);
 	ragdoll::Application::ApplicationConfig config;
 	config.bCreateCustomMeshes = result["custom"].as_optional<bool>().value_or(false);
 	config.bDrawDebugBoundingBoxes = result["dbgBoxes"].as_optional<bool>().value_or(false);
 	config.bInitDLSS = result["dlss"].as_optional<bool>().value_or(false);
+	config.bLegacyGLTFLoad = result["legacyLoad"].as_optional<bool>().value_or(false);
+	config.bUseMeshCache = !result["noMeshCache"].as_optional<bool>().value_or(false);
+	config.bQuantizedVertices = result["quantizeVertices"].as_optional<bool>().value_or(false);
+	config.bOptimizeMeshes = !result["noMeshOptimize"].as_optional<bool>().value_or(false);
+	config.bMeshImportStats = result["meshStats"].as_optional<bool>().value_or(false);
+	config.LodCount = result["lodCount"].as_optional<uint32_t>().value_or(config.LodCount);
+	config.TextureBudgetMB = result["textureBudget"].as_optional<uint32_t>().value_or(config.TextureBudgetMB);
+	config.TextureCpuBudgetMB = result["textureCpuBudget"].as_optional<uint32_t>().value_or(config.TextureCpuBudgetMB);
+	config.FirstFrameTextureMs = result["firstFrameTextureMs"].as_optional<double>().value_or(config.FirstFrameTextureMs);
+	config.bCompressTextures = !result["noTextureCompression"].as_optional<bool>().value_or(false);
+	config.bFastTextureCompression = result["fastTextureCompression"].as_optional<bool>().value_or(false);
+	config.bUseTextureCache = !result["noTextureCache"].as_optional<bool>().value_or(false);
+	config.IOWorkerCount = result["ioWorkers"].as_optional<uint32_t>().value_or(config.IOWorkerCount);
+	config.bStreamIO = result["streamIO"].as_optional<bool>().value_or(false);
+	config.ArchivePath = result["archive"].as_optional<std::string>().value_or("");
+	config.bUsePipelineManifest = !result["noPipelineManifest"].as_optional<bool>().value_or(false);
 	config.glTfSampleSceneToLoad = result["sample"].as_optional<std::string>().value_or("");
 	config.glTfSceneToLoad = result["scene"].as_optional<std::string>().value_or("");
+	auto benchName = result["bench"].as_optional<std::string>();
+	config.CheckName = benchName ? *benchName : result["verify"].as_optional<std::string>().value_or("");
+	config.bRunBenchmark = benchName.has_value();
+	const std::string inputPath = result["input"].as_optional<std::string>().value_or("");
+
+	//headless, only needs the logger and the executor
+	if (auto reportPath = result["textureReport"].as_optional<std::string>())
+	{
+		ragdoll::Logger::Init();
+		ReportTextureCompression(*reportPath);
+		delete app;
+		return 0;
+	}
+	if (auto archivePath = result["packAssets"].as_optional<std::string>())
+	{
+		ragdoll::Logger::Init();
+		ragdoll::FileManager manager;
+		manager.Init();
+		const bool bPacked = ragdoll::PackedArchive::Build(manager.GetRoot(), *archivePath, {});
+		manager.Shutdown();
+		delete app;
+		return bPacked ? 0 : 1;
+	}
+	if (result["buildShaders"].as_optional<bool>().value_or(false))
+	{
+		ragdoll::Logger::Init();
+		ragdoll::FileManager manager;
+		manager.Init();
+		const std::filesystem::path root = manager.GetRoot();
+		manager.Shutdown();
+		std::unique_ptr<ShaderCompiler> compiler = ShaderCompiler::CreateDxc();
+		ShaderBuild build(root / "shaders.cfg", root / "cso", root / "cache" / "shaders");
+		bool bBuilt = false;
+		if (!compiler)
+			RD_CORE_ERROR("dxcompiler could not be loaded");
+		else if (build.LoadConfig())
+		{
+			const ShaderBuild::Result buildResult = build.Build(*compiler);
+			RD_CORE_INFO("{} of {} shaders compiled in {:.2f}ms, {} from the store, {} failed", buildResult.Compiled, buildResult.Permutations, buildResult.TotalMs, buildResult.Reused, buildResult.Failed);
+			bBuilt = buildResult.Failed == 0;
+		}
+		delete app;
+		return bBuilt ? 0 : 1;
+	}
+	if (!config.CheckName.empty())
+	{
+		ragdoll::FileManager::Settings fileSettings;
+		fileSettings.m_WorkerCount = config.IOWorkerCount;
+		fileSettings.m_Backend = config.bStreamIO ? ragdoll::IOBackend::Type::Stream : ragdoll::IOBackend::NativeType;
+		TextureStreamer::Settings textureSettings;
+		textureSettings.CpuBudgetBytes = size_t(config.TextureCpuBudgetMB) << 20;
+		textureSettings.bCompress = config.bCompressTextures;
+		textureSettings.Quality = config.bFastTextureCompression ? TextureEncodeQuality::Fast : TextureEncodeQuality::High;
+		const HeadlessCheck headlessChecks[] = {
+			{ "jobs", VerifyJobGraph, BenchmarkJobGraph },
+			{ "lod", VerifyLodSelection, {} },
+			{ "fileIO", [&] { return ragdoll::VerifyFileManager(fileSettings) && ragdoll::VerifyFileWrites(fileSettings); },
+				[&] { ragdoll::BenchmarkFileManager(fileSettings); ragdoll::BenchmarkFileBackends(fileSettings); ragdoll::BenchmarkFileWrites(fileSettings); } },
+			{ "archive", ragdoll::VerifyPackedArchive, [&] { ragdoll::BenchmarkPackedArchive(inputPath); }, true },
+			{ "pipelineCache", [] { return VerifyPipelineKeys() && VerifyPipelineCache(); }, BenchmarkPipelineLookup },
+			{ "pipelineWarmup", VerifyPipelineManifest, BenchmarkPipelineWarmup },
+			{ "shaderBuild", VerifyShaderBuild, [] {
+				ragdoll::FileManager manager;
+				manager.Init();
+				const std::filesystem::path root = manager.GetRoot();
+				manager.Shutdown();
+				BenchmarkShaderBuild(root);
+			} },
+			{ "accessors", VerifyAccessorDecoding, BenchmarkAccessorDecoding },
+			{ "textureStreaming", [] { return VerifyTextureResidency() && VerifyBlockCompression(); }, BenchmarkTextureResidency },
+			{ "decodeMemory", {}, [&] { TextureStreamer::BenchmarkDecodeMemory(inputPath, textureSettings); }, true },
+		};
+		for (const HeadlessCheck& check : headlessChecks)
+		{
+			if (config.CheckName != check.Name || !(config.bRunBenchmark ? bool(check.Benchmark) : bool(check.Verify)))
+				continue;
+			ragdoll::Logger::Init();
+			bool bPassed = true;
+			if (check.bNeedsInput && config.bRunBenchmark && inputPath.empty())
+			{
+				RD_CORE_ERROR("--bench {} needs --input <path>", check.Name);
+				bPassed = false;
+			}
+			else if (check.Verify)
+				bPassed = check.Verify();
+			if (bPassed && config.bRunBenchmark)
+				check.Benchmark();
+			delete app;
+			return bPassed ? 0 : 1;
+		}
+		if (!ragdoll::Application::HasSceneCheck(config.CheckName, config.bRunBenchmark))
+		{
+			ragdoll::Logger::Init();
+			std::string names;
+			for (const HeadlessCheck& check : headlessChecks)
+			{
+				if (config.bRunBenchmark ? bool(check.Benchmark) : bool(check.Verify))
+					names += std::string(check.Name) + ", ";
+			}
+			RD_CORE_ERROR("There is no {} called {}, the ones without a window are {}and the ones after loading the scene are {}",
+				config.bRunBenchmark ? "benchmark" : "check", config.CheckName, names, ragdoll::Application::GetSceneCheckNames(config.bRunBenchmark));
+			delete app;
+			return 1;
+		}
+	}
 
 	app->Init(config);
 	app->Run();
 	app->Shutdown();
 
+	const int exitCode = app->GetExitCode();
 	delete app;
-}
\ No newline at end of file
+	return exitCode;
+}
@@ -1,4 +1,446 @@
 #include "ragdollpch.h"
 #include "Executor.h"
 
-tf::Executor SExecutor::Executor = tf::Executor(TF_THREAD_COUNT);
\ No newline at end of file
+#include "Profiler.h"
+
+namespace
+{
+	std::mutex BackgroundMutex;
+	std::condition_variable BackgroundIdle;
+	std::deque<std::function<void()>> BackgroundQueue;
+	//guarded by BackgroundMutex
+	uint32_t BackgroundRunning{};
+	std::atomic<uint32_t> GraphsRunning{};
+
+	uint32_t GetBackgroundLimit()
+	{
+		const uint32_t Workers = static_cast<uint32_t>(SExecutor::Executor.num_workers());
+		return GraphsRunning.load(std::memory_order_acquire) > 0 ? std::max(1u, Workers / 4) : Workers;
+	}
+
+	//hands queued background jobs to the executor up to the limit, called whenever a job finishes or a graph stops holding them back
+	void PumpBackground()
+	{
+		std::vector<std::function<void()>> Started;
+		{
+			std::lock_guard<std::mutex> Lock(BackgroundMutex);
+			const uint32_t Limit = GetBackgroundLimit();
+			while (!BackgroundQueue.empty() && BackgroundRunning < Limit)
+			{
+				Started.push_back(std::move(BackgroundQueue.front()));
+				BackgroundQueue.pop_front();
+				++BackgroundRunning;
+			}
+		}
+		for (std::function<void()>& Job : Started)
+		{
+			SExecutor::Executor.silent_async([Job = std::move(Job)]() {
+				{
+					RD_SCOPE(Job, Background);
+					Job();
+				}
+				{
+					std::lock_guard<std::mutex> Lock(BackgroundMutex);
+					--BackgroundRunning;
+					if (BackgroundRunning == 0 && BackgroundQueue.empty())
+						BackgroundIdle.notify_all();
+				}
+				PumpBackground();
+			});
+		}
+	}
+}
+
+tf::Executor SExecutor::Executor = tf::Executor(SExecutor::GetWorkerCount());
+
+uint32_t SExecutor::GetWorkerCount()
+{
+	//hardware_concurrency is 0 when it does not know, 8 is what the executor always had before
+	const uint32_t Threads = std::thread::hardware_concurrency();
+	if (Threads == 0)
+		return 8;
+	//a single core still needs a worker, the main thread is not one
+	return std::max(1u, Threads - 1);
+}
+
+void SExecutor::Background(std::function<void()> job)
+{
+	{
+		std::lock_guard<std::mutex> Lock(BackgroundMutex);
+		BackgroundQueue.push_back(std::move(job));
+	}
+	PumpBackground();
+}
+
+size_t SExecutor::GetBackgroundCount()
+{
+	std::lock_guard<std::mutex> Lock(BackgroundMutex);
+	return BackgroundQueue.size() + BackgroundRunning;
+}
+
+void SExecutor::WaitForBackground()
+{
+	std::unique_lock<std::mutex> Lock(BackgroundMutex);
+	BackgroundIdle.wait(Lock, []() { return BackgroundRunning == 0 && BackgroundQueue.empty(); });
+}
+
+void SExecutor::Run(tf::Taskflow& taskflow)
+{
+	if (Executor.this_worker_id() >= 0)
+		Executor.corun(taskflow);
+	else
+		Executor.run(taskflow).wait();
+}
+
+struct JobGraph::State
+{
+	struct Task
+	{
+		std::function<void()> Work;
+		std::vector<uint32_t> Successors;
+		uint32_t PredecessorCount{};
+		bool bEnabled{ true };
+		MicroProfileToken Token{};
+		std::atomic<uint32_t> Pending{};
+	};
+
+	tf::Executor* Executor{};
+	//tasks never move, the atomics in them can not
+	std::deque<Task> Tasks;
+	std::atomic<uint32_t> Remaining{};
+	//a task readied while the running thread sleeps goes to it instead of the executor, guarded by Mutex
+	std::mutex Mutex;
+	std::condition_variable Condition;
+	std::vector<uint32_t> Ready;
+	bool bWaiting{};
+};
+
+void JobGraph::Execute(const std::shared_ptr<State>& graph, uint32_t task)
+{
+	//whoever finishes a task keeps going with the first successor it readied, only the rest are handed out
+	for (uint32_t Current = task; Current != UINT32_MAX;)
+	{
+		State::Task& Task = graph->Tasks[Current];
+		if (Task.bEnabled)
+		{
+			ProfileScope Scope(Task.Token);
+			Task.Work();
+		}
+		uint32_t Next = UINT32_MAX;
+		for (uint32_t Successor : Task.Successors)
+		{
+			if (graph->Tasks[Successor].Pending.fetch_sub(1, std::memory_order_acq_rel) != 1)
+				continue;
+			if (Next == UINT32_MAX)
+				Next = Successor;
+			else
+				MakeReady(graph, Successor);
+		}
+		//nothing of the task is touched after this, the next run may already be resetting it
+		if (graph->Remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			std::lock_guard<std::mutex> Lock(graph->Mutex);
+			graph->Condition.notify_all();
+		}
+		Current = Next;
+	}
+}
+
+void JobGraph::MakeReady(const std::shared_ptr<State>& graph, uint32_t task)
+{
+	{
+		std::lock_guard<std::mutex> Lock(graph->Mutex);
+		if (graph->bWaiting && graph->Ready.empty())
+		{
+			graph->Ready.push_back(task);
+			graph->Condition.notify_one();
+			return;
+		}
+	}
+	graph->Executor->silent_async([graph, task]() { Execute(graph, task); });
+}
+
+JobGraph::JobGraph(tf::Executor& executor) : Graph(std::make_shared<State>())
+{
+	Graph->Executor = &executor;
+}
+
+uint32_t JobGraph::Add(const char* group, const char* name, std::function<void()> work)
+{
+	State::Task& Task = Graph->Tasks.emplace_back();
+	Task.Work = std::move(work);
+	Task.Token = MicroProfileGetToken(group, name, MP_AUTO, MicroProfileTokenTypeCpu, 0);
+	return static_cast<uint32_t>(Graph->Tasks.size() - 1);
+}
+
+void JobGraph::Precede(uint32_t before, uint32_t after)
+{
+	Graph->Tasks[before].Successors.push_back(after);
+	++Graph->Tasks[after].PredecessorCount;
+}
+
+void JobGraph::SetEnabled(uint32_t task, bool bEnabled)
+{
+	Graph->Tasks[task].bEnabled = bEnabled;
+}
+
+size_t JobGraph::GetTaskCount() const
+{
+	return Graph->Tasks.size();
+}
+
+void JobGraph::Run()
+{
+	if (Graph->Tasks.empty())
+		return;
+	GraphsRunning.fetch_add(1, std::memory_order_acq_rel);
+	Graph->Remaining.store(static_cast<uint32_t>(Graph->Tasks.size()), std::memory_order_relaxed);
+	Graph->Ready.clear();
+	for (State::Task& Task : Graph->Tasks)
+		Task.Pending.store(Task.PredecessorCount, std::memory_order_relaxed);
+	//the running thread keeps the first root for itself
+	uint32_t First = UINT32_MAX;
+	for (uint32_t i = 0; i < Graph->Tasks.size(); ++i)
+	{
+		if (Graph->Tasks[i].PredecessorCount != 0)
+			continue;
+		if (First == UINT32_MAX)
+			First = i;
+		else
+			MakeReady(Graph, i);
+	}
+	Execute(Graph, First);
+
+	if (Graph->Executor->this_worker_id() >= 0)
+	{
+		//a worker must not sleep, everything it handed out may be queued behind it, it runs executor work until the graph is done
+		Graph->Executor->corun_until([this]() { return Graph->Remaining.load(std::memory_order_acquire) == 0; });
+	}
+	else
+	{
+		//sleep until the graph is done or a task is readied while nothing else is running it
+		std::unique_lock<std::mutex> Lock(Graph->Mutex);
+		while (Graph->Remaining.load(std::memory_order_acquire) != 0)
+		{
+			if (!Graph->Ready.empty())
+			{
+				const uint32_t Task = Graph->Ready.back();
+				Graph->Ready.pop_back();
+				Lock.unlock();
+				Execute(Graph, Task);
+				Lock.lock();
+				continue;
+			}
+			Graph->bWaiting = true;
+			Graph->Condition.wait(Lock);
+			Graph->bWaiting = false;
+		}
+	}
+	GraphsRunning.fetch_sub(1, std::memory_order_acq_rel);
+	PumpBackground();
+}
+
+bool VerifyJobGraph()
+{
+	bool bPassed = true;
+	auto Check = [&bPassed](bool bCondition, const std::string& what) {
+		if (!bCondition)
+		{
+			RD_CORE_ERROR("Job graph check failed: {}", what);
+			bPassed = false;
+		}
+	};
+
+	//random edges from lower to higher tasks, every task checks its predecessors finished before it started
+	constexpr uint32_t TaskCount = 256;
+	std::mt19937 Random(7);
+	JobGraph Graph;
+	std::vector<std::vector<uint32_t>> Predecessors(TaskCount);
+	std::vector<std::atomic<uint32_t>> Runs(TaskCount);
+	std::vector<std::atomic<uint64_t>> Finished(TaskCount);
+	std::atomic<uint64_t> Clock{};
+	std::atomic<uint32_t> OutOfOrder{};
+	for (uint32_t i = 0; i < TaskCount; ++i)
+	{
+		Graph.Add("Job", "Verify", [&, i]() {
+			const uint64_t Start = Clock.fetch_add(1, std::memory_order_acq_rel) + 1;
+			for (uint32_t Predecessor : Predecessors[i])
+			{
+				const uint64_t PredecessorEnd = Finished[Predecessor].load(std::memory_order_acquire);
+				if (PredecessorEnd == 0 || PredecessorEnd > Start)
+					OutOfOrder.fetch_add(1, std::memory_order_relaxed);
+			}
+			Runs[i].fetch_add(1, std::memory_order_relaxed);
+			Finished[i].store(Clock.fetch_add(1, std::memory_order_acq_rel) + 1, std::memory_order_release);
+		});
+		for (uint32_t Edge = 0; i > 0 && Edge < Random() % 4; ++Edge)
+		{
+			const uint32_t Predecessor = Random() % i;
+			if (std::find(Predecessors[i].begin(), Predecessors[i].end(), Predecessor) != Predecessors[i].end())
+				continue;
+			Predecessors[i].push_back(Predecessor);
+			Graph.Precede(Predecessor, i);
+		}
+	}
+	std::vector<uint8_t> Enabled(TaskCount, 1);
+	std::vector<uint32_t> Expected(TaskCount);
+	for (uint32_t Frame = 0; Frame < 200; ++Frame)
+	{
+		for (std::atomic<uint64_t>& End : Finished)
+			End.store(0, std::memory_order_relaxed);
+		//a switched off task never stamps, its successors have to skip it
+		for (uint32_t i = 0; i < TaskCount; ++i)
+		{
+			Enabled[i] = Frame % 2 == 0 || Random() % 8 != 0;
+			Graph.SetEnabled(i, Enabled[i]);
+			Expected[i] += Enabled[i];
+			if (!Enabled[i])
+				Finished[i].store(1, std::memory_order_relaxed);
+		}
+		Graph.Run();
+	}
+	bool bCounts = true;
+	for (uint32_t i = 0; i < TaskCount; ++i)
+		bCounts &= Runs[i].load() == Expected[i];
+	Check(bCounts, "every enabled task runs once per run");
+	Check(OutOfOrder.load() == 0, "no task starts before its predecessors finished");
+
+	//a graph run from a worker helps on the worker
+	{
+		std::atomic<uint32_t> Inner{};
+		JobGraph Nested;
+		for (uint32_t i = 0; i < 64; ++i)
+			Nested.Add("Job", "Verify Nested", [&Inner]() { Inner.fetch_add(1, std::memory_order_relaxed); });
+		tf::Taskflow Outer;
+		Outer.emplace([&Nested]() { Nested.Run(); });
+		SExecutor::Run(Outer);
+		Check(Inner.load() == 64, "a graph runs from inside a worker");
+	}
+
+	//background jobs queued while a graph runs only get a quarter of the workers
+	{
+		const uint32_t Workers = static_cast<uint32_t>(SExecutor::Executor.num_workers());
+		const uint32_t Limit = std::max(1u, Workers / 4);
+		std::atomic<uint32_t> Running{}, MostRunning{}, Done{};
+		std::atomic<bool> bGraphRunning{ false };
+		JobGraph Frame;
+		Frame.Add("Job", "Verify Frame", [&]() {
+			bGraphRunning = true;
+			for (uint32_t i = 0; i < Workers * 4; ++i)
+			{
+				SExecutor::Background([&]() {
+					const uint32_t Now = Running.fetch_add(1) + 1;
+					if (bGraphRunning.load())
+					{
+						uint32_t Most = MostRunning.load();
+						while (Now > Most && !MostRunning.compare_exchange_weak(Most, Now));
+					}
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+					Running.fetch_sub(1);
+					Done.fetch_add(1);
+				});
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+			bGraphRunning = false;
+		});
+		Frame.Run();
+		SExecutor::WaitForBackground();
+		Check(MostRunning.load() <= Limit, fmt::format("{} background jobs ran next to a graph, the limit is {}", MostRunning.load(), Limit));
+		Check(Done.load() == Workers * 4 && SExecutor::GetBackgroundCount() == 0, "every background job runs once the graph is done");
+	}
+
+	if (bPassed)
+		RD_CORE_INFO("Job graph checks passed");
+	return bPassed;
+}
+
+void BenchmarkJobGraph()
+{
+	//a frame worth of passes that each do a little work, so the time is mostly scheduling
+	constexpr uint32_t TaskCount = 24;
+	constexpr uint32_t FrameCount = 5000;
+	std::atomic<uint64_t> Sink{};
+	auto Work = [&Sink]() {
+		uint64_t Value = 0;
+		for (uint32_t i = 0; i < 2000; ++i)
+			Value = Value * 6364136223846793005ull + i;
+		Sink.fetch_add(Value, std::memory_order_relaxed);
+	};
+	auto Time = [](auto&& frame) {
+		auto Start = std::chrono::high_resolution_clock::now();
+		for (uint32_t i = 0; i < FrameCount; ++i)
+			frame();
+		return std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - Start).count() / FrameCount;
+	};
+
+	const double Serial = Time([&]() {
+		for (uint32_t i = 0; i < TaskCount; ++i)
+			Work();
+	});
+	RD_CORE_INFO("Job scheduling, {} tasks a frame over {} frames, {:.1f}us a frame serial on one thread", TaskCount, FrameCount, Serial);
+	RD_CORE_INFO("  workers  taskflow rebuilt  taskflow reused  job graph");
+
+	//the shared executor is sized for this machine, smaller ones show how each scales with the worker count
+	std::vector<uint32_t> WorkerCounts;
+	for (uint32_t Workers = 1; Workers < SExecutor::GetWorkerCount(); Workers *= 2)
+		WorkerCounts.push_back(Workers);
+	WorkerCounts.push_back(SExecutor::GetWorkerCount());
+	for (uint32_t Workers : WorkerCounts)
+	{
+		tf::Executor Executor(Workers);
+		const double Rebuilt = Time([&]() {
+			tf::Taskflow Taskflow;
+			for (uint32_t i = 0; i < TaskCount; ++i)
+				Taskflow.emplace(Work);
+			Executor.run(Taskflow).wait();
+		});
+		tf::Taskflow Reused;
+		for (uint32_t i = 0; i < TaskCount; ++i)
+			Reused.emplace(Work);
+		const double ReusedTime = Time([&]() { Executor.run(Reused).wait(); });
+		JobGraph Graph(Executor);
+		for (uint32_t i = 0; i < TaskCount; ++i)
+			Graph.Add("Job", "Benchmark", Work);
+		const double GraphTime = Time([&]() { Graph.Run(); });
+		RD_CORE_INFO("  {:7}  {:14.1f}us  {:13.1f}us  {:7.1f}us", Workers, Rebuilt, ReusedTime, GraphTime);
+	}
+
+	//the same frame on the shared executor while background work floods the workers, handed straight to the executor and through the background queue
+	tf::Taskflow Reused;
+	for (uint32_t i = 0; i < TaskCount; ++i)
+		Reused.emplace(Work);
+	JobGraph Graph;
+	for (uint32_t i = 0; i < TaskCount; ++i)
+		Graph.Add("Job", "Benchmark", Work);
+	auto Flooded = [&](bool bBackgroundQueue, auto&& frame) {
+		constexpr uint32_t Frames = 200;
+		std::atomic<bool> bStop{ false };
+		std::function<void()> Decode;
+		Decode = [&]() {
+			std::this_thread::sleep_for(std::chrono::microseconds(500));
+			if (bStop.load())
+				return;
+			if (bBackgroundQueue)
+				SExecutor::Background(Decode);
+			else
+				SExecutor::Executor.silent_async(Decode);
+		};
+		for (size_t i = 0; i < SExecutor::Executor.num_workers() * 2; ++i)
+		{
+			if (bBackgroundQueue)
+				SExecutor::Background(Decode);
+			else
+				SExecutor::Executor.silent_async(Decode);
+		}
+		auto Start = std::chrono::high_resolution_clock::now();
+		for (uint32_t i = 0; i < Frames; ++i)
+			frame();
+		const double Us = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - Start).count() / Frames;
+		bStop = true;
+		SExecutor::WaitForBackground();
+		SExecutor::Executor.wait_for_all();
+		return Us;
+	};
+	RD_CORE_INFO("  flooded on {} workers, taskflow and executor background {:8.1f}us a frame", SExecutor::Executor.num_workers(), Flooded(false, [&]() { SExecutor::Executor.run(Reused).wait(); }));
+	RD_CORE_INFO("  flooded on {} workers, job graph and background queue   {:8.1f}us a frame", SExecutor::Executor.num_workers(), Flooded(true, [&]() { Graph.Run(); }));
+}
@@ -1,9 +1,59 @@
 #pragma once
 #include "taskflow.hpp"
 
-#define TF_THREAD_COUNT 8
-
 struct SExecutor
 {
 	static tf::Executor Executor;
-};
\ No newline at end of file
+
+	//one worker per hardware thread but the one the main thread runs on, it helps with every job graph it runs
+	static uint32_t GetWorkerCount();
+
+	//work that can wait, like texture decodes, started only on workers the job graphs of a frame do not need
+	//while a graph runs at most a quarter of the workers are handed background work, the rest is left for frame tasks
+	static void Background(std::function<void()> job);
+	//queued and running background jobs
+	static size_t GetBackgroundCount();
+	//blocks until every background job queued so far has run
+	static void WaitForBackground();
+
+	//runs a taskflow from wherever we are, a worker helps with it instead of blocking
+	static void Run(tf::Taskflow& taskflow);
+};
+
+//a task graph that is built once and run as often as needed, a frame switches off the tasks it does not need instead of rebuilding it
+//the thread that runs it works on it too and only sleeps while every ready task is already taken
+//tasks run at frame priority, background jobs are held back while any graph runs
+//nothing can be added or switched while the graph runs
+class JobGraph
+{
+public:
+	//tasks go to the shared executor, another one is only for comparing worker counts
+	explicit JobGraph(tf::Executor& executor = SExecutor::Executor);
+	JobGraph(const JobGraph&) = delete;
+	JobGraph& operator=(const JobGraph&) = delete;
+
+	//every task is profiled under group and name, both have to outlive the graph
+	uint32_t Add(const char* group, const char* name, std::function<void()> work);
+	//after only starts once before is done
+	void Precede(uint32_t before, uint32_t after);
+	//a task that is switched off still releases its successors, it just does not do its work
+	void SetEnabled(uint32_t task, bool bEnabled);
+	void Run();
+
+	size_t GetTaskCount() const;
+
+private:
+	//shared with the executor tasks of a run, the last of them may still be returning after the run is over
+	struct State;
+	std::shared_ptr<State> Graph;
+
+	//runs the task and then whichever successor it readied first, the other successors are handed out
+	static void Execute(const std::shared_ptr<State>& graph, uint32_t task);
+	//to the running thread if it is sleeping with nothing to do, otherwise to the executor, never to both
+	static void MakeReady(const std::shared_ptr<State>& graph, uint32_t task);
+};
+
+//checks every task of a graph runs once and after its predecessors, over reruns and switched off tasks, and that background jobs make way for graphs
+bool VerifyJobGraph();
+//cost of scheduling a frame worth of tiny tasks through a reused job graph against building and running a taskflow every frame, for every worker count up to the hardware
+void BenchmarkJobGraph();
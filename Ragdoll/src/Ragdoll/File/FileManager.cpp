@@ -31,76 +31,39 @@ ________________________________________________________________________________
 #include "ragdollpch.h"
 
 #include "FileManager.h"
+#include "Ragdoll/Executor.h"
 
 namespace ragdoll
 {
-	FileIORequest& FileIORequest::operator=(FileIORequest&& other) noexcept
+	namespace
 	{
-		if(this != &other)
+		void Deliver(FileIORequest& request, std::span<const uint8_t> data, bool bSuccess)
 		{
-			m_Path = std::move(other.m_Path);
-			m_Size = other.m_Size;
-			m_ReadCallback = std::move(other.m_ReadCallback);
-			m_Guid = other.m_Guid;
-			m_Type = other.m_Type;
+			if (request.m_Type == FileIORequest::Type::Read)
+			{
+				if (request.m_ReadCallback)
+					request.m_ReadCallback(request.m_Guid, data.data(), static_cast<uint32_t>(data.size()));
+			}
+			else if (request.m_WriteCallback)
+				request.m_WriteCallback(request.m_Guid, bSuccess);
 		}
-		return *this;
 	}
 
-	FileIORequest& FileIORequest::operator=(const FileIORequest& other)
+	FileManager::FileManager()
 	{
-		if (this != &other)
-		{
-			m_Path = other.m_Path;
-			m_Size = other.m_Size;
-			m_ReadCallback = other.m_ReadCallback;
-			m_Guid = other.m_Guid;
-			m_Type = other.m_Type;
-		}
-		return *this;
 	}
 
-	void FileManager::Buffer::Load(const std::filesystem::path& root)
-	{
-		m_Status = Status::Executing;
-		std::filesystem::path path = root / m_Request.m_Path;
-		if(!std::filesystem::exists(path))
-		{
-			RD_ASSERT(true, "File {} not found", path.string());
-			m_Status = Status::Idle;
-			return;
-		}
-		//only load byte data for the engine to use
-		std::ifstream file(root / m_Request.m_Path, std::ios::binary);
-		if (!file.is_open())
-		{
-			RD_ASSERT(true, "File {} unable to be opened", path.string());
-			m_Status = Status::Idle;
-			return;
-		}
-		//if size is 0, read the whole file
-		std::streamsize size = m_Request.m_Size;
-		if (m_Request.m_Size == 0)
-		{
-			file.seekg(0, std::ios::end);
-			size = file.tellg();
-			file.seekg(0, std::ios::beg);
-		}
-		m_Data.resize(size);
-		file.read(reinterpret_cast<char*>(m_Data.data()), size);
-		m_Status = Status::Callback;
-	}
-
-	FileManager::FileManager()
+	void FileManager::Init()
 	{
-		m_QueueMutex = std::make_unique<std::mutex>();
-		m_FileIOMutex = std::make_unique<std::mutex>();
-		m_FileIONextAccessMutex = std::make_unique<std::mutex>();
-		m_FileIOLowPriorityMutex = std::make_unique<std::mutex>();
+		Init(Settings{});
 	}
 
-	void FileManager::Init()
+	void FileManager::Init(const Settings& settings)
 	{
+		m_Settings = settings;
+		m_Settings.m_WorkerCount = std::max(m_Settings.m_WorkerCount, 1u);
+		m_BufferPool.SetLimit(m_Settings.m_MaxPooledBytes);
+		m_Backend = IOBackend::Create(m_Settings.m_Backend, m_Settings.m_BatchSize);
 		//TODO: should be config next time
 		m_Root = m_Root.parent_path() / "assets";
 		//check if the asset folder exists
@@ -119,109 +82,966 @@ namespace ragdoll
 			}
 		}
 
-		//start the io thread
+		//start the io threads
 		m_Running = true;
-		m_IOThread = std::thread(&FileManager::ThreadUpdate, this);
+		for (uint32_t i = 0; i < m_Settings.m_WorkerCount; ++i)
+			m_IOThreads.emplace_back(&FileManager::WorkerUpdate, this);
+		m_Writing = true;
+		m_WriteThread = std::thread(&FileManager::WriterUpdate, this);
 	}
 
 	void FileManager::Update()
 	{
-		for(auto& buffer : m_Buffer)
+		std::vector<Completed> completed;
+		{
+			std::lock_guard<std::mutex> lock(m_CompletedMutex);
+			completed.swap(m_CompletedQueue);
+		}
+		for (Completed& it : completed)
+		{
+			Deliver(it.m_Request, it.m_View.data() ? it.m_View : std::span<const uint8_t>(it.m_Data), it.m_bSuccess);
+			m_BufferPool.Release(std::move(it.m_Data));
+			Retire();
+		}
+	}
+
+	void FileManager::WorkerUpdate()
+	{
+		std::vector<FileIORequest> batch;
+		std::vector<IORead> reads;
+		//indices into batch of the requests that are not in an archive
+		std::vector<size_t> loose;
+		while (true)
 		{
-			if (buffer.m_Status == Buffer::Status::Callback)
+			batch.clear();
 			{
-				if(buffer.m_Request.m_ReadCallback)
-					buffer.m_Request.m_ReadCallback(buffer.m_Request.m_Guid, buffer.m_Data.data(), static_cast<uint32_t>(buffer.m_Data.size()));
-				buffer.m_Status = Buffer::Status::Idle;
+				std::unique_lock<std::mutex> lock(m_QueueMutex);
+				m_QueueCondition.wait(lock, [this]() {
+					return !m_Running || std::any_of(std::begin(m_RequestQueues), std::end(m_RequestQueues), [](const std::deque<FileIORequest>& queue) { return !queue.empty(); });
+				});
+				if (!m_Running)
+					return;
+				//a fair share of what is queued so one worker does not sit on a batch while the others idle
+				size_t queued = 0;
+				for (const std::deque<FileIORequest>& queue : m_RequestQueues)
+					queued += queue.size();
+				const size_t batchSize = std::clamp<size_t>(queued / m_Settings.m_WorkerCount, 1, m_Backend->GetMaxBatch());
+				for (std::deque<FileIORequest>& queue : m_RequestQueues)
+				{
+					while (!queue.empty() && batch.size() < batchSize)
+					{
+						batch.emplace_back(std::move(queue.front()));
+						queue.pop_front();
+					}
+				}
+			}
+
+			reads.clear();
+			loose.clear();
+			for (size_t i = 0; i < batch.size(); ++i)
+			{
+				FileIORequest& request = batch[i];
+				const PackedArchive* archive = nullptr;
+				if (const PackedArchive::Entry* entry = FindInArchives(request.m_Path, archive))
+				{
+					//stored entries are handed out straight from the mapping, deflated ones are inflated here
+					m_ArchiveReads.fetch_add(1, std::memory_order_relaxed);
+					m_Completed.fetch_add(1, std::memory_order_relaxed);
+					if (const uint8_t* view = archive->GetView(*entry))
+					{
+						const uint64_t offset = std::min(request.m_Offset, entry->m_Size);
+						const uint64_t size = request.m_Size ? std::min(request.m_Size, entry->m_Size - offset) : entry->m_Size - offset;
+						m_BytesRead.fetch_add(size, std::memory_order_relaxed);
+						Complete(std::move(request), {}, true, std::span<const uint8_t>(view + offset, static_cast<size_t>(size)));
+					}
+					else
+					{
+						std::vector<uint8_t> data = m_BufferPool.Acquire(static_cast<size_t>(entry->m_Size));
+						const bool bSuccess = archive->Read(*entry, request.m_Offset, request.m_Size, data);
+						m_BytesRead.fetch_add(data.size(), std::memory_order_relaxed);
+						Complete(std::move(request), std::move(data), bSuccess);
+					}
+					continue;
+				}
+				loose.push_back(i);
+				IORead& read = reads.emplace_back();
+				read.m_Path = m_Root / request.m_Path;
+				read.m_Offset = request.m_Offset;
+				read.m_Size = request.m_Size;
+			}
+			if (!reads.empty())
+				m_Backend->Read(reads, m_BufferPool);
+
+			for (size_t i = 0; i < loose.size(); ++i)
+			{
+				IORead& read = reads[i];
+				if (read.m_bSuccess)
+				{
+					m_Completed.fetch_add(1, std::memory_order_relaxed);
+					m_BytesRead.fetch_add(read.m_Data.size(), std::memory_order_relaxed);
+				}
+				else
+					m_Failed.fetch_add(1, std::memory_order_relaxed);
+				Complete(std::move(batch[loose[i]]), std::move(read.m_Data), read.m_bSuccess);
 			}
 		}
 	}
 
-	void FileManager::ThreadUpdate()
+	void FileManager::WriterUpdate()
 	{
-		while(m_Running)
+		std::deque<FileIORequest> queued;
+		std::vector<FileIORequest> batch;
+		std::vector<IOWrite> writes;
+		//bytes of the writes that had others merged into them
+		std::vector<std::vector<uint8_t>> merged;
+		//index into writes of every request of the batch
+		std::vector<size_t> owners;
+		std::unordered_map<std::filesystem::path::string_type, size_t> fileWrites;
+		while (true)
 		{
-			std::lock_guard<std::mutex> lock(*m_QueueMutex);
-			//check if there are any requests
-			if (m_RequestQueue.empty())
 			{
-				// Sleep for a bit
-				std::this_thread::sleep_for(std::chrono::milliseconds(1));
-				continue;
+				std::unique_lock<std::mutex> lock(m_WriteMutex);
+				m_WriteCondition.wait(lock, [this]() { return !m_Writing || !m_WriteQueue.empty(); });
+				//queued writes are still written on shutdown
+				if (m_WriteQueue.empty())
+					return;
+				queued.swap(m_WriteQueue);
 			}
-
-			// Get the next request
-			FileIORequest request = m_RequestQueue.top();
-			//all threaded loads are lower priority compared to immediate loading
-			m_FileIOLowPriorityMutex->lock();	//lock l
-			m_FileIONextAccessMutex->lock();	//lock n
-			m_FileIOMutex->lock();				//lock m
-			m_FileIONextAccessMutex->unlock();	//unlock n
-			if(request.m_Type == FileIORequest::Type::Read)
+			while (!queued.empty())
 			{
-				// Check for available buffers
-				Buffer* freeBuffer = nullptr;
-				if (m_Buffer[0].m_Status == Buffer::Status::Idle)
+				batch.clear();
+				writes.clear();
+				merged.clear();
+				owners.clear();
+				fileWrites.clear();
+				//a file is written at most once per batch, a write that does not continue the last write of its file starts the next batch
+				while (!queued.empty())
+				{
+					FileIORequest& request = queued.front();
+					const std::span<const uint8_t> data = request.GetWriteData();
+					const std::filesystem::path path = (m_Root / request.m_Path).lexically_normal();
+					auto found = fileWrites.find(path.native());
+					if (found != fileWrites.end())
+					{
+						IOWrite& last = writes[found->second];
+						const bool bContinues = (request.m_WriteMode == FileIORequest::WriteMode::Append && last.m_Mode != IOWrite::Mode::Patch)
+							|| (request.m_WriteMode == FileIORequest::WriteMode::Patch && last.m_Mode != IOWrite::Mode::Append && request.m_Offset == last.m_Offset + last.m_Data.size());
+						if (!bContinues || last.m_Data.size() + data.size() > m_Settings.m_MaxCoalescedBytes)
+							break;
+						std::vector<uint8_t>& bytes = merged[found->second];
+						if (bytes.empty())
+							bytes.assign(last.m_Data.begin(), last.m_Data.end());
+						bytes.insert(bytes.end(), data.begin(), data.end());
+						last.m_Data = bytes;
+						last.m_bFlush |= request.m_Flush == FileIORequest::Flush::Durable;
+						m_CoalescedWrites.fetch_add(1, std::memory_order_relaxed);
+						owners.push_back(found->second);
+					}
+					else
+					{
+						if (writes.size() == m_Settings.m_BatchSize)
+							break;
+						fileWrites.emplace(path.native(), writes.size());
+						owners.push_back(writes.size());
+						IOWrite& write = writes.emplace_back();
+						write.m_Path = path;
+						write.m_Mode = request.m_WriteMode == FileIORequest::WriteMode::Append ? IOWrite::Mode::Append
+							: request.m_WriteMode == FileIORequest::WriteMode::Patch ? IOWrite::Mode::Patch : IOWrite::Mode::Replace;
+						write.m_Offset = request.m_WriteMode == FileIORequest::WriteMode::Patch ? request.m_Offset : 0;
+						write.m_Data = data;
+						write.m_bFlush = request.m_Flush == FileIORequest::Flush::Durable;
+						merged.emplace_back();
+					}
+					//moving the request keeps its write buffer where it is so the spans stay valid
+					batch.emplace_back(std::move(request));
+					queued.pop_front();
+				}
+
+				m_Backend->Write(writes);
+
+				for (size_t i = 0; i < batch.size(); ++i)
 				{
-					freeBuffer = &m_Buffer[0];
+					const bool bSuccess = writes[owners[i]].m_bSuccess;
+					if (bSuccess)
+					{
+						m_Writes.fetch_add(1, std::memory_order_relaxed);
+						m_BytesWritten.fetch_add(batch[i].GetWriteData().size(), std::memory_order_relaxed);
+					}
+					else
+						m_FailedWrites.fetch_add(1, std::memory_order_relaxed);
+					//the bytes are on their way, no need to carry them to the callback
+					std::vector<uint8_t>().swap(batch[i].m_WriteBuffer);
+					Complete(std::move(batch[i]), {}, bSuccess);
 				}
-				else if (m_Buffer[1].m_Status == Buffer::Status::Idle)
+			}
+		}
+	}
+
+	void FileManager::Complete(FileIORequest&& request, std::vector<uint8_t>&& data, bool bSuccess, std::span<const uint8_t> view)
+	{
+		//a failed read still gets its callback with no data so nobody waits on it forever
+		if (request.m_Completion == FileIORequest::Completion::Task)
+		{
+			SExecutor::Executor.silent_async([this, request = std::move(request), data = std::move(data), bSuccess, view]() mutable {
+				Deliver(request, view.data() ? view : std::span<const uint8_t>(data), bSuccess);
+				m_BufferPool.Release(std::move(data));
+				Retire();
+			});
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(m_CompletedMutex);
+			m_CompletedQueue.push_back({ std::move(request), std::move(data), bSuccess, view });
+		}
+		//wakes WaitIdle so it can pump the callback
+		m_IdleCondition.notify_all();
+	}
+
+	void FileManager::Retire()
+	{
+		if (m_Pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			std::lock_guard<std::mutex> lock(m_IdleMutex);
+			m_IdleCondition.notify_all();
+		}
+	}
+
+	void FileManager::QueueRequest(FileIORequest request)
+	{
+		m_Pending.fetch_add(1, std::memory_order_acq_rel);
+		if (request.m_Type == FileIORequest::Type::Write)
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_WriteMutex);
+				m_WriteQueue.push_back(std::move(request));
+			}
+			m_WriteCondition.notify_one();
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(m_QueueMutex);
+			m_RequestQueues[static_cast<size_t>(request.m_Priority)].push_back(std::move(request));
+			uint64_t queued = 0;
+			for (const std::deque<FileIORequest>& queue : m_RequestQueues)
+				queued += queue.size();
+			if (queued > m_PeakQueued.load(std::memory_order_relaxed))
+				m_PeakQueued.store(queued, std::memory_order_relaxed);
+		}
+		m_QueueCondition.notify_one();
+	}
+
+	const uint8_t* FileManager::ImmediateLoad(std::filesystem::path path, uint32_t& size)
+	{
+		//high priority immediate loading blocking, reads next to the workers instead of waiting for them
+		std::lock_guard<std::mutex> lock(m_ImmediateMutex);
+		const PackedArchive* archive = nullptr;
+		if (const PackedArchive::Entry* entry = FindInArchives(path, archive))
+		{
+			m_ArchiveReads.fetch_add(1, std::memory_order_relaxed);
+			size = static_cast<uint32_t>(entry->m_Size);
+			if (const uint8_t* view = archive->GetView(*entry))
+				return view;
+			if (!archive->Read(*entry, 0, 0, m_ImmediateBuffer))
+				size = 0;
+			return m_ImmediateBuffer.data();
+		}
+		IORead read;
+		read.m_Path = m_Root / path;
+		m_Backend->Read({ &read, 1 }, m_BufferPool);
+		m_BufferPool.Release(std::move(m_ImmediateBuffer));
+		m_ImmediateBuffer = std::move(read.m_Data);
+		size = static_cast<uint32_t>(m_ImmediateBuffer.size());
+		return m_ImmediateBuffer.data();
+	}
+
+	bool FileManager::Mount(const std::filesystem::path& archivePath, const std::filesystem::path& mountPoint)
+	{
+		std::unique_ptr<PackedArchive> archive = std::make_unique<PackedArchive>();
+		if (!archive->Open(archivePath.is_absolute() ? archivePath : m_Root / archivePath))
+			return false;
+		RD_CORE_INFO("Mounted {} with {} files at /{}", archivePath.string(), archive->GetEntries().size(), mountPoint.generic_string());
+		std::unique_lock<std::shared_mutex> lock(m_ArchiveMutex);
+		m_Archives.push_back({ PackedArchive::NormalizePath(mountPoint), std::move(archive) });
+		return true;
+	}
+
+	const PackedArchive::Entry* FileManager::FindInArchives(const std::filesystem::path& path, const PackedArchive*& archive) const
+	{
+		std::shared_lock<std::shared_mutex> lock(m_ArchiveMutex);
+		if (m_Archives.empty())
+			return nullptr;
+		std::filesystem::path relative = path;
+		if (path.is_absolute())
+		{
+			//only what is under the root can be in an archive
+			relative = path.lexically_relative(m_Root);
+			if (relative.empty() || *relative.begin() == "..")
+				return nullptr;
+		}
+		const std::string normalized = PackedArchive::NormalizePath(relative);
+		for (auto it = m_Archives.rbegin(); it != m_Archives.rend(); ++it)
+		{
+			std::string_view name = normalized;
+			if (!it->m_MountPoint.empty())
+			{
+				if (name.size() <= it->m_MountPoint.size() || name.compare(0, it->m_MountPoint.size(), it->m_MountPoint) != 0 || name[it->m_MountPoint.size()] != '/')
+					continue;
+				name.remove_prefix(it->m_MountPoint.size() + 1);
+			}
+			if (const PackedArchive::Entry* entry = it->m_Archive->Find(name))
+			{
+				archive = it->m_Archive.get();
+				return entry;
+			}
+		}
+		return nullptr;
+	}
+
+	void FileManager::WaitIdle()
+	{
+		while (m_Pending.load(std::memory_order_acquire) > 0)
+		{
+			Update();
+			std::unique_lock<std::mutex> lock(m_IdleMutex);
+			if (m_Pending.load(std::memory_order_acquire) > 0)
+				m_IdleCondition.wait_for(lock, std::chrono::milliseconds(1));
+		}
+	}
+
+	FileManager::Stats FileManager::GetStats() const
+	{
+		Stats stats;
+		stats.m_Completed = m_Completed.load(std::memory_order_relaxed);
+		stats.m_Failed = m_Failed.load(std::memory_order_relaxed);
+		stats.m_BytesRead = m_BytesRead.load(std::memory_order_relaxed);
+		stats.m_BufferReuses = m_BufferPool.GetReuses();
+		stats.m_PeakQueued = m_PeakQueued.load(std::memory_order_relaxed);
+		stats.m_Writes = m_Writes.load(std::memory_order_relaxed);
+		stats.m_FailedWrites = m_FailedWrites.load(std::memory_order_relaxed);
+		stats.m_BytesWritten = m_BytesWritten.load(std::memory_order_relaxed);
+		stats.m_CoalescedWrites = m_CoalescedWrites.load(std::memory_order_relaxed);
+		stats.m_ArchiveReads = m_ArchiveReads.load(std::memory_order_relaxed);
+		return stats;
+	}
+
+	void FileManager::Shutdown()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_QueueMutex);
+			m_Running = false;
+		}
+		m_QueueCondition.notify_all();
+		for (std::thread& thread : m_IOThreads)
+		{
+			if (thread.joinable())
+				thread.join();
+		}
+		m_IOThreads.clear();
+		//every queued write still lands, only their main thread callbacks are dropped below
+		{
+			std::lock_guard<std::mutex> lock(m_WriteMutex);
+			m_Writing = false;
+		}
+		m_WriteCondition.notify_all();
+		if (m_WriteThread.joinable())
+			m_WriteThread.join();
+		//whatever was never read or never delivered is dropped
+		uint64_t dropped = 0;
+		for (std::deque<FileIORequest>& queue : m_RequestQueues)
+		{
+			dropped += queue.size();
+			queue.clear();
+		}
+		{
+			std::lock_guard<std::mutex> lock(m_CompletedMutex);
+			dropped += m_CompletedQueue.size();
+			m_CompletedQueue.clear();
+		}
+		m_Pending.fetch_sub(dropped, std::memory_order_acq_rel);
+		//task callbacks in flight still touch the buffer pool
+		std::unique_lock<std::mutex> lock(m_IdleMutex);
+		m_IdleCondition.wait(lock, [this]() { return m_Pending.load(std::memory_order_acquire) == 0; });
+		std::unique_lock<std::shared_mutex> archiveLock(m_ArchiveMutex);
+		m_Archives.clear();
+	}
+
+	namespace
+	{
+		//byte j of test file i
+		uint8_t GetTestByte(size_t file, size_t j)
+		{
+			return static_cast<uint8_t>(file * 31 + j * 7 + (j >> 8));
+		}
+
+		//writes count files of the given size, sizes of 0 are varied per file, returns their absolute paths
+		std::vector<std::filesystem::path> WriteTestFiles(const std::filesystem::path& directory, size_t count, size_t size)
+		{
+			std::error_code ec;
+			std::filesystem::create_directories(directory, ec);
+			std::vector<std::filesystem::path> paths;
+			std::vector<uint8_t> data;
+			for (size_t i = 0; i < count; ++i)
+			{
+				const size_t fileSize = size ? size : (i * 4099 + 1) % (size_t(300) << 10);
+				data.resize(fileSize);
+				for (size_t j = 0; j < fileSize; ++j)
+					data[j] = GetTestByte(i, j);
+				paths.emplace_back(directory / fmt::format("{}.bin", i));
+				std::ofstream file(paths.back(), std::ios::binary);
+				file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+			}
+			return paths;
+		}
+
+		//the single io thread with two buffers the worker pool replaced, kept only to benchmark against
+		class PollingFileManager
+		{
+			struct Buffer
+			{
+				std::atomic<int> m_Status{};	//0 idle, 1 executing, 2 callback
+				FileIORequest m_Request;
+				std::vector<uint8_t> m_Data;
+			};
+		public:
+			void Init()
+			{
+				m_Thread = std::thread([this]() {
+					while (m_Running)
+					{
+						std::lock_guard<std::mutex> lock(m_QueueMutex);
+						if (m_RequestQueue.empty())
+						{
+							std::this_thread::sleep_for(std::chrono::milliseconds(1));
+							continue;
+						}
+						Buffer* freeBuffer = m_Buffer[0].m_Status == 0 ? &m_Buffer[0] : m_Buffer[1].m_Status == 0 ? &m_Buffer[1] : nullptr;
+						if (!freeBuffer)
+						{
+							std::this_thread::sleep_for(std::chrono::milliseconds(1));
+							continue;
+						}
+						freeBuffer->m_Status = 1;
+						freeBuffer->m_Request = m_RequestQueue.front();
+						m_RequestQueue.pop_front();
+						IORead read;
+						read.m_Path = freeBuffer->m_Request.m_Path;
+						read.m_Size = freeBuffer->m_Request.m_Size;
+						m_Backend->Read({ &read, 1 }, m_Pool);
+						freeBuffer->m_Data = std::move(read.m_Data);
+						freeBuffer->m_Status = 2;
+					}
+				});
+			}
+			void Update()
+			{
+				for (Buffer& buffer : m_Buffer)
 				{
-					freeBuffer = &m_Buffer[1];
+					if (buffer.m_Status == 2)
+					{
+						buffer.m_Request.m_ReadCallback(buffer.m_Request.m_Guid, buffer.m_Data.data(), static_cast<uint32_t>(buffer.m_Data.size()));
+						buffer.m_Status = 0;
+					}
 				}
+			}
+			void QueueRequest(FileIORequest request)
+			{
+				std::lock_guard<std::mutex> lock(m_QueueMutex);
+				m_RequestQueue.push_back(std::move(request));
+			}
+			void Shutdown()
+			{
+				m_Running = false;
+				m_Thread.join();
+			}
+
+		private:
+			std::atomic<bool> m_Running{ true };
+			std::deque<FileIORequest> m_RequestQueue;
+			std::mutex m_QueueMutex;
+			Buffer m_Buffer[2];
+			std::thread m_Thread;
+			std::unique_ptr<IOBackend> m_Backend = IOBackend::Create(IOBackend::Type::Stream, 1);
+			IOBufferPool m_Pool;
+		};
+	}
+
+	bool VerifyFileManager(const FileManager::Settings& settings)
+	{
+		constexpr size_t FileCount = 64;
+		constexpr size_t RequestCount = 4096;
+		constexpr size_t SubmitTasks = 16;
+		const std::filesystem::path directory = std::filesystem::temp_directory_path() / "RagdollFileManagerVerify";
+		const std::vector<std::filesystem::path> paths = WriteTestFiles(directory, FileCount, 0);
+		std::vector<size_t> sizes(FileCount);
+		for (size_t i = 0; i < FileCount; ++i)
+			sizes[i] = static_cast<size_t>(std::filesystem::file_size(paths[i]));
 
+		FileManager manager;
+		manager.Init(settings);
+		const std::thread::id mainThread = std::this_thread::get_id();
+		std::unique_ptr<std::atomic<uint32_t>[]> deliveries(new std::atomic<uint32_t>[RequestCount]);
+		for (size_t i = 0; i < RequestCount; ++i)
+			deliveries[i] = 0;
+		std::atomic<uint32_t> failures{};
+		auto Fail = [&failures](const char* reason, size_t request) {
+			if (failures.fetch_add(1) < 8)
+				RD_CORE_ERROR("File manager check failed on request {}: {}", request, reason);
+		};
 
-				if(freeBuffer)
+		//every fourth request only wants the middle of its file and every eighth reads from an arbitrary offset to the end
+		auto MakeRequest = [&](size_t i) {
+			const size_t file = i % FileCount;
+			const uint64_t offset = (i % 4 == 3) ? sizes[file] / 4 : (i % 8 == 5) ? (i * 7919) % sizes[file] : 0;
+			const uint64_t readSize = (i % 4 == 3) ? sizes[file] / 2 : 0;
+			const size_t expected = readSize ? static_cast<size_t>(readSize) : sizes[file] - static_cast<size_t>(offset);
+			const FileIORequest::Completion completion = (i % 2) ? FileIORequest::Completion::Task : FileIORequest::Completion::MainThread;
+			return FileIORequest(Guid(i + 1), paths[file], [&, i, file, offset, expected, completion](Guid guid, const uint8_t* data, uint32_t size) {
+				deliveries[i].fetch_add(1);
+				if (guid != Guid(i + 1))
+					Fail("wrong guid", i);
+				if (completion == FileIORequest::Completion::MainThread && std::this_thread::get_id() != mainThread)
+					Fail("main thread callback ran off the main thread", i);
+				if (completion == FileIORequest::Completion::Task && SExecutor::Executor.this_worker_id() < 0)
+					Fail("task callback ran outside the executor", i);
+				if (size != expected)
 				{
-					// Load the file
-					freeBuffer->m_Request = request;
-					freeBuffer->Load(m_Root);
-					m_RequestQueue.pop();
+					Fail("wrong size", i);
+					return;
 				}
-				else
+				for (size_t j = 0; j < size; ++j)
 				{
-					// Sleep for a bit
-					std::this_thread::sleep_for(std::chrono::milliseconds(1));
-					continue;
+					if (data[j] != GetTestByte(file, static_cast<size_t>(offset) + j))
+					{
+						Fail("wrong bytes", i);
+						return;
+					}
 				}
+			}, offset, readSize, FileIORequest::Type::Read, static_cast<FileIORequest::Priority>(i % 3), completion);
+		};
+
+		//queued from many tasks at once while the main thread keeps delivering
+		std::atomic<size_t> submitted{};
+		tf::Taskflow taskflow;
+		for (size_t t = 0; t < SubmitTasks; ++t)
+		{
+			taskflow.emplace([&, t]() {
+				for (size_t i = t; i < RequestCount; i += SubmitTasks)
+				{
+					manager.QueueRequest(MakeRequest(i));
+					submitted.fetch_add(1);
+				}
+			});
+		}
+		tf::Future<void> future = SExecutor::Executor.run(taskflow);
+		while (submitted.load() < RequestCount)
+		{
+			manager.Update();
+			std::this_thread::yield();
+		}
+		future.wait();
+		manager.WaitIdle();
+
+		for (size_t i = 0; i < RequestCount; ++i)
+		{
+			if (deliveries[i] != 1)
+				Fail("not delivered exactly once", i);
+		}
+		const FileManager::Stats stats = manager.GetStats();
+		if (stats.m_Completed != RequestCount || stats.m_Failed != 0)
+			Fail("stats do not add up", RequestCount);
+		manager.Shutdown();
+
+		std::error_code ec;
+		std::filesystem::remove_all(directory, ec);
+		if (failures)
+		{
+			RD_CORE_ERROR("File manager checks failed {} times", failures.load());
+			return false;
+		}
+		RD_CORE_INFO("File manager checks passed, {} requests from {} tasks on {} io threads through the {} backend, {} buffer reuses, peak queue {}",
+			RequestCount, SubmitTasks, settings.m_WorkerCount, manager.GetBackendName(), stats.m_BufferReuses, stats.m_PeakQueued);
+		return true;
+	}
+
+	void BenchmarkFileManager(const FileManager::Settings& settings)
+	{
+		struct Workload
+		{
+			const char* m_Name;
+			size_t m_FileCount;
+			size_t m_FileSize;
+		};
+		const Workload workloads[] = {
+			{ "4KB", 4096, size_t(4) << 10 },
+			{ "256KB", 512, size_t(256) << 10 },
+		};
+		const std::filesystem::path directory = std::filesystem::temp_directory_path() / "RagdollFileManagerBenchmark";
+		using Clock = std::chrono::high_resolution_clock;
+
+		//queues every file at once and pumps the main thread until every callback ran
+		auto Run = [](auto& manager, const std::vector<std::filesystem::path>& paths, FileIORequest::Completion completion, auto&& update) {
+			std::vector<double> latencies(paths.size());
+			std::atomic<size_t> done{};
+			const Clock::time_point start = Clock::now();
+			for (size_t i = 0; i < paths.size(); ++i)
+			{
+				manager.QueueRequest(FileIORequest(Guid(i + 1), paths[i], [&, i](Guid, const uint8_t*, uint32_t) {
+					latencies[i] = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+					done.fetch_add(1, std::memory_order_release);
+				}, 0, 0, FileIORequest::Type::Read, FileIORequest::Priority::Normal, completion));
 			}
-			else
+			while (done.load(std::memory_order_acquire) < paths.size())
 			{
-				//just write as per normal
+				update();
+				std::this_thread::yield();
+			}
+			const double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+			std::sort(latencies.begin(), latencies.end());
+			struct Result { double m_Ms, m_P50, m_P99; };
+			return Result{ ms, latencies[latencies.size() / 2], latencies[latencies.size() * 99 / 100] };
+		};
 
-				//no callbacks for writing because it should be fire and forget
+		RD_CORE_INFO("File manager benchmark, {} io threads, files were just written so this measures the dispatch more than the disk", settings.m_WorkerCount);
+		for (const Workload& workload : workloads)
+		{
+			const std::vector<std::filesystem::path> paths = WriteTestFiles(directory / workload.m_Name, workload.m_FileCount, workload.m_FileSize);
+			const double megabytes = double(workload.m_FileCount * workload.m_FileSize) / (1024.0 * 1024.0);
+			auto Log = [&](const char* name, const auto& result) {
+				RD_CORE_INFO("  {} x {} {}: {:.2f}ms, {:.1f}MB/s, {:.0f} reads/s, latency p50 {:.2f}ms p99 {:.2f}ms",
+					workload.m_FileCount, workload.m_Name, name, result.m_Ms, megabytes / (result.m_Ms / 1000.0), workload.m_FileCount / (result.m_Ms / 1000.0), result.m_P50, result.m_P99);
+			};
+			{
+				PollingFileManager manager;
+				manager.Init();
+				Log("polling thread", Run(manager, paths, FileIORequest::Completion::MainThread, [&manager]() { manager.Update(); }));
+				manager.Shutdown();
+			}
+			{
+				FileManager manager;
+				manager.Init(settings);
+				Log("worker pool, main thread callbacks", Run(manager, paths, FileIORequest::Completion::MainThread, [&manager]() { manager.Update(); }));
+				Log("worker pool, task callbacks", Run(manager, paths, FileIORequest::Completion::Task, [&manager]() { manager.Update(); }));
+				manager.Shutdown();
 			}
-			//unlocks all mutex
-			m_FileIOMutex->unlock();
-			m_FileIOLowPriorityMutex->unlock();
 		}
+		std::error_code ec;
+		std::filesystem::remove_all(directory, ec);
 	}
 
-	void FileManager::QueueRequest(FileIORequest request)
+	void BenchmarkFileBackends(const FileManager::Settings& settings)
 	{
-		std::lock_guard<std::mutex>lock(*m_QueueMutex);
-		m_RequestQueue.push(request);
+		constexpr uint32_t WarmPasses = 3;
+		using Clock = std::chrono::high_resolution_clock;
+		FileManager::Settings backendSettings = settings;
+		IOBackend::Type backends[] = { settings.m_Backend, settings.m_Backend == IOBackend::Type::Stream ? IOBackend::NativeType : IOBackend::Type::Stream };
+		for (IOBackend::Type backend : backends)
+		{
+			backendSettings.m_Backend = backend;
+			FileManager manager;
+			manager.Init(backendSettings);
+			std::vector<std::filesystem::path> paths;
+			uint64_t totalBytes = 0;
+			std::error_code ec;
+			for (const auto& entry : std::filesystem::recursive_directory_iterator(manager.GetRoot(), ec))
+			{
+				if (!entry.is_regular_file())
+					continue;
+				paths.emplace_back(entry.path());
+				totalBytes += entry.file_size();
+			}
+			if (paths.empty())
+			{
+				RD_CORE_WARN("No files under {}", manager.GetRoot().string());
+				manager.Shutdown();
+				return;
+			}
+			auto Pass = [&]() {
+				std::atomic<uint64_t> bytes{};
+				const Clock::time_point start = Clock::now();
+				for (size_t i = 0; i < paths.size(); ++i)
+				{
+					manager.QueueRequest(FileIORequest(Guid(i + 1), paths[i], [&bytes](Guid, const uint8_t*, uint32_t size) {
+						bytes.fetch_add(size, std::memory_order_relaxed);
+					}, 0, 0, FileIORequest::Type::Read, FileIORequest::Priority::Normal, FileIORequest::Completion::Task));
+				}
+				manager.WaitIdle();
+				const double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+				if (bytes != totalBytes)
+					RD_CORE_WARN("Read {} of {} bytes", bytes.load(), totalBytes);
+				return ms;
+			};
+			const char* name = manager.GetBackendName();
+			//a first pass out of the page cache says nothing about the disk, drop the tree where the os lets us
+			bool bCold = true;
+			for (const std::filesystem::path& path : paths)
+				bCold &= IOBackend::EvictFromCache(path);
+			const double firstMs = Pass();
+			double warmMs = 0.0;
+			for (uint32_t i = 0; i < WarmPasses; ++i)
+				warmMs += Pass() / WarmPasses;
+			manager.Shutdown();
+
+			const double megabytes = totalBytes / (1024.0 * 1024.0);
+			RD_CORE_INFO("Asset tree through the {} backend, {} files {:.2f}MB on {} io threads",
+				name, paths.size(), megabytes, settings.m_WorkerCount);
+			RD_CORE_INFO("  {}: {:.2f}ms {:.1f}MB/s, warm: {:.2f}ms {:.1f}MB/s {:.0f} files/s",
+				bCold ? "cold" : "first", firstMs, megabytes / (firstMs / 1000.0), warmMs, megabytes / (warmMs / 1000.0), paths.size() / (warmMs / 1000.0));
+		}
 	}
 
-	const uint8_t* FileManager::ImmediateLoad(std::filesystem::path path, uint32_t& size)
+	bool VerifyFileWrites(const FileManager::Settings& settings)
 	{
-		//high priority immediate loading blocking
-		m_FileIONextAccessMutex->lock();
-		m_FileIOMutex->lock();
-		m_FileIONextAccessMutex->unlock();
-		//main thread do not need to care about buffer status
-		m_ImmediateBuffer.m_Request.m_Path = path;
-		m_ImmediateBuffer.Load(m_Root);
-		//unlock all mutex
-		m_FileIOMutex->unlock();
-		size = static_cast<uint32_t>(m_ImmediateBuffer.m_Data.size());
-		return m_ImmediateBuffer.m_Data.data();
+		constexpr uint32_t SubmitTasks = 16;
+		constexpr uint32_t AppendFiles = 4;
+		constexpr uint32_t AppendsPerTask = 128;
+		constexpr size_t RecordBytes = 64;
+		constexpr uint32_t Patches = 256;
+		constexpr size_t PatchBytes = 4096;
+		constexpr uint32_t Replaces = 32;
+		constexpr uint32_t RangedReads = 1024;
+		const std::filesystem::path directory = std::filesystem::temp_directory_path() / "RagdollFileWriteVerify";
+		std::error_code ec;
+		std::filesystem::remove_all(directory, ec);
+		const std::filesystem::path patchPath = directory / "patched.bin";
+		const std::filesystem::path replacePath = directory / "replaced.bin";
+		auto GetAppendPath = [&directory](uint32_t file) { return directory / fmt::format("appended{}.bin", file); };
+
+		FileManager manager;
+		manager.Init(settings);
+		const std::thread::id mainThread = std::this_thread::get_id();
+		std::atomic<uint32_t> failures{};
+		auto Fail = [&failures](const char* reason, uint64_t id) {
+			if (failures.fetch_add(1) < 8)
+				RD_CORE_ERROR("File write check failed on {}: {}", id, reason);
+		};
+		std::atomic<uint32_t> callbacks{};
+		uint32_t expectedCallbacks = 0;
+		auto MakeCallback = [&](FileIORequest::Completion completion) {
+			return [&, completion](Guid guid, bool bSuccess) {
+				callbacks.fetch_add(1);
+				if (!bSuccess)
+					Fail("write failed", guid);
+				if (completion == FileIORequest::Completion::MainThread && std::this_thread::get_id() != mainThread)
+					Fail("main thread callback ran off the main thread", guid);
+				if (completion == FileIORequest::Completion::Task && SExecutor::Executor.this_worker_id() < 0)
+					Fail("task callback ran outside the executor", guid);
+			};
+		};
+
+		//records of task, sequence and a pattern appended from many tasks into a few files at once,
+		//the records of one task have to land in the order it queued them
+		tf::Taskflow taskflow;
+		for (uint32_t t = 0; t < SubmitTasks; ++t)
+		{
+			taskflow.emplace([&, t]() {
+				for (uint32_t i = 0; i < AppendsPerTask; ++i)
+				{
+					std::vector<uint8_t> record(RecordBytes);
+					memcpy(record.data(), &t, sizeof(t));
+					memcpy(record.data() + 4, &i, sizeof(i));
+					for (size_t j = 8; j < RecordBytes; ++j)
+						record[j] = GetTestByte(t, i * RecordBytes + j);
+					const FileIORequest::Completion completion = (i % 2) ? FileIORequest::Completion::Task : FileIORequest::Completion::MainThread;
+					manager.QueueRequest(FileIORequest(Guid((uint64_t(t) << 32 | i) + 1), GetAppendPath(t % AppendFiles), std::move(record), FileIORequest::WriteMode::Append, 0,
+						i + 1 == AppendsPerTask ? FileIORequest::Flush::Durable : FileIORequest::Flush::None, MakeCallback(completion), completion));
+				}
+			});
+		}
+		expectedCallbacks += SubmitTasks * AppendsPerTask;
+		tf::Future<void> future = SExecutor::Executor.run(taskflow);
+
+		//the first half of the patches in order so they merge, the second half in a scattered order
+		for (uint32_t i = 0; i < Patches; ++i)
+		{
+			const uint32_t patch = i < Patches / 2 ? i : Patches / 2 + (i * 37) % (Patches / 2);
+			std::vector<uint8_t> bytes(PatchBytes);
+			for (size_t j = 0; j < PatchBytes; ++j)
+				bytes[j] = GetTestByte(1000, patch * PatchBytes + j);
+			manager.QueueRequest(FileIORequest(Guid(uint64_t(1) << 48 | i), patchPath, std::move(bytes), FileIORequest::WriteMode::Patch, uint64_t(patch) * PatchBytes,
+				FileIORequest::Flush::None, MakeCallback(FileIORequest::Completion::MainThread)));
+		}
+		expectedCallbacks += Patches;
+		//the last replace wins
+		for (uint32_t i = 0; i < Replaces; ++i)
+		{
+			std::vector<uint8_t> bytes(1000 + i * 977);
+			for (size_t j = 0; j < bytes.size(); ++j)
+				bytes[j] = GetTestByte(2000 + i, j);
+			manager.QueueRequest(FileIORequest(Guid(uint64_t(2) << 48 | i), replacePath, std::move(bytes), FileIORequest::WriteMode::Replace, 0,
+				(i % 4 == 0) ? FileIORequest::Flush::Durable : FileIORequest::Flush::None, MakeCallback(FileIORequest::Completion::Task), FileIORequest::Completion::Task));
+		}
+		expectedCallbacks += Replaces;
+		while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			manager.Update();
+			std::this_thread::yield();
+		}
+		manager.WaitIdle();
+		if (callbacks != expectedCallbacks)
+			Fail("not every write called back", callbacks.load());
+
+		//the appended records
+		std::vector<uint32_t> nextSequence(SubmitTasks);
+		for (uint32_t file = 0; file < AppendFiles; ++file)
+		{
+			std::ifstream stream(GetAppendPath(file), std::ios::binary);
+			std::vector<uint8_t> data((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+			if (data.size() != (SubmitTasks / AppendFiles) * AppendsPerTask * RecordBytes)
+				Fail("appended file has the wrong size", file);
+			for (size_t offset = 0; offset + RecordBytes <= data.size(); offset += RecordBytes)
+			{
+				uint32_t task = 0, sequence = 0;
+				memcpy(&task, data.data() + offset, sizeof(task));
+				memcpy(&sequence, data.data() + offset + 4, sizeof(sequence));
+				if (task >= SubmitTasks || task % AppendFiles != file || sequence != nextSequence[task])
+				{
+					Fail("appended record out of order", offset);
+					break;
+				}
+				++nextSequence[task];
+				for (size_t j = 8; j < RecordBytes; ++j)
+				{
+					if (data[offset + j] != GetTestByte(task, sequence * RecordBytes + j))
+					{
+						Fail("appended record has the wrong bytes", offset);
+						break;
+					}
+				}
+			}
+		}
+
+		//the patched file read back in ranges at arbitrary offsets, some of them running past the end
+		const size_t patchedSize = Patches * PatchBytes;
+		for (uint32_t i = 0; i < RangedReads; ++i)
+		{
+			const uint64_t offset = (uint64_t(i) * 7919 + i * i) % patchedSize;
+			const uint64_t size = (uint64_t(i) * 131) % 9000 + 1;
+			const size_t expected = static_cast<size_t>(std::min<uint64_t>(size, patchedSize - offset));
+			manager.QueueRequest(FileIORequest(Guid(uint64_t(3) << 48 | i), patchPath, [&, offset, expected](Guid guid, const uint8_t* data, uint32_t readSize) {
+				if (readSize != expected)
+				{
+					Fail("ranged read has the wrong size", guid);
+					return;
+				}
+				for (size_t j = 0; j < readSize; ++j)
+				{
+					if (data[j] != GetTestByte(1000, static_cast<size_t>(offset) + j))
+					{
+						Fail("ranged read has the wrong bytes", guid);
+						return;
+					}
+				}
+			}, offset, size, FileIORequest::Type::Read, FileIORequest::Priority::Normal, FileIORequest::Completion::Task));
+		}
+		manager.QueueRequest(FileIORequest(Guid(uint64_t(4) << 48), replacePath, [&](Guid guid, const uint8_t* data, uint32_t size) {
+			if (size != 1000 + (Replaces - 1) * 977)
+			{
+				Fail("replaced file has the wrong size", guid);
+				return;
+			}
+			for (size_t j = 0; j < size; ++j)
+			{
+				if (data[j] != GetTestByte(2000 + Replaces - 1, j))
+				{
+					Fail("replaced file has the wrong bytes", guid);
+					return;
+				}
+			}
+		}));
+		manager.WaitIdle();
+		if (std::filesystem::exists(replacePath.string() + ".tmp"))
+			Fail("replace left its temporary behind", 0);
+
+		const FileManager::Stats stats = manager.GetStats();
+		const char* backendName = manager.GetBackendName();
+		manager.Shutdown();
+		std::filesystem::remove_all(directory, ec);
+		if (failures)
+		{
+			RD_CORE_ERROR("File write checks failed {} times", failures.load());
+			return false;
+		}
+		RD_CORE_INFO("File write checks passed through the {} backend, {} writes of which {} were merged, {} ranged reads",
+			backendName, stats.m_Writes, stats.m_CoalescedWrites, RangedReads);
+		return true;
 	}
 
-	void FileManager::Shutdown()
+	void BenchmarkFileWrites(const FileManager::Settings& settings)
 	{
-		m_Running = false;
-		if(m_IOThread.joinable())
-			m_IOThread.join();
+		struct Workload
+		{
+			const char* m_Name;
+			uint32_t m_Count;
+			size_t m_Size;
+			FileIORequest::WriteMode m_Mode;
+			FileIORequest::Flush m_Flush;
+		};
+		const Workload workloads[] = {
+			{ "4KB appends to one file", 16384, size_t(4) << 10, FileIORequest::WriteMode::Append, FileIORequest::Flush::None },
+			{ "256KB files", 256, size_t(256) << 10, FileIORequest::WriteMode::Replace, FileIORequest::Flush::None },
+			{ "256KB durable files", 64, size_t(256) << 10, FileIORequest::WriteMode::Replace, FileIORequest::Flush::Durable },
+		};
+		const std::filesystem::path directory = std::filesystem::temp_directory_path() / "RagdollFileWriteBenchmark";
+		using Clock = std::chrono::high_resolution_clock;
+		std::vector<uint8_t> payload(size_t(256) << 10);
+		for (size_t j = 0; j < payload.size(); ++j)
+			payload[j] = GetTestByte(0, j);
+		auto GetPath = [&directory](const Workload& workload, uint32_t i) {
+			return workload.m_Mode == FileIORequest::WriteMode::Append ? directory / "appended.bin" : directory / fmt::format("{}.bin", i);
+		};
+
+		RD_CORE_INFO("File write benchmark, {} io threads", settings.m_WorkerCount);
+		for (const Workload& workload : workloads)
+		{
+			const double megabytes = double(workload.m_Count * workload.m_Size) / (1024.0 * 1024.0);
+			//the caller time is how long the thread that wants the bytes written was held up
+			auto Log = [&](const char* name, double ms, double callerMs, uint64_t coalesced) {
+				RD_CORE_INFO("  {} x {} {}: {:.2f}ms, {:.1f}MB/s, {:.0f} writes/s, caller busy {:.2f}ms, {} merged",
+					workload.m_Count, workload.m_Name, name, ms, megabytes / (ms / 1000.0), workload.m_Count / (ms / 1000.0), callerMs, coalesced);
+			};
+			std::error_code ec;
+			//every write blocking on the thread that wants it written
+			{
+				std::filesystem::remove_all(directory, ec);
+				std::unique_ptr<IOBackend> backend = IOBackend::Create(IOBackend::Type::Stream, 1);
+				const Clock::time_point start = Clock::now();
+				for (uint32_t i = 0; i < workload.m_Count; ++i)
+				{
+					IOWrite write;
+					write.m_Path = GetPath(workload, i);
+					write.m_Mode = workload.m_Mode == FileIORequest::WriteMode::Append ? IOWrite::Mode::Append : IOWrite::Mode::Replace;
+					write.m_Data = std::span<const uint8_t>(payload.data(), workload.m_Size);
+					write.m_bFlush = workload.m_Flush == FileIORequest::Flush::Durable;
+					backend->Write({ &write, 1 });
+				}
+				const double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+				Log("blocking on the caller", ms, ms, 0);
+			}
+			for (IOBackend::Type backend : { IOBackend::Type::Stream, IOBackend::NativeType })
+			{
+				std::filesystem::remove_all(directory, ec);
+				FileManager::Settings backendSettings = settings;
+				backendSettings.m_Backend = backend;
+				FileManager manager;
+				manager.Init(backendSettings);
+				const Clock::time_point start = Clock::now();
+				for (uint32_t i = 0; i < workload.m_Count; ++i)
+				{
+					//points at the shared payload, it outlives every write
+					FileIORequest request(Guid(i + 1), GetPath(workload, i), payload.data(), static_cast<uint32_t>(workload.m_Size));
+					request.m_WriteMode = workload.m_Mode;
+					request.m_Flush = workload.m_Flush;
+					request.m_Completion = FileIORequest::Completion::Task;
+					manager.QueueRequest(std::move(request));
+				}
+				const double callerMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+				manager.WaitIdle();
+				const double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+				Log(manager.GetBackendName(), ms, callerMs, manager.GetStats().m_CoalescedWrites);
+				manager.Shutdown();
+			}
+		}
+		std::error_code ec;
+		std::filesystem::remove_all(directory, ec);
 	}
 }
@@ -28,6 +28,10 @@
 			SOFTWARE.
 __________________________________________________________________________________*/
 #pragma once
+#include <condition_variable>
+#include <shared_mutex>
+#include "IOBackend.h"
+#include "PackedArchive.h"
 
 //#include "Ragdoll/Memory/RagdollAllocator.h"
 
@@ -44,7 +48,33 @@ namespace ragdoll
 		{
 			High = 0,
 			Normal,
-			Low
+			Low,
+			Count
+		};
+		//where the read or write callback runs
+		enum class Completion
+		{
+			//in FileManager::Update, the data is only valid during the callback
+			MainThread,
+			//in a task on the executor as soon as the read is done, the data is only valid during the callback
+			Task
+		};
+		enum class WriteMode
+		{
+			//the whole file, written next to it and renamed over it so readers never see half of it
+			Replace,
+			//at the end of the file, creating it if needed
+			Append,
+			//at m_Offset into the file, creating it if needed, the rest of the file is kept
+			Patch
+		};
+		//how sure a write is to be on disk when its callback runs
+		enum class Flush
+		{
+			//handed to the os, it writes the pages back whenever it likes
+			None,
+			//flushed to the device before the callback, for anything that has to survive a crash
+			Durable
 		};
 
 		FileIORequest()
@@ -52,90 +82,193 @@ namespace ragdoll
 			if(m_Guid == Guid::null)
 				m_Guid = GuidGenerator::Generate();
 		}
-		FileIORequest(Guid guid, std::filesystem::path path, std::function<void(Guid, const uint8_t*, uint32_t)> callback, uint64_t offset = 0, uint64_t size = 0, Type type = Type::Read, Priority priority = Priority::Normal)
-			: m_Guid{ guid }, m_Path(path), m_ReadCallback(callback), m_Offset(offset), m_Size(size), m_Type(type), m_Priority(priority)
+		FileIORequest(Guid guid, std::filesystem::path path, std::function<void(Guid, const uint8_t*, uint32_t)> callback, uint64_t offset = 0, uint64_t size = 0, Type type = Type::Read, Priority priority = Priority::Normal, Completion completion = Completion::MainThread)
+			: m_Guid{ guid }, m_Path(path), m_ReadCallback(callback), m_Offset(offset), m_Size(size), m_Type(type), m_Priority(priority), m_Completion(completion)
 		{
 			if (m_Guid == Guid::null)
 				RD_ASSERT(true, "Please generate a guid for your request and keep track of it");
 		}
+		//data has to stay alive until the write callback runs
 		FileIORequest(Guid guid, std::filesystem::path path, uint8_t* data, uint32_t size, Type type = Type::Write, Priority priority = Priority::Normal)
 			: m_Guid{ guid }, m_Path(path), m_WriteData(data), m_WriteSize(size), m_Type(type), m_Priority(priority)
 		{
 			if (m_Guid == Guid::null)
 				RD_ASSERT(true, "Please generate a guid for your request and keep track of it");
 		}
+		//the request owns the bytes it writes
+		FileIORequest(Guid guid, std::filesystem::path path, std::vector<uint8_t> data, WriteMode mode = WriteMode::Replace, uint64_t offset = 0, Flush flush = Flush::None, std::function<void(Guid, bool)> callback = {}, Completion completion = Completion::MainThread)
+			: m_Guid{ guid }, m_Path(path), m_WriteBuffer(std::move(data)), m_WriteMode(mode), m_Offset(offset), m_Flush(flush), m_WriteCallback(callback), m_Type(Type::Write), m_Completion(completion)
+		{
+			if (m_Guid == Guid::null)
+				RD_ASSERT(true, "Please generate a guid for your request and keep track of it");
+		}
 		FileIORequest(FileIORequest&&) = default;
 		FileIORequest(const FileIORequest&) = default;
 		~FileIORequest() = default;
 
 		Guid m_Guid;
-		Type m_Type;
-		Priority m_Priority{ 0 };
+		Type m_Type{ Type::Read };
+		Priority m_Priority{ Priority::Normal };
+		Completion m_Completion{ Completion::MainThread };
 		std::filesystem::path m_Path;
+		//byte range of a read, a size of 0 reads from the offset to the end of the file
+		//where a patch write goes
 		uint64_t m_Offset{ 0 };
 		uint64_t m_Size{ 0 };
 		//id of the request, data ptr, and size of data for read
 		std::function<void(Guid, const uint8_t*, uint32_t)> m_ReadCallback;
-		//data ptr and size for write
+		//data ptr and size for write, m_WriteBuffer is used instead when it is not empty
 		uint8_t* m_WriteData{ nullptr };
 		uint32_t m_WriteSize{ 0 };
+		std::vector<uint8_t> m_WriteBuffer;
+		WriteMode m_WriteMode{ WriteMode::Replace };
+		Flush m_Flush{ Flush::None };
+		//id of the request and whether every byte made it
+		std::function<void(Guid, bool)> m_WriteCallback;
 
-		FileIORequest& operator=(FileIORequest&& other) noexcept;
-		FileIORequest& operator=(const FileIORequest& other);
+		std::span<const uint8_t> GetWriteData() const
+		{
+			return m_WriteBuffer.empty() ? std::span<const uint8_t>(m_WriteData, m_WriteSize) : std::span<const uint8_t>(m_WriteBuffer);
+		}
+
+		FileIORequest& operator=(FileIORequest&& other) = default;
+		FileIORequest& operator=(const FileIORequest& other) = default;
 	};
 
 	class FileManager
 	{
-		struct Buffer
+	public:
+		struct Settings
+		{
+			//threads blocking on reads, a few more than one keeps the disk queue busy
+			uint32_t m_WorkerCount{ 4 };
+			//read buffers kept around for the next reads, anything above goes back to the heap
+			size_t m_MaxPooledBytes{ size_t(64) << 20 };
+			IOBackend::Type m_Backend{ IOBackend::NativeType };
+			//reads one worker hands the backend at once, backends that can not batch take them one by one
+			uint32_t m_BatchSize{ 16 };
+			//bytes the writer merges into one write before it starts a new one
+			size_t m_MaxCoalescedBytes{ size_t(8) << 20 };
+		};
+		struct Stats
+		{
+			uint64_t m_Completed{};
+			uint64_t m_Failed{};
+			uint64_t m_BytesRead{};
+			//reads served by a pooled buffer
+			uint64_t m_BufferReuses{};
+			uint64_t m_PeakQueued{};
+			uint64_t m_Writes{};
+			uint64_t m_FailedWrites{};
+			uint64_t m_BytesWritten{};
+			//writes that went to the disk merged into an earlier one of the same file
+			uint64_t m_CoalescedWrites{};
+			//reads served by a mounted archive instead of the disk
+			uint64_t m_ArchiveReads{};
+		};
+
+	private:
+		struct Completed
 		{
-			enum class Status
-			{
-				Idle,
-				Executing,
-				Callback,
-			} m_Status{ Status::Idle };
 			FileIORequest m_Request;
 			std::vector<uint8_t> m_Data;
-
-			void Load(const std::filesystem::path& root);
+			bool m_bSuccess{};
+			//bytes straight out of an archive mapping, used instead of m_Data when set
+			std::span<const uint8_t> m_View;
 		};
+		struct MountedArchive
+		{
+			//normalized, empty for the root
+			std::string m_MountPoint;
+			std::unique_ptr<PackedArchive> m_Archive;
+		};
+
 	public:
 		FileManager();
 
 		void Init();
-		//checks when the file manager is done loading then can call the callbacks
+		void Init(const Settings& settings);
+		//delivers the callbacks of the main thread requests that finished since the last update
 		void Update();
-		//check queue status and will load async, callback will be called when done in main thread
-		void ThreadUpdate();
 		void QueueRequest(FileIORequest request);
+		//blocking, the data stays valid until the next immediate load
 		const uint8_t* ImmediateLoad(std::filesystem::path path, uint32_t& size);
+		//reads of paths under the mount point, relative to the root, come out of the archive from then on
+		//later mounts win over earlier ones and archives win over loose files, writes always go to loose files
+		//the archive stays mapped until shutdown so mount before queueing the reads that should use it
+		//only reads through the file manager see it, glTF files and their buffers and streamed textures still map their loose files
+		bool Mount(const std::filesystem::path& archivePath, const std::filesystem::path& mountPoint = {});
+		//blocks until every queued request is read or written and its callback has run, pumps the main thread callbacks itself
+		void WaitIdle();
 
 		void Shutdown();
 
 		std::filesystem::path GetRoot() const { return m_Root; }
+		Stats GetStats() const;
+		const char* GetBackendName() const { return m_Backend->GetName(); }
 
 	private:
+		//pops the next batch of requests, highest priority first and oldest first within a priority
+		void WorkerUpdate();
+		//writes in queue order and merges the ones that continue a write to the same file
+		void WriterUpdate();
+		void Complete(FileIORequest&& request, std::vector<uint8_t>&& data, bool bSuccess, std::span<const uint8_t> view = {});
+		//the entry a path under the root resolves to in the mounted archives, null if it is a loose file
+		const PackedArchive::Entry* FindInArchives(const std::filesystem::path& path, const PackedArchive*& archive) const;
+		void Retire();
+
 		//root directory
 		std::filesystem::path m_Root = std::filesystem::current_path();
-		//stop thread bool
-		bool m_Running{ true };
-		//queue of files to load
-		std::priority_queue<FileIORequest, std::vector<FileIORequest>,
-			std::function<bool(const FileIORequest&, const FileIORequest&)>> m_RequestQueue{
-				[](const FileIORequest& lhs, const FileIORequest& rhs) {
-					return lhs.m_Priority < rhs.m_Priority;
-				}
-		};
-		//mutex for the queue
-		std::unique_ptr<std::mutex> m_QueueMutex{};
-		//mutex for read writes with triple mutex prioritisation
-		std::unique_ptr<std::mutex> m_FileIOMutex{};
-		std::unique_ptr<std::mutex> m_FileIONextAccessMutex{};
-		std::unique_ptr<std::mutex> m_FileIOLowPriorityMutex{};
-		//double buffering loading system with a loader thread
-		Buffer m_Buffer[2]{};
-		Buffer m_ImmediateBuffer{};
-		//thread to do IO
-		std::thread m_IOThread;
+		Settings m_Settings;
+		//stop workers bool, only changed under the queue mutex
+		bool m_Running{ false };
+		//one fifo per priority, workers sleep on the condition variable while all are empty
+		std::deque<FileIORequest> m_RequestQueues[static_cast<size_t>(FileIORequest::Priority::Count)];
+		std::mutex m_QueueMutex;
+		std::condition_variable m_QueueCondition;
+		//finished reads waiting for Update to run their callback
+		std::vector<Completed> m_CompletedQueue;
+		std::mutex m_CompletedMutex;
+		//requests queued and not retired yet, WaitIdle sleeps on it
+		std::atomic<uint64_t> m_Pending{};
+		std::mutex m_IdleMutex;
+		std::condition_variable m_IdleCondition;
+		IOBufferPool m_BufferPool;
+		std::unique_ptr<IOBackend> m_Backend;
+		std::vector<uint8_t> m_ImmediateBuffer;
+		std::vector<MountedArchive> m_Archives;
+		mutable std::shared_mutex m_ArchiveMutex;
+		std::mutex m_ImmediateMutex;
+		//threads to do IO
+		std::vector<std::thread> m_IOThreads;
+		//writes have their own queue and a single thread so the writes to one file land in the order they were queued,
+		//the priority of a write is ignored and a read of a file that is being written may see part of the write
+		std::deque<FileIORequest> m_WriteQueue;
+		std::mutex m_WriteMutex;
+		std::condition_variable m_WriteCondition;
+		bool m_Writing{ false };
+		std::thread m_WriteThread;
+
+		std::atomic<uint64_t> m_Completed{};
+		std::atomic<uint64_t> m_Failed{};
+		std::atomic<uint64_t> m_BytesRead{};
+		std::atomic<uint64_t> m_PeakQueued{};
+		std::atomic<uint64_t> m_Writes{};
+		std::atomic<uint64_t> m_FailedWrites{};
+		std::atomic<uint64_t> m_BytesWritten{};
+		std::atomic<uint64_t> m_CoalescedWrites{};
+		std::atomic<uint64_t> m_ArchiveReads{};
 	};
+
+	//thousands of reads of a set of patterned files queued from many tasks at once, every callback checks its bytes
+	//and has to arrive exactly once on the thread its request asked for, returns false on any failure
+	bool VerifyFileManager(const FileManager::Settings& settings);
+	//throughput and latency of the worker pool against the single polling thread with two buffers it replaced
+	void BenchmarkFileManager(const FileManager::Settings& settings);
+	//reads the whole asset tree through every backend, the first pass is only cold if nothing read the tree recently
+	void BenchmarkFileBackends(const FileManager::Settings& settings);
+	//appends, patches and replaces from many tasks at once read back with ranged reads at arbitrary offsets, returns false on any failure
+	bool VerifyFileWrites(const FileManager::Settings& settings);
+	//write throughput of small appends, whole files and durable whole files through every backend against plain std::ofstream
+	void BenchmarkFileWrites(const FileManager::Settings& settings);
 }
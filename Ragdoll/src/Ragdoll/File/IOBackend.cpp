@@ -0,0 +1,839 @@
+﻿/*!
+\file		IOBackend.cpp
+\date		17/10/2026
+
+\author		Devin Tan
+\email		devintrh@gmail.com
+
+\copyright	MIT License
+
+			Copyright © 2024 Tan Rui Hao Devin
+
+			Permission is hereby granted, free of charge, to any person obtaining a copy
+			of this software and associated documentation files (the "Software"), to deal
+			in the Software without restriction, including without limitation the rights
+			to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+			copies of the Software, and to permit persons to whom the Software is
+			furnished to do so, subject to the following conditions:
+
+			The above copyright notice and this permission notice shall be included in all
+			copies or substantial portions of the Software.
+
+			THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+			IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+			FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+			AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+			LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+			OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+			SOFTWARE.
+__________________________________________________________________________________*/
+#include "ragdollpch.h"
+#include "IOBackend.h"
+#ifdef _WIN32
+#include <Windows.h>
+#elif defined(__linux__)
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace ragdoll
+{
+	std::vector<uint8_t> IOBufferPool::Acquire(size_t size)
+	{
+		std::vector<uint8_t> buffer;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			//smallest free buffer that fits so the large ones stay for the large reads
+			auto best = m_Free.end();
+			for (auto it = m_Free.begin(); it != m_Free.end(); ++it)
+			{
+				if (it->capacity() >= size && (best == m_Free.end() || it->capacity() < best->capacity()))
+					best = it;
+			}
+			if (best != m_Free.end())
+			{
+				buffer = std::move(*best);
+				*best = std::move(m_Free.back());
+				m_Free.pop_back();
+				m_PooledBytes -= buffer.capacity();
+				m_Reuses.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+		buffer.resize(size);
+		return buffer;
+	}
+
+	void IOBufferPool::Release(std::vector<uint8_t>&& buffer)
+	{
+		if (buffer.capacity() == 0)
+			return;
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (m_PooledBytes + buffer.capacity() > m_Limit)
+			return;
+		m_PooledBytes += buffer.capacity();
+		buffer.clear();
+		m_Free.emplace_back(std::move(buffer));
+	}
+
+	namespace
+	{
+		std::filesystem::path GetTemporaryPath(const std::filesystem::path& path)
+		{
+			std::filesystem::path temporary = path;
+			temporary += ".tmp";
+			return temporary;
+		}
+
+#ifdef _WIN32
+		//FlushFileBuffers writes back every cached page of the file, not just the ones written through this handle
+		bool FlushToDevice(const std::filesystem::path& path)
+		{
+			HANDLE file = CreateFileW(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (file == INVALID_HANDLE_VALUE)
+				return false;
+			const bool bFlushed = FlushFileBuffers(file);
+			CloseHandle(file);
+			return bFlushed;
+		}
+#else
+		//fsync writes back every cached page of the file, not just the ones written through this descriptor
+		bool FlushToDevice(const std::filesystem::path& path)
+		{
+			const int file = open(path.c_str(), O_WRONLY | O_CLOEXEC);
+			if (file < 0)
+				return false;
+			const bool bFlushed = fsync(file) == 0;
+			close(file);
+			return bFlushed;
+		}
+#endif
+
+		class StreamBackend : public IOBackend
+		{
+		public:
+			const char* GetName() const override { return "stream"; }
+			uint32_t GetMaxBatch() const override { return 1; }
+
+			void Read(std::span<IORead> reads, IOBufferPool& pool) override
+			{
+				for (IORead& read : reads)
+				{
+					read.m_bSuccess = false;
+					//only load byte data for the engine to use
+					std::ifstream file(read.m_Path, std::ios::binary | std::ios::ate);
+					if (!file.is_open())
+					{
+						RD_ASSERT(true, "File {} unable to be opened", read.m_Path.string());
+						continue;
+					}
+					const uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+					const uint64_t offset = (std::min)(read.m_Offset, fileSize);
+					const uint64_t size = read.m_Size ? (std::min)(read.m_Size, fileSize - offset) : fileSize - offset;
+					file.seekg(static_cast<std::streamoff>(offset), std::ios::beg);
+					read.m_Data = pool.Acquire(static_cast<size_t>(size));
+					file.read(reinterpret_cast<char*>(read.m_Data.data()), static_cast<std::streamsize>(size));
+					read.m_Data.resize(static_cast<size_t>(file.gcount()));
+					read.m_bSuccess = true;
+				}
+			}
+
+			void Write(std::span<IOWrite> writes) override
+			{
+				for (IOWrite& write : writes)
+				{
+					write.m_bSuccess = false;
+					std::error_code ec;
+					std::filesystem::create_directories(write.m_Path.parent_path(), ec);
+					const std::filesystem::path target = write.m_Mode == IOWrite::Mode::Replace ? GetTemporaryPath(write.m_Path) : write.m_Path;
+					{
+						std::ofstream file;
+						if (write.m_Mode == IOWrite::Mode::Replace)
+							file.open(target, std::ios::binary | std::ios::trunc);
+						else if (write.m_Mode == IOWrite::Mode::Append)
+							file.open(target, std::ios::binary | std::ios::app);
+						else
+						{
+							//in and out keeps what is already there, a file that does not exist yet can not be opened like that
+							file.open(target, std::ios::binary | std::ios::in | std::ios::out);
+							if (!file.is_open())
+								file.open(target, std::ios::binary);
+							file.seekp(static_cast<std::streamoff>(write.m_Offset), std::ios::beg);
+						}
+						if (!file.is_open())
+						{
+							RD_CORE_ERROR("File {} unable to be opened for writing", target.string());
+							continue;
+						}
+						file.write(reinterpret_cast<const char*>(write.m_Data.data()), static_cast<std::streamsize>(write.m_Data.size()));
+						if (!file.good())
+						{
+							RD_CORE_ERROR("File {} write failed", target.string());
+							continue;
+						}
+					}
+					if (write.m_bFlush && !FlushToDevice(target))
+					{
+						RD_CORE_ERROR("File {} flush failed", target.string());
+						continue;
+					}
+					if (write.m_Mode == IOWrite::Mode::Replace)
+					{
+						std::filesystem::rename(target, write.m_Path, ec);
+						if (ec)
+						{
+							RD_CORE_ERROR("File {} unable to be replaced: {}", write.m_Path.string(), ec.message());
+							continue;
+						}
+					}
+					write.m_bSuccess = true;
+				}
+			}
+		};
+
+#ifdef _WIN32
+		class OverlappedBackend : public IOBackend
+		{
+		public:
+			explicit OverlappedBackend(uint32_t maxBatch) : m_MaxBatch{ (std::max)(maxBatch, 1u) } {}
+
+			const char* GetName() const override { return "overlapped"; }
+			uint32_t GetMaxBatch() const override { return m_MaxBatch; }
+
+			void Read(std::span<IORead> reads, IOBufferPool& pool) override
+			{
+				struct Pending
+				{
+					HANDLE m_File{ INVALID_HANDLE_VALUE };
+					OVERLAPPED m_Overlapped{};
+					bool m_bIssued{ false };
+				};
+				std::vector<Pending> pending(reads.size());
+				//issue every read before waiting on any so the disk sees the whole batch
+				for (size_t i = 0; i < reads.size(); ++i)
+				{
+					IORead& read = reads[i];
+					Pending& it = pending[i];
+					read.m_bSuccess = false;
+					it.m_File = CreateFileW(read.m_Path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_OVERLAPPED | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+					if (it.m_File == INVALID_HANDLE_VALUE)
+					{
+						RD_ASSERT(true, "File {} unable to be opened", read.m_Path.string());
+						continue;
+					}
+					LARGE_INTEGER fileSize{};
+					GetFileSizeEx(it.m_File, &fileSize);
+					const uint64_t offset = (std::min)(read.m_Offset, static_cast<uint64_t>(fileSize.QuadPart));
+					const uint64_t size = read.m_Size ? (std::min)(read.m_Size, fileSize.QuadPart - offset) : fileSize.QuadPart - offset;
+					if (size > MAXDWORD)
+					{
+						RD_CORE_ERROR("File {} read of {} bytes is too large for one read", read.m_Path.string(), size);
+						continue;
+					}
+					read.m_Data = pool.Acquire(static_cast<size_t>(size));
+					if (size == 0)
+					{
+						read.m_bSuccess = true;
+						continue;
+					}
+					it.m_Overlapped.Offset = static_cast<DWORD>(offset);
+					it.m_Overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+					if (!ReadFile(it.m_File, read.m_Data.data(), static_cast<DWORD>(size), nullptr, &it.m_Overlapped) && GetLastError() != ERROR_IO_PENDING)
+					{
+						RD_CORE_ERROR("File {} read failed with {}", read.m_Path.string(), GetLastError());
+						continue;
+					}
+					it.m_bIssued = true;
+				}
+				for (size_t i = 0; i < reads.size(); ++i)
+				{
+					IORead& read = reads[i];
+					Pending& it = pending[i];
+					if (it.m_bIssued)
+					{
+						//one read per handle, so waiting on the handle itself is enough
+						DWORD bytes = 0;
+						if (GetOverlappedResult(it.m_File, &it.m_Overlapped, &bytes, TRUE) || GetLastError() == ERROR_HANDLE_EOF)
+						{
+							read.m_Data.resize(bytes);
+							read.m_bSuccess = true;
+						}
+						else
+							RD_CORE_ERROR("File {} read failed with {}", read.m_Path.string(), GetLastError());
+					}
+					if (it.m_File != INVALID_HANDLE_VALUE)
+						CloseHandle(it.m_File);
+				}
+			}
+
+			void Write(std::span<IOWrite> writes) override
+			{
+				struct Pending
+				{
+					HANDLE m_File{ INVALID_HANDLE_VALUE };
+					OVERLAPPED m_Overlapped{};
+					std::filesystem::path m_Target;
+					bool m_bIssued{ false };
+					bool m_bFailed{ false };
+				};
+				std::vector<Pending> pending(writes.size());
+				//every file of the batch is different so all of them can be in flight at once
+				for (size_t i = 0; i < writes.size(); ++i)
+				{
+					IOWrite& write = writes[i];
+					Pending& it = pending[i];
+					write.m_bSuccess = false;
+					std::error_code ec;
+					std::filesystem::create_directories(write.m_Path.parent_path(), ec);
+					it.m_Target = write.m_Mode == IOWrite::Mode::Replace ? GetTemporaryPath(write.m_Path) : write.m_Path;
+					it.m_File = CreateFileW(it.m_Target.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, write.m_Mode == IOWrite::Mode::Replace ? CREATE_ALWAYS : OPEN_ALWAYS, FILE_FLAG_OVERLAPPED, nullptr);
+					if (it.m_File == INVALID_HANDLE_VALUE)
+					{
+						RD_CORE_ERROR("File {} unable to be opened for writing", it.m_Target.string());
+						it.m_bFailed = true;
+						continue;
+					}
+					if (write.m_Data.size() > MAXDWORD)
+					{
+						RD_CORE_ERROR("File {} write of {} bytes is too large for one write", it.m_Target.string(), write.m_Data.size());
+						it.m_bFailed = true;
+						continue;
+					}
+					if (write.m_Data.empty())
+						continue;
+					//both halves all ones writes at the end of the file
+					const uint64_t offset = write.m_Mode == IOWrite::Mode::Append ? UINT64_MAX : write.m_Mode == IOWrite::Mode::Patch ? write.m_Offset : 0;
+					it.m_Overlapped.Offset = static_cast<DWORD>(offset);
+					it.m_Overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+					if (!WriteFile(it.m_File, write.m_Data.data(), static_cast<DWORD>(write.m_Data.size()), nullptr, &it.m_Overlapped) && GetLastError() != ERROR_IO_PENDING)
+					{
+						RD_CORE_ERROR("File {} write failed with {}", it.m_Target.string(), GetLastError());
+						it.m_bFailed = true;
+						continue;
+					}
+					it.m_bIssued = true;
+				}
+				for (size_t i = 0; i < writes.size(); ++i)
+				{
+					IOWrite& write = writes[i];
+					Pending& it = pending[i];
+					if (it.m_bIssued)
+					{
+						DWORD bytes = 0;
+						if (!GetOverlappedResult(it.m_File, &it.m_Overlapped, &bytes, TRUE) || bytes != write.m_Data.size())
+						{
+							RD_CORE_ERROR("File {} write failed with {}", it.m_Target.string(), GetLastError());
+							it.m_bFailed = true;
+						}
+					}
+					if (!it.m_bFailed && write.m_bFlush && !FlushFileBuffers(it.m_File))
+					{
+						RD_CORE_ERROR("File {} flush failed with {}", it.m_Target.string(), GetLastError());
+						it.m_bFailed = true;
+					}
+					if (it.m_File != INVALID_HANDLE_VALUE)
+						CloseHandle(it.m_File);
+					if (it.m_bFailed)
+						continue;
+					if (write.m_Mode == IOWrite::Mode::Replace && !MoveFileExW(it.m_Target.c_str(), write.m_Path.c_str(), MOVEFILE_REPLACE_EXISTING | (write.m_bFlush ? MOVEFILE_WRITE_THROUGH : 0)))
+					{
+						RD_CORE_ERROR("File {} unable to be replaced with {}", write.m_Path.string(), GetLastError());
+						continue;
+					}
+					write.m_bSuccess = true;
+				}
+			}
+
+		private:
+			uint32_t m_MaxBatch;
+		};
+#endif
+
+#ifdef __linux__
+		//a submission and completion queue shared with the kernel, only one call uses it at a time
+		class UringQueue
+		{
+		public:
+			//every entry gets a slot of the registered arena, reads that fit land there and are copied out
+			//the kernel pins the arena once instead of the pages of every read, larger reads go straight into their buffer
+			static constexpr size_t SlotSize = size_t(128) << 10;
+
+			~UringQueue()
+			{
+				if (m_Arena != MAP_FAILED)
+					munmap(m_Arena, m_ArenaSize);
+				if (m_Sqes != MAP_FAILED)
+					munmap(m_Sqes, m_SqesSize);
+				if (m_CqRing != MAP_FAILED && m_CqRing != m_SqRing)
+					munmap(m_CqRing, m_CqRingSize);
+				if (m_SqRing != MAP_FAILED)
+					munmap(m_SqRing, m_SqRingSize);
+				if (m_Ring >= 0)
+					close(m_Ring);
+			}
+
+			//false if the kernel has no io_uring or it is switched off
+			bool Init(uint32_t entries)
+			{
+				io_uring_params params{};
+				m_Ring = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+				if (m_Ring < 0)
+					return false;
+				m_Entries = params.sq_entries;
+				m_SqRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+				m_CqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+				const bool bSingleMap = params.features & IORING_FEAT_SINGLE_MMAP;
+				if (bSingleMap)
+					m_SqRingSize = m_CqRingSize = (std::max)(m_SqRingSize, m_CqRingSize);
+				m_SqRing = mmap(nullptr, m_SqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_Ring, IORING_OFF_SQ_RING);
+				if (m_SqRing == MAP_FAILED)
+					return false;
+				m_CqRing = bSingleMap ? m_SqRing : mmap(nullptr, m_CqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_Ring, IORING_OFF_CQ_RING);
+				if (m_CqRing == MAP_FAILED)
+					return false;
+				m_SqesSize = params.sq_entries * sizeof(io_uring_sqe);
+				m_Sqes = mmap(nullptr, m_SqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_Ring, IORING_OFF_SQES);
+				if (m_Sqes == MAP_FAILED)
+					return false;
+				uint8_t* sq = static_cast<uint8_t*>(m_SqRing);
+				m_SqHead = reinterpret_cast<uint32_t*>(sq + params.sq_off.head);
+				m_SqTail = reinterpret_cast<uint32_t*>(sq + params.sq_off.tail);
+				m_SqMask = *reinterpret_cast<uint32_t*>(sq + params.sq_off.ring_mask);
+				m_SqArray = reinterpret_cast<uint32_t*>(sq + params.sq_off.array);
+				uint8_t* cq = static_cast<uint8_t*>(m_CqRing);
+				m_CqHead = reinterpret_cast<uint32_t*>(cq + params.cq_off.head);
+				m_CqTail = reinterpret_cast<uint32_t*>(cq + params.cq_off.tail);
+				m_CqMask = *reinterpret_cast<uint32_t*>(cq + params.cq_off.ring_mask);
+				m_Cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+				//a locked memory limit too small for the arena only costs the copy free small reads
+				m_ArenaSize = m_Entries * SlotSize;
+				m_Arena = mmap(nullptr, m_ArenaSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+				if (m_Arena != MAP_FAILED)
+				{
+					std::vector<iovec> slots(m_Entries);
+					for (uint32_t i = 0; i < m_Entries; ++i)
+						slots[i] = { GetSlot(i), SlotSize };
+					m_bArenaRegistered = syscall(__NR_io_uring_register, m_Ring, IORING_REGISTER_BUFFERS, slots.data(), m_Entries) == 0;
+				}
+				return true;
+			}
+
+			uint32_t GetEntries() const { return m_Entries; }
+			bool HasArena() const { return m_bArenaRegistered; }
+			uint8_t* GetSlot(uint32_t slot) const { return static_cast<uint8_t*>(m_Arena) + slot * SlotSize; }
+
+			//null while every entry is taken, prepared entries go out with the next submit
+			io_uring_sqe* GetSqe()
+			{
+				const uint32_t head = std::atomic_ref<uint32_t>(*m_SqHead).load(std::memory_order_acquire);
+				const uint32_t tail = std::atomic_ref<uint32_t>(*m_SqTail).load(std::memory_order_relaxed) + m_Prepared;
+				if (tail - head >= m_Entries)
+					return nullptr;
+				const uint32_t index = tail & m_SqMask;
+				io_uring_sqe* sqe = static_cast<io_uring_sqe*>(m_Sqes) + index;
+				memset(sqe, 0, sizeof(io_uring_sqe));
+				m_SqArray[index] = index;
+				++m_Prepared;
+				return sqe;
+			}
+
+			//hands every prepared entry to the kernel and waits for at least one completion
+			void SubmitAndWait()
+			{
+				std::atomic_ref<uint32_t> tail(*m_SqTail);
+				tail.store(tail.load(std::memory_order_relaxed) + m_Prepared, std::memory_order_release);
+				m_Unsubmitted += m_Prepared;
+				m_Prepared = 0;
+				for (;;)
+				{
+					const int submitted = static_cast<int>(syscall(__NR_io_uring_enter, m_Ring, m_Unsubmitted, 1, IORING_ENTER_GETEVENTS, nullptr, 0));
+					if (submitted >= 0)
+					{
+						m_Unsubmitted -= static_cast<uint32_t>(submitted);
+						return;
+					}
+					//out of memory for the requests or interrupted, both go away on their own
+					if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+					{
+						//reads in flight may still land in their buffers, nothing can be released safely any more
+						RD_CRITICAL_ASSERT(true, "io_uring_enter failed with {}", strerror(errno));
+					}
+				}
+			}
+
+			//every completion that arrived, the entries they free can be prepared again from inside the callback
+			template<typename Callback>
+			void ForEachCompletion(Callback&& callback)
+			{
+				std::atomic_ref<uint32_t> head(*m_CqHead);
+				uint32_t current = head.load(std::memory_order_relaxed);
+				const uint32_t tail = std::atomic_ref<uint32_t>(*m_CqTail).load(std::memory_order_acquire);
+				for (; current != tail; ++current)
+				{
+					const io_uring_cqe cqe = m_Cqes[current & m_CqMask];
+					head.store(current + 1, std::memory_order_release);
+					callback(cqe);
+				}
+			}
+
+		private:
+			int m_Ring{ -1 };
+			uint32_t m_Entries{};
+			uint32_t m_Prepared{};
+			uint32_t m_Unsubmitted{};
+			void* m_SqRing{ MAP_FAILED };
+			size_t m_SqRingSize{};
+			void* m_CqRing{ MAP_FAILED };
+			size_t m_CqRingSize{};
+			void* m_Sqes{ MAP_FAILED };
+			size_t m_SqesSize{};
+			uint32_t* m_SqHead{};
+			uint32_t* m_SqTail{};
+			uint32_t* m_SqArray{};
+			uint32_t m_SqMask{};
+			uint32_t* m_CqHead{};
+			uint32_t* m_CqTail{};
+			io_uring_cqe* m_Cqes{};
+			uint32_t m_CqMask{};
+			void* m_Arena{ MAP_FAILED };
+			size_t m_ArenaSize{};
+			bool m_bArenaRegistered{ false };
+		};
+
+		//keeps the queue full with the ops that still have to go out and hands every completion back
+		//an op whose completion says it is not done yet goes out again, like the rest of a short read
+		template<typename Issue, typename Complete>
+		void DriveQueue(UringQueue& queue, std::vector<uint32_t> ops, Issue&& issue, Complete&& complete)
+		{
+			size_t next = 0;
+			uint32_t inFlight = 0;
+			while (next < ops.size() || inFlight > 0)
+			{
+				for (; next < ops.size(); ++next)
+				{
+					io_uring_sqe* sqe = queue.GetSqe();
+					if (!sqe)
+						break;
+					issue(ops[next], *sqe);
+					sqe->user_data = ops[next];
+					++inFlight;
+				}
+				queue.SubmitAndWait();
+				queue.ForEachCompletion([&](const io_uring_cqe& cqe) {
+					--inFlight;
+					if (complete(static_cast<uint32_t>(cqe.user_data), cqe.res))
+						ops.push_back(static_cast<uint32_t>(cqe.user_data));
+				});
+			}
+		}
+
+		class UringBackend : public IOBackend
+		{
+		public:
+			explicit UringBackend(uint32_t maxBatch) : m_MaxBatch{ (std::max)(maxBatch, 1u) } {}
+
+			//false if the kernel refuses to set up a queue, the caller falls back to streams then
+			bool Init()
+			{
+				std::unique_ptr<UringQueue> queue = AcquireQueue();
+				if (!queue)
+					return false;
+				RD_CORE_INFO("io_uring backend with {} entries a queue, registered buffers {}", queue->GetEntries(), queue->HasArena() ? "on" : "off, the locked memory limit is too low");
+				ReleaseQueue(std::move(queue));
+				return true;
+			}
+
+			const char* GetName() const override { return "io_uring"; }
+			uint32_t GetMaxBatch() const override { return m_MaxBatch; }
+
+			void Read(std::span<IORead> reads, IOBufferPool& pool) override
+			{
+				struct Pending
+				{
+					int m_File{ -1 };
+					uint64_t m_Offset{};
+					uint64_t m_Size{};
+					uint64_t m_Done{};
+					int32_t m_Slot{ -1 };
+				};
+				std::unique_ptr<UringQueue> queue = AcquireQueue();
+				if (!queue)
+				{
+					m_Fallback.Read(reads, pool);
+					return;
+				}
+				std::vector<Pending> pending(reads.size());
+				std::vector<uint32_t> ops;
+				//open and size every file first so the reads of the whole batch go out in one submit
+				for (uint32_t i = 0; i < reads.size(); ++i)
+				{
+					IORead& read = reads[i];
+					Pending& it = pending[i];
+					read.m_bSuccess = false;
+					it.m_File = open(read.m_Path.c_str(), O_RDONLY | O_CLOEXEC);
+					if (it.m_File < 0)
+					{
+						RD_ASSERT(true, "File {} unable to be opened", read.m_Path.string());
+						continue;
+					}
+					struct stat status{};
+					fstat(it.m_File, &status);
+					const uint64_t fileSize = static_cast<uint64_t>(status.st_size);
+					it.m_Offset = (std::min)(read.m_Offset, fileSize);
+					it.m_Size = read.m_Size ? (std::min)(read.m_Size, fileSize - it.m_Offset) : fileSize - it.m_Offset;
+					read.m_Data = pool.Acquire(static_cast<size_t>(it.m_Size));
+					if (it.m_Size == 0)
+					{
+						read.m_bSuccess = true;
+						continue;
+					}
+					posix_fadvise(it.m_File, static_cast<off_t>(it.m_Offset), static_cast<off_t>(it.m_Size), POSIX_FADV_SEQUENTIAL);
+					ops.push_back(i);
+				}
+				//never more in flight than entries, so a slot is always free for a read that fits
+				std::vector<int32_t> freeSlots;
+				for (uint32_t i = 0; queue->HasArena() && i < queue->GetEntries(); ++i)
+					freeSlots.push_back(static_cast<int32_t>(i));
+				DriveQueue(*queue, std::move(ops),
+					[&](uint32_t i, io_uring_sqe& sqe) {
+						Pending& it = pending[i];
+						if (it.m_Done == 0 && it.m_Size <= UringQueue::SlotSize && !freeSlots.empty())
+						{
+							it.m_Slot = freeSlots.back();
+							freeSlots.pop_back();
+						}
+						const uint64_t remaining = it.m_Size - it.m_Done;
+						sqe.fd = it.m_File;
+						sqe.off = it.m_Offset + it.m_Done;
+						sqe.len = static_cast<uint32_t>((std::min)(remaining, uint64_t(1) << 30));
+						if (it.m_Slot >= 0)
+						{
+							sqe.opcode = IORING_OP_READ_FIXED;
+							sqe.addr = reinterpret_cast<uint64_t>(queue->GetSlot(static_cast<uint32_t>(it.m_Slot)) + it.m_Done);
+							sqe.buf_index = static_cast<uint16_t>(it.m_Slot);
+						}
+						else
+						{
+							sqe.opcode = IORING_OP_READ;
+							sqe.addr = reinterpret_cast<uint64_t>(reads[i].m_Data.data() + it.m_Done);
+						}
+					},
+					[&](uint32_t i, int32_t result) {
+						IORead& read = reads[i];
+						Pending& it = pending[i];
+						if (result < 0)
+							RD_CORE_ERROR("File {} read failed with {}", read.m_Path.string(), strerror(-result));
+						else
+						{
+							it.m_Done += static_cast<uint64_t>(result);
+							//a short read is not the end, only reading nothing is
+							if (result > 0 && it.m_Done < it.m_Size)
+								return true;
+							if (it.m_Slot >= 0)
+								memcpy(read.m_Data.data(), queue->GetSlot(static_cast<uint32_t>(it.m_Slot)), static_cast<size_t>(it.m_Done));
+							read.m_Data.resize(static_cast<size_t>(it.m_Done));
+							read.m_bSuccess = true;
+						}
+						if (it.m_Slot >= 0)
+							freeSlots.push_back(it.m_Slot);
+						it.m_Slot = -1;
+						return false;
+					});
+				for (const Pending& it : pending)
+				{
+					if (it.m_File >= 0)
+						close(it.m_File);
+				}
+				ReleaseQueue(std::move(queue));
+			}
+
+			void Write(std::span<IOWrite> writes) override
+			{
+				struct Pending
+				{
+					int m_File{ -1 };
+					std::filesystem::path m_Target;
+					uint64_t m_Done{};
+					bool m_bFailed{ false };
+				};
+				std::unique_ptr<UringQueue> queue = AcquireQueue();
+				if (!queue)
+				{
+					m_Fallback.Write(writes);
+					return;
+				}
+				std::vector<Pending> pending(writes.size());
+				std::vector<uint32_t> ops;
+				//every file of the batch is different so all of them can be in flight at once
+				for (uint32_t i = 0; i < writes.size(); ++i)
+				{
+					IOWrite& write = writes[i];
+					Pending& it = pending[i];
+					write.m_bSuccess = false;
+					std::error_code ec;
+					std::filesystem::create_directories(write.m_Path.parent_path(), ec);
+					it.m_Target = write.m_Mode == IOWrite::Mode::Replace ? GetTemporaryPath(write.m_Path) : write.m_Path;
+					const int flags = write.m_Mode == IOWrite::Mode::Replace ? O_TRUNC : write.m_Mode == IOWrite::Mode::Append ? O_APPEND : 0;
+					it.m_File = open(it.m_Target.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC | flags, 0644);
+					if (it.m_File < 0)
+					{
+						RD_CORE_ERROR("File {} unable to be opened for writing", it.m_Target.string());
+						it.m_bFailed = true;
+						continue;
+					}
+					if (!write.m_Data.empty())
+						ops.push_back(i);
+				}
+				DriveQueue(*queue, std::move(ops),
+					[&](uint32_t i, io_uring_sqe& sqe) {
+						const IOWrite& write = writes[i];
+						const Pending& it = pending[i];
+						sqe.opcode = IORING_OP_WRITE;
+						sqe.fd = it.m_File;
+						//all ones writes at the file position, which O_APPEND keeps at the end
+						sqe.off = write.m_Mode == IOWrite::Mode::Append ? UINT64_MAX : (write.m_Mode == IOWrite::Mode::Patch ? write.m_Offset : 0) + it.m_Done;
+						sqe.addr = reinterpret_cast<uint64_t>(write.m_Data.data() + it.m_Done);
+						sqe.len = static_cast<uint32_t>((std::min)(static_cast<uint64_t>(write.m_Data.size()) - it.m_Done, uint64_t(1) << 30));
+					},
+					[&](uint32_t i, int32_t result) {
+						Pending& it = pending[i];
+						if (result <= 0)
+						{
+							RD_CORE_ERROR("File {} write failed with {}", it.m_Target.string(), result < 0 ? strerror(-result) : "nothing written");
+							it.m_bFailed = true;
+							return false;
+						}
+						it.m_Done += static_cast<uint64_t>(result);
+						return it.m_Done < writes[i].m_Data.size();
+					});
+				//the flushes of the batch go out together too, once every write has landed
+				std::vector<uint32_t> flushes;
+				for (uint32_t i = 0; i < writes.size(); ++i)
+				{
+					if (writes[i].m_bFlush && !pending[i].m_bFailed)
+						flushes.push_back(i);
+				}
+				DriveQueue(*queue, std::move(flushes),
+					[&](uint32_t i, io_uring_sqe& sqe) {
+						sqe.opcode = IORING_OP_FSYNC;
+						sqe.fd = pending[i].m_File;
+					},
+					[&](uint32_t i, int32_t result) {
+						if (result < 0)
+						{
+							RD_CORE_ERROR("File {} flush failed with {}", pending[i].m_Target.string(), strerror(-result));
+							pending[i].m_bFailed = true;
+						}
+						return false;
+					});
+				ReleaseQueue(std::move(queue));
+				for (uint32_t i = 0; i < writes.size(); ++i)
+				{
+					IOWrite& write = writes[i];
+					Pending& it = pending[i];
+					if (it.m_File >= 0)
+						close(it.m_File);
+					if (it.m_bFailed)
+						continue;
+					if (write.m_Mode == IOWrite::Mode::Replace)
+					{
+						std::error_code ec;
+						std::filesystem::rename(it.m_Target, write.m_Path, ec);
+						if (ec)
+						{
+							RD_CORE_ERROR("File {} unable to be replaced: {}", write.m_Path.string(), ec.message());
+							continue;
+						}
+						//the rename itself only survives a crash once the directory is flushed
+						if (write.m_bFlush)
+						{
+							const int directory = open(write.m_Path.parent_path().c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+							if (directory >= 0)
+							{
+								fsync(directory);
+								close(directory);
+							}
+						}
+					}
+					write.m_bSuccess = true;
+				}
+			}
+
+		private:
+			//a queue per call in flight, kept for the next call instead of being set up again
+			std::unique_ptr<UringQueue> AcquireQueue()
+			{
+				{
+					std::lock_guard<std::mutex> lock(m_Mutex);
+					if (!m_Queues.empty())
+					{
+						std::unique_ptr<UringQueue> queue = std::move(m_Queues.back());
+						m_Queues.pop_back();
+						return queue;
+					}
+				}
+				std::unique_ptr<UringQueue> queue = std::make_unique<UringQueue>();
+				if (!queue->Init(m_MaxBatch))
+					return nullptr;
+				return queue;
+			}
+
+			void ReleaseQueue(std::unique_ptr<UringQueue> queue)
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				m_Queues.emplace_back(std::move(queue));
+			}
+
+			uint32_t m_MaxBatch;
+			std::mutex m_Mutex;
+			std::vector<std::unique_ptr<UringQueue>> m_Queues;
+			//when a queue can not be set up, like past the limit of the process
+			StreamBackend m_Fallback;
+		};
+#endif
+	}
+
+	std::unique_ptr<IOBackend> IOBackend::Create(Type type, uint32_t maxBatch)
+	{
+		switch (type)
+		{
+#ifdef _WIN32
+		case Type::Overlapped:
+			return std::make_unique<OverlappedBackend>(maxBatch);
+#endif
+#ifdef __linux__
+		case Type::Uring:
+		{
+			std::unique_ptr<UringBackend> backend = std::make_unique<UringBackend>(maxBatch);
+			if (backend->Init())
+				return backend;
+			RD_CORE_WARN("io_uring is not available, reading through streams instead");
+			return std::make_unique<StreamBackend>();
+		}
+#endif
+		case Type::Stream:
+		default:
+			return std::make_unique<StreamBackend>();
+		}
+	}
+	bool IOBackend::EvictFromCache(const std::filesystem::path& path)
+	{
+#ifdef __linux__
+		//only clean pages go, which is every page of a file nobody is writing
+		const int file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (file < 0)
+			return false;
+		const bool bEvicted = posix_fadvise(file, 0, 0, POSIX_FADV_DONTNEED) == 0;
+		close(file);
+		return bEvicted;
+#else
+		//win32 only skips its cache for handles opened unbuffered, nothing evicts a file for every reader
+		return false;
+#endif
+	}
+}
\ No newline at end of file
@@ -0,0 +1,116 @@
+﻿/*!
+\file		IOBackend.h
+\date		17/10/2026
+
+\author		Devin Tan
+\email		devintrh@gmail.com
+
+\copyright	MIT License
+
+			Copyright © 2024 Tan Rui Hao Devin
+
+			Permission is hereby granted, free of charge, to any person obtaining a copy
+			of this software and associated documentation files (the "Software"), to deal
+			in the Software without restriction, including without limitation the rights
+			to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+			copies of the Software, and to permit persons to whom the Software is
+			furnished to do so, subject to the following conditions:
+
+			The above copyright notice and this permission notice shall be included in all
+			copies or substantial portions of the Software.
+
+			THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+			IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+			FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+			AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+			LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+			OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+			SOFTWARE.
+__________________________________________________________________________________*/
+#pragma once
+#include <span>
+
+namespace ragdoll
+{
+	//read buffers go back into the pool once their callback returns
+	class IOBufferPool
+	{
+	public:
+		std::vector<uint8_t> Acquire(size_t size);
+		void Release(std::vector<uint8_t>&& buffer);
+		void SetLimit(size_t bytes) { m_Limit = bytes; }
+		uint64_t GetReuses() const { return m_Reuses; }
+
+	private:
+		std::mutex m_Mutex;
+		std::vector<std::vector<uint8_t>> m_Free;
+		size_t m_PooledBytes{};
+		size_t m_Limit{};
+		std::atomic<uint64_t> m_Reuses{};
+	};
+
+	//one read of a batch, a size of 0 reads from the offset to the end of the file
+	struct IORead
+	{
+		std::filesystem::path m_Path;
+		uint64_t m_Offset{ 0 };
+		uint64_t m_Size{ 0 };
+		//filled from the pool, holds what was actually read which is less than m_Size past the end of the file
+		std::vector<uint8_t> m_Data;
+		bool m_bSuccess{ false };
+	};
+
+	//one write of a batch, a batch never has two writes to the same file
+	struct IOWrite
+	{
+		enum class Mode
+		{
+			//written to a temporary next to the file and renamed over it
+			Replace,
+			Append,
+			//at m_Offset, the rest of the file is kept
+			Patch
+		};
+		std::filesystem::path m_Path;
+		Mode m_Mode{ Mode::Replace };
+		uint64_t m_Offset{ 0 };
+		std::span<const uint8_t> m_Data;
+		//flushed to the device before the write counts as done
+		bool m_bFlush{ false };
+		bool m_bSuccess{ false };
+	};
+
+	//how the file manager workers move bytes to and from the disk, every call is independent so one backend serves all workers
+	class IOBackend
+	{
+	public:
+		enum class Type
+		{
+			//blocking std::fstream reads and writes one after the other
+			Stream,
+			//every read or write of a batch is in flight at once as overlapped win32 io
+			Overlapped,
+			//every read or write of a batch submitted at once through io_uring, small reads land in registered buffers, linux only
+			Uring,
+		};
+		//the batched backend of the platform this is built for
+#ifdef _WIN32
+		static constexpr Type NativeType = Type::Overlapped;
+#else
+		static constexpr Type NativeType = Type::Uring;
+#endif
+
+		virtual ~IOBackend() = default;
+		virtual const char* GetName() const = 0;
+		//how many reads one call is worth handing over
+		virtual uint32_t GetMaxBatch() const = 0;
+		//returns once every read of the batch has finished or failed
+		virtual void Read(std::span<IORead> reads, IOBufferPool& pool) = 0;
+		//returns once every write of the batch is in the os, or on the device for the flushed ones, or has failed
+		virtual void Write(std::span<IOWrite> writes) = 0;
+
+		static std::unique_ptr<IOBackend> Create(Type type, uint32_t maxBatch);
+		//drops the file from the os page cache where the os allows it, so the next read comes from the disk
+		static bool EvictFromCache(const std::filesystem::path& path);
+	};
+}
@@ -0,0 +1,474 @@
+﻿/*!
+\file		PackedArchive.cpp
+\date		17/10/2026
+
+\author		Devin Tan
+\email		devintrh@gmail.com
+
+\copyright	MIT License
+
+			Copyright © 2024 Tan Rui Hao Devin
+
+			Permission is hereby granted, free of charge, to any person obtaining a copy
+			of this software and associated documentation files (the "Software"), to deal
+			in the Software without restriction, including without limitation the rights
+			to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+			copies of the Software, and to permit persons to whom the Software is
+			furnished to do so, subject to the following conditions:
+
+			The above copyright notice and this permission notice shall be included in all
+			copies or substantial portions of the Software.
+
+			THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+			IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+			FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+			AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+			LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+			OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+			SOFTWARE.
+__________________________________________________________________________________*/
+#include "ragdollpch.h"
+#include "PackedArchive.h"
+#include "FileManager.h"
+#include "Ragdoll/Core/Hash.h"
+#include "stb_image.h"
+
+//deflate from stb_image_write, its implementation is compiled with tinygltf
+extern "C" unsigned char* stbi_zlib_compress(unsigned char* data, int data_len, int* out_len, int quality);
+
+namespace ragdoll
+{
+	namespace
+	{
+		uint64_t AlignUp(uint64_t value, uint64_t alignment)
+		{
+			return (value + alignment - 1) / alignment * alignment;
+		}
+
+		//deflating these again only costs load time
+		bool IsCompressedFormat(const std::filesystem::path& path)
+		{
+			std::string extension = path.extension().string();
+			std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+			return extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".dds" || extension == ".ktx2" || extension == ".rdtex" || extension == ".rdpak";
+		}
+	}
+
+	bool PackedArchive::Open(const std::filesystem::path& path)
+	{
+		Close();
+		if (!m_File.Open(path) || m_File.GetSize() < sizeof(Header))
+		{
+			RD_CORE_ERROR("Archive {} unable to be opened", path.string());
+			Close();
+			return false;
+		}
+		Header header;
+		memcpy(&header, m_File.GetData(), sizeof(Header));
+		const uint64_t tocEnd = sizeof(Header) + uint64_t(header.m_EntryCount) * sizeof(Entry);
+		if (header.m_Magic != Magic || header.m_Version != Version || tocEnd > m_File.GetSize()
+			|| header.m_NamesOffset < tocEnd || header.m_NamesOffset + header.m_NamesSize > m_File.GetSize())
+		{
+			RD_CORE_ERROR("Archive {} is not a version {} archive", path.string(), Version);
+			Close();
+			return false;
+		}
+		m_Entries = reinterpret_cast<const Entry*>(m_File.GetData() + sizeof(Header));
+		m_EntryCount = header.m_EntryCount;
+		m_Names = reinterpret_cast<const char*>(m_File.GetData() + header.m_NamesOffset);
+		m_NamesSize = header.m_NamesSize;
+		for (const Entry& entry : GetEntries())
+		{
+			if (entry.m_Offset + entry.m_StoredSize > m_File.GetSize() || entry.m_NameOffset >= m_NamesSize)
+			{
+				RD_CORE_ERROR("Archive {} has an entry past its end", path.string());
+				Close();
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void PackedArchive::Close()
+	{
+		m_File.Close();
+		m_Entries = nullptr;
+		m_EntryCount = 0;
+		m_Names = nullptr;
+		m_NamesSize = 0;
+	}
+
+	const PackedArchive::Entry* PackedArchive::Find(std::string_view normalizedPath) const
+	{
+		const uint64_t hash = HashPath(normalizedPath);
+		const Entry* end = m_Entries + m_EntryCount;
+		const Entry* it = std::lower_bound(m_Entries, end, hash, [](const Entry& entry, uint64_t value) { return entry.m_PathHash < value; });
+		//the name check makes a hash collision a miss instead of the wrong file
+		if (it == end || it->m_PathHash != hash || GetName(*it) != normalizedPath)
+			return nullptr;
+		return it;
+	}
+
+	std::string_view PackedArchive::GetName(const Entry& entry) const
+	{
+		const char* name = m_Names + entry.m_NameOffset;
+		return std::string_view(name, strnlen(name, static_cast<size_t>(m_NamesSize - entry.m_NameOffset)));
+	}
+
+	const uint8_t* PackedArchive::GetView(const Entry& entry) const
+	{
+		if (entry.m_Flags & Deflated)
+			return nullptr;
+		return m_File.GetData() + entry.m_Offset;
+	}
+
+	bool PackedArchive::Read(const Entry& entry, uint64_t offset, uint64_t size, std::vector<uint8_t>& data) const
+	{
+		offset = std::min(offset, entry.m_Size);
+		size = size ? std::min(size, entry.m_Size - offset) : entry.m_Size - offset;
+		if (const uint8_t* view = GetView(entry))
+		{
+			data.assign(view + offset, view + offset + size);
+			return true;
+		}
+		//deflate can not seek, the whole entry is inflated and the range moved to the front
+		data.resize(static_cast<size_t>(entry.m_Size));
+		const int inflated = stbi_zlib_decode_buffer(reinterpret_cast<char*>(data.data()), static_cast<int>(data.size()),
+			reinterpret_cast<const char*>(m_File.GetData() + entry.m_Offset), static_cast<int>(entry.m_StoredSize));
+		if (inflated != static_cast<int>(entry.m_Size))
+		{
+			RD_CORE_ERROR("Archive entry {} failed to inflate", GetName(entry));
+			data.clear();
+			return false;
+		}
+		if (offset)
+			memmove(data.data(), data.data() + offset, static_cast<size_t>(size));
+		data.resize(static_cast<size_t>(size));
+		return true;
+	}
+
+	std::string PackedArchive::NormalizePath(const std::filesystem::path& path)
+	{
+		std::string normalized = path.lexically_normal().generic_string();
+		std::replace(normalized.begin(), normalized.end(), '\\', '/');
+		std::transform(normalized.begin(), normalized.end(), normalized.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+		size_t start = 0;
+		while (normalized.compare(start, 2, "./") == 0)
+			start += 2;
+		while (start < normalized.size() && normalized[start] == '/')
+			++start;
+		return normalized.substr(start);
+	}
+
+	uint64_t PackedArchive::HashPath(std::string_view normalizedPath)
+	{
+		return Hash64(normalizedPath.data(), normalizedPath.size());
+	}
+
+	bool PackedArchive::Build(const std::filesystem::path& sourceRoot, const std::filesystem::path& archivePath, const BuildSettings& settings)
+	{
+		RD_SCOPE(Load, Build Archive);
+		struct Source
+		{
+			std::filesystem::path m_Path;
+			std::string m_Name;
+			uint64_t m_Hash;
+		};
+		std::vector<Source> sources;
+		std::error_code ec;
+		const std::filesystem::path archiveAbsolute = std::filesystem::absolute(archivePath, ec);
+		for (auto it = std::filesystem::recursive_directory_iterator(sourceRoot, ec); it != std::filesystem::recursive_directory_iterator(); it.increment(ec))
+		{
+			//the caches are written at runtime and other archives are mounted on their own
+			if (it->is_directory() && it.depth() == 0 && it->path().filename() == "cache")
+			{
+				it.disable_recursion_pending();
+				continue;
+			}
+			if (!it->is_regular_file() || it->path().extension() == ".rdpak" || std::filesystem::absolute(it->path(), ec) == archiveAbsolute)
+				continue;
+			Source& source = sources.emplace_back();
+			source.m_Path = it->path();
+			source.m_Name = NormalizePath(it->path().lexically_relative(sourceRoot));
+			source.m_Hash = HashPath(source.m_Name);
+		}
+		std::sort(sources.begin(), sources.end(), [](const Source& a, const Source& b) { return a.m_Hash < b.m_Hash; });
+		for (size_t i = 1; i < sources.size(); ++i)
+		{
+			if (sources[i].m_Hash == sources[i - 1].m_Hash)
+			{
+				RD_CORE_ERROR("Archive paths {} and {} hash the same", sources[i - 1].m_Name, sources[i].m_Name);
+				return false;
+			}
+		}
+
+		const uint64_t alignment = std::max(settings.m_Alignment, 1u);
+		Header header{};
+		header.m_Magic = Magic;
+		header.m_Version = Version;
+		header.m_EntryCount = static_cast<uint32_t>(sources.size());
+		header.m_Alignment = static_cast<uint32_t>(alignment);
+		header.m_NamesOffset = sizeof(Header) + sources.size() * sizeof(Entry);
+		std::vector<Entry> entries(sources.size());
+		std::string names;
+		for (size_t i = 0; i < sources.size(); ++i)
+		{
+			entries[i].m_PathHash = sources[i].m_Hash;
+			entries[i].m_NameOffset = static_cast<uint32_t>(names.size());
+			names += sources[i].m_Name;
+			names += '\0';
+		}
+		header.m_NamesSize = names.size();
+
+		std::filesystem::create_directories(archivePath.parent_path(), ec);
+		//written next to the archive and renamed over it so a mounted archive is never half written
+		std::filesystem::path tempPath = archivePath;
+		tempPath += ".tmp";
+		uint64_t storedBytes = 0, rawBytes = 0;
+		uint32_t deflated = 0;
+		{
+			std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+			if (!out)
+			{
+				RD_CORE_ERROR("Archive {} unable to be written", archivePath.string());
+				return false;
+			}
+			uint64_t offset = AlignUp(header.m_NamesOffset + header.m_NamesSize, alignment);
+			std::vector<uint8_t> data;
+			for (size_t i = 0; i < sources.size(); ++i)
+			{
+				std::ifstream file(sources[i].m_Path, std::ios::binary | std::ios::ate);
+				if (!file)
+				{
+					RD_CORE_ERROR("File {} unable to be packed", sources[i].m_Path.string());
+					return false;
+				}
+				data.resize(static_cast<size_t>(file.tellg()));
+				file.seekg(0, std::ios::beg);
+				file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size()));
+
+				Entry& entry = entries[i];
+				entry.m_Offset = offset;
+				entry.m_Size = data.size();
+				const uint8_t* stored = data.data();
+				entry.m_StoredSize = data.size();
+				unsigned char* compressed = nullptr;
+				if (settings.m_bCompress && !IsCompressedFormat(sources[i].m_Path) && data.size() >= 256 && data.size() < INT_MAX)
+				{
+					int compressedSize = 0;
+					compressed = stbi_zlib_compress(data.data(), static_cast<int>(data.size()), &compressedSize, settings.m_Quality);
+					if (compressed && compressedSize < data.size() * settings.m_MaxRatio)
+					{
+						stored = compressed;
+						entry.m_StoredSize = static_cast<uint64_t>(compressedSize);
+						entry.m_Flags |= Deflated;
+						++deflated;
+					}
+				}
+				out.seekp(static_cast<std::streamoff>(offset), std::ios::beg);
+				out.write(reinterpret_cast<const char*>(stored), static_cast<std::streamsize>(entry.m_StoredSize));
+				free(compressed);
+				storedBytes += entry.m_StoredSize;
+				rawBytes += entry.m_Size;
+				offset = AlignUp(offset + entry.m_StoredSize, alignment);
+			}
+			out.seekp(0, std::ios::beg);
+			out.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+			out.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(Entry)));
+			out.write(names.data(), static_cast<std::streamsize>(names.size()));
+			if (!out.good())
+			{
+				RD_CORE_ERROR("Archive {} write failed", archivePath.string());
+				return false;
+			}
+		}
+		std::filesystem::rename(tempPath, archivePath, ec);
+		if (ec)
+		{
+			RD_CORE_ERROR("Archive {} unable to be replaced: {}", archivePath.string(), ec.message());
+			return false;
+		}
+		RD_CORE_INFO("Packed {} files of {:.2f}MB into {} as {:.2f}MB, {} deflated", sources.size(), rawBytes / (1024.0 * 1024.0), archivePath.string(),
+			storedBytes / (1024.0 * 1024.0), deflated);
+		return true;
+	}
+
+	namespace
+	{
+		//byte j of test file i, every other file is noise so both stored and deflated entries get checked
+		uint8_t GetArchiveTestByte(size_t file, size_t j)
+		{
+			if (file % 2)
+				return static_cast<uint8_t>((j * 2654435761u + file * 40503u) >> 13);
+			return static_cast<uint8_t>((j / 64 + file) & 0x7);
+		}
+	}
+
+	bool VerifyPackedArchive()
+	{
+		constexpr size_t FileCount = 48;
+		constexpr uint32_t RangedReads = 512;
+		const std::filesystem::path directory = std::filesystem::temp_directory_path() / "RagdollArchiveVerify";
+		const std::filesystem::path sourceRoot = directory / "source";
+		const std::filesystem::path archivePath = directory / "verify.rdpak";
+		std::error_code ec;
+		std::filesystem::remove_all(directory, ec);
+		std::vector<std::string> names;
+		std::vector<size_t> sizes;
+		for (size_t i = 0; i < FileCount; ++i)
+		{
+			//nested folders, mixed case and an empty file
+			names.emplace_back(fmt::format("{}/Sub{}/File{}.bin", i % 3 ? "data" : "Shaders", i % 5, i));
+			sizes.push_back(i == 7 ? 0 : (i * 7919 + 13) % (size_t(200) << 10));
+			std::vector<uint8_t> data(sizes.back());
+			for (size_t j = 0; j < data.size(); ++j)
+				data[j] = GetArchiveTestByte(i, j);
+			std::filesystem::create_directories((sourceRoot / names.back()).parent_path(), ec);
+			std::ofstream file(sourceRoot / names.back(), std::ios::binary);
+			file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+		}
+
+		uint32_t failures = 0;
+		auto Fail = [&failures](const char* reason, const std::string& name) {
+			if (failures++ < 8)
+				RD_CORE_ERROR("Archive check failed on {}: {}", name, reason);
+		};
+		PackedArchive::BuildSettings buildSettings;
+		if (!PackedArchive::Build(sourceRoot, archivePath, buildSettings))
+			return false;
+		{
+			PackedArchive archive;
+			if (!archive.Open(archivePath) || archive.GetEntries().size() != FileCount)
+				Fail("archive did not open with every file", archivePath.string());
+			uint32_t deflated = 0;
+			for (const PackedArchive::Entry& entry : archive.GetEntries())
+			{
+				deflated += (entry.m_Flags & PackedArchive::Deflated) ? 1 : 0;
+				if (entry.m_Offset % buildSettings.m_Alignment)
+					Fail("entry is not aligned", std::string(archive.GetName(entry)));
+			}
+			if (deflated == 0 || deflated == FileCount)
+				Fail("expected a mix of stored and deflated entries", archivePath.string());
+			if (archive.Find("data/sub1/missing.bin"))
+				Fail("found a file that was never packed", "data/sub1/missing.bin");
+		}
+
+		FileManager manager;
+		manager.Init();
+		if (!manager.Mount(archivePath, "packed"))
+			Fail("mount failed", archivePath.string());
+		for (size_t i = 0; i < FileCount; ++i)
+		{
+			//another spelling of the same path has to land on the same entry
+			std::string spelling = "./packed/" + names[i];
+			std::transform(spelling.begin(), spelling.end(), spelling.begin(), [](unsigned char c) { return static_cast<char>(toupper(c)); });
+			uint32_t size = 0;
+			const uint8_t* data = manager.ImmediateLoad(spelling, size);
+			if (size != sizes[i])
+			{
+				Fail("immediate load has the wrong size", names[i]);
+				continue;
+			}
+			for (size_t j = 0; j < size; ++j)
+			{
+				if (data[j] != GetArchiveTestByte(i, j))
+				{
+					Fail("immediate load has the wrong bytes", names[i]);
+					break;
+				}
+			}
+		}
+		std::atomic<uint32_t> asyncFailures{};
+		for (uint32_t i = 0; i < RangedReads; ++i)
+		{
+			const size_t file = i % FileCount;
+			const uint64_t offset = sizes[file] ? (uint64_t(i) * 7919) % sizes[file] : 0;
+			const uint64_t size = (i % 3) ? (uint64_t(i) * 131) % 20000 + 1 : 0;
+			const size_t expected = static_cast<size_t>(size ? std::min<uint64_t>(size, sizes[file] - offset) : sizes[file] - offset);
+			manager.QueueRequest(FileIORequest(Guid(i + 1), std::filesystem::path("packed") / names[file], [&, file, offset, expected](Guid, const uint8_t* data, uint32_t readSize) {
+				if (readSize != expected)
+				{
+					asyncFailures.fetch_add(1);
+					return;
+				}
+				for (size_t j = 0; j < readSize; ++j)
+				{
+					if (data[j] != GetArchiveTestByte(file, static_cast<size_t>(offset) + j))
+					{
+						asyncFailures.fetch_add(1);
+						return;
+					}
+				}
+			}, offset, size, FileIORequest::Type::Read, FileIORequest::Priority::Normal, (i % 2) ? FileIORequest::Completion::Task : FileIORequest::Completion::MainThread));
+		}
+		manager.WaitIdle();
+		if (asyncFailures)
+			Fail("queued ranged reads came back wrong", std::to_string(asyncFailures.load()));
+		const FileManager::Stats stats = manager.GetStats();
+		if (stats.m_ArchiveReads != FileCount + RangedReads)
+			Fail("not every read came from the archive", std::to_string(stats.m_ArchiveReads));
+		manager.Shutdown();
+		std::filesystem::remove_all(directory, ec);
+		if (failures)
+		{
+			RD_CORE_ERROR("Archive checks failed {} times", failures);
+			return false;
+		}
+		RD_CORE_INFO("Archive checks passed, {} files read whole and {} ranged reads through the mount", FileCount, RangedReads);
+		return true;
+	}
+
+	void BenchmarkPackedArchive(const std::filesystem::path& archivePath)
+	{
+		using Clock = std::chrono::high_resolution_clock;
+		std::vector<std::string> names;
+		uint64_t rawBytes = 0;
+		{
+			PackedArchive archive;
+			if (!archive.Open(archivePath))
+				return;
+			for (const PackedArchive::Entry& entry : archive.GetEntries())
+			{
+				names.emplace_back(archive.GetName(entry));
+				rawBytes += entry.m_Size;
+			}
+		}
+		//the startup pattern, one blocking load after the other
+		auto Run = [&](bool bMounted) {
+			FileManager manager;
+			manager.Init();
+			const Clock::time_point start = Clock::now();
+			if (bMounted)
+				manager.Mount(archivePath);
+			uint64_t bytes = 0;
+			uint32_t missing = 0;
+			//touches every page, a mapped entry is not read until then, and both runs have to agree on it
+			uint64_t checksum = 0;
+			for (const std::string& name : names)
+			{
+				uint32_t size = 0;
+				const uint8_t* data = manager.ImmediateLoad(name, size);
+				for (uint32_t j = 0; j < size; j += 4096)
+					checksum = checksum * 31 + data[j];
+				bytes += size;
+				missing += size == 0 ? 1 : 0;
+			}
+			const double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+			manager.Shutdown();
+			if (bytes != rawBytes)
+				RD_CORE_WARN("Read {} of {} bytes, {} files empty or missing", bytes, rawBytes, missing);
+			return std::make_pair(ms, checksum);
+		};
+		const double megabytes = rawBytes / (1024.0 * 1024.0);
+		RD_CORE_INFO("Archive benchmark over the {} files {:.2f}MB of {}, the first run pays for whatever the os has not cached", names.size(), megabytes, archivePath.string());
+		for (uint32_t pass = 0; pass < 2; ++pass)
+		{
+			const auto [looseMs, looseChecksum] = Run(false);
+			const auto [packedMs, packedChecksum] = Run(true);
+			if (looseChecksum != packedChecksum)
+				RD_CORE_WARN("The archive does not match the loose files, it is older than them");
+			RD_CORE_INFO("  pass {}: loose files {:.2f}ms {:.0f} files/s, archive {:.2f}ms {:.0f} files/s including the mount",
+				pass, looseMs, names.size() / (looseMs / 1000.0), packedMs, names.size() / (packedMs / 1000.0));
+		}
+	}
+}
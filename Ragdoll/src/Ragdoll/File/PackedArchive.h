@@ -0,0 +1,113 @@
+﻿/*!
+\file		PackedArchive.h
+\date		17/10/2026
+
+\author		Devin Tan
+\email		devintrh@gmail.com
+
+\copyright	MIT License
+
+			Copyright © 2024 Tan Rui Hao Devin
+
+			Permission is hereby granted, free of charge, to any person obtaining a copy
+			of this software and associated documentation files (the "Software"), to deal
+			in the Software without restriction, including without limitation the rights
+			to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+			copies of the Software, and to permit persons to whom the Software is
+			furnished to do so, subject to the following conditions:
+
+			The above copyright notice and this permission notice shall be included in all
+			copies or substantial portions of the Software.
+
+			THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+			IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+			FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+			AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+			LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+			OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+			SOFTWARE.
+__________________________________________________________________________________*/
+#pragma once
+#include <span>
+#include "MappedFile.h"
+
+namespace ragdoll
+{
+	//read only pack of many files in one, mapped whole so opening an entry costs a binary search instead of a file open
+	//layout: header, toc sorted by path hash, names, then every entry at an aligned offset
+	//entries that shrink well are stored deflated, the rest are stored as is and can be used straight from the mapping
+	class PackedArchive
+	{
+	public:
+		//'RDPK'
+		static constexpr uint32_t Magic = 0x4b504452;
+		//bump whenever the layout changes
+		static constexpr uint32_t Version = 1;
+
+		enum EntryFlags : uint32_t
+		{
+			Deflated = 1 << 0,
+		};
+		struct Header
+		{
+			uint32_t m_Magic;
+			uint32_t m_Version;
+			uint32_t m_EntryCount;
+			uint32_t m_Alignment;
+			uint64_t m_NamesOffset;
+			uint64_t m_NamesSize;
+		};
+		struct Entry
+		{
+			uint64_t m_PathHash;
+			uint64_t m_Offset;
+			//bytes in the archive
+			uint64_t m_StoredSize;
+			//bytes of the file
+			uint64_t m_Size;
+			uint32_t m_Flags;
+			//into the names, null terminated
+			uint32_t m_NameOffset;
+		};
+		struct BuildSettings
+		{
+			//of every entry, a page keeps entries friendly to unbuffered reads
+			uint32_t m_Alignment{ 4096 };
+			bool m_bCompress{ true };
+			//zlib level
+			int m_Quality{ 8 };
+			//entries are only kept deflated when this much smaller
+			float m_MaxRatio{ 0.9f };
+		};
+
+		bool Open(const std::filesystem::path& path);
+		void Close();
+		bool IsOpen() const { return m_File.IsOpen(); }
+
+		const Entry* Find(std::string_view normalizedPath) const;
+		std::span<const Entry> GetEntries() const { return { m_Entries, m_EntryCount }; }
+		std::string_view GetName(const Entry& entry) const;
+		//the file bytes straight from the mapping, null when the entry is deflated
+		const uint8_t* GetView(const Entry& entry) const;
+		//inflates or copies the range into data, a size of 0 reads from the offset to the end of the entry
+		bool Read(const Entry& entry, uint64_t offset, uint64_t size, std::vector<uint8_t>& data) const;
+
+		//forward slashes, lower case and no leading ./ so every spelling of a path hashes the same
+		static std::string NormalizePath(const std::filesystem::path& path);
+		static uint64_t HashPath(std::string_view normalizedPath);
+		//packs every file under the source root, already compressed formats are never deflated
+		static bool Build(const std::filesystem::path& sourceRoot, const std::filesystem::path& archivePath, const BuildSettings& settings);
+
+	private:
+		MappedFile m_File;
+		const Entry* m_Entries{ nullptr };
+		uint32_t m_EntryCount{ 0 };
+		const char* m_Names{ nullptr };
+		uint64_t m_NamesSize{ 0 };
+	};
+
+	//packs a folder of generated files, mounts it and reads every entry back whole and in ranges, returns false on any failure
+	bool VerifyPackedArchive();
+	//opens and reads every entry of the archive once as loose files under the asset root and once through the mounted archive
+	void BenchmarkPackedArchive(const std::filesystem::path& archivePath);
+}
@@ -6,7 +6,13 @@
 #include "Ragdoll/Entity/EntityManager.h"
 
 #include "Executor.h"
+#include "TangentSpace.h"
+#include "TextureStreamer.h"
+#include "DecodeScratch.h"
 #include "Profiler.h"
+#include "MeshCache.h"
+#include "MeshImport.h"
+#include "Ragdoll/Core/Hash.h"
 
 #include "Ragdoll/Components/TransformComp.h"
 #include "Ragdoll/Components/RenderableComp.h"
@@ -19,46 +25,17 @@
 #define TINYGLTF_NO_EXTERNAL_IMAGE
 #define TINYGLTF_USE_CPP14
 #define STB_IMAGE_IMPLEMENTATION
+//image decodes on the executor draw their stb buffers from the per worker scratch caches
+#define STBI_MALLOC(size) DecodeScratch::Allocate(size)
+#define STBI_REALLOC(block, size) DecodeScratch::Reallocate(block, size)
+#define STBI_FREE(block) DecodeScratch::Free(block)
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 // #define TINYGLTF_NOEXCEPTION // optional. disable exception handling.
 #include <tiny_gltf.h>
 
 #include <nvrhi/common/dxgi-format.h>
 #include "DirectXTex.h"
-
-struct DDS_HEADER {
-	DWORD           dwSize;
-	DWORD           dwFlags;
-	DWORD           dwHeight;
-	DWORD           dwWidth;
-	DWORD           dwPitchOrLinearSize;
-	DWORD           dwDepth;
-	DWORD           dwMipMapCount;
-	DWORD           dwReserved1[11];
-	struct DDS_PIXELFORMAT {
-		DWORD dwSize;
-		DWORD dwFlags;
-		DWORD dwFourCC;
-		DWORD dwRGBBitCount;
-		DWORD dwRBitMask;
-		DWORD dwGBitMask;
-		DWORD dwBBitMask;
-		DWORD dwABitMask;
-	} ddspf;
-	DWORD           dwCaps;
-	DWORD           dwCaps2;
-	DWORD           dwCaps3;
-	DWORD           dwCaps4;
-	DWORD           dwReserved2;
-};
-
-struct DDS_HEADER_DXT10 {
-	uint32_t dxgiFormat;
-	uint32_t resourceDimension;
-	uint32_t miscFlag;
-	uint32_t arraySize;
-	uint32_t miscFlags2;
-};
+#include <numeric>
 
 size_t DirectX::BitsPerPixel(DXGI_FORMAT fmt) noexcept
 {
@@ -494,20 +471,6 @@ HRESULT DirectX::ComputePitch(DXGI_FORMAT fmt, size_t width, size_t height,
 	return S_OK;
 }
 
-nvrhi::Format SearchForFormat(uint32_t flag)
-{
-	for (int i = 0; i < (int)nvrhi::Format::COUNT; ++i)
-	{
-		nvrhi::DxgiFormatMapping mapping = nvrhi::getDxgiFormatMapping((nvrhi::Format)i);
-		if (mapping.resourceFormat == flag)
-			return mapping.abstractFormat;
-		if (mapping.rtvFormat == flag)
-			return mapping.abstractFormat;
-		if (mapping.srvFormat == flag)
-			return mapping.abstractFormat;
-	}
-}
-
 void GLTFLoader::Init(std::filesystem::path root, std::shared_ptr<ragdoll::FileManager> fm, std::shared_ptr<ragdoll::EntityManager> em, std::shared_ptr<ragdoll::Scene> scene)
 {
 	Root = root;
@@ -619,6 +582,656 @@ enum AttributeType {
 	Count
 };
 
+//images are decoded in the texture tasks, stop tinygltf from decoding the embedded ones on its own
+bool SkipImageLoad(tinygltf::Image*, const int, std::string*, std::string*, int, int, const unsigned char*, int, void*)
+{
+	return true;
+}
+
+//the old path, tinygltf copies every buffer into the model
+bool LoadCopiedModel(tinygltf::TinyGLTF& loader, tinygltf::Model& model, const std::filesystem::path& path, std::string& err, std::string& warn)
+{
+	loader.SetImageLoader(SkipImageLoad, nullptr);
+	if (path.extension() == ".glb")
+		return loader.LoadBinaryFromFile(&model, &err, &warn, path.string());
+	return loader.LoadASCIIFromFile(&model, &err, &warn, path.string());
+}
+
+//uris are percent encoded utf-8, a space in a file name comes in as %20
+std::filesystem::path ResolveUri(const std::filesystem::path& directory, const std::string& uri)
+{
+	std::string Decoded;
+	if (!tinygltf::URIDecode(uri, &Decoded, nullptr))
+		Decoded = uri;
+	return directory / std::filesystem::path(std::u8string(Decoded.begin(), Decoded.end()));
+}
+
+bool GLTFLoader::LoadMappedModel(tinygltf::TinyGLTF& loader, tinygltf::Model& model, const std::filesystem::path& path, std::string& err, std::string& warn)
+{
+	ragdoll::MappedFile& File = MappedFiles.emplace_back();
+	if (!File.Open(path))
+		return false;
+
+	std::string_view Json;
+	const uint8_t* BinChunk = nullptr;
+	if (path.extension() == ".glb")
+	{
+		//glb is a 12 byte header of magic, version and length, followed by the json chunk and an optional bin chunk
+		//every chunk starts with its length and type
+		const uint8_t* Data = File.GetData();
+		const uint32_t* Header = reinterpret_cast<const uint32_t*>(Data);
+		if (File.GetSize() < 20 || Header[0] != 0x46546C67 || Header[1] != 2 || Header[2] > File.GetSize())
+		{
+			err = "Invalid glb header";
+			return false;
+		}
+		uint32_t JsonLength = Header[3];
+		if (Header[4] != 0x4E4F534A || 20 + size_t(JsonLength) > Header[2])
+		{
+			err = "Invalid glb json chunk";
+			return false;
+		}
+		Json = { reinterpret_cast<const char*>(Data + 20), JsonLength };
+		//chunks are 4 byte aligned, the bin chunk is right after the json chunk if it exists
+		size_t BinHeaderOffset = 20 + size_t(JsonLength);
+		if (BinHeaderOffset + 8 <= Header[2])
+		{
+			const uint32_t* BinHeader = reinterpret_cast<const uint32_t*>(Data + BinHeaderOffset);
+			if (BinHeader[1] == 0x004E4942)
+				BinChunk = Data + BinHeaderOffset + 8;
+		}
+	}
+	else
+	{
+		Json = { reinterpret_cast<const char*>(File.GetData()), File.GetSize() };
+	}
+
+	nlohmann::json Doc = nlohmann::json::parse(Json.begin(), Json.end(), nullptr, false);
+	if (Doc.is_discarded())
+	{
+		err = "Unable to parse gltf json";
+		return false;
+	}
+	//point every buffer at mapped memory, then swap it out in the json for a 1 byte placeholder so tinygltf does not copy it
+	MappedBuffers.clear();
+	if (Doc.contains("buffers"))
+	{
+		for (nlohmann::json& Buffer : Doc["buffers"])
+		{
+			//meshopt fallback buffers hold no data at all, every view into them is decoded from a compressed buffer instead
+			const bool bMeshoptFallback = Buffer.contains("extensions") && Buffer["extensions"].contains("EXT_meshopt_compression");
+			if (!Buffer.contains("uri") && bMeshoptFallback)
+			{
+				MappedBuffers.emplace_back(nullptr);
+			}
+			else if (!Buffer.contains("uri"))
+			{
+				if (!BinChunk)
+				{
+					err = "Buffer without uri but there is no glb bin chunk";
+					return false;
+				}
+				MappedBuffers.emplace_back(BinChunk);
+			}
+			else
+			{
+				std::string Uri = Buffer["uri"].get<std::string>();
+				if (Uri.starts_with("data:"))
+				{
+					//base64 buffers have to be decoded anyway, leave them to tinygltf
+					MappedBuffers.emplace_back(nullptr);
+					continue;
+				}
+				ragdoll::MappedFile& BufferFile = MappedFiles.emplace_back();
+				if (!BufferFile.Open(ResolveUri(path.parent_path(), Uri)))
+				{
+					err = "Unable to map buffer " + Uri;
+					return false;
+				}
+				MappedBuffers.emplace_back(BufferFile.GetData());
+			}
+			Buffer["uri"] = "data:application/octet-stream;base64,AA==";
+			Buffer["byteLength"] = 1;
+		}
+	}
+	//tinygltf hands an image in a buffer view to the image loader straight out of the buffer, which is now the placeholder
+	//so those images get a placeholder uri of their own and their view is put back once tinygltf is done
+	std::vector<std::pair<int, std::string>> ImageViews;
+	if (Doc.contains("images"))
+	{
+		for (nlohmann::json& Image : Doc["images"])
+		{
+			auto& [BufferView, MimeType] = ImageViews.emplace_back(-1, std::string());
+			if (!Image.contains("bufferView"))
+				continue;
+			BufferView = Image["bufferView"].get<int>();
+			MimeType = Image.value("mimeType", std::string());
+			Image.erase("bufferView");
+			Image.erase("mimeType");
+			Image["uri"] = "data:image/png;base64,AA==";
+		}
+	}
+	std::string Stripped = Doc.dump();
+	loader.SetImageLoader(SkipImageLoad, nullptr);
+	if (!loader.LoadASCIIFromString(&model, &err, &warn, Stripped.c_str(), static_cast<uint32_t>(Stripped.size()), path.parent_path().string()))
+		return false;
+	for (size_t i = 0; i < ImageViews.size() && i < model.images.size(); ++i)
+	{
+		if (ImageViews[i].first < 0)
+			continue;
+		if (size_t(ImageViews[i].first) >= model.bufferViews.size())
+		{
+			err = "Image " + std::to_string(i) + " points at a buffer view that does not exist";
+			return false;
+		}
+		model.images[i].uri.clear();
+		model.images[i].bufferView = ImageViews[i].first;
+		model.images[i].mimeType = ImageViews[i].second;
+	}
+	return true;
+}
+
+bool GLTFLoader::VerifyMappedLoad(const tinygltf::Model& model, const std::filesystem::path& path) const
+{
+	RD_SCOPE(Load, Verify Mapped Load);
+	tinygltf::TinyGLTF loader;
+	tinygltf::Model copied;
+	std::string err, warn;
+	if (!LoadCopiedModel(loader, copied, path, err, warn))
+	{
+		RD_CORE_ERROR("Mapped load: {} does not load through tinygltf: {}", path.string(), err);
+		return false;
+	}
+	bool bMatches = true;
+	if (model.images.size() != copied.images.size() || model.bufferViews.size() != copied.bufferViews.size())
+	{
+		RD_CORE_ERROR("Mapped load: {} images and {} buffer views, tinygltf has {} and {}", model.images.size(), model.bufferViews.size(), copied.images.size(), copied.bufferViews.size());
+		return false;
+	}
+	for (size_t i = 0; i < model.images.size(); ++i)
+	{
+		const tinygltf::Image& mapped = model.images[i];
+		const tinygltf::Image& expected = copied.images[i];
+		if (mapped.uri != expected.uri || mapped.bufferView != expected.bufferView || mapped.mimeType != expected.mimeType)
+		{
+			RD_CORE_ERROR("Mapped load: image {} is {} in view {}, tinygltf has {} in view {}", i, mapped.uri, mapped.bufferView, expected.uri, expected.bufferView);
+			bMatches = false;
+		}
+	}
+	//every view the mapped load hands out, embedded images included, has to hold the bytes tinygltf copied
+	for (size_t i = 0; i < copied.bufferViews.size(); ++i)
+	{
+		const tinygltf::BufferView& view = copied.bufferViews[i];
+		const tinygltf::Buffer& buffer = copied.buffers[view.buffer];
+		//meshopt fallback buffers have nothing to compare
+		if (view.byteOffset + view.byteLength > buffer.data.size())
+			continue;
+		if (memcmp(GetBufferViewData(model, static_cast<int32_t>(i)), buffer.data.data() + view.byteOffset, view.byteLength) != 0)
+		{
+			RD_CORE_ERROR("Mapped load: buffer view {} differs from what tinygltf copied", i);
+			bMatches = false;
+		}
+	}
+	return bMatches;
+}
+
+const uint8_t* GLTFLoader::GetBufferData(const tinygltf::Model& model, int32_t bufferIndex) const
+{
+	if (bufferIndex < MappedBuffers.size() && MappedBuffers[bufferIndex])
+		return MappedBuffers[bufferIndex];
+	return model.buffers[bufferIndex].data.data();
+}
+
+const uint8_t* GLTFLoader::GetBufferViewData(const tinygltf::Model& model, int32_t bufferViewIndex) const
+{
+	//a decoded view starts at 0, its byte offset is into the fallback buffer
+	if (bufferViewIndex < DecodedBufferViews.size() && !DecodedBufferViews[bufferViewIndex].empty())
+		return DecodedBufferViews[bufferViewIndex].data();
+	const tinygltf::BufferView& bufferView = model.bufferViews[bufferViewIndex];
+	return GetBufferData(model, bufferView.buffer) + bufferView.byteOffset;
+}
+
+bool GLTFLoader::DecodeCompressedBufferViews(const tinygltf::Model& model)
+{
+	RD_SCOPE(Load, Decode Compressed Buffer Views);
+	DecodedBufferViews.clear();
+	//pull everything out of the tinygltf values first so the tasks only touch plain data
+	struct CompressedView
+	{
+		size_t Index{};
+		const uint8_t* Source{};
+		size_t SourceSize{};
+		size_t Count{};
+		size_t Stride{};
+		std::string Mode;
+		std::string Filter;
+		int Result{ -1 };
+	};
+	std::vector<CompressedView> compressedViews;
+	for (size_t i = 0; i < model.bufferViews.size(); ++i)
+	{
+		auto it = model.bufferViews[i].extensions.find("EXT_meshopt_compression");
+		if (it == model.bufferViews[i].extensions.end())
+			continue;
+		const tinygltf::Value& ext = it->second;
+		auto getSize = [&ext](const char* key) { return ext.Has(key) ? static_cast<size_t>(ext.Get(key).GetNumberAsDouble()) : size_t(0); };
+		auto getString = [&ext](const char* key, const char* fallback) { return ext.Has(key) ? ext.Get(key).Get<std::string>() : std::string(fallback); };
+		const int32_t buffer = ext.Get("buffer").GetNumberAsInt();
+		if (buffer < 0 || buffer >= model.buffers.size())
+		{
+			RD_ASSERT(true, "Compressed buffer view {} points at a missing buffer {}", i, buffer);
+			return false;
+		}
+		CompressedView& view = compressedViews.emplace_back();
+		view.Index = i;
+		view.Source = GetBufferData(model, buffer) + getSize("byteOffset");
+		view.SourceSize = getSize("byteLength");
+		view.Count = getSize("count");
+		view.Stride = getSize("byteStride");
+		view.Mode = getString("mode", "");
+		view.Filter = getString("filter", "NONE");
+	}
+	if (compressedViews.empty())
+		return true;
+
+	DecodedBufferViews.resize(model.bufferViews.size());
+	auto start = std::chrono::high_resolution_clock::now();
+	{
+		//every view is independent, one task each, this thread decodes too while it waits
+		JobGraph Decodes;
+		for (CompressedView& view : compressedViews)
+		{
+			Decodes.Add("Load", "Buffer View",
+				[this, &view]()
+				{
+					std::vector<uint8_t>& decoded = DecodedBufferViews[view.Index];
+					decoded.resize(view.Count * view.Stride);
+					if (view.Mode == "ATTRIBUTES")
+						view.Result = meshopt_decodeVertexBuffer(decoded.data(), view.Count, view.Stride, view.Source, view.SourceSize);
+					else if (view.Mode == "TRIANGLES")
+						view.Result = meshopt_decodeIndexBuffer(decoded.data(), view.Count, view.Stride, view.Source, view.SourceSize);
+					else if (view.Mode == "INDICES")
+						view.Result = meshopt_decodeIndexSequence(decoded.data(), view.Count, view.Stride, view.Source, view.SourceSize);
+					if (view.Result != 0)
+						return;
+					//filters undo the attribute quantization in place
+					if (view.Filter == "OCTAHEDRAL")
+						meshopt_decodeFilterOct(decoded.data(), view.Count, view.Stride);
+					else if (view.Filter == "QUATERNION")
+						meshopt_decodeFilterQuat(decoded.data(), view.Count, view.Stride);
+					else if (view.Filter == "EXPONENTIAL")
+						meshopt_decodeFilterExp(decoded.data(), view.Count, view.Stride);
+				}
+			);
+		}
+		Decodes.Run();
+	}
+	const double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+	size_t compressedBytes{}, decodedBytes{};
+	bool bSuccess = true;
+	for (const CompressedView& view : compressedViews)
+	{
+		if (view.Result != 0)
+		{
+			RD_CORE_ERROR("Unable to decode meshopt buffer view {} ({} {}), error {}", view.Index, view.Mode, view.Filter, view.Result);
+			bSuccess = false;
+		}
+		compressedBytes += view.SourceSize;
+		decodedBytes += view.Count * view.Stride;
+	}
+	RD_CORE_INFO("Decoded {} meshopt buffer views, {:.2f} MB -> {:.2f} MB ({:.1f}% smaller on disk) in {:.2f} ms, {:.2f} GB/s",
+		compressedViews.size(), compressedBytes / (1024.0 * 1024.0), decodedBytes / (1024.0 * 1024.0),
+		100.0 * (1.0 - double(compressedBytes) / std::max<size_t>(decodedBytes, 1)), ms, decodedBytes / (ms * 1e6));
+	CompressionStats.BufferViews += static_cast<uint32_t>(compressedViews.size());
+	CompressionStats.CompressedBytes += compressedBytes;
+	CompressionStats.DecodedBytes += decodedBytes;
+	CompressionStats.DecodeMs += ms;
+	return bSuccess;
+}
+
+AccessorView GLTFLoader::GetAccessorView(const tinygltf::Model& model, const tinygltf::Accessor& accessor) const
+{
+	AccessorView view;
+	view.Count = accessor.count;
+	view.ComponentType = accessor.componentType;
+	view.ComponentCount = static_cast<uint32_t>(tinygltf::GetNumComponentsInType(accessor.type));
+	view.bNormalized = accessor.normalized;
+	//sparse accessors can leave out the buffer view, everything that is not replaced is zero then
+	if (accessor.bufferView < 0)
+		return view;
+	const tinygltf::BufferView& bufferView = model.bufferViews[accessor.bufferView];
+	view.Data = GetBufferViewData(model, accessor.bufferView) + accessor.byteOffset;
+	//0 means tightly packed
+	view.Stride = bufferView.byteStride ? bufferView.byteStride : view.ComponentCount * tinygltf::GetComponentSizeInBytes(accessor.componentType);
+	return view;
+}
+
+bool GLTFLoader::GetSparseValues(const tinygltf::Model& model, const tinygltf::Accessor& accessor, std::vector<uint32_t>& targets, AccessorView& values) const
+{
+	if (!accessor.sparse.isSparse || accessor.sparse.count <= 0)
+		return false;
+	const auto& sparse = accessor.sparse;
+	AccessorView indices;
+	indices.Data = GetBufferViewData(model, sparse.indices.bufferView) + sparse.indices.byteOffset;
+	indices.Count = sparse.count;
+	indices.Stride = tinygltf::GetComponentSizeInBytes(sparse.indices.componentType);
+	indices.ComponentType = sparse.indices.componentType;
+	indices.ComponentCount = 1;
+	targets.resize(sparse.count);
+	if (!WidenIndices(indices, targets.data()))
+		return false;
+	//same type as the accessor but always tightly packed
+	values = GetAccessorView(model, accessor);
+	values.Data = GetBufferViewData(model, sparse.values.bufferView) + sparse.values.byteOffset;
+	values.Count = sparse.count;
+	values.Stride = values.ComponentCount * tinygltf::GetComponentSizeInBytes(accessor.componentType);
+	return true;
+}
+
+bool GLTFLoader::DecodeIndices(const tinygltf::Model& model, const tinygltf::Accessor& accessor, uint32_t* dst) const
+{
+	if (!WidenIndices(GetAccessorView(model, accessor), dst))
+		return false;
+	std::vector<uint32_t> targets;
+	AccessorView values;
+	if (GetSparseValues(model, accessor, targets, values))
+		return ScatterIndices(values, targets.data(), dst, accessor.count);
+	return true;
+}
+
+bool GLTFLoader::DecodeAttribute(const tinygltf::Model& model, const tinygltf::Accessor& accessor, float* dst, size_t dstStride, uint32_t dstComponents) const
+{
+	if (!GatherAttribute(GetAccessorView(model, accessor), dst, dstStride, dstComponents))
+		return false;
+	std::vector<uint32_t> targets;
+	AccessorView values;
+	if (GetSparseValues(model, accessor, targets, values))
+		return ScatterAttribute(values, targets.data(), dst, dstStride, dstComponents, accessor.count);
+	return true;
+}
+
+uint64_t GLTFLoader::GetMeshCacheKey(const tinygltf::Model& model, const std::filesystem::path& path) const
+{
+	//the import settings change the cooked vertices and indices as well
+	const uint64_t paramsKey = MeshCache::GetParamsKey();
+	uint64_t key = ragdoll::Hash64(&paramsKey, sizeof(paramsKey), ImportSettings.GetKey());
+	if (bUseMappedFiles)
+	{
+		//the source file and every external buffer are already mapped, in the same order as the buffers
+		for (const ragdoll::MappedFile& file : MappedFiles)
+			key = ragdoll::Hash64(file.GetData(), file.GetSize(), key);
+		return key;
+	}
+	//the gltf/glb itself covers the json, data uris and the glb bin chunk
+	ragdoll::MappedFile source;
+	if (source.Open(path))
+		key = ragdoll::Hash64(source.GetData(), source.GetSize(), key);
+	for (const tinygltf::Buffer& buffer : model.buffers)
+	{
+		if (!buffer.uri.empty() && !buffer.uri.starts_with("data:"))
+			key = ragdoll::Hash64(buffer.data.data(), buffer.data.size(), key);
+	}
+	return key;
+}
+
+bool GLTFLoader::VerifyMeshDecode(const tinygltf::Model& model, size_t firstMesh, size_t firstVertexBufferIndex, size_t firstVertex, size_t firstIndex)
+{
+	RD_SCOPE(Load, Verify Mesh Decode);
+	const AssetManager& assets = *AssetManager::GetInstance();
+	//load the model again the serial way, every primitive decoded on this thread in gltf order and appended as soon as it is done
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	std::vector<VertexBufferInfo> infos;
+	std::vector<std::vector<MeshLodLevel>> lods;
+	for (const auto& itMesh : model.meshes) {
+		for (const tinygltf::Primitive& itPrim : itMesh.primitives)
+		{
+			DirectX::BoundingBox box;
+			DecodePrimitive(model, itPrim, itMesh.name, IndexStagingBuffer, VertexStagingBuffer, box);
+			MeshImport::Optimize(VertexStagingBuffer, IndexStagingBuffer, ImportSettings);
+			MeshImport::GenerateLods(VertexStagingBuffer, IndexStagingBuffer, ImportSettings, lods.emplace_back());
+			VertexBufferInfo& info = infos.emplace_back();
+			info.VerticesOffset = static_cast<uint32_t>(firstVertex + vertices.size());
+			info.IndicesOffset = static_cast<uint32_t>(firstIndex + indices.size());
+			info.VerticesCount = static_cast<uint32_t>(VertexStagingBuffer.size());
+			info.IndicesCount = static_cast<uint32_t>(IndexStagingBuffer.size());
+			info.BestFitBox = box;
+			vertices.insert(vertices.end(), VertexStagingBuffer.begin(), VertexStagingBuffer.end());
+			indices.insert(indices.end(), IndexStagingBuffer.begin(), IndexStagingBuffer.end());
+		}
+	}
+	//lods go in after every full detail mesh
+	for (size_t i = 0; i < lods.size(); ++i)
+	{
+		for (const MeshLodLevel& lod : lods[i])
+		{
+			if (infos[i].LodCount++ == 0)
+				infos[i].FirstLodIndex = static_cast<uint32_t>(firstVertexBufferIndex + infos.size());
+			VertexBufferInfo info;
+			info.VerticesOffset = infos[i].VerticesOffset;
+			info.VerticesCount = infos[i].VerticesCount;
+			info.IndicesOffset = static_cast<uint32_t>(firstIndex + indices.size());
+			info.IndicesCount = static_cast<uint32_t>(lod.Indices.size());
+			info.LodError = lod.Error;
+			info.BestFitBox = infos[i].BestFitBox;
+			infos.push_back(info);
+			indices.insert(indices.end(), lod.Indices.begin(), lod.Indices.end());
+		}
+	}
+
+	//then everything the parallel load merged into the asset manager has to be the same
+	bool bMatches = true;
+	if (assets.Vertices.size() - firstVertex != vertices.size() || memcmp(assets.Vertices.data() + firstVertex, vertices.data(), vertices.size() * sizeof(Vertex)) != 0)
+	{
+		RD_CORE_ERROR("Mesh decode: {} vertices merged, a serial load has {} or they differ", assets.Vertices.size() - firstVertex, vertices.size());
+		bMatches = false;
+	}
+	if (assets.Indices.size() - firstIndex != indices.size() || memcmp(assets.Indices.data() + firstIndex, indices.data(), indices.size() * sizeof(uint32_t)) != 0)
+	{
+		RD_CORE_ERROR("Mesh decode: {} indices merged, a serial load has {} or they differ", assets.Indices.size() - firstIndex, indices.size());
+		bMatches = false;
+	}
+	if (assets.VertexBufferInfos.size() - firstVertexBufferIndex != infos.size())
+	{
+		RD_CORE_ERROR("Mesh decode: {} vertex buffer infos merged, a serial load has {}", assets.VertexBufferInfos.size() - firstVertexBufferIndex, infos.size());
+		return false;
+	}
+	for (size_t i = 0; i < infos.size(); ++i)
+	{
+		const VertexBufferInfo& merged = assets.VertexBufferInfos[firstVertexBufferIndex + i];
+		const VertexBufferInfo& expected = infos[i];
+		if (merged.VerticesOffset != expected.VerticesOffset || merged.VerticesCount != expected.VerticesCount ||
+			merged.IndicesOffset != expected.IndicesOffset || merged.IndicesCount != expected.IndicesCount ||
+			merged.LodCount != expected.LodCount || merged.FirstLodIndex != expected.FirstLodIndex || merged.LodError != expected.LodError ||
+			memcmp(&merged.BestFitBox, &expected.BestFitBox, sizeof(DirectX::BoundingBox)) != 0)
+		{
+			RD_CORE_ERROR("Mesh decode: vertex buffer info {} differs from a serial load", firstVertexBufferIndex + i);
+			bMatches = false;
+		}
+	}
+	//every submesh points at its primitive in gltf order
+	size_t primitiveIndex = 0;
+	for (size_t i = 0; i < model.meshes.size(); ++i)
+	{
+		const Mesh& mesh = assets.Meshes[firstMesh + i];
+		bool bSubmeshes = mesh.Submeshes.size() == model.meshes[i].primitives.size();
+		for (size_t j = 0; bSubmeshes && j < mesh.Submeshes.size(); ++j)
+			bSubmeshes = mesh.Submeshes[j].VertexBufferIndex == firstVertexBufferIndex + primitiveIndex + j;
+		if (!bSubmeshes)
+		{
+			RD_CORE_ERROR("Mesh decode: the submeshes of {} do not match its primitives", model.meshes[i].name);
+			bMatches = false;
+		}
+		primitiveIndex += model.meshes[i].primitives.size();
+	}
+	return bMatches;
+}
+
+void GLTFLoader::ReportLods(const std::string& fileName, size_t firstVertexBufferIndex, size_t meshCount) const
+{
+	AssetManager* manager = AssetManager::GetInstance();
+	//level 0 is the full detail mesh
+	struct LodLevelStats
+	{
+		size_t Meshes{};
+		size_t Triangles{};
+		size_t Meshlets{};
+		size_t Bytes{};
+	};
+	std::vector<LodLevelStats> levels(1);
+	auto AddToLevel = [manager, &levels](size_t level, const VertexBufferInfo& info) {
+		LodLevelStats& stats = levels[level];
+		++stats.Meshes;
+		stats.Triangles += info.IndicesCount / 3;
+		stats.Meshlets += info.MeshletCount;
+		//indices, meshlets, their bounds, and the meshlet vertex and packed triangle lists
+		stats.Bytes += info.IndicesCount * sizeof(uint32_t) + info.MeshletCount * (sizeof(meshopt_Meshlet) + sizeof(FMeshletBounds));
+		for (uint32_t i = 0; i < info.MeshletCount; ++i)
+		{
+			const meshopt_Meshlet& meshlet = manager->Meshlets[info.MeshletGroupOffset + i];
+			stats.Bytes += (meshlet.vertex_count + meshlet.triangle_count) * sizeof(uint32_t);
+		}
+	};
+	for (size_t i = firstVertexBufferIndex; i < firstVertexBufferIndex + meshCount; ++i)
+	{
+		const VertexBufferInfo& base = manager->VertexBufferInfos[i];
+		if (levels.size() < base.LodCount + 1)
+			levels.resize(base.LodCount + 1);
+		AddToLevel(0, base);
+		//lods share the vertices, only the full detail mesh pays for them
+		levels[0].Bytes += base.VerticesCount * sizeof(Vertex);
+		for (uint32_t j = 0; j < base.LodCount; ++j)
+			AddToLevel(j + 1, manager->VertexBufferInfos[base.FirstLodIndex + j]);
+	}
+	size_t lodBytes{};
+	for (size_t level = 0; level < levels.size(); ++level)
+	{
+		const LodLevelStats& stats = levels[level];
+		RD_CORE_INFO("Lod {} of {}: {} meshes, {} triangles ({:.1f}% of lod 0), {} meshlets, {:.2f}MB",
+			level, fileName, stats.Meshes, stats.Triangles, 100.0 * stats.Triangles / std::max<size_t>(levels[0].Triangles, 1), stats.Meshlets, stats.Bytes / (1024.0 * 1024.0));
+		if (level > 0)
+			lodBytes += stats.Bytes;
+	}
+	RD_CORE_INFO("Lods of {} add {:.2f}MB on top of {:.2f}MB of full detail geometry", fileName, lodBytes / (1024.0 * 1024.0), levels[0].Bytes / (1024.0 * 1024.0));
+}
+
+void GLTFLoader::DecodePrimitive(const tinygltf::Model& model, const tinygltf::Primitive& itPrim, const std::string& meshName, std::vector<uint32_t>& indices, std::vector<Vertex>& vertices, DirectX::BoundingBox& box) const
+{
+	std::unordered_map<std::string, tinygltf::Accessor> attributeToAccessors;
+	uint32_t vertexCount{};
+	indices.clear();
+	vertices.clear();
+
+	//add the relevant data into the map to use
+	{
+		for (const auto& itAttrib : itPrim.attributes) {
+			tinygltf::Accessor vertexAccessor = model.accessors[itAttrib.second];
+			attributeToAccessors[itAttrib.first] = vertexAccessor;
+			vertexCount = (uint32_t)vertexAccessor.count;
+		}
+		RD_ASSERT(vertexCount == 0, "There are no vertices?");
+	}
+
+	//a primitive without indices draws its vertices in order
+	if (itPrim.indices < 0)
+	{
+		indices.resize(vertexCount);
+		std::iota(indices.begin(), indices.end(), 0u);
+	}
+	else
+	{
+		const tinygltf::Accessor& accessor = model.accessors[itPrim.indices];
+		indices.resize(accessor.count);
+		//widened a whole accessor at a time to reconcile things like short to uint
+		RD_ASSERT(!DecodeIndices(model, accessor, indices.data()), "Unsupport index type for {}", meshName);
+		//one check over the widened indices instead of one per index
+		if (accessor.maxValues.size() != 0 && !indices.empty())
+			RD_ASSERT(*std::max_element(indices.begin(), indices.end()) > accessor.maxValues[0], "");
+#if 0
+		RD_CORE_TRACE("Loaded {} indices at byte offest {}", accessor.count, accessor.byteOffset);
+		RD_CORE_TRACE("Largest index is {}", *std::max_element(indices.begin(), indices.end()));
+#endif
+	}
+
+	//for every attribute, check if there is one that corresponds with renderer attributes
+	bool tangentExist = false;
+	{
+		vertices.resize(vertexCount);
+		for (const auto& it : attributeToAccessors) {
+			nvrhi::VertexAttributeDesc const* desc = nullptr;
+			const tinygltf::Accessor& accessor = it.second;
+			AttributeType type = AttributeType::None;
+			for (const nvrhi::VertexAttributeDesc& itDesc : AssetManager::GetInstance()->InstancedVertexAttributes) {
+				if (it.first.find(itDesc.name) != std::string::npos)
+				{
+					if (itDesc.name == "POSITION")
+						type = AttributeType::Position;
+					else if (itDesc.name == "COLOR")
+						continue;	//skip vertex color
+					else if (itDesc.name == "NORMAL")
+						type = AttributeType::Normal;
+					else if (itDesc.name == "TANGENT") {
+						type = AttributeType::Tangent;
+						tangentExist = true;
+					}
+					else if (itDesc.name == "BINORMAL")
+						type = AttributeType::Binormal;
+					else if (itDesc.name == "TEXCOORD")
+						type = AttributeType::Texcoord;
+					desc = &itDesc;
+				}
+			}
+			RD_ASSERT(desc == nullptr, "Loaded mesh contains a attribute not supported by the renderer: {}", it.first);
+			//the input layout can describe the packed gpu layout, the cpu side always decodes into Vertex
+			size_t vertexOffset{}, vertexFieldSize{};
+			switch (type)
+			{
+			case AttributeType::Position: vertexOffset = offsetof(Vertex, position); vertexFieldSize = sizeof(Vertex::position); break;
+			case AttributeType::Normal: vertexOffset = offsetof(Vertex, normal); vertexFieldSize = sizeof(Vertex::normal); break;
+			case AttributeType::Tangent: vertexOffset = offsetof(Vertex, tangent); vertexFieldSize = sizeof(Vertex::tangent); break;
+			case AttributeType::Texcoord: vertexOffset = offsetof(Vertex, texcoord); vertexFieldSize = sizeof(Vertex::texcoord); break;
+			default: RD_ASSERT(true, "Loaded mesh contains a attribute not supported by the renderer: {}", it.first);
+			}
+			//gather the whole accessor into that field of every vertex, converting normalized and quantized components to float
+			//tangents come in with the bitangent sign in w, which lands in tangent.w
+			float* field = reinterpret_cast<float*>(reinterpret_cast<uint8_t*>(vertices.data()) + vertexOffset);
+			RD_ASSERT(!DecodeAttribute(model, accessor, field, sizeof(Vertex), static_cast<uint32_t>(vertexFieldSize / sizeof(float))),
+				"Unsupported component type {} for {} in {}", accessor.componentType, it.first, meshName);
+
+			if (type == AttributeType::Position)
+			{
+				//KHR_mesh_quantization keeps min and max in the stored integers, they are only positions as they are if not normalized
+				const bool bMinMaxArePositions = accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT || !accessor.normalized;
+				if (bMinMaxArePositions && accessor.maxValues.size() == 3 && accessor.minValues.size() == 3)
+				{
+					Vector3 max{ (float)accessor.maxValues[0], (float)accessor.maxValues[1], (float)accessor.maxValues[2] };
+					Vector3 min{ (float)accessor.minValues[0], (float)accessor.minValues[1], (float)accessor.minValues[2] };
+					DirectX::BoundingBox::CreateFromPoints(box, min, max);
+				}
+				else
+				{
+					Vector3 min, max;
+					min = max = vertices[0].position;
+					for (const Vertex& v : vertices) {
+						min.x = std::min(v.position.x, min.x); max.x = std::max(v.position.x, max.x);
+						min.y = std::min(v.position.y, min.y); max.y = std::max(v.position.y, max.y);
+						min.z = std::min(v.position.z, min.z); max.z = std::max(v.position.z, max.z);
+					}
+					DirectX::BoundingBox::CreateFromPoints(box, min, max);
+				}
+			}
+#if 0
+			RD_CORE_INFO("Loaded {} vertices of attribute: {}", vertexCount, desc->name);
+#endif
+		}
+	}
+
+	//gltf tangents come with the bitangent sign in w, generate both when they are missing
+	if (!tangentExist)
+		GenerateTangents(vertices, indices);
+}
+
 void GLTFLoader::LoadAndCreateModel(const std::string& fileName)
 {
 	RD_SCOPE(Load, Load GLTF);
@@ -630,8 +1243,25 @@ void GLTFLoader::LoadAndCreateModel(const std::string& fileName)
 	std::filesystem::path modelRoot = path.parent_path().lexically_relative(Root);
 	{
 		RD_SCOPE(Load, Load GLTF File);
-		bool ret = loader.LoadASCIIFromFile(&model, &err, &warn, path.string());
-		RD_ASSERT(ret == false, "Issue loading {}", path.string());
+		MappedFiles.clear();
+		MappedBuffers.clear();
+		DecodedBufferViews.clear();
+		bool ret;
+		if (bUseMappedFiles)
+			ret = LoadMappedModel(loader, model, path, err, warn);
+		else
+			ret = LoadCopiedModel(loader, model, path, err, warn);
+		RD_ASSERT(ret == false, "Issue loading {}: {}", path.string(), err);
+	}
+	if (bVerifyMeshDecode && bUseMappedFiles)
+	{
+		if (VerifyMappedLoad(model, path))
+			RD_CORE_INFO("Mapped load of {} matches a tinygltf load", fileName);
+		else
+		{
+			RD_CORE_ERROR("Mapped load of {} differs from a tinygltf load", fileName);
+			bVerifyPassed = false;
+		}
 	}
 
 	{
@@ -645,208 +1275,141 @@ void GLTFLoader::LoadAndCreateModel(const std::string& fileName)
 	}
 
 	uint32_t meshIndicesOffset = static_cast<uint32_t>(AssetManager::GetInstance()->Meshes.size());
+	size_t primitiveCount = 0;
+	for (const auto& itMesh : model.meshes)
+		primitiveCount += itMesh.primitives.size();
+	//every primitive gets a vertex buffer info in gltf order, starting from here
+	const size_t vertexBufferIndicesOffset = AssetManager::GetInstance()->VertexBufferInfos.size();
+	const size_t verticesOffset = AssetManager::GetInstance()->Vertices.size();
+	const size_t indicesOffset = AssetManager::GetInstance()->Indices.size();
+	//try the cooked geometry first, the key covers the source bytes and the meshlet params
+	uint64_t meshCacheKey{};
+	std::filesystem::path meshCachePath;
+	bMeshCacheHit = false;
+	if (bUseMeshCache && primitiveCount > 0)
+	{
+		RD_SCOPE(Load, Mesh Cache Lookup);
+		meshCacheKey = GetMeshCacheKey(model, path);
+		meshCachePath = MeshCache::GetCachePath(Root / "cache" / "meshes", path, meshCacheKey);
+		bMeshCacheHit = MeshCache::Load(meshCachePath, meshCacheKey, primitiveCount);
+	}
 	//load meshes
+	if (!bMeshCacheHit)
 	{
 		RD_SCOPE(Load, Load Meshes);
-		// go downwards from meshes
-		for (const auto& itMesh : model.meshes) {
-			//should not create a new input layout handle, use the one provided by the renderer
-			std::vector<Vertex> newBuffer;
-			std::unordered_map<std::string, tinygltf::Accessor> attributeToAccessors;
-			//for every mesh, create a new mesh object
-			Mesh mesh;
-			//keep track of what is the currently loaded buffer and data
-			uint32_t binSize = 0;
-			uint32_t vertexCount{};
-
-			//load all the submeshes
-			size_t materialIndicesOffset = AssetManager::GetInstance()->Materials.size();
-			for (const tinygltf::Primitive& itPrim : itMesh.primitives)
-			{
-				RD_SCOPE(Load, Mesh);
-				Submesh submesh{};
-				DirectX::BoundingBox box;
-				VertexBufferInfo buffer;
-				IndexStagingBuffer.clear();
-				VertexStagingBuffer.clear();
-
-				//set the material index for the primitive
-				submesh.MaterialIndex = itPrim.material + materialIndicesOffset;
-
-				//load the indices first
-				{
-					const tinygltf::Accessor& accessor = model.accessors[itPrim.indices];
-					const tinygltf::BufferView& bufferView = model.bufferViews[accessor.bufferView];
-					IndexStagingBuffer.resize(accessor.count);
-					uint8_t* data = model.buffers[bufferView.buffer].data.data();
-					size_t byteOffset = bufferView.byteOffset + accessor.byteOffset;
-					//manually assign to reconcil things like short to uint
-					for (int i = 0; i < accessor.count; ++i) {
-						switch (accessor.componentType) {
-						case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
-							IndexStagingBuffer[i] = *reinterpret_cast<uint8_t*>(data + byteOffset + i * tinygltf::GetComponentSizeInBytes(accessor.componentType));
-							break;
-						case TINYGLTF_COMPONENT_TYPE_SHORT:
-							IndexStagingBuffer[i] = *reinterpret_cast<int16_t*>(data + byteOffset + i * tinygltf::GetComponentSizeInBytes(accessor.componentType));
-							break;
-						case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
-							IndexStagingBuffer[i] = *reinterpret_cast<uint16_t*>(data + byteOffset + i * tinygltf::GetComponentSizeInBytes(accessor.componentType));
-							break;
-						case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
-							IndexStagingBuffer[i] = *reinterpret_cast<uint32_t*>(data + byteOffset + i * tinygltf::GetComponentSizeInBytes(accessor.componentType));
-							break;
-						default:
-							RD_ASSERT(true, "Unsupport index type for {}", itMesh.name);
-						}
-						if (accessor.maxValues.size() != 0)
-							RD_ASSERT(IndexStagingBuffer[i] > accessor.maxValues[0], "");
-					}
-#if 0
-					RD_CORE_TRACE("Loaded {} indices at byte offest {}", accessor.count, accessor.byteOffset);
-					RD_CORE_TRACE("Largest index is {}", *std::max_element(indices.begin(), indices.end()));
-#endif
-					buffer.IndicesCount = (uint32_t)accessor.count;
-				}
-
-				//add the relevant data into the map to use
-				{
-					for (const auto& itAttrib : itPrim.attributes) {
-						tinygltf::Accessor vertexAccessor = model.accessors[itAttrib.second];
-						tinygltf::BufferView bufferView = model.bufferViews[vertexAccessor.bufferView];
-						attributeToAccessors[itAttrib.first] = vertexAccessor;
-						vertexCount = (uint32_t)vertexAccessor.count;
-					}
-					RD_ASSERT(vertexCount == 0, "There are no vertices?");
-				}
-
-				//for every attribute, check if there is one that corresponds with renderer attributes
-				bool tangentExist = false, binormalExist = false;
+		RD_ASSERT(!DecodeCompressedBufferViews(model), "Unable to decode the meshopt compressed buffers of {}", fileName);
+		//every primitive decodes into its own staging buffers on the executor
+		struct DecodedPrimitive
+		{
+			std::vector<uint32_t> Indices;
+			std::vector<Vertex> Vertices;
+			DirectX::BoundingBox Box;
+			MeshImportStats Stats;
+			std::vector<MeshLodLevel> Lods;
+		};
+		std::vector<DecodedPrimitive> decodedPrimitives(primitiveCount);
+		{
+			RD_SCOPE(Load, Decode Primitives);
+			JobGraph Decodes;
+			size_t primitiveIndex = 0;
+			for (const auto& itMesh : model.meshes) {
+				for (const tinygltf::Primitive& itPrim : itMesh.primitives)
 				{
-					VertexStagingBuffer.resize(vertexCount);
-					for (const auto& it : attributeToAccessors) {
-						nvrhi::VertexAttributeDesc const* desc = nullptr;
-						const tinygltf::Accessor& accessor = it.second;
-						const tinygltf::BufferView& bufferView = model.bufferViews[accessor.bufferView];
-						AttributeType type;
-						for (const nvrhi::VertexAttributeDesc& itDesc : AssetManager::GetInstance()->InstancedVertexAttributes) {
-							if (it.first.find(itDesc.name) != std::string::npos)
-							{
-								if (itDesc.name == "POSITION")
-									type = AttributeType::Position;
-								else if (itDesc.name == "COLOR")
-									continue;	//skip vertex color
-								else if (itDesc.name == "NORMAL")
-									type = AttributeType::Normal;
-								else if (itDesc.name == "TANGENT") {
-									type = AttributeType::Tangent;
-									tangentExist = true;
-								}
-								else if (itDesc.name == "BINORMAL") {
-									type = AttributeType::Binormal;
-									binormalExist = true;
-								}
-								else if (itDesc.name == "TEXCOORD")
-									type = AttributeType::Texcoord;
-								desc = &itDesc;
-							}
-						}
-						RD_ASSERT(desc == nullptr, "Loaded mesh contains a attribute not supported by the renderer: {}", it.first);
-						uint32_t size = tinygltf::GetNumComponentsInType(accessor.type) * tinygltf::GetComponentSizeInBytes(accessor.componentType);
-						//memcpy the data from the buffer over into the vertices
-						uint8_t* data = model.buffers[bufferView.buffer].data.data();
-						for (uint32_t i = 0; i < vertexCount; ++i) {
-							Vertex& v = VertexStagingBuffer[i];
-							uint8_t* bytePos = reinterpret_cast<uint8_t*>(&v) + desc->offset;
-							size_t byteOffset = accessor.byteOffset + bufferView.byteOffset;
-							size_t stride = bufferView.byteStride == 0 ? size : bufferView.byteStride;
-							memcpy(bytePos, data + byteOffset + i * stride, size);
-						}
-
-						if (type == AttributeType::Position)
+					DecodedPrimitive* decoded = &decodedPrimitives[primitiveIndex++];
+					Decodes.Add("Load", "Mesh",
+						[this, &model, &itMesh, &itPrim, decoded]()
 						{
-							if (accessor.maxValues.size() == 3 && accessor.minValues.size() == 3)
-							{
-								Vector3 max{ (float)accessor.maxValues[0], (float)accessor.maxValues[1], (float)accessor.maxValues[2] };
-								Vector3 min{ (float)accessor.minValues[0], (float)accessor.minValues[1], (float)accessor.minValues[2] };
-								DirectX::BoundingBox::CreateFromPoints(box, min, max);
-							}
-							else
-							{
-								Vector3 min, max;
-								min = max = VertexStagingBuffer[0].position;
-								for (const Vertex& v : VertexStagingBuffer) {
-									min.x = std::min(v.position.x, min.x); max.x = std::max(v.position.x, max.x);
-									min.y = std::min(v.position.y, min.y); max.y = std::max(v.position.y, max.y);
-									min.z = std::min(v.position.z, min.z); max.z = std::max(v.position.z, max.z);
-								}
-								DirectX::BoundingBox::CreateFromPoints(box, min, max);
-							}
-						}
-#if 0
-						RD_CORE_INFO("Loaded {} vertices of attribute: {}", vertexCount, desc->name);
-#endif
-					}
-				}
-
-				//if tangent or binormal does not exist, generate them
-				{
-					if (!tangentExist || !binormalExist)
-					{
-						//generate the tangents and binormals
-						for (size_t i = 0; i < IndexStagingBuffer.size(); i += 3) {
-							Vertex& v0 = VertexStagingBuffer[IndexStagingBuffer[i]];
-							Vertex& v1 = VertexStagingBuffer[IndexStagingBuffer[i + 1]];
-							Vertex& v2 = VertexStagingBuffer[IndexStagingBuffer[i + 2]];
-
-							Vector3 edge1 = v1.position - v0.position;
-							Vector3 edge2 = v2.position - v0.position;
-
-							Vector2 deltaUV1 = v1.texcoord - v0.texcoord;
-							Vector2 deltaUV2 = v2.texcoord - v0.texcoord;
-
-							float f = 1.0f / (deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y);
-
-							Vector3 tangent;
-							if (tangentExist)
-								tangent = VertexStagingBuffer[IndexStagingBuffer[i]].tangent;
-							else {
-								tangent.x = f * (deltaUV2.y * edge1.x - deltaUV1.y * edge2.x);
-								tangent.y = f * (deltaUV2.y * edge1.y - deltaUV1.y * edge2.y);
-								tangent.z = f * (deltaUV2.y * edge1.z - deltaUV1.y * edge2.z);
-
-								// Normalize and store tangent
-								tangent.Normalize();
-								v0.tangent = v1.tangent = v2.tangent = tangent;
-							}
+							DecodePrimitive(model, itPrim, itMesh.name, decoded->Indices, decoded->Vertices, decoded->Box);
+							MeshImport::Optimize(decoded->Vertices, decoded->Indices, ImportSettings, &decoded->Stats);
+							MeshImport::GenerateLods(decoded->Vertices, decoded->Indices, ImportSettings, decoded->Lods);
 						}
-					}
-				}
-
-				//add to the asset manager vertices
-				{
-					submesh.VertexBufferIndex = AssetManager::GetInstance()->AddVertices(VertexStagingBuffer, IndexStagingBuffer);
-					AssetManager::GetInstance()->VertexBufferInfos[submesh.VertexBufferIndex].BestFitBox = box;
-					mesh.Submeshes.emplace_back(submesh);
+					);
 				}
 			}
-#if 0
-			RD_CORE_INFO("Mesh: {}", itMesh.name);
-			for (const auto& it : vertices)
+			Decodes.Run();
+		}
+
+		//merge in gltf order so the global buffers come out the same as a serial load
+		RD_SCOPE(Load, Merge Primitives);
+		size_t primitiveIndex = 0;
+		size_t totalIndices{}, totalVerticesBefore{}, totalVerticesAfter{};
+		double totalTransformedBefore{}, totalTransformedAfter{};
+		for (const auto& itMesh : model.meshes) {
+			for (const tinygltf::Primitive& itPrim : itMesh.primitives)
 			{
-				RD_CORE_INFO("Pos: {}, Normal: {}, Texcoord: {}", it.position, it.normal, it.texcoord);
+				DecodedPrimitive& decoded = decodedPrimitives[primitiveIndex++];
+				const MeshImportStats& stats = decoded.Stats;
+				RD_CORE_INFO("Mesh import {}[{}]: {} -> {} vertices, ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}",
+					itMesh.name, &itPrim - itMesh.primitives.data(), stats.VerticesBefore, stats.VerticesAfter, stats.ACMRBefore, stats.ACMRAfter, stats.ATVRBefore, stats.ATVRAfter);
+				//acmr is per triangle and atvr per vertex, weight them back into transform counts for the totals
+				const size_t triangleCount = decoded.Indices.size() / 3;
+				totalIndices += decoded.Indices.size();
+				totalVerticesBefore += stats.VerticesBefore;
+				totalVerticesAfter += stats.VerticesAfter;
+				totalTransformedBefore += stats.ACMRBefore * triangleCount;
+				totalTransformedAfter += stats.ACMRAfter * triangleCount;
+				//add to the asset manager vertices
+				size_t vertexBufferIndex = AssetManager::GetInstance()->AddVertices(decoded.Vertices, decoded.Indices);
+				AssetManager::GetInstance()->VertexBufferInfos[vertexBufferIndex].BestFitBox = decoded.Box;
+				//release the staging memory as soon as it is merged, the lods go in after every full detail mesh
+				decoded.Indices = {};
+				decoded.Vertices = {};
 			}
-			for (const auto& it : indices)
+		}
+		//lods come after the full detail meshes so the submeshes can keep indexing by primitive
+		primitiveIndex = 0;
+		for (DecodedPrimitive& decoded : decodedPrimitives)
+		{
+			for (const MeshLodLevel& lod : decoded.Lods)
+				AssetManager::GetInstance()->AddLod(vertexBufferIndicesOffset + primitiveIndex, lod.Indices, lod.Error);
+			decoded.Lods = {};
+			++primitiveIndex;
+		}
+		if (totalIndices > 0)
+		{
+			const double triangleCount = totalIndices / 3.0;
+			RD_CORE_INFO("Mesh import {}: {} -> {} vertices, ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}", fileName,
+				totalVerticesBefore, totalVerticesAfter,
+				totalTransformedBefore / triangleCount, totalTransformedAfter / triangleCount,
+				totalTransformedBefore / std::max<size_t>(totalVerticesBefore, 1), totalTransformedAfter / std::max<size_t>(totalVerticesAfter, 1));
+		}
+	}
+	{
+		//for every mesh, create a new mesh object, the vertex buffers are the same whether they were decoded or cooked
+		size_t primitiveIndex = 0;
+		size_t materialIndicesOffset = AssetManager::GetInstance()->Materials.size();
+		for (const auto& itMesh : model.meshes) {
+			Mesh mesh;
+			//load all the submeshes
+			for (const tinygltf::Primitive& itPrim : itMesh.primitives)
 			{
-				RD_CORE_INFO("Index: {}", it);
+				Submesh submesh{};
+				//set the material index for the primitive
+				submesh.MaterialIndex = itPrim.material + materialIndicesOffset;
+				submesh.VertexBufferIndex = vertexBufferIndicesOffset + primitiveIndex++;
+				mesh.Submeshes.emplace_back(submesh);
 			}
-#endif
 			AssetManager::GetInstance()->Meshes.emplace_back(mesh);
 		}
 	}
+	if (bVerifyMeshDecode && !bMeshCacheHit)
+	{
+		if (VerifyMeshDecode(model, meshIndicesOffset, vertexBufferIndicesOffset, verticesOffset, indicesOffset))
+			RD_CORE_INFO("Parallel mesh decode of {} matches a serial load", fileName);
+		else
+		{
+			RD_CORE_ERROR("Parallel mesh decode of {} differs from a serial load", fileName);
+			bVerifyPassed = false;
+		}
+	}
+	if (!bMeshCacheHit)
 	{
 		//create the meshlets based on the global vertex and index buffers
 		AssetManager::GetInstance()->UpdateMeshletsData();
+		if (bUseMeshCache && primitiveCount > 0)
+			MeshCache::Save(meshCachePath, meshCacheKey, vertexBufferIndicesOffset);
 	}
+	ReportLods(fileName, vertexBufferIndicesOffset, primitiveCount);
 	//create the buffers
 	{
 		AssetManager::GetInstance()->UpdateMeshBuffers();
@@ -910,9 +1473,31 @@ void GLTFLoader::LoadAndCreateModel(const std::string& fileName)
 		RD_SCOPE(Load, Loading Textures);
 		AssetManager::GetInstance()->Textures.resize(model.textures.size() + textureIndicesOffset);
 		AssetManager::GetInstance()->Images.resize(model.textures.size() + imageIndicesOffset);
-		std::vector<nvrhi::ICommandList*> cmdLists(model.textures.size());
-		std::vector<nvrhi::CommandListHandle> cmdListHandles(model.textures.size());
-		tf::Taskflow TaskFlow;
+		//streaming priority of every texture, the primitives that sample it weighted by how much its slot shows
+		//the slot also decides how the mips are filtered and which block format the texture is compressed to
+		std::vector<float> texturePriorities(model.textures.size());
+		std::vector<TextureUsage> textureUsages(model.textures.size(), TextureUsage::Color);
+		{
+			const size_t materialIndicesOffset = AssetManager::GetInstance()->Materials.size() - model.materials.size();
+			auto addPriority = [&](int32_t textureIndex, float weight, TextureUsage usage) {
+				if (textureIndex < static_cast<int32_t>(textureIndicesOffset))
+					return;
+				texturePriorities[textureIndex - textureIndicesOffset] += weight;
+				if (usage != TextureUsage::Color)
+					textureUsages[textureIndex - textureIndicesOffset] = usage;
+			};
+			for (const auto& itMesh : model.meshes) {
+				for (const tinygltf::Primitive& itPrim : itMesh.primitives)
+				{
+					if (itPrim.material < 0)
+						continue;
+					const Material& mat = AssetManager::GetInstance()->Materials[materialIndicesOffset + itPrim.material];
+					addPriority(mat.AlbedoTextureIndex, 4.f, TextureUsage::Color);
+					addPriority(mat.NormalTextureIndex, 2.f, TextureUsage::Normal);
+					addPriority(mat.RoughnessMetallicTextureIndex, 1.f, TextureUsage::Linear);
+				}
+			}
+		}
 		for (uint32_t i = 0; i < model.textures.size(); ++i)
 		{
 			const tinygltf::Texture& itTex = model.textures[i];
@@ -1006,183 +1591,31 @@ void GLTFLoader::LoadAndCreateModel(const std::string& fileName)
 			tex.SamplerIndex = (int)type;
 			tex.ImageIndex = i + imageIndicesOffset;
 
-			//enqueue command to load image associated with the texture
-			cmdLists[i] = cmdListHandles[i] = DirectXDevice::GetNativeDevice()->createCommandList(nvrhi::CommandListParameters().setEnableImmediateExecution(false));
-			nvrhi::CommandListHandle hdl = cmdListHandles[i];
-
 			//check if texture has a dds extension, if it does, load that instead
 			uint32_t imageIndex = itTex.source;
 			if (itTex.extensions.contains("MSFT_texture_dds"))
 			{
 				imageIndex = itTex.extensions.at("MSFT_texture_dds").Get("source").GetNumberAsInt();
 			}
-			Image* img = &AssetManager::GetInstance()->Images[i + imageIndicesOffset];
-			tinygltf::Image* itImg = &model.images[imageIndex];
-			//push the loading into the taskflow
-			TaskFlow.emplace(
-				[itImg, path, img, imageIndicesOffset, i, hdl]()
-				{
-					std::vector<uint8_t> data;
-					int32_t size;
-					{
-						RD_SCOPE(Load, Load File);
-						std::filesystem::path modelPath = path.parent_path() / itImg->uri;
-						//load raw bytes, do not use stbi load
-						std::ifstream file(modelPath, std::ios::binary | std::ios::ate);
-						RD_ASSERT(!file, "Unable to open file {}:{}", strerror(errno), modelPath.string());
-						size = static_cast<int32_t>(file.tellg());
-						file.seekg(0, std::ios::beg);
-						data.resize(size);
-						RD_ASSERT(!file.read((char*)data.data(), size), "Failed to read file {}", itImg->uri);
-					}
-					if (itImg->uri.find(".dds") == std::string::npos)
-					{
-						RD_SCOPE(Load, STB Load);
-						//use stbi_info_from_memory to check header on info for how to load
-						int w = -1, h = -1, comp = -1, req_comp = 0;
-						RD_ASSERT(!stbi_info_from_memory(data.data(), size, &w, &h, &comp), "stb unable to read image {}", itImg->uri);
-						int bits = 8;
-						int pixel_type = TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE;
-						if (comp == 3)
-							req_comp = 4;
-						//dont support hdr images
-						//use stbi_load_from_memory to load the image data, set up all the desc with that info
-						uint8_t* raw = stbi_load_from_memory(data.data(), size, &w, &h, &comp, req_comp);
-						RD_ASSERT(!raw, "Issue loading {}", itImg->uri);
-						itImg->width = w;
-						itImg->height = h;
-						itImg->component = comp;
-						itImg->bits = bits;
-						itImg->pixel_type = pixel_type;
-						//do not free the image here, free it when creating textures in gpu
-						img->RawData = raw;
-
-						nvrhi::TextureDesc texDesc;
-						texDesc.width = itImg->width;
-						texDesc.height = itImg->height;
-						texDesc.dimension = nvrhi::TextureDimension::Texture2D;
-						switch (itImg->component)
-						{
-						case 1:
-							texDesc.format = nvrhi::Format::R8_UNORM;
-							break;
-						case 2:
-							texDesc.format = nvrhi::Format::RG8_UNORM;
-							break;
-						case 3:
-							texDesc.format = nvrhi::Format::RGBA8_UNORM;
-							break;
-						case 4:
-							texDesc.format = nvrhi::Format::RGBA8_UNORM;
-							break;
-						default:
-							RD_ASSERT(true, "Unsupported texture channel count");
-						}
-						texDesc.debugName = itImg->uri;
-						texDesc.initialState = nvrhi::ResourceStates::ShaderResource;
-						texDesc.isRenderTarget = false;
-						texDesc.keepInitialState = true;
-
-						img->TextureHandle = DirectXDevice::GetNativeDevice()->createTexture(texDesc);
-						img->bIsDDS = false;
-						RD_ASSERT(img->TextureHandle == nullptr, "Issue creating texture handle: {}", itImg->uri);
-
-						DirectXDevice::GetInstance()->m_NvrhiDevice->writeDescriptorTable(AssetManager::GetInstance()->DescriptorTable, nvrhi::BindingSetItem::Texture_SRV(i + imageIndicesOffset, img->TextureHandle));
-
-						hdl->open();
-						//upload the texture data
-						hdl->writeTexture(img->TextureHandle, 0, 0, img->RawData, itImg->width* (itImg->component == 3 ? 4 : itImg->component));
-						hdl->close();
-					}
-					else
-					{
-						RD_SCOPE(Load, DDS Load);
-
-						// Validate DDS header
-						const uint8_t* ddsData = reinterpret_cast<const uint8_t*>(data.data());
-
-						if (reinterpret_cast<const uint32_t*>(ddsData)[0] != ' SDD') // DDS Magic Number
-							RD_ASSERT(true, "Invalid DDS header for {}", itImg->uri);
-
-						const DDS_HEADER* header = reinterpret_cast<const DDS_HEADER*>(ddsData + sizeof(uint32_t)); // Skip magic number
-						bool hasDXT10Header = (header->ddspf.dwFourCC == '01XD'); // DX10 extension
-						const DDS_HEADER_DXT10* dxt10Header = hasDXT10Header ? reinterpret_cast<const DDS_HEADER_DXT10*>(ddsData + sizeof(uint32_t) + sizeof(DDS_HEADER)) : nullptr;
-						
-						nvrhi::Format format{ nvrhi::Format::UNKNOWN };
-						if(hasDXT10Header)
-							format = SearchForFormat(dxt10Header->dxgiFormat);
-						else
-						{
-							if (header->ddspf.dwFourCC == '1TXD') 
-								format = nvrhi::Format::BC1_UNORM;  // DXT1
-							if (header->ddspf.dwFourCC == '3TXD') 
-								format = nvrhi::Format::BC2_UNORM;  // DXT3
-							if (header->ddspf.dwFourCC == '5TXD')
-								format = nvrhi::Format::BC3_UNORM;  // DXT5
-							if (header->ddspf.dwFourCC == 'U4ET') 
-								format = nvrhi::Format::BC4_UNORM;  // ATI1 / BC4
-							if (header->ddspf.dwFourCC == '2ITA')
-								format = nvrhi::Format::BC5_UNORM;  // ATI2 / BC5
-						}
-
-						RD_ASSERT(format == nvrhi::Format::UNKNOWN, "Unsupported DDS format for {}", itImg->uri);
-
-						// Create texture description
-						nvrhi::TextureDesc desc;
-						desc.width = header->dwWidth;
-						desc.height = header->dwHeight;
-						desc.mipLevels = header->dwMipMapCount > 0 ? header->dwMipMapCount : 1;
-						desc.dimension = (header->dwDepth > 1) ? nvrhi::TextureDimension::Texture3D : nvrhi::TextureDimension::Texture2D;
-						desc.format = format;
-						desc.isRenderTarget = false;
-						desc.initialState = nvrhi::ResourceStates::ShaderResource;
-						desc.keepInitialState = true;
-						desc.debugName = itImg->uri;
-
-						img->TextureHandle = DirectXDevice::GetNativeDevice()->createTexture(desc);
-						RD_ASSERT(img->TextureHandle == nullptr, "Issue creating texture handle: {}", itImg->uri);
-
-						// Bind texture to descriptor table
-						DirectXDevice::GetInstance()->m_NvrhiDevice->writeDescriptorTable(
-							AssetManager::GetInstance()->DescriptorTable,
-							nvrhi::BindingSetItem::Texture_SRV(i + imageIndicesOffset, img->TextureHandle)
-						);
-
-						// Determine the start of pixel data in DDS file
-						size_t headerSize = sizeof(uint32_t) + sizeof(DDS_HEADER) + (hasDXT10Header ? sizeof(DDS_HEADER_DXT10) : 0);
-						const uint8_t* pixelData = ddsData + headerSize;
-
-						hdl->open();
-
-						size_t offset = 0;
-						for (uint32_t mipLevel = 0; mipLevel < desc.mipLevels; ++mipLevel) {
-							uint32_t mipWidth = std::max(1u, desc.width >> mipLevel);
-							uint32_t mipHeight = std::max(1u, desc.height >> mipLevel);
-
-							size_t rowPitch, slicePitch;
-							DirectX::ComputePitch(hasDXT10Header ? (DXGI_FORMAT)dxt10Header->dxgiFormat : nvrhi::getDxgiFormatMapping(format).resourceFormat, mipWidth, mipHeight, rowPitch, slicePitch);
-
-							hdl->writeTexture(img->TextureHandle, 0, mipLevel, pixelData + offset, rowPitch, slicePitch);
-							offset += slicePitch; // Move to next mip level data
-						}
-
-						hdl->close();
-					}
-				}
-			);
-		}
-		//execute all the task
-		SExecutor::Executor.run(TaskFlow).wait();
-
-		DirectXDevice::GetNativeDevice()->executeCommandLists(cmdLists.data(), cmdLists.size());
-
-		//free all raw bytes
-		for (auto& it : AssetManager::GetInstance()->Images) {
-			if (!it.bIsDDS)
+			const tinygltf::Image& itImg = model.images[imageIndex];
+			TextureStreamSource source;
+			source.Name = itImg.uri;
+			source.bIsDDS = itImg.uri.find(".dds") != std::string::npos || itImg.mimeType == "image/vnd-ms.dds";
+			source.bMapFile = bUseMappedFiles;
+			source.Usage = textureUsages[i];
+			//images embedded in a buffer view (glb) are copied out, the buffers are unmapped once the load is done
+			if (itImg.bufferView >= 0)
+			{
+				const uint8_t* embeddedData = GetBufferViewData(model, itImg.bufferView);
+				source.Embedded.assign(embeddedData, embeddedData + model.bufferViews[itImg.bufferView].byteLength);
+				source.Name = itImg.name.empty() ? fileName + " image " + std::to_string(imageIndex) : itImg.name;
+			}
+			else
 			{
-				stbi_image_free(it.RawData);
-				it.RawData = nullptr;
+				source.Path = ResolveUri(path.parent_path(), itImg.uri);
 			}
+			//decodes start right away, the slot shows the default texture until the tail is up
+			TextureStreamer::GetInstance()->AddImage(i + imageIndicesOffset, std::move(source), texturePriorities[i]);
 		}
 	}
 	
@@ -1231,4 +1664,8 @@ void GLTFLoader::LoadAndCreateModel(const std::string& fileName)
 		TransformLayer->DebugPrintHierarchy();
 #endif
 	}
+	//done with the model, unmap everything
+	MappedFiles.clear();
+	MappedBuffers.clear();
+	DecodedBufferViews.clear();
 }
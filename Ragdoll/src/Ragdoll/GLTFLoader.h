@@ -1,6 +1,9 @@
 #pragma once
 #include "Ragdoll/Math/RagdollMath.h"
 #include "Ragdoll/AssetManager.h"
+#include "Ragdoll/AccessorDecode.h"
+#include "Ragdoll/File/MappedFile.h"
+#include "Ragdoll/MeshImport.h"
 #include <nvrhi/nvrhi.h>
 #include <taskflow.hpp>
 
@@ -20,9 +23,61 @@ class GLTFLoader {
 	std::vector<uint32_t> IndexStagingBuffer;
 	std::vector<Vertex> VertexStagingBuffer;
 
+	//files mapped for the model currently being loaded, released once the load is done
+	//a deque so the file being parsed stays put while its buffers are mapped after it
+	std::deque<ragdoll::MappedFile> MappedFiles;
+	//mapped memory backing each gltf buffer, nullptr if tinygltf holds the data instead
+	std::vector<const uint8_t*> MappedBuffers;
+	//EXT_meshopt_compression buffer views decoded for the model currently being loaded, empty for views that are not compressed
+	std::vector<std::vector<uint8_t>> DecodedBufferViews;
+
 	nvrhi::CommandListHandle CommandList;
 public:
+	//map the gltf/glb and its external files instead of copying everything into tinygltf buffers
+	bool bUseMappedFiles{ true };
+	//load the meshes a second time serially and check what the parallel decode merged into the asset manager is byte identical
+	//a mapped load is also checked against a plain tinygltf load of the same file
+	bool bVerifyMeshDecode{ false };
+	//false once a bVerifyMeshDecode check found a difference, the differences are logged
+	bool bVerifyPassed{ true };
+	//reuse the cooked geometry and meshlets under <root>/cache/meshes when the source has not changed
+	bool bUseMeshCache{ true };
+	//whether the last LoadAndCreateModel was served from the mesh cache
+	bool bMeshCacheHit{ false };
+	//optimization applied to every primitive before it goes into the global buffers
+	MeshImportSettings ImportSettings;
+	//totals over every EXT_meshopt_compression buffer view decoded by this loader
+	struct
+	{
+		uint32_t BufferViews{};
+		size_t CompressedBytes{};
+		size_t DecodedBytes{};
+		double DecodeMs{};
+	} CompressionStats;
+
 	void Init(std::filesystem::path root, std::shared_ptr<ragdoll::FileManager> fm, std::shared_ptr<ragdoll::EntityManager> em, std::shared_ptr<ragdoll::Scene> tl);
 	void LoadAndCreateModel(const std::string& fileName);
 private:
+	bool LoadMappedModel(tinygltf::TinyGLTF& loader, tinygltf::Model& model, const std::filesystem::path& path, std::string& err, std::string& warn);
+	const uint8_t* GetBufferData(const tinygltf::Model& model, int32_t bufferIndex) const;
+	//start of a buffer view, the decoded bytes if it was meshopt compressed
+	const uint8_t* GetBufferViewData(const tinygltf::Model& model, int32_t bufferViewIndex) const;
+	//decodes every EXT_meshopt_compression buffer view in parallel into DecodedBufferViews, false if any of them fails
+	bool DecodeCompressedBufferViews(const tinygltf::Model& model);
+	//strided view of the dense part of an accessor, no data if it has no buffer view
+	AccessorView GetAccessorView(const tinygltf::Model& model, const tinygltf::Accessor& accessor) const;
+	//the element indices a sparse accessor replaces and a view of the values that replace them, false if it is not sparse
+	bool GetSparseValues(const tinygltf::Model& model, const tinygltf::Accessor& accessor, std::vector<uint32_t>& targets, AccessorView& values) const;
+	//decode a whole accessor including its sparse substitution, attributes go into the first dstComponents floats of every dstStride
+	bool DecodeIndices(const tinygltf::Model& model, const tinygltf::Accessor& accessor, uint32_t* dst) const;
+	bool DecodeAttribute(const tinygltf::Model& model, const tinygltf::Accessor& accessor, float* dst, size_t dstStride, uint32_t dstComponents) const;
+	uint64_t GetMeshCacheKey(const tinygltf::Model& model, const std::filesystem::path& path) const;
+	//loads the file again through tinygltf's copy path and compares the images and every buffer view with what the mapped load hands out
+	bool VerifyMappedLoad(const tinygltf::Model& model, const std::filesystem::path& path) const;
+	//decodes and appends every primitive of the model serially and compares that with the vertices, indices, infos and meshes the parallel load merged, logs every difference
+	bool VerifyMeshDecode(const tinygltf::Model& model, size_t firstMesh, size_t firstVertexBufferIndex, size_t firstVertex, size_t firstIndex);
+	//logs the triangles, meshlets and memory of every lod level of the meshes that were just added
+	void ReportLods(const std::string& fileName, size_t firstVertexBufferIndex, size_t meshCount) const;
+	//decodes the indices, vertices and bounds of a single primitive, safe to call from multiple threads
+	void DecodePrimitive(const tinygltf::Model& model, const tinygltf::Primitive& prim, const std::string& meshName, std::vector<uint32_t>& indices, std::vector<Vertex>& vertices, DirectX::BoundingBox& box) const;
 };
\ No newline at end of file
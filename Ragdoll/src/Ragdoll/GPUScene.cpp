@@ -112,17 +112,23 @@ struct FAmplificationGroupInfo
 	uint32_t MeshletGroupOffset;
 };
 
-void ragdoll::FGPUScene::Update(Scene* Scene)
+void ragdoll::FGPUScene::Update(Scene* Scene, bool bLodsChanged)
 {
 	//if the projection matrix change, update the frustum aabb
-	if (Scene->SceneInfo.PrevMainCameraProj != Scene->SceneInfo.MainCameraProj)
+	const bool bProjectionChanged = Scene->SceneInfo.PrevMainCameraProj != Scene->SceneInfo.MainCameraProj;
+	//every change of the frame goes out in the same list, ahead of the renderer
+	if (bLodsChanged || bProjectionChanged)
 	{
+		if (!UpdateCommandList)
+			UpdateCommandList = DirectXDevice::GetNativeDevice()->createCommandList();
+		UpdateCommandList->open();
+		if (bLodsChanged)
+			UpdateInstances(Scene, UpdateCommandList);
 		//prepare the bounding boxes of all the lightgrid
-		nvrhi::CommandListHandle CommandList = DirectXDevice::GetNativeDevice()->createCommandList();
-		CommandList->open();
-		UpdateLightGrid(Scene, CommandList);
-		CommandList->close();
-		DirectXDevice::GetNativeDevice()->executeCommandList(CommandList);
+		if (bProjectionChanged)
+			UpdateLightGrid(Scene, UpdateCommandList);
+		UpdateCommandList->close();
+		DirectXDevice::GetNativeDevice()->executeCommandList(UpdateCommandList);
 	}
 	SceneRef = Scene;
 }
@@ -208,16 +214,6 @@ void ragdoll::FGPUScene::UpdateBuffers(Scene* Scene)
 			data.Flags |= DOUBLE_SIDED;
 		}
 	}
-	//do not need to sort instances now as it contains mesh indices instead now
-	std::vector<FInstanceData> Instances;
-	Instances.resize(Scene->StaticProxies.size());
-	for (int i = 0; i < Scene->StaticProxies.size(); ++i)
-	{
-		Instances[i].ModelToWorld = Scene->StaticProxies[i].ModelToWorld;
-		Instances[i].PrevModelToWorld = Scene->StaticProxies[i].PrevWorldMatrix;
-		Instances[i].MaterialIndex = Scene->StaticProxies[i].MaterialIndex;
-		Instances[i].MeshIndex = Scene->StaticProxies[i].MeshIndex;
-	}
 	//indirect draw args do not need any values
 	//get all the bounding boxes and upload onto gpu
 	std::vector<FBoundingBox> BoundingBoxes;
@@ -244,12 +240,6 @@ void ragdoll::FGPUScene::UpdateBuffers(Scene* Scene)
 	CommandList->setPermanentBufferState(MaterialBuffer, nvrhi::ResourceStates::ShaderResource);
 	CommandList->endMarker();
 
-	CommandList->beginMarker("Writing Instance Data");
-	CommandList->beginTrackingBufferState(InstanceBuffer, nvrhi::ResourceStates::CopyDest);
-	CommandList->writeBuffer(InstanceBuffer, Instances.data(), sizeof(FInstanceData) * Instances.size());
-	CommandList->setPermanentBufferState(InstanceBuffer, nvrhi::ResourceStates::ShaderResource);
-	CommandList->endMarker();
-
 	RD_ASSERT(Scene->PointLightProxies.size() > MAX_LIGHT_COUNT, "Exceeded maximum number of point lights");
 	CommandList->beginMarker("Writing Point Lights Data");
 	CommandList->beginTrackingBufferState(PointLightBufferHandle, nvrhi::ResourceStates::CopyDest);
@@ -271,6 +261,21 @@ void ragdoll::FGPUScene::UpdateBuffers(Scene* Scene)
 		Triangles.indexFormat = nvrhi::Format::R32_UINT;
 		Triangles.vertexFormat = nvrhi::Format::RGB32_FLOAT;
 		Triangles.vertexStride = sizeof(Vertex);
+		if (AssetManager::GetInstance()->bQuantizedVertices)
+		{
+			//unorm positions go in as is, the geometry transform stretches them back over the mesh box
+			Triangles.vertexFormat = nvrhi::Format::RGBA16_UNORM;
+			Triangles.vertexStride = sizeof(PackedVertex);
+			const Vector3 Center = BufferInfo.BestFitBox.Center;
+			const Vector3 Extents = BufferInfo.BestFitBox.Extents;
+			const Vector3 Min = Center - Extents;
+			const nvrhi::rt::AffineTransform Dequantize = {
+				Extents.x * 2.f, 0.f, 0.f, Min.x,
+				0.f, Extents.y * 2.f, 0.f, Min.y,
+				0.f, 0.f, Extents.z * 2.f, Min.z,
+			};
+			GeomDesc.setTransform(Dequantize);
+		}
 		Triangles.vertexCount = BufferInfo.VerticesCount;
 		Triangles.indexCount = BufferInfo.IndicesCount;
 		//offsets are in bytes
@@ -287,7 +292,38 @@ void ragdoll::FGPUScene::UpdateBuffers(Scene* Scene)
 	}
 	CommandList->endMarker();
 
-	//create the new TLAS with all the new instances
+	//instance data and the tlas depend on the lod each proxy picked
+	UpdateInstances(Scene, CommandList);
+
+	//reset the indirect arg
+	nvrhi::DispatchMeshleIndirectArguments IndirectArgs;
+	IndirectArgs.threadGroupCountX = 0;
+	IndirectArgs.threadGroupCountY = IndirectArgs.threadGroupCountZ = 1;
+	CommandList->beginMarker("Writing Indirect Args");
+	CommandList->writeBuffer(IndirectMeshletArgsBuffer, &IndirectArgs, sizeof(nvrhi::DispatchMeshleIndirectArguments));
+	CommandList->close();
+
+	DirectXDevice::GetNativeDevice()->executeCommandList(CommandList);
+	DirectXDevice::GetNativeDevice()->waitForIdle();
+}
+
+void ragdoll::FGPUScene::UpdateInstances(Scene* Scene, nvrhi::CommandListHandle CommandList)
+{
+	//do not need to sort instances now as it contains mesh indices instead now
+	std::vector<FInstanceData> Instances;
+	Instances.resize(Scene->StaticProxies.size());
+	for (int i = 0; i < Scene->StaticProxies.size(); ++i)
+	{
+		Instances[i].ModelToWorld = Scene->StaticProxies[i].ModelToWorld;
+		Instances[i].PrevModelToWorld = Scene->StaticProxies[i].PrevWorldMatrix;
+		Instances[i].MaterialIndex = Scene->StaticProxies[i].MaterialIndex;
+		Instances[i].MeshIndex = Scene->StaticProxies[i].MeshIndex;
+	}
+	CommandList->beginMarker("Writing Instance Data");
+	CommandList->writeBuffer(InstanceBuffer, Instances.data(), sizeof(FInstanceData) * Instances.size());
+	CommandList->endMarker();
+
+	//create the TLAS with the lod every instance currently uses
 	CommandList->beginMarker("Create TLAS");
 	std::vector<nvrhi::rt::InstanceDesc> InstanceDescs(Scene->StaticProxies.size());
 	for (uint32_t i = 0; i < Scene->StaticProxies.size(); ++i)
@@ -310,24 +346,17 @@ void ragdoll::FGPUScene::UpdateBuffers(Scene* Scene)
 			InstanceDesc.flags = nvrhi::rt::InstanceFlags::TriangleCullDisable | nvrhi::rt::InstanceFlags::ForceNonOpaque;
 		InstanceDesc.instanceMask = 1;
 	}
-	nvrhi::rt::AccelStructDesc TLASDesc = nvrhi::rt::AccelStructDesc();
-	TLASDesc.debugName = "TLAS";
-	TLASDesc.isTopLevel = true;
-	TLASDesc.topLevelMaxInstances = Scene->StaticProxies.size();
-	TopLevelAS = DirectXDevice::GetNativeDevice()->createAccelStruct(TLASDesc);
+	//rebuilt whenever the lods change, only recreate it when it runs out of space
+	if (!TopLevelAS || TopLevelAS->getDesc().topLevelMaxInstances < Scene->StaticProxies.size())
+	{
+		nvrhi::rt::AccelStructDesc TLASDesc = nvrhi::rt::AccelStructDesc();
+		TLASDesc.debugName = "TLAS";
+		TLASDesc.isTopLevel = true;
+		TLASDesc.topLevelMaxInstances = Scene->StaticProxies.size();
+		TopLevelAS = DirectXDevice::GetNativeDevice()->createAccelStruct(TLASDesc);
+	}
 	CommandList->buildTopLevelAccelStruct(TopLevelAS, InstanceDescs.data(), InstanceDescs.size());
 	CommandList->endMarker();
-
-	//reset the indirect arg
-	nvrhi::DispatchMeshleIndirectArguments IndirectArgs;
-	IndirectArgs.threadGroupCountX = 0;
-	IndirectArgs.threadGroupCountY = IndirectArgs.threadGroupCountZ = 1;
-	CommandList->beginMarker("Writing Indirect Args");
-	CommandList->writeBuffer(IndirectMeshletArgsBuffer, &IndirectArgs, sizeof(nvrhi::DispatchMeshleIndirectArguments));
-	CommandList->close();
-
-	DirectXDevice::GetNativeDevice()->executeCommandList(CommandList);
-	DirectXDevice::GetNativeDevice()->waitForIdle();
 }
 
 void ragdoll::FGPUScene::UpdateLightGrid(Scene* Scene, nvrhi::CommandListHandle CommandList)
@@ -759,6 +788,9 @@ void ragdoll::FGPUScene::CreateBuffers(const std::vector<Proxy>& Proxies)
 	//instance buffer
 	nvrhi::BufferDesc InstanceBufferDesc = nvrhi::utils::CreateStaticConstantBufferDesc(sizeof(FInstanceData) * Proxies.size(), "InstanceBuffer");
 	InstanceBufferDesc.structStride = sizeof(FInstanceData);
+	//rewritten whenever the lods change, nvrhi moves it to copy dest and back around every write
+	InstanceBufferDesc.initialState = nvrhi::ResourceStates::ShaderResource;
+	InstanceBufferDesc.keepInitialState = true;
 	InstanceBuffer = DirectXDevice::GetNativeDevice()->createBuffer(InstanceBufferDesc);
 	//instance id buffer
 	nvrhi::BufferDesc InstanceIdBufferDesc = nvrhi::utils::CreateStaticConstantBufferDesc(sizeof(int32_t) * Proxies.size(), "InstanceIdsBuffer");
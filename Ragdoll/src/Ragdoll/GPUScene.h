@@ -48,10 +48,15 @@ namespace ragdoll
 
 		//temp
 		Scene* SceneRef;
+		//records the instance and light grid changes of a frame, reused every frame
+		nvrhi::CommandListHandle UpdateCommandList;
 
-		void Update(Scene* Scene);
+		//uploads whatever changed since the last frame, the instances only when a proxy picked another lod
+		void Update(Scene* Scene, bool bLodsChanged);
 		//will sort the proxies before making a instance buffer copy and uploading to gpu
 		void UpdateBuffers(Scene* Scene);
+		//uploads the instance buffer and rebuilds the tlas from the mesh index every proxy currently uses, will not open or close the command list
+		void UpdateInstances(Scene* Scene, nvrhi::CommandListHandle CommandList);
 		//updates the bounding box buffer, will not open or close the command list
 		void UpdateLightGrid(Scene* Scene, nvrhi::CommandListHandle CommandList);
 		//culls the light grid, will not open or close the command list
@@ -161,8 +161,9 @@ void ImguiRenderer::DrawSettings(ragdoll::DebugInfo& DebugInfo, ragdoll::SceneIn
 
 	ImGui::Begin("Debug");
 	if (ImGui::Button("Reload Shaders")) {
-		//need to call bat file to recompile
-		AssetManager::GetInstance()->RecompileShaders();
+		//only what changed since the last build is compiled and reloaded
+		//the other passes of this frame are still recording, the rebuild runs once they are done
+		AssetManager::GetInstance()->RequestShaderReload();
 	}
 
 	const char* resolutions[] = {
@@ -356,6 +357,9 @@ void ImguiRenderer::DrawSettings(ragdoll::DebugInfo& DebugInfo, ragdoll::SceneIn
 			if (SceneInfo.bEnableInstanceColors)
 				SceneInfo.bEnableMeshletColors = false;
 		}
+		ImGui::Checkbox("Enable Lods", &SceneInfo.bEnableLod);
+		if (SceneInfo.bEnableLod)
+			ImGui::SliderFloat("Lod pixel error", &SceneInfo.LodPixelError, 0.1f, 16.f);
 		if (ImGui::Checkbox("Enable Light Grid", &DebugInfo.bEnableLightGrid))
 			SceneInfo.bIsCameraDirty = true;
 		if(ImGui::Checkbox("Show Frustum", &DebugInfo.bShowFrustum));
@@ -391,6 +395,7 @@ void ImguiRenderer::DrawSettings(ragdoll::DebugInfo& DebugInfo, ragdoll::SceneIn
 		ImGui::Text("%d proxies passed frustum test", DebugInfo.PassedFrustumCullCount);
 		ImGui::Text("%d proxies passed occlusion 1 test", DebugInfo.PassedOcclusion1CullCount);
 		ImGui::Text("%d proxies passed occlusion 2 test", DebugInfo.PassedOcclusion2CullCount);
+		ImGui::Text("%d / %d triangles after lod selection", DebugInfo.LodTriangleCount, DebugInfo.FullDetailTriangleCount);
 		if (SceneInfo.bEnableMeshletShading)
 		{
 			//useless data now because i do not know how meshlets passed the instance test now
@@ -0,0 +1,87 @@
+#include "ragdollpch.h"
+#include "LodSelection.h"
+
+#include "Profiler.h"
+
+float GetProjectedError(float error, float distance, float projScale)
+{
+	//inside or touching the bounds, every error is as big as it gets
+	if (distance <= 0.f)
+		return std::numeric_limits<float>::max();
+	return error / distance * projScale;
+}
+
+uint32_t SelectLod(const float* lodErrors, uint32_t lodCount, float distance, float projScale, float maxPixelError)
+{
+	uint32_t selected = 0;
+	//errors only grow, so stop at the first lod that is too coarse
+	for (uint32_t i = 1; i < lodCount; ++i)
+	{
+		if (GetProjectedError(lodErrors[i], distance, projScale) > maxPixelError)
+			break;
+		selected = i;
+	}
+	return selected;
+}
+
+bool VerifyLodSelection()
+{
+	RD_SCOPE(Load, Verify Lod Selection);
+	uint32_t Failures{};
+	auto Check = [&Failures](bool bPassed, const char* what) {
+		if (!bPassed)
+		{
+			RD_CORE_ERROR("Lod selection: {}", what);
+			++Failures;
+		}
+	};
+	const float Errors[] = { 0.f, 0.01f, 0.04f, 0.2f, 1.f };
+	const uint32_t Count = 5;
+	//a 1080p viewport at a 90 degree fov
+	const float ProjScale = 540.f;
+
+	Check(GetProjectedError(0.01f, 10.f, ProjScale) == 0.01f / 10.f * ProjScale, "the projected error should be error over distance times the scale");
+	Check(SelectLod(Errors, Count, 0.f, ProjScale, 1.f) == 0, "a camera inside the bounds should get full detail");
+	Check(SelectLod(Errors, Count, -1.f, ProjScale, 1.f) == 0, "a negative distance should get full detail");
+	Check(SelectLod(Errors, 1, 1000.f, ProjScale, 1.f) == 0, "a mesh without lods can only pick its full detail");
+	Check(SelectLod(Errors, Count, 1e9f, ProjScale, 1.f) == Count - 1, "a far away mesh should pick its coarsest lod");
+	//exactly at the threshold is still good enough
+	const float Distance = Errors[2] * ProjScale;
+	Check(SelectLod(Errors, Count, Distance, ProjScale, 1.f) == 2, "a lod right at the threshold should be picked");
+	Check(SelectLod(Errors, Count, Distance * 0.99f, ProjScale, 1.f) == 1, "a lod just over the threshold should not be picked");
+	//the first lod that is too coarse stops the search even if a later one would pass
+	const float Unordered[] = { 0.f, 0.5f, 0.01f };
+	Check(SelectLod(Unordered, 3, 10.f, ProjScale, 1.f) == 0, "the search should stop at the first lod that is too coarse");
+
+	//the pick is the last lod of the passing prefix and never gets finer as the camera moves away
+	std::mt19937 Random(11);
+	std::uniform_real_distribution<float> Step(0.f, 0.1f);
+	std::uniform_real_distribution<float> Threshold(0.25f, 4.f);
+	std::vector<float> LodErrors;
+	bool bConsistent = true, bMonotonic = true;
+	for (uint32_t Iteration = 0; Iteration < 1000 && bConsistent && bMonotonic; ++Iteration)
+	{
+		LodErrors.assign(1, 0.f);
+		const uint32_t LodCount = 1 + Iteration % 8;
+		for (uint32_t i = 1; i < LodCount; ++i)
+			LodErrors.push_back(LodErrors.back() + Step(Random));
+		const float MaxPixelError = Threshold(Random);
+		uint32_t Previous = 0;
+		for (float d = 0.f; d < 200.f && bConsistent && bMonotonic; d += 0.5f)
+		{
+			const uint32_t Lod = SelectLod(LodErrors.data(), LodCount, d, ProjScale, MaxPixelError);
+			uint32_t Expected = 0;
+			while (Expected + 1 < LodCount && GetProjectedError(LodErrors[Expected + 1], d, ProjScale) <= MaxPixelError)
+				++Expected;
+			bConsistent = Lod == Expected;
+			bMonotonic = Lod >= Previous;
+			Previous = Lod;
+		}
+	}
+	Check(bConsistent, "the pick should be the coarsest lod within the threshold");
+	Check(bMonotonic, "moving away should never pick a finer lod");
+
+	if (Failures == 0)
+		RD_CORE_INFO("Lod selection checks passed");
+	return Failures == 0;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+//screen space size in pixels of a world space error seen at the given distance
+//projScale is half the viewport height times the y scale of the projection matrix
+float GetProjectedError(float error, float distance, float projScale);
+
+//picks the coarsest lod whose projected error stays within maxPixelError
+//lodErrors are world space errors of every lod, increasing, with lodErrors[0] being the full detail mesh
+//returns an index into lodErrors, 0 if nothing coarser is good enough
+uint32_t SelectLod(const float* lodErrors, uint32_t lodCount, float distance, float projScale, float maxPixelError);
+
+//checks the picks against the projected error by brute force, at the edges and as the camera moves away, returns false on any failure
+bool VerifyLodSelection();
@@ -0,0 +1,250 @@
+#include "ragdollpch.h"
+#include "MeshCache.h"
+
+#include "Profiler.h"
+#include "Ragdoll/Core/Hash.h"
+#include "Ragdoll/File/MappedFile.h"
+
+namespace
+{
+	//'RDMC'
+	constexpr uint32_t MeshCacheMagic = 0x434D4452;
+
+	struct MeshCacheHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint64_t Key;
+		uint64_t VertexBufferInfoCount;
+		uint64_t VertexCount;
+		uint64_t IndexCount;
+		uint64_t MeshletCount;
+		uint64_t MeshletVertexCount;
+		uint64_t MeshletTriangleCount;
+	};
+
+	//byte offset of every section, each one starts 16 byte aligned so the mapped data can be copied straight out
+	struct MeshCacheLayout
+	{
+		size_t VertexBufferInfos;
+		size_t Vertices;
+		size_t Indices;
+		size_t Meshlets;
+		size_t MeshletVertices;
+		size_t MeshletTriangles;
+		size_t MeshletBounds;
+		size_t Size;
+	};
+
+	constexpr size_t AlignSection(size_t offset)
+	{
+		return (offset + 15) & ~size_t(15);
+	}
+
+	MeshCacheLayout GetLayout(const MeshCacheHeader& header)
+	{
+		MeshCacheLayout layout;
+		size_t offset = AlignSection(sizeof(MeshCacheHeader));
+		auto Section = [&offset](uint64_t count, size_t stride) {
+			size_t begin = offset;
+			offset = AlignSection(offset + static_cast<size_t>(count) * stride);
+			return begin;
+		};
+		layout.VertexBufferInfos = Section(header.VertexBufferInfoCount, sizeof(VertexBufferInfo));
+		layout.Vertices = Section(header.VertexCount, sizeof(Vertex));
+		layout.Indices = Section(header.IndexCount, sizeof(uint32_t));
+		layout.Meshlets = Section(header.MeshletCount, sizeof(meshopt_Meshlet));
+		layout.MeshletVertices = Section(header.MeshletVertexCount, sizeof(uint32_t));
+		layout.MeshletTriangles = Section(header.MeshletTriangleCount, sizeof(uint32_t));
+		layout.MeshletBounds = Section(header.MeshletCount, sizeof(FMeshletBounds));
+		layout.Size = offset;
+		return layout;
+	}
+
+	template<typename T>
+	void AppendSection(std::vector<T>& dst, const uint8_t* src, uint64_t count)
+	{
+		const T* begin = reinterpret_cast<const T*>(src);
+		dst.insert(dst.end(), begin, begin + count);
+	}
+
+	template<typename T>
+	void WriteSection(std::ofstream& out, size_t offset, const T* data, size_t count)
+	{
+		//zero pad up to the start of the section
+		static constexpr char Padding[16]{};
+		size_t current = static_cast<size_t>(out.tellp());
+		out.write(Padding, offset - current);
+		out.write(reinterpret_cast<const char*>(data), count * sizeof(T));
+	}
+}
+
+uint64_t MeshCache::GetParamsKey()
+{
+	struct
+	{
+		uint32_t Version;
+		uint32_t MaxVertices;
+		uint32_t MaxTriangles;
+		uint32_t ChunkTriangles;
+		uint32_t VertexSize;
+		uint32_t VertexBufferInfoSize;
+		uint32_t MeshletSize;
+		uint32_t MeshletBoundsSize;
+	} Params{
+		Version,
+		static_cast<uint32_t>(max_vertices),
+		static_cast<uint32_t>(max_triangles),
+		meshlet_chunk_triangles,
+		sizeof(Vertex),
+		sizeof(VertexBufferInfo),
+		sizeof(meshopt_Meshlet),
+		sizeof(FMeshletBounds)
+	};
+	return ragdoll::Hash64(&Params, sizeof(Params));
+}
+
+std::filesystem::path MeshCache::GetCachePath(const std::filesystem::path& cacheRoot, const std::filesystem::path& source, uint64_t key)
+{
+	return cacheRoot / fmt::format("{}_{:016x}.rdmesh", source.stem().string(), key);
+}
+
+bool MeshCache::Load(const std::filesystem::path& cachePath, uint64_t key, size_t expectedVertexBufferCount)
+{
+	RD_SCOPE(Load, Mesh Cache Load);
+	std::error_code ec;
+	if (!std::filesystem::exists(cachePath, ec))
+		return false;
+	ragdoll::MappedFile File;
+	if (!File.Open(cachePath) || File.GetSize() < sizeof(MeshCacheHeader))
+		return false;
+
+	MeshCacheHeader Header;
+	memcpy(&Header, File.GetData(), sizeof(MeshCacheHeader));
+	if (Header.Magic != MeshCacheMagic || Header.Version != Version || Header.Key != key)
+	{
+		RD_CORE_WARN("Mesh cache {} does not match the source, recooking", cachePath.string());
+		return false;
+	}
+	//every element is at least 4 bytes, so any count bigger than the file is garbage and would overflow the layout
+	const uint64_t Counts[] = { Header.VertexBufferInfoCount, Header.VertexCount, Header.IndexCount, Header.MeshletCount, Header.MeshletVertexCount, Header.MeshletTriangleCount };
+	for (uint64_t Count : Counts)
+	{
+		if (Count > File.GetSize())
+		{
+			RD_CORE_WARN("Mesh cache {} is corrupted, recooking", cachePath.string());
+			return false;
+		}
+	}
+	MeshCacheLayout Layout = GetLayout(Header);
+	if (Layout.Size > File.GetSize() || Header.VertexBufferInfoCount < expectedVertexBufferCount)
+	{
+		RD_CORE_WARN("Mesh cache {} is corrupted, recooking", cachePath.string());
+		return false;
+	}
+
+	AssetManager* Manager = AssetManager::GetInstance();
+	const uint8_t* Data = File.GetData();
+	//cached offsets are relative to the first entry, move them to the end of the global buffers
+	const uint32_t VerticesBase = static_cast<uint32_t>(Manager->Vertices.size());
+	const uint32_t IndicesBase = static_cast<uint32_t>(Manager->Indices.size());
+	const uint32_t MeshletBase = static_cast<uint32_t>(Manager->Meshlets.size());
+	const uint32_t MeshletVerticesBase = static_cast<uint32_t>(Manager->MeshletVertices.size());
+	const uint32_t MeshletTrianglesBase = static_cast<uint32_t>(Manager->MeshletTrianglesPacked.size());
+	const uint32_t InfosBase = static_cast<uint32_t>(Manager->VertexBufferInfos.size());
+	const VertexBufferInfo* Infos = reinterpret_cast<const VertexBufferInfo*>(Data + Layout.VertexBufferInfos);
+	Manager->VertexBufferInfos.reserve(Manager->VertexBufferInfos.size() + Header.VertexBufferInfoCount);
+	for (size_t i = 0; i < Header.VertexBufferInfoCount; ++i)
+	{
+		VertexBufferInfo Info = Infos[i];
+		Info.VerticesOffset += VerticesBase;
+		Info.IndicesOffset += IndicesBase;
+		Info.MeshletGroupOffset += MeshletBase;
+		Info.MeshletGroupVerticesOffset += MeshletVerticesBase;
+		Info.MeshletGroupPrimitivesOffset += MeshletTrianglesBase;
+		if (Info.LodCount > 0)
+			Info.FirstLodIndex += InfosBase;
+		Manager->VertexBufferInfos.emplace_back(Info);
+	}
+	AppendSection(Manager->Vertices, Data + Layout.Vertices, Header.VertexCount);
+	AppendSection(Manager->Indices, Data + Layout.Indices, Header.IndexCount);
+	AppendSection(Manager->Meshlets, Data + Layout.Meshlets, Header.MeshletCount);
+	AppendSection(Manager->MeshletVertices, Data + Layout.MeshletVertices, Header.MeshletVertexCount);
+	AppendSection(Manager->MeshletTrianglesPacked, Data + Layout.MeshletTriangles, Header.MeshletTriangleCount);
+	AppendSection(Manager->MeshletBounds, Data + Layout.MeshletBounds, Header.MeshletCount);
+	return true;
+}
+
+bool MeshCache::Save(const std::filesystem::path& cachePath, uint64_t key, size_t firstVertexBufferIndex)
+{
+	RD_SCOPE(Load, Mesh Cache Save);
+	AssetManager* Manager = AssetManager::GetInstance();
+	if (firstVertexBufferIndex >= Manager->VertexBufferInfos.size())
+		return false;
+
+	//everything from the first vertex buffer onwards belongs to this model
+	const VertexBufferInfo First = Manager->VertexBufferInfos[firstVertexBufferIndex];
+	std::vector<VertexBufferInfo> Infos(Manager->VertexBufferInfos.begin() + firstVertexBufferIndex, Manager->VertexBufferInfos.end());
+	for (VertexBufferInfo& Info : Infos)
+	{
+		Info.VerticesOffset -= First.VerticesOffset;
+		Info.IndicesOffset -= First.IndicesOffset;
+		Info.MeshletGroupOffset -= First.MeshletGroupOffset;
+		Info.MeshletGroupVerticesOffset -= First.MeshletGroupVerticesOffset;
+		Info.MeshletGroupPrimitivesOffset -= First.MeshletGroupPrimitivesOffset;
+		if (Info.LodCount > 0)
+			Info.FirstLodIndex -= static_cast<uint32_t>(firstVertexBufferIndex);
+	}
+
+	MeshCacheHeader Header{};
+	Header.Magic = MeshCacheMagic;
+	Header.Version = Version;
+	Header.Key = key;
+	Header.VertexBufferInfoCount = Infos.size();
+	Header.VertexCount = Manager->Vertices.size() - First.VerticesOffset;
+	Header.IndexCount = Manager->Indices.size() - First.IndicesOffset;
+	Header.MeshletCount = Manager->Meshlets.size() - First.MeshletGroupOffset;
+	Header.MeshletVertexCount = Manager->MeshletVertices.size() - First.MeshletGroupVerticesOffset;
+	Header.MeshletTriangleCount = Manager->MeshletTrianglesPacked.size() - First.MeshletGroupPrimitivesOffset;
+	MeshCacheLayout Layout = GetLayout(Header);
+
+	std::error_code ec;
+	std::filesystem::create_directories(cachePath.parent_path(), ec);
+	//write to a temporary file first so a crash halfway never leaves a truncated entry behind
+	std::filesystem::path TempPath = cachePath;
+	TempPath += ".tmp";
+	{
+		std::ofstream Out(TempPath, std::ios::binary | std::ios::trunc);
+		if (!Out)
+		{
+			RD_CORE_WARN("Unable to write mesh cache {}", cachePath.string());
+			return false;
+		}
+		Out.write(reinterpret_cast<const char*>(&Header), sizeof(MeshCacheHeader));
+		WriteSection(Out, Layout.VertexBufferInfos, Infos.data(), Infos.size());
+		WriteSection(Out, Layout.Vertices, Manager->Vertices.data() + First.VerticesOffset, Header.VertexCount);
+		WriteSection(Out, Layout.Indices, Manager->Indices.data() + First.IndicesOffset, Header.IndexCount);
+		WriteSection(Out, Layout.Meshlets, Manager->Meshlets.data() + First.MeshletGroupOffset, Header.MeshletCount);
+		WriteSection(Out, Layout.MeshletVertices, Manager->MeshletVertices.data() + First.MeshletGroupVerticesOffset, Header.MeshletVertexCount);
+		WriteSection(Out, Layout.MeshletTriangles, Manager->MeshletTrianglesPacked.data() + First.MeshletGroupPrimitivesOffset, Header.MeshletTriangleCount);
+		WriteSection(Out, Layout.MeshletBounds, Manager->MeshletBounds.data() + First.MeshletGroupOffset, Header.MeshletCount);
+		//pad the tail so the file size matches the layout
+		WriteSection<char>(Out, Layout.Size, nullptr, 0);
+		if (!Out)
+		{
+			RD_CORE_WARN("Unable to write mesh cache {}", cachePath.string());
+			Out.close();
+			std::filesystem::remove(TempPath, ec);
+			return false;
+		}
+	}
+	std::filesystem::rename(TempPath, cachePath, ec);
+	if (ec)
+	{
+		RD_CORE_WARN("Unable to write mesh cache {}: {}", cachePath.string(), ec.message());
+		std::filesystem::remove(TempPath, ec);
+		return false;
+	}
+	RD_CORE_INFO("Cooked mesh cache {}", cachePath.string());
+	return true;
+}
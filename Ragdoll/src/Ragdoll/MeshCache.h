@@ -0,0 +1,21 @@
+#pragma once
+#include "Ragdoll/AssetManager.h"
+
+//cooked geometry of one model, the vertex buffer infos, vertices, indices and meshlet data exactly as
+//AssetManager holds them after UpdateMeshletsData, so a hit can be appended without decoding or building meshlets
+struct MeshCache
+{
+	//bump whenever the layout of the file or of any cooked struct changes
+	static constexpr uint32_t Version = 4;
+
+	//key over everything that changes the cooked output other than the source data itself
+	static uint64_t GetParamsKey();
+	static std::filesystem::path GetCachePath(const std::filesystem::path& cacheRoot, const std::filesystem::path& source, uint64_t key);
+
+	//maps the cache file and appends its contents to the asset manager, vertex buffer infos are rebased onto the current global buffers
+	//the first expectedVertexBufferCount infos are the full detail meshes, their lods follow
+	//returns false if there is no valid entry for the key, the asset manager is left untouched in that case
+	static bool Load(const std::filesystem::path& cachePath, uint64_t key, size_t expectedVertexBufferCount);
+	//writes the asset manager data from firstVertexBufferIndex onwards, meshlets must already be built
+	static bool Save(const std::filesystem::path& cachePath, uint64_t key, size_t firstVertexBufferIndex);
+};
@@ -0,0 +1,106 @@
+#include "ragdollpch.h"
+#include "MeshImport.h"
+
+#include "Profiler.h"
+#include "Ragdoll/Core/Hash.h"
+
+uint64_t MeshImportSettings::GetKey() const
+{
+	//pack into plain words, the struct itself has padding
+	uint32_t Params[] = {
+		bRemap,
+		bOptimizeVertexCache,
+		bOptimizeOverdraw,
+		bOptimizeOverdraw ? std::bit_cast<uint32_t>(OverdrawThreshold) : 0u,
+		bOptimizeVertexFetch,
+		LodCount,
+		LodCount ? std::bit_cast<uint32_t>(LodReduction) : 0u,
+		LodCount ? std::bit_cast<uint32_t>(LodMaxError) : 0u,
+	};
+	return ragdoll::Hash64(Params, sizeof(Params));
+}
+
+void MeshImport::Analyze(const std::vector<uint32_t>& indices, size_t vertexCount, float& acmr, float& atvr)
+{
+	if (indices.empty() || vertexCount == 0)
+	{
+		acmr = atvr = 0.f;
+		return;
+	}
+	meshopt_VertexCacheStatistics Stats = meshopt_analyzeVertexCache(indices.data(), indices.size(), vertexCount, StatsCacheSize, 0, 0);
+	acmr = Stats.acmr;
+	atvr = Stats.atvr;
+}
+
+void MeshImport::GenerateLods(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const MeshImportSettings& settings, std::vector<MeshLodLevel>& lods)
+{
+	lods.clear();
+	if (settings.LodCount == 0 || vertices.empty() || indices.size() < 3 || indices.size() % 3 != 0)
+		return;
+	RD_SCOPE(Load, Generate Lods);
+	const float* Positions = &vertices[0].position.x;
+	//the simplifier reports errors relative to the mesh extents
+	const float ErrorScale = meshopt_simplifyScale(Positions, vertices.size(), sizeof(Vertex));
+	size_t PreviousCount = indices.size();
+	float Ratio = 1.f;
+	for (uint32_t i = 0; i < settings.LodCount; ++i)
+	{
+		Ratio *= settings.LodReduction;
+		size_t TargetCount = static_cast<size_t>(indices.size() * Ratio) / 3 * 3;
+		if (TargetCount < 3)
+			break;
+		//always simplify from the full mesh so the error is measured against it
+		MeshLodLevel Level;
+		Level.Indices.resize(indices.size());
+		float ResultError{};
+		size_t Count = meshopt_simplify(Level.Indices.data(), indices.data(), indices.size(), Positions, vertices.size(), sizeof(Vertex), TargetCount, settings.LodMaxError, 0, &ResultError);
+		//a lod that barely removes anything is not worth its indices and meshlets, and the next ones would be no better
+		if (Count == 0 || Count > PreviousCount * 9 / 10)
+			break;
+		Level.Indices.resize(Count);
+		Level.Indices.shrink_to_fit();
+		meshopt_optimizeVertexCache(Level.Indices.data(), Level.Indices.data(), Count, vertices.size());
+		//errors have to grow with the lod index for the selection to work
+		Level.Error = std::max(ResultError * ErrorScale, lods.empty() ? 0.f : lods.back().Error);
+		lods.emplace_back(std::move(Level));
+		PreviousCount = Count;
+	}
+}
+
+void MeshImport::Optimize(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, const MeshImportSettings& settings, MeshImportStats* stats)
+{
+	RD_SCOPE(Load, Optimize Mesh);
+	if (stats)
+	{
+		stats->VerticesBefore = static_cast<uint32_t>(vertices.size());
+		Analyze(indices, vertices.size(), stats->ACMRBefore, stats->ATVRBefore);
+	}
+	//the reorders work on whole triangles
+	if (!indices.empty() && indices.size() % 3 == 0)
+	{
+		if (settings.bRemap)
+		{
+			std::vector<uint32_t> Remap(vertices.size());
+			size_t UniqueCount = meshopt_generateVertexRemap(Remap.data(), indices.data(), indices.size(), vertices.data(), vertices.size(), sizeof(Vertex));
+			meshopt_remapIndexBuffer(indices.data(), indices.data(), indices.size(), Remap.data());
+			//the remap works in place as long as the destination is not bigger than the source
+			meshopt_remapVertexBuffer(vertices.data(), vertices.data(), vertices.size(), sizeof(Vertex), Remap.data());
+			vertices.resize(UniqueCount);
+		}
+		if (settings.bOptimizeVertexCache)
+			meshopt_optimizeVertexCache(indices.data(), indices.data(), indices.size(), vertices.size());
+		if (settings.bOptimizeOverdraw)
+			meshopt_optimizeOverdraw(indices.data(), indices.data(), indices.size(), &vertices[0].position.x, vertices.size(), sizeof(Vertex), settings.OverdrawThreshold);
+		if (settings.bOptimizeVertexFetch)
+		{
+			//vertices nothing references get dropped here
+			size_t UsedCount = meshopt_optimizeVertexFetch(vertices.data(), indices.data(), indices.size(), vertices.data(), vertices.size(), sizeof(Vertex));
+			vertices.resize(UsedCount);
+		}
+	}
+	if (stats)
+	{
+		stats->VerticesAfter = static_cast<uint32_t>(vertices.size());
+		Analyze(indices, vertices.size(), stats->ACMRAfter, stats->ATVRAfter);
+	}
+}
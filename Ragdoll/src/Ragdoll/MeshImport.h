@@ -0,0 +1,57 @@
+#pragma once
+#include "Ragdoll/AssetManager.h"
+
+//what the import stage does to every primitive before it is added to the asset manager
+struct MeshImportSettings
+{
+	//merge bitwise identical vertices
+	bool bRemap{ true };
+	//reorder triangles for the post transform cache
+	bool bOptimizeVertexCache{ true };
+	//reorder triangle clusters front to back, only keeps orders that are within the threshold of the cache optimized acmr
+	bool bOptimizeOverdraw{ true };
+	float OverdrawThreshold{ 1.05f };
+	//reorder the vertices into first use order for fetch locality
+	bool bOptimizeVertexFetch{ true };
+	//number of simplified lods generated on top of the full detail mesh, each one aims for LodReduction of the triangles of the one before
+	uint32_t LodCount{ 3 };
+	float LodReduction{ 0.5f };
+	//the simplifier stops collapsing past this error, relative to the mesh extents
+	float LodMaxError{ 0.05f };
+
+	//changes whenever the settings change the output, goes into the mesh cache key
+	uint64_t GetKey() const;
+};
+
+struct MeshImportStats
+{
+	uint32_t VerticesBefore{};
+	uint32_t VerticesAfter{};
+	//average cache miss ratio, transformed vertices per triangle, 0.5 is the best possible on a closed mesh
+	float ACMRBefore{};
+	float ACMRAfter{};
+	//average transformed vertex ratio, transformed vertices per vertex, 1 is the best possible
+	float ATVRBefore{};
+	float ATVRAfter{};
+};
+
+struct MeshLodLevel
+{
+	std::vector<uint32_t> Indices;
+	//geometric error in mesh space
+	float Error{};
+};
+
+struct MeshImport
+{
+	//size of the fifo cache the acmr and atvr are simulated against
+	static constexpr uint32_t StatsCacheSize = 16;
+
+	//runs the enabled stages on a single primitive in place, safe to call from multiple threads
+	static void Optimize(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, const MeshImportSettings& settings, MeshImportStats* stats = nullptr);
+	//simplifies the optimized mesh into up to LodCount index buffers over the same vertices, coarsest last
+	//stops early once the simplifier cannot make meaningful progress within LodMaxError
+	static void GenerateLods(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const MeshImportSettings& settings, std::vector<MeshLodLevel>& lods);
+	//simulates the vertex cache over the index buffer, returns acmr and atvr
+	static void Analyze(const std::vector<uint32_t>& indices, size_t vertexCount, float& acmr, float& atvr);
+};
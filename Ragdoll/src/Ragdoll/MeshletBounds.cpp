@@ -0,0 +1,583 @@
+#include "ragdollpch.h"
+#include "MeshletBounds.h"
+
+#include "Profiler.h"
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define RD_MESHLET_BOUNDS_SSE 1
+#include <immintrin.h>
+#endif
+//msvc takes avx intrinsics without /arch:AVX, the cpu is checked at runtime instead
+#if defined(__AVX__) || (defined(_MSC_VER) && defined(_M_X64))
+#define RD_MESHLET_BOUNDS_AVX 1
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace
+{
+	//one meshlet per lane, every op works on all the lanes at once
+	struct ScalarLanes
+	{
+		static constexpr uint32_t Width = 1;
+		using Float = float;
+		using Mask = bool;
+		static Float Load(const float* p) { return *p; }
+		static void Store(float* p, Float v) { *p = v; }
+		static Float Set(float v) { return v; }
+		static Float Add(Float a, Float b) { return a + b; }
+		static Float Sub(Float a, Float b) { return a - b; }
+		static Float Mul(Float a, Float b) { return a * b; }
+		static Float Div(Float a, Float b) { return a / b; }
+		//same operand order as minps and maxps so every width agrees on nans
+		static Float Min(Float a, Float b) { return a < b ? a : b; }
+		static Float Max(Float a, Float b) { return a > b ? a : b; }
+		static Float Sqrt(Float a) { return sqrtf(a); }
+		static Mask Greater(Float a, Float b) { return a > b; }
+		static Mask LessEqual(Float a, Float b) { return a <= b; }
+		static Mask And(Mask a, Mask b) { return a && b; }
+		static Mask AndNot(Mask a, Mask b) { return a && !b; }
+		static Mask Or(Mask a, Mask b) { return a || b; }
+		static Mask None() { return false; }
+		static Float Select(Mask m, Float a, Float b) { return m ? a : b; }
+	};
+
+#if RD_MESHLET_BOUNDS_SSE
+	struct SseLanes
+	{
+		static constexpr uint32_t Width = 4;
+		using Float = __m128;
+		using Mask = __m128;
+		static Float Load(const float* p) { return _mm_loadu_ps(p); }
+		static void Store(float* p, Float v) { _mm_storeu_ps(p, v); }
+		static Float Set(float v) { return _mm_set1_ps(v); }
+		static Float Add(Float a, Float b) { return _mm_add_ps(a, b); }
+		static Float Sub(Float a, Float b) { return _mm_sub_ps(a, b); }
+		static Float Mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+		static Float Div(Float a, Float b) { return _mm_div_ps(a, b); }
+		static Float Min(Float a, Float b) { return _mm_min_ps(a, b); }
+		static Float Max(Float a, Float b) { return _mm_max_ps(a, b); }
+		static Float Sqrt(Float a) { return _mm_sqrt_ps(a); }
+		static Mask Greater(Float a, Float b) { return _mm_cmpgt_ps(a, b); }
+		static Mask LessEqual(Float a, Float b) { return _mm_cmple_ps(a, b); }
+		static Mask And(Mask a, Mask b) { return _mm_and_ps(a, b); }
+		static Mask AndNot(Mask a, Mask b) { return _mm_andnot_ps(b, a); }
+		static Mask Or(Mask a, Mask b) { return _mm_or_ps(a, b); }
+		static Mask None() { return _mm_setzero_ps(); }
+		//no blendv without sse4.1
+		static Float Select(Mask m, Float a, Float b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+	};
+#endif
+
+#if RD_MESHLET_BOUNDS_AVX
+	struct AvxLanes
+	{
+		static constexpr uint32_t Width = 8;
+		using Float = __m256;
+		using Mask = __m256;
+		static Float Load(const float* p) { return _mm256_loadu_ps(p); }
+		static void Store(float* p, Float v) { _mm256_storeu_ps(p, v); }
+		static Float Set(float v) { return _mm256_set1_ps(v); }
+		static Float Add(Float a, Float b) { return _mm256_add_ps(a, b); }
+		static Float Sub(Float a, Float b) { return _mm256_sub_ps(a, b); }
+		static Float Mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+		static Float Div(Float a, Float b) { return _mm256_div_ps(a, b); }
+		static Float Min(Float a, Float b) { return _mm256_min_ps(a, b); }
+		static Float Max(Float a, Float b) { return _mm256_max_ps(a, b); }
+		static Float Sqrt(Float a) { return _mm256_sqrt_ps(a); }
+		static Mask Greater(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+		static Mask LessEqual(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+		static Mask And(Mask a, Mask b) { return _mm256_and_ps(a, b); }
+		static Mask AndNot(Mask a, Mask b) { return _mm256_andnot_ps(b, a); }
+		static Mask Or(Mask a, Mask b) { return _mm256_or_ps(a, b); }
+		static Mask None() { return _mm256_setzero_ps(); }
+		static Float Select(Mask m, Float a, Float b) { return _mm256_blendv_ps(b, a, m); }
+	};
+
+	bool HasAvx()
+	{
+#if defined(__AVX__)
+		return true;
+#else
+		//the cpu has to support it and the os has to save the ymm registers
+		int Info[4];
+		__cpuid(Info, 1);
+		const bool bAvx = (Info[2] & (1 << 28)) != 0;
+		const bool bOsXSave = (Info[2] & (1 << 27)) != 0;
+		return bAvx && bOsXSave && (_xgetbv(0) & 0x6) == 0x6;
+#endif
+	}
+#endif
+
+	template<typename L>
+	struct Lanes3
+	{
+		typename L::Float X, Y, Z;
+	};
+
+	template<typename L>
+	Lanes3<L> Load3(const float* x, const float* y, const float* z, size_t i)
+	{
+		i *= L::Width;
+		return { L::Load(x + i), L::Load(y + i), L::Load(z + i) };
+	}
+
+	template<typename L>
+	Lanes3<L> Sub3(const Lanes3<L>& a, const Lanes3<L>& b)
+	{
+		return { L::Sub(a.X, b.X), L::Sub(a.Y, b.Y), L::Sub(a.Z, b.Z) };
+	}
+
+	template<typename L>
+	typename L::Float Dot3(const Lanes3<L>& a, const Lanes3<L>& b)
+	{
+		return L::Add(L::Add(L::Mul(a.X, b.X), L::Mul(a.Y, b.Y)), L::Mul(a.Z, b.Z));
+	}
+
+	template<typename L>
+	Lanes3<L> Select3(typename L::Mask m, const Lanes3<L>& a, const Lanes3<L>& b)
+	{
+		return { L::Select(m, a.X, b.X), L::Select(m, a.Y, b.Y), L::Select(m, a.Z, b.Z) };
+	}
+
+	//the point of the set furthest from the given one, the first one wins ties
+	//the loops below walk both halves of a set side by side, every step depends on the one before so this halves the chain, count has to be even
+	template<typename L>
+	Lanes3<L> GetFurthestPoint(const Lanes3<L>& point, const float* x, const float* y, const float* z, uint32_t count)
+	{
+		const uint32_t Half = count / 2;
+		Lanes3<L> Furthest[2] = { point, point };
+		typename L::Float FurthestDistSqred[2] = { L::Set(0.f), L::Set(0.f) };
+		for (uint32_t i = 0; i < Half; ++i)
+		{
+			for (uint32_t k = 0; k < 2; ++k)
+			{
+				Lanes3<L> p = Load3<L>(x, y, z, i + k * Half);
+				Lanes3<L> v = Sub3(p, point);
+				typename L::Float DistSqred = Dot3(v, v);
+				typename L::Mask IsFurther = L::Greater(DistSqred, FurthestDistSqred[k]);
+				Furthest[k] = Select3<L>(IsFurther, p, Furthest[k]);
+				FurthestDistSqred[k] = L::Select(IsFurther, DistSqred, FurthestDistSqred[k]);
+			}
+		}
+		//the first half has the lower indices so it keeps the ties
+		return Select3<L>(L::Greater(FurthestDistSqred[1], FurthestDistSqred[0]), Furthest[1], Furthest[0]);
+	}
+
+	//ritter sphere, the furthest pair from the first point spans the initial sphere which then only grows its radius to stay conservative
+	template<typename L>
+	void GetRitterSphere(const float* x, const float* y, const float* z, uint32_t count, Lanes3<L>& center, typename L::Float& radius)
+	{
+		Lanes3<L> First = Load3<L>(x, y, z, 0);
+		Lanes3<L> p0 = GetFurthestPoint<L>(First, x, y, z, count);
+		Lanes3<L> p1 = GetFurthestPoint<L>(p0, x, y, z, count);
+		const typename L::Float OneHalf = L::Set(0.5f);
+		center = { L::Mul(L::Add(p0.X, p1.X), OneHalf), L::Mul(L::Add(p0.Y, p1.Y), OneHalf), L::Mul(L::Add(p0.Z, p1.Z), OneHalf) };
+		Lanes3<L> v = Sub3(p1, center);
+		typename L::Float RadiusSqred[2] = { Dot3(v, v), Dot3(v, v) };
+		const uint32_t Half = count / 2;
+		for (uint32_t i = 0; i < Half; ++i)
+		{
+			for (uint32_t k = 0; k < 2; ++k)
+			{
+				v = Sub3(Load3<L>(x, y, z, i + k * Half), center);
+				RadiusSqred[k] = L::Max(RadiusSqred[k], Dot3(v, v));
+			}
+		}
+		radius = L::Sqrt(L::Max(RadiusSqred[0], RadiusSqred[1]));
+	}
+
+	//soa scratch of one batch, element i of lane l is at i * Width + l
+	//kept small enough to stay in l1 with 8 lanes, triangles only keep their normal and plane offset
+	struct BoundsScratch
+	{
+		std::vector<float> Positions[3];
+		std::vector<uint32_t> Triangles;
+		std::vector<float> Normals[3];
+		std::vector<float> PlaneOffsets;
+	};
+
+	template<typename L>
+	void ComputeBoundsBatched(const meshopt_Meshlet* meshlets, size_t meshletCount, const uint32_t* meshletVertices, const uint32_t* meshletTrianglesPacked,
+		const Vertex* vertices, FMeshletBounds* bounds, MeshletAABB* aabbs)
+	{
+		using Float = typename L::Float;
+		using Mask = typename L::Mask;
+		constexpr uint32_t W = L::Width;
+		BoundsScratch Scratch;
+		for (uint32_t k = 0; k < 3; ++k)
+		{
+			Scratch.Positions[k].resize(max_vertices * W);
+			Scratch.Normals[k].resize(max_triangles * W);
+		}
+		Scratch.Triangles.resize(max_triangles * W);
+		Scratch.PlaneOffsets.resize(max_triangles * W);
+		float* PX = Scratch.Positions[0].data(); float* PY = Scratch.Positions[1].data(); float* PZ = Scratch.Positions[2].data();
+		float* NX = Scratch.Normals[0].data(); float* NY = Scratch.Normals[1].data(); float* NZ = Scratch.Normals[2].data();
+		float* ND = Scratch.PlaneOffsets.data();
+		uint32_t* Triangles = Scratch.Triangles.data();
+		const Float Zero = L::Set(0.f);
+		const Float One = L::Set(1.f);
+
+		for (size_t Base = 0; Base < meshletCount; Base += W)
+		{
+			//lanes past the end repeat the last meshlet and get thrown away
+			uint32_t VertexCount{}, TriangleCount{};
+			for (uint32_t l = 0; l < W; ++l)
+			{
+				const meshopt_Meshlet& Meshlet = meshlets[std::min<size_t>(Base + l, meshletCount - 1)];
+				VertexCount = std::max(VertexCount, Meshlet.vertex_count);
+				TriangleCount = std::max(TriangleCount, Meshlet.triangle_count);
+			}
+			//the reductions walk two halves at once
+			VertexCount = (VertexCount + 1) & ~1u;
+			TriangleCount = (TriangleCount + 1) & ~1u;
+
+			//gather, short meshlets are padded with their first vertex and triangle which changes none of the results
+			//positions are relative to the first vertex of the meshlet so meshes far from the origin keep their precision
+			float Origin[3][W];
+			for (uint32_t l = 0; l < W; ++l)
+			{
+				const meshopt_Meshlet& Meshlet = meshlets[std::min<size_t>(Base + l, meshletCount - 1)];
+				const uint32_t* MeshletVertices = meshletVertices + Meshlet.vertex_offset;
+				const Vector3& First = vertices[MeshletVertices[0]].position;
+				Origin[0][l] = First.x;
+				Origin[1][l] = First.y;
+				Origin[2][l] = First.z;
+				for (uint32_t i = 0; i < VertexCount; ++i)
+				{
+					const Vector3& p = vertices[MeshletVertices[i < Meshlet.vertex_count ? i : 0]].position;
+					PX[i * W + l] = p.x - First.x;
+					PY[i * W + l] = p.y - First.y;
+					PZ[i * W + l] = p.z - First.z;
+				}
+				const uint32_t* MeshletTriangles = meshletTrianglesPacked + Meshlet.triangle_offset;
+				for (uint32_t t = 0; t < TriangleCount; ++t)
+					Triangles[t * W + l] = MeshletTriangles[t < Meshlet.triangle_count ? t : 0];
+			}
+
+			Lanes3<L> Center;
+			Float Radius;
+			GetRitterSphere<L>(PX, PY, PZ, VertexCount, Center, Radius);
+
+			Lanes3<L> BoxMin[2], BoxMax[2];
+			BoxMin[0] = BoxMin[1] = BoxMax[0] = BoxMax[1] = Load3<L>(PX, PY, PZ, 0);
+			for (uint32_t i = 0; i < VertexCount / 2; ++i)
+			{
+				for (uint32_t k = 0; k < 2; ++k)
+				{
+					Lanes3<L> p = Load3<L>(PX, PY, PZ, i + k * VertexCount / 2);
+					BoxMin[k] = { L::Min(BoxMin[k].X, p.X), L::Min(BoxMin[k].Y, p.Y), L::Min(BoxMin[k].Z, p.Z) };
+					BoxMax[k] = { L::Max(BoxMax[k].X, p.X), L::Max(BoxMax[k].Y, p.Y), L::Max(BoxMax[k].Z, p.Z) };
+				}
+			}
+			BoxMin[0] = { L::Min(BoxMin[0].X, BoxMin[1].X), L::Min(BoxMin[0].Y, BoxMin[1].Y), L::Min(BoxMin[0].Z, BoxMin[1].Z) };
+			BoxMax[0] = { L::Max(BoxMax[0].X, BoxMax[1].X), L::Max(BoxMax[0].Y, BoxMax[1].Y), L::Max(BoxMax[0].Z, BoxMax[1].Z) };
+
+			//triangle normals and plane offsets, zero area triangles take the first valid one of their meshlet so they do not widen the cone
+			Mask Found = L::None();
+			Lanes3<L> FirstNormal = { Zero, Zero, Zero };
+			Float FirstOffset = Zero;
+			for (uint32_t t = 0; t < TriangleCount; ++t)
+			{
+				alignas(32) float Corners[9][W];
+				for (uint32_t l = 0; l < W; ++l)
+				{
+					const uint32_t Packed = Triangles[t * W + l];
+					for (uint32_t k = 0; k < 3; ++k)
+					{
+						const uint32_t Index = ((Packed >> (k * 8)) & 0xFF) * W + l;
+						Corners[k * 3 + 0][l] = PX[Index];
+						Corners[k * 3 + 1][l] = PY[Index];
+						Corners[k * 3 + 2][l] = PZ[Index];
+					}
+				}
+				Lanes3<L> a = Load3<L>(Corners[0], Corners[1], Corners[2], 0);
+				Lanes3<L> e1 = Sub3(Load3<L>(Corners[3], Corners[4], Corners[5], 0), a);
+				Lanes3<L> e2 = Sub3(Load3<L>(Corners[6], Corners[7], Corners[8], 0), a);
+				Lanes3<L> n = {
+					L::Sub(L::Mul(e1.Y, e2.Z), L::Mul(e1.Z, e2.Y)),
+					L::Sub(L::Mul(e1.Z, e2.X), L::Mul(e1.X, e2.Z)),
+					L::Sub(L::Mul(e1.X, e2.Y), L::Mul(e1.Y, e2.X)) };
+				Float LengthSqred = Dot3(n, n);
+				Mask Valid = L::Greater(LengthSqred, Zero);
+				//zero area normals stay zero, which is how the next loop tells them apart
+				Float InvLength = L::Div(One, L::Sqrt(L::Select(Valid, LengthSqred, One)));
+				n = { L::Mul(n.X, InvLength), L::Mul(n.Y, InvLength), L::Mul(n.Z, InvLength) };
+				Float Offset = Dot3(a, n);
+				L::Store(NX + t * W, n.X); L::Store(NY + t * W, n.Y); L::Store(NZ + t * W, n.Z);
+				L::Store(ND + t * W, Offset);
+				Mask IsFirst = L::AndNot(Valid, Found);
+				FirstNormal = Select3<L>(IsFirst, n, FirstNormal);
+				FirstOffset = L::Select(IsFirst, Offset, FirstOffset);
+				Found = L::Or(Found, Valid);
+			}
+			for (uint32_t t = 0; t < TriangleCount; ++t)
+			{
+				Lanes3<L> n = Load3<L>(NX, NY, NZ, t);
+				Mask Valid = L::Greater(Dot3(n, n), Zero);
+				n = Select3<L>(Valid, n, FirstNormal);
+				L::Store(NX + t * W, n.X); L::Store(NY + t * W, n.Y); L::Store(NZ + t * W, n.Z);
+				L::Store(ND + t * W, L::Select(Valid, L::Load(ND + t * W), FirstOffset));
+			}
+
+			//treating the normals as points, the center of their bounding sphere is the cone axis
+			Lanes3<L> Axis;
+			Float NormalRadius;
+			GetRitterSphere<L>(NX, NY, NZ, TriangleCount, Axis, NormalRadius);
+			Float AxisLength = L::Sqrt(Dot3(Axis, Axis));
+			Float InvAxisLength = L::Select(L::Greater(AxisLength, Zero), L::Div(One, AxisLength), Zero);
+			Axis = { L::Mul(Axis.X, InvAxisLength), L::Mul(Axis.Y, InvAxisLength), L::Mul(Axis.Z, InvAxisLength) };
+			Float MinDots[2] = { One, One };
+			for (uint32_t t = 0; t < TriangleCount / 2; ++t)
+			{
+				for (uint32_t k = 0; k < 2; ++k)
+					MinDots[k] = L::Min(MinDots[k], Dot3(Load3<L>(NX, NY, NZ, t + k * TriangleCount / 2), Axis));
+			}
+			Float MinDot = L::Min(MinDots[0], MinDots[1]);
+			//same cut off as meshopt, a cone of about 168 degrees or wider culls nothing
+			Mask ValidCone = L::AndNot(Found, L::LessEqual(MinDot, L::Set(0.1f)));
+
+			//the apex sits on the axis behind the sphere center, in the negative half space of every triangle
+			Float MaxTs[2] = { Zero, Zero };
+			for (uint32_t t = 0; t < TriangleCount / 2; ++t)
+			{
+				for (uint32_t k = 0; k < 2; ++k)
+				{
+					const uint32_t i = t + k * TriangleCount / 2;
+					Lanes3<L> n = Load3<L>(NX, NY, NZ, i);
+					Float DistanceToPlane = L::Sub(Dot3(Center, n), L::Load(ND + i * W));
+					MaxTs[k] = L::Max(MaxTs[k], L::Div(DistanceToPlane, Dot3(Axis, n)));
+				}
+			}
+			Float MaxT = L::Max(MaxTs[0], MaxTs[1]);
+
+			Lanes3<L> Offset = Load3<L>(Origin[0], Origin[1], Origin[2], 0);
+			Lanes3<L> Apex = { L::Sub(Center.X, L::Mul(Axis.X, MaxT)), L::Sub(Center.Y, L::Mul(Axis.Y, MaxT)), L::Sub(Center.Z, L::Mul(Axis.Z, MaxT)) };
+			Apex = Select3<L>(ValidCone, { L::Add(Apex.X, Offset.X), L::Add(Apex.Y, Offset.Y), L::Add(Apex.Z, Offset.Z) }, { Zero, Zero, Zero });
+			Axis = Select3<L>(ValidCone, Axis, { Zero, Zero, Zero });
+			//the cone of normals is mindot wide, the culling cone is that turned 90 degrees, so the cut off is sin instead of cos
+			Float Cutoff = L::Select(ValidCone, L::Sqrt(L::Max(Zero, L::Sub(One, L::Mul(MinDot, MinDot)))), One);
+
+			float Out[17][W];
+			const Float Results[17] = {
+				L::Add(Center.X, Offset.X), L::Add(Center.Y, Offset.Y), L::Add(Center.Z, Offset.Z), Radius,
+				Apex.X, Apex.Y, Apex.Z, Cutoff, Axis.X, Axis.Y, Axis.Z,
+				L::Add(BoxMin[0].X, Offset.X), L::Add(BoxMin[0].Y, Offset.Y), L::Add(BoxMin[0].Z, Offset.Z),
+				L::Add(BoxMax[0].X, Offset.X), L::Add(BoxMax[0].Y, Offset.Y), L::Add(BoxMax[0].Z, Offset.Z) };
+			for (uint32_t k = 0; k < 17; ++k)
+				L::Store(Out[k], Results[k]);
+			for (uint32_t l = 0; l < W && Base + l < meshletCount; ++l)
+			{
+				FMeshletBounds& Bounds = bounds[Base + l];
+				Bounds.Center = Vector3(Out[0][l], Out[1][l], Out[2][l]);
+				Bounds.Radius = Out[3][l];
+				Bounds.ConeApex = Vector3(Out[4][l], Out[5][l], Out[6][l]);
+				Bounds.ConeCutoff = Out[7][l];
+				Bounds.ConeAxis = Vector3(Out[8][l], Out[9][l], Out[10][l]);
+				if (aabbs)
+				{
+					aabbs[Base + l].Min = Vector3(Out[11][l], Out[12][l], Out[13][l]);
+					aabbs[Base + l].Max = Vector3(Out[14][l], Out[15][l], Out[16][l]);
+				}
+			}
+		}
+	}
+
+	//the per meshlet ritter sphere the meshlets used before the batched kernel, kept to validate against
+	Vector4 GetReferenceRitterSphere(const Vertex* vertices, const meshopt_Meshlet& meshlet, const uint32_t* meshletVertices)
+	{
+		auto GetFurthest = [&](const Vector3& point) {
+			float FurthestDistSqred = 0;
+			Vector3 FurthestPoint = point;
+			for (size_t i = 0; i < meshlet.vertex_count; i++)
+			{
+				Vector3 p = vertices[meshletVertices[meshlet.vertex_offset + i]].position;
+				float DistSqred = (p - point).LengthSquared();
+				if (DistSqred > FurthestDistSqred)
+				{
+					FurthestDistSqred = DistSqred;
+					FurthestPoint = p;
+				}
+			}
+			return FurthestPoint;
+		};
+		Vector3 p0 = GetFurthest(vertices[meshletVertices[meshlet.vertex_offset]].position);
+		Vector3 p1 = GetFurthest(p0);
+		Vector3 Center = (p0 + p1) * 0.5f;
+		float RadiusSqred = (p1 - Center).LengthSquared();
+		for (size_t i = 0; i < meshlet.vertex_count; i++)
+			RadiusSqred = std::max(RadiusSqred, (vertices[meshletVertices[meshlet.vertex_offset + i]].position - Center).LengthSquared());
+		return Vector4(Center.x, Center.y, Center.z, sqrtf(RadiusSqred));
+	}
+}
+
+void ComputeMeshletBounds(const meshopt_Meshlet* meshlets, size_t meshletCount, const uint32_t* meshletVertices, const uint32_t* meshletTrianglesPacked,
+	const Vertex* vertices, FMeshletBounds* bounds, MeshletAABB* aabbs)
+{
+	if (meshletCount == 0)
+		return;
+#if RD_MESHLET_BOUNDS_AVX
+	static const bool bHasAvx = HasAvx();
+	if (bHasAvx)
+		return ComputeBoundsBatched<AvxLanes>(meshlets, meshletCount, meshletVertices, meshletTrianglesPacked, vertices, bounds, aabbs);
+#endif
+#if RD_MESHLET_BOUNDS_SSE
+	ComputeBoundsBatched<SseLanes>(meshlets, meshletCount, meshletVertices, meshletTrianglesPacked, vertices, bounds, aabbs);
+#else
+	ComputeBoundsBatched<ScalarLanes>(meshlets, meshletCount, meshletVertices, meshletTrianglesPacked, vertices, bounds, aabbs);
+#endif
+}
+
+void ComputeMeshletBoundsScalar(const meshopt_Meshlet* meshlets, size_t meshletCount, const uint32_t* meshletVertices, const uint32_t* meshletTrianglesPacked,
+	const Vertex* vertices, FMeshletBounds* bounds, MeshletAABB* aabbs)
+{
+	if (meshletCount == 0)
+		return;
+	ComputeBoundsBatched<ScalarLanes>(meshlets, meshletCount, meshletVertices, meshletTrianglesPacked, vertices, bounds, aabbs);
+}
+
+uint32_t GetMeshletBoundsWidth()
+{
+#if RD_MESHLET_BOUNDS_AVX
+	static const bool bHasAvx = HasAvx();
+	if (bHasAvx)
+		return AvxLanes::Width;
+#endif
+#if RD_MESHLET_BOUNDS_SSE
+	return SseLanes::Width;
+#else
+	return ScalarLanes::Width;
+#endif
+}
+
+bool BenchmarkMeshletBounds(const AssetManager& assets)
+{
+	RD_SCOPE(Load, Benchmark Meshlet Bounds);
+	const size_t MeshletCount = assets.Meshlets.size();
+	if (MeshletCount == 0)
+		return true;
+	std::vector<FMeshletBounds> Batched(MeshletCount), Scalar(MeshletCount);
+	std::vector<MeshletAABB> Boxes(MeshletCount);
+	std::vector<Vector4> Ritter(MeshletCount);
+	std::vector<meshopt_Bounds> Meshopt(MeshletCount);
+	std::vector<uint8_t> TrianglesUnpacked(max_triangles * 3);
+
+	//every method over every meshlet of every mesh, best of a few runs
+	constexpr uint32_t RunCount = 5;
+	auto Time = [&](auto&& method) {
+		double Best = std::numeric_limits<double>::max();
+		for (uint32_t Run = 0; Run < RunCount; ++Run)
+		{
+			auto Start = std::chrono::high_resolution_clock::now();
+			for (const VertexBufferInfo& Info : assets.VertexBufferInfos)
+			{
+				if (Info.MeshletCount > 0)
+					method(Info);
+			}
+			std::chrono::duration<double> Duration = std::chrono::high_resolution_clock::now() - Start;
+			Best = std::min(Best, Duration.count());
+		}
+		return Best;
+	};
+	auto Batch = [&](const VertexBufferInfo& Info) {
+		ComputeMeshletBounds(&assets.Meshlets[Info.MeshletGroupOffset], Info.MeshletCount, &assets.MeshletVertices[Info.MeshletGroupVerticesOffset],
+			&assets.MeshletTrianglesPacked[Info.MeshletGroupPrimitivesOffset], &assets.Vertices[Info.VerticesOffset], &Batched[Info.MeshletGroupOffset], &Boxes[Info.MeshletGroupOffset]);
+	};
+	auto ScalarKernel = [&](const VertexBufferInfo& Info) {
+		ComputeMeshletBoundsScalar(&assets.Meshlets[Info.MeshletGroupOffset], Info.MeshletCount, &assets.MeshletVertices[Info.MeshletGroupVerticesOffset],
+			&assets.MeshletTrianglesPacked[Info.MeshletGroupPrimitivesOffset], &assets.Vertices[Info.VerticesOffset], &Scalar[Info.MeshletGroupOffset]);
+	};
+	auto Reference = [&](const VertexBufferInfo& Info) {
+		for (uint32_t i = 0; i < Info.MeshletCount; ++i)
+			Ritter[Info.MeshletGroupOffset + i] = GetReferenceRitterSphere(&assets.Vertices[Info.VerticesOffset], assets.Meshlets[Info.MeshletGroupOffset + i], &assets.MeshletVertices[Info.MeshletGroupVerticesOffset]);
+	};
+	auto MeshoptBounds = [&](const VertexBufferInfo& Info) {
+		for (uint32_t i = 0; i < Info.MeshletCount; ++i)
+		{
+			const meshopt_Meshlet& Meshlet = assets.Meshlets[Info.MeshletGroupOffset + i];
+			const uint32_t* Packed = &assets.MeshletTrianglesPacked[Info.MeshletGroupPrimitivesOffset + Meshlet.triangle_offset];
+			for (uint32_t t = 0; t < Meshlet.triangle_count * 3; ++t)
+				TrianglesUnpacked[t] = static_cast<uint8_t>(Packed[t / 3] >> ((t % 3) * 8));
+			Meshopt[Info.MeshletGroupOffset + i] = meshopt_computeMeshletBounds(&assets.MeshletVertices[Info.MeshletGroupVerticesOffset + Meshlet.vertex_offset], TrianglesUnpacked.data(),
+				Meshlet.triangle_count, &assets.Vertices[Info.VerticesOffset].position.x, Info.VerticesCount, sizeof(Vertex));
+		}
+	};
+	const double BatchedTime = Time(Batch);
+	const double ScalarTime = Time(ScalarKernel);
+	const double ReferenceTime = Time(Reference);
+	const double MeshoptTime = Time(MeshoptBounds);
+
+	//the batched kernel has to match the scalar one and the old ritter sphere, meshopt uses a different sphere so it is only compared
+	float MaxKernelError{}, MaxRitterError{}, MaxRadiusRatio{}, RadiusRatioSum{}, MaxAxisAngle{};
+	size_t EscapedVertices{}, UnculledTriangles{}, ExposedApexes{}, ConeCount{}, MeshoptConeCount{};
+	for (const VertexBufferInfo& Info : assets.VertexBufferInfos)
+	{
+		const Vertex* Vertices = &assets.Vertices[Info.VerticesOffset];
+		for (uint32_t i = Info.MeshletGroupOffset; i < Info.MeshletGroupOffset + Info.MeshletCount; ++i)
+		{
+			const FMeshletBounds& a = Batched[i];
+			const FMeshletBounds& b = Scalar[i];
+			const float Scale = std::max(a.Radius, 1e-6f);
+			MaxKernelError = std::max({ MaxKernelError, Vector3::Distance(a.Center, b.Center) / Scale, fabsf(a.Radius - b.Radius) / Scale,
+				Vector3::Distance(a.ConeApex, b.ConeApex) / Scale, Vector3::Distance(a.ConeAxis, b.ConeAxis), fabsf(a.ConeCutoff - b.ConeCutoff) });
+			MaxRitterError = std::max({ MaxRitterError, Vector3::Distance(a.Center, Vector3(Ritter[i].x, Ritter[i].y, Ritter[i].z)) / Scale, fabsf(a.Radius - Ritter[i].w) / Scale });
+			const float RadiusRatio = Meshopt[i].radius > 0.f ? a.Radius / Meshopt[i].radius : 1.f;
+			MaxRadiusRatio = std::max(MaxRadiusRatio, RadiusRatio);
+			RadiusRatioSum += RadiusRatio;
+
+			const meshopt_Meshlet& Meshlet = assets.Meshlets[i];
+			const uint32_t* MeshletVertices = &assets.MeshletVertices[Info.MeshletGroupVerticesOffset + Meshlet.vertex_offset];
+			//the kernel works relative to the first vertex, moving back can round by an ulp of the position
+			const float Slack = a.Radius * 1e-4f + 1e-6f;
+			for (uint32_t v = 0; v < Meshlet.vertex_count; ++v)
+			{
+				const Vector3& p = Vertices[MeshletVertices[v]].position;
+				if (Vector3::Distance(p, a.Center) > a.Radius + Slack || p.x < Boxes[i].Min.x - Slack || p.y < Boxes[i].Min.y - Slack || p.z < Boxes[i].Min.z - Slack
+					|| p.x > Boxes[i].Max.x + Slack || p.y > Boxes[i].Max.y + Slack || p.z > Boxes[i].Max.z + Slack)
+					++EscapedVertices;
+			}
+			MeshoptConeCount += Meshopt[i].cone_cutoff < 1.f;
+			if (a.ConeCutoff >= 1.f)
+				continue;
+			++ConeCount;
+			if (Meshopt[i].cone_cutoff < 1.f)
+				MaxAxisAngle = std::max(MaxAxisAngle, acosf(std::clamp(a.ConeAxis.Dot(Vector3(Meshopt[i].cone_axis)), -1.f, 1.f)));
+			//the cone has to hold every normal and the apex has to be behind every triangle, otherwise visible triangles get culled
+			const float MinDot = sqrtf(std::max(0.f, 1.f - a.ConeCutoff * a.ConeCutoff));
+			const uint32_t* Triangles = &assets.MeshletTrianglesPacked[Info.MeshletGroupPrimitivesOffset + Meshlet.triangle_offset];
+			for (uint32_t t = 0; t < Meshlet.triangle_count; ++t)
+			{
+				const Vector3& p0 = Vertices[MeshletVertices[Triangles[t] & 0xFF]].position;
+				const Vector3& p1 = Vertices[MeshletVertices[(Triangles[t] >> 8) & 0xFF]].position;
+				const Vector3& p2 = Vertices[MeshletVertices[(Triangles[t] >> 16) & 0xFF]].position;
+				Vector3 n = (p1 - p0).Cross(p2 - p0);
+				if (n.LengthSquared() == 0.f)
+					continue;
+				n.Normalize();
+				if (n.Dot(a.ConeAxis) < MinDot - 1e-4f)
+					++UnculledTriangles;
+				if ((a.ConeApex - p0).Dot(n) > 1e-4f * Scale)
+					++ExposedApexes;
+			}
+		}
+	}
+
+	RD_CORE_INFO("Meshlet bounds: {} meshlets, {} wide batches", MeshletCount, GetMeshletBoundsWidth());
+	RD_CORE_INFO("Meshlet bounds: batched {:.2f}ms ({:.2f}M meshlets/s), scalar {:.2f}ms ({:.2f}M/s), old ritter sphere {:.2f}ms ({:.2f}M/s), meshopt {:.2f}ms ({:.2f}M/s)",
+		BatchedTime * 1000.0, MeshletCount / BatchedTime / 1e6, ScalarTime * 1000.0, MeshletCount / ScalarTime / 1e6,
+		ReferenceTime * 1000.0, MeshletCount / ReferenceTime / 1e6, MeshoptTime * 1000.0, MeshletCount / MeshoptTime / 1e6);
+	RD_CORE_INFO("Meshlet bounds: max difference to the scalar kernel {:.7f}, to the old ritter sphere {:.7f} of the radius",
+		MaxKernelError, MaxRitterError);
+	RD_CORE_INFO("Meshlet bounds: radius against meshopt {:.3f}x average, {:.3f}x worst, {} cones against {} from meshopt, axes at most {:.2f} deg apart",
+		RadiusRatioSum / MeshletCount, MaxRadiusRatio, ConeCount, MeshoptConeCount, DirectX::XMConvertToDegrees(MaxAxisAngle));
+	if (EscapedVertices || UnculledTriangles || ExposedApexes || MaxKernelError > 1e-4f || MaxRitterError > 1e-4f)
+	{
+		RD_CORE_ERROR("Meshlet bounds: {} vertices outside their sphere or box, {} normals outside their cone, {} triangles in front of their apex",
+			EscapedVertices, UnculledTriangles, ExposedApexes);
+		return false;
+	}
+	RD_CORE_INFO("Meshlet bounds: all bounds are conservative");
+	return true;
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include "Ragdoll/AssetManager.h"
+
+struct MeshletAABB
+{
+	Vector3 Min;
+	Vector3 Max;
+};
+
+//bounding sphere, box and normal cone of every meshlet, a batch of meshlets at a time
+//the positions of a batch are gathered into soa scratch first so every lane works on its own meshlet
+//meshlets, vertices and packed triangles use the local offsets of a single mesh, aabbs can be null
+void ComputeMeshletBounds(const meshopt_Meshlet* meshlets, size_t meshletCount, const uint32_t* meshletVertices, const uint32_t* meshletTrianglesPacked,
+	const Vertex* vertices, FMeshletBounds* bounds, MeshletAABB* aabbs = nullptr);
+//same kernel one meshlet at a time, the fallback and the reference for the batched one
+void ComputeMeshletBoundsScalar(const meshopt_Meshlet* meshlets, size_t meshletCount, const uint32_t* meshletVertices, const uint32_t* meshletTrianglesPacked,
+	const Vertex* vertices, FMeshletBounds* bounds, MeshletAABB* aabbs = nullptr);
+//meshlets per batch of ComputeMeshletBounds on this cpu, 8 with avx, 4 with sse, 1 otherwise
+uint32_t GetMeshletBoundsWidth();
+
+//checks the batched bounds of every loaded meshlet against the scalar kernel, the old ritter sphere and meshopt_computeMeshletBounds,
+//then logs the throughput of each in meshlets per second, false if a bound is not conservative or the kernels disagree
+bool BenchmarkMeshletBounds(const AssetManager& assets);
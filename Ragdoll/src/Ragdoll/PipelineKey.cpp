@@ -0,0 +1,994 @@
+#include "ragdollpch.h"
+#include "PipelineKey.h"
+
+#include "Ragdoll/Core/Hash.h"
+#include <latch>
+#include <numeric>
+
+namespace
+{
+	//plain values go through a small buffer and are hashed a buffer at a time instead of a field at a time
+	//the states are added field by field, hashing them as raw bytes would take their padding with them
+	class KeyHasher
+	{
+	public:
+		template<typename T>
+		void Add(const T& value)
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			if (Size + sizeof(T) > sizeof(Buffer))
+				Flush();
+			memcpy(Buffer + Size, &value, sizeof(T));
+			Size += sizeof(T);
+		}
+		void Add(const std::string& value)
+		{
+			Add(static_cast<uint32_t>(value.size()));
+			Flush();
+			Seed = ragdoll::Hash64(value.data(), value.size(), Seed);
+		}
+		uint64_t Get()
+		{
+			Flush();
+			return Seed;
+		}
+
+	private:
+		void Flush()
+		{
+			if (Size == 0)
+				return;
+			Seed = ragdoll::Hash64(Buffer, Size, Seed);
+			Size = 0;
+		}
+
+		uint8_t Buffer[256];
+		size_t Size{};
+		uint64_t Seed{};
+	};
+
+	void AddShader(KeyHasher& hasher, nvrhi::IShader* shader, ShaderHashCache& shaders)
+	{
+		hasher.Add(shaders.Get(shader));
+	}
+
+	void AddState(KeyHasher& hasher, const nvrhi::RenderState& state)
+	{
+		for (const nvrhi::BlendState::RenderTarget& Target : state.blendState.targets)
+		{
+			hasher.Add(Target.blendEnable);
+			hasher.Add(Target.srcBlend);
+			hasher.Add(Target.destBlend);
+			hasher.Add(Target.blendOp);
+			hasher.Add(Target.srcBlendAlpha);
+			hasher.Add(Target.destBlendAlpha);
+			hasher.Add(Target.blendOpAlpha);
+			hasher.Add(Target.colorWriteMask);
+		}
+		hasher.Add(state.blendState.alphaToCoverageEnable);
+
+		const nvrhi::DepthStencilState& Depth = state.depthStencilState;
+		hasher.Add(Depth.depthTestEnable);
+		hasher.Add(Depth.depthWriteEnable);
+		hasher.Add(Depth.depthFunc);
+		hasher.Add(Depth.stencilEnable);
+		hasher.Add(Depth.stencilReadMask);
+		hasher.Add(Depth.stencilWriteMask);
+		hasher.Add(Depth.stencilRefValue);
+		hasher.Add(Depth.dynamicStencilRef);
+		for (const nvrhi::DepthStencilState::StencilOpDesc* Face : { &Depth.frontFaceStencil, &Depth.backFaceStencil })
+		{
+			hasher.Add(Face->failOp);
+			hasher.Add(Face->depthFailOp);
+			hasher.Add(Face->passOp);
+			hasher.Add(Face->stencilFunc);
+		}
+
+		const nvrhi::RasterState& Raster = state.rasterState;
+		hasher.Add(Raster.fillMode);
+		hasher.Add(Raster.cullMode);
+		hasher.Add(Raster.frontCounterClockwise);
+		hasher.Add(Raster.depthClipEnable);
+		hasher.Add(Raster.scissorEnable);
+		hasher.Add(Raster.multisampleEnable);
+		hasher.Add(Raster.antialiasedLineEnable);
+		hasher.Add(Raster.depthBias);
+		hasher.Add(Raster.depthBiasClamp);
+		hasher.Add(Raster.slopeScaledDepthBias);
+		hasher.Add(Raster.forcedSampleCount);
+		hasher.Add(Raster.programmableSamplePositionsEnable);
+		hasher.Add(Raster.conservativeRasterEnable);
+		hasher.Add(Raster.quadFillEnable);
+		hasher.Add(Raster.samplePositionsX);
+		hasher.Add(Raster.samplePositionsY);
+
+		hasher.Add(state.singlePassStereo.enabled);
+		hasher.Add(state.singlePassStereo.independentViewportMask);
+		hasher.Add(state.singlePassStereo.renderTargetIndexOffset);
+	}
+
+	void AddFramebuffer(KeyHasher& hasher, const nvrhi::FramebufferInfo& framebuffer)
+	{
+		hasher.Add(static_cast<uint32_t>(framebuffer.colorFormats.size()));
+		for (nvrhi::Format Format : framebuffer.colorFormats)
+			hasher.Add(Format);
+		hasher.Add(framebuffer.depthFormat);
+		hasher.Add(framebuffer.sampleCount);
+		hasher.Add(framebuffer.sampleQuality);
+	}
+
+	void AddItem(KeyHasher& hasher, const nvrhi::BindingLayoutItem& item)
+	{
+		//the bitfields are read out one by one, the unused bits are never written by the helpers
+		hasher.Add(item.slot);
+		hasher.Add(static_cast<nvrhi::ResourceType>(item.type));
+		hasher.Add(static_cast<uint16_t>(item.size));
+	}
+
+	void AddLayoutDesc(KeyHasher& hasher, const nvrhi::BindingLayoutDesc& desc)
+	{
+		hasher.Add(desc.visibility);
+		hasher.Add(desc.registerSpace);
+		hasher.Add(desc.registerSpaceIsDescriptorSet);
+		hasher.Add(static_cast<uint32_t>(desc.bindings.size()));
+		for (const nvrhi::BindingLayoutItem& Item : desc.bindings)
+			AddItem(hasher, Item);
+		hasher.Add(desc.bindingOffsets.shaderResource);
+		hasher.Add(desc.bindingOffsets.sampler);
+		hasher.Add(desc.bindingOffsets.constantBuffer);
+		hasher.Add(desc.bindingOffsets.unorderedAccess);
+	}
+
+	//by what is in the layout, the key itself compares the layout objects
+	void AddLayout(KeyHasher& hasher, nvrhi::IBindingLayout* layout)
+	{
+		if (!layout)
+		{
+			hasher.Add(uint8_t(0));
+			return;
+		}
+		if (const nvrhi::BindingLayoutDesc* Desc = layout->getDesc())
+		{
+			hasher.Add(uint8_t(1));
+			AddLayoutDesc(hasher, *Desc);
+		}
+		else if (const nvrhi::BindlessLayoutDesc* Bindless = layout->getBindlessDesc())
+		{
+			hasher.Add(uint8_t(2));
+			hasher.Add(Bindless->visibility);
+			hasher.Add(Bindless->firstSlot);
+			hasher.Add(Bindless->maxCapacity);
+			hasher.Add(static_cast<uint32_t>(Bindless->registerSpaces.size()));
+			for (const nvrhi::BindingLayoutItem& Item : Bindless->registerSpaces)
+				AddItem(hasher, Item);
+		}
+	}
+
+	void AddLayouts(KeyHasher& hasher, const nvrhi::BindingLayoutVector& layouts)
+	{
+		hasher.Add(static_cast<uint32_t>(layouts.size()));
+		for (const nvrhi::BindingLayoutHandle& Layout : layouts)
+			AddLayout(hasher, Layout);
+	}
+
+	void AddInputLayout(KeyHasher& hasher, nvrhi::IInputLayout* layout)
+	{
+		const uint32_t Count = layout ? layout->getNumAttributes() : 0;
+		hasher.Add(Count);
+		for (uint32_t i = 0; i < Count; ++i)
+		{
+			const nvrhi::VertexAttributeDesc* Attribute = layout->getAttributeDesc(i);
+			hasher.Add(Attribute->name);
+			hasher.Add(Attribute->format);
+			hasher.Add(Attribute->arraySize);
+			hasher.Add(Attribute->bufferIndex);
+			hasher.Add(Attribute->offset);
+			hasher.Add(Attribute->elementStride);
+			hasher.Add(Attribute->isInstanced);
+		}
+	}
+
+	bool Equal(const nvrhi::DepthStencilState::StencilOpDesc& a, const nvrhi::DepthStencilState::StencilOpDesc& b)
+	{
+		return a.failOp == b.failOp
+			&& a.depthFailOp == b.depthFailOp
+			&& a.passOp == b.passOp
+			&& a.stencilFunc == b.stencilFunc;
+	}
+
+	bool Equal(const nvrhi::RenderState& a, const nvrhi::RenderState& b)
+	{
+		const nvrhi::DepthStencilState& DepthA = a.depthStencilState;
+		const nvrhi::DepthStencilState& DepthB = b.depthStencilState;
+		const nvrhi::RasterState& RasterA = a.rasterState;
+		const nvrhi::RasterState& RasterB = b.rasterState;
+		return a.blendState == b.blendState
+			&& DepthA.depthTestEnable == DepthB.depthTestEnable
+			&& DepthA.depthWriteEnable == DepthB.depthWriteEnable
+			&& DepthA.depthFunc == DepthB.depthFunc
+			&& DepthA.stencilEnable == DepthB.stencilEnable
+			&& DepthA.stencilReadMask == DepthB.stencilReadMask
+			&& DepthA.stencilWriteMask == DepthB.stencilWriteMask
+			&& DepthA.stencilRefValue == DepthB.stencilRefValue
+			&& DepthA.dynamicStencilRef == DepthB.dynamicStencilRef
+			&& Equal(DepthA.frontFaceStencil, DepthB.frontFaceStencil)
+			&& Equal(DepthA.backFaceStencil, DepthB.backFaceStencil)
+			&& RasterA.fillMode == RasterB.fillMode
+			&& RasterA.cullMode == RasterB.cullMode
+			&& RasterA.frontCounterClockwise == RasterB.frontCounterClockwise
+			&& RasterA.depthClipEnable == RasterB.depthClipEnable
+			&& RasterA.scissorEnable == RasterB.scissorEnable
+			&& RasterA.multisampleEnable == RasterB.multisampleEnable
+			&& RasterA.antialiasedLineEnable == RasterB.antialiasedLineEnable
+			&& RasterA.depthBias == RasterB.depthBias
+			&& RasterA.depthBiasClamp == RasterB.depthBiasClamp
+			&& RasterA.slopeScaledDepthBias == RasterB.slopeScaledDepthBias
+			&& RasterA.forcedSampleCount == RasterB.forcedSampleCount
+			&& RasterA.programmableSamplePositionsEnable == RasterB.programmableSamplePositionsEnable
+			&& RasterA.conservativeRasterEnable == RasterB.conservativeRasterEnable
+			&& RasterA.quadFillEnable == RasterB.quadFillEnable
+			&& memcmp(RasterA.samplePositionsX, RasterB.samplePositionsX, sizeof(RasterA.samplePositionsX)) == 0
+			&& memcmp(RasterA.samplePositionsY, RasterB.samplePositionsY, sizeof(RasterA.samplePositionsY)) == 0
+			&& a.singlePassStereo == b.singlePassStereo;
+	}
+
+	bool Equal(const nvrhi::BindingLayoutVector& a, const nvrhi::BindingLayoutVector& b)
+	{
+		if (a.size() != b.size())
+			return false;
+		for (size_t i = 0; i < a.size(); ++i)
+		{
+			if (a[i] != b[i])
+				return false;
+		}
+		return true;
+	}
+}
+
+namespace
+{
+	struct ShaderLookup
+	{
+		nvrhi::IShader* Shader;
+		uint64_t Hash;
+
+		bool Matches(const nvrhi::ShaderHandle& key) const { return key == Shader; }
+		nvrhi::ShaderHandle MakeKey() const { return Shader; }
+	};
+}
+
+uint64_t ShaderHashCache::Get(nvrhi::IShader* shader)
+{
+	if (!shader)
+		return 0;
+	//the address only picks the bucket, the hash that goes into the keys is the content
+	const ShaderLookup Lookup{ shader, ragdoll::Hash64(&shader, sizeof(shader)) };
+	return Hashes.Get(Lookup, [shader]() {
+		const void* Bytecode = nullptr;
+		size_t Size = 0;
+		shader->getBytecode(&Bytecode, &Size);
+		//a library hands out every entry point with the bytecode of the whole library, the entry and type tell them apart
+		const nvrhi::ShaderDesc& Desc = shader->getDesc();
+		const uint64_t Seed = ragdoll::Hash64(Desc.entryName.data(), Desc.entryName.size(), static_cast<uint64_t>(Desc.shaderType));
+		return ragdoll::Hash64(Bytecode, Size, Seed);
+	});
+}
+
+bool GraphicsPipelineKey::operator==(const GraphicsPipelineKey& other) const
+{
+	return Hash == other.Hash && GraphicsPipelineLookup{ other.Desc, other.Framebuffer, other.Hash }.Matches(*this);
+}
+
+bool GraphicsPipelineLookup::Matches(const GraphicsPipelineKey& key) const
+{
+	const nvrhi::GraphicsPipelineDesc& Other = key.Desc;
+	return Desc.primType == Other.primType
+		&& Desc.patchControlPoints == Other.patchControlPoints
+		&& Desc.inputLayout == Other.inputLayout
+		&& Desc.VS == Other.VS
+		&& Desc.HS == Other.HS
+		&& Desc.DS == Other.DS
+		&& Desc.GS == Other.GS
+		&& Desc.PS == Other.PS
+		&& Equal(Desc.renderState, Other.renderState)
+		&& Desc.shadingRateState == Other.shadingRateState
+		&& Equal(Desc.bindingLayouts, Other.bindingLayouts)
+		&& Framebuffer == key.Framebuffer;
+}
+
+bool ComputePipelineKey::operator==(const ComputePipelineKey& other) const
+{
+	return Hash == other.Hash && ComputePipelineLookup{ other.Desc, other.Hash }.Matches(*this);
+}
+
+bool ComputePipelineLookup::Matches(const ComputePipelineKey& key) const
+{
+	return Desc.CS == key.Desc.CS
+		&& Equal(Desc.bindingLayouts, key.Desc.bindingLayouts);
+}
+
+bool MeshletPipelineKey::operator==(const MeshletPipelineKey& other) const
+{
+	return Hash == other.Hash && MeshletPipelineLookup{ other.Desc, other.Framebuffer, other.Hash }.Matches(*this);
+}
+
+bool MeshletPipelineLookup::Matches(const MeshletPipelineKey& key) const
+{
+	const nvrhi::MeshletPipelineDesc& Other = key.Desc;
+	return Desc.primType == Other.primType
+		&& Desc.AS == Other.AS
+		&& Desc.MS == Other.MS
+		&& Desc.PS == Other.PS
+		&& Equal(Desc.renderState, Other.renderState)
+		&& Equal(Desc.bindingLayouts, Other.bindingLayouts)
+		&& Framebuffer == key.Framebuffer;
+}
+
+bool RaytracePipelineKey::operator==(const RaytracePipelineKey& other) const
+{
+	return Hash == other.Hash && RaytracePipelineLookup{ other.Desc, other.Hash }.Matches(*this);
+}
+
+bool RaytracePipelineLookup::Matches(const RaytracePipelineKey& key) const
+{
+	const nvrhi::rt::PipelineDesc& Other = key.Desc;
+	if (Desc.shaders.size() != Other.shaders.size()
+		|| Desc.hitGroups.size() != Other.hitGroups.size()
+		|| !Equal(Desc.globalBindingLayouts, Other.globalBindingLayouts)
+		|| Desc.maxPayloadSize != Other.maxPayloadSize
+		|| Desc.maxAttributeSize != Other.maxAttributeSize
+		|| Desc.maxRecursionDepth != Other.maxRecursionDepth
+		|| Desc.hlslExtensionsUAV != Other.hlslExtensionsUAV)
+		return false;
+	for (size_t i = 0; i < Desc.shaders.size(); ++i)
+	{
+		const nvrhi::rt::PipelineShaderDesc& A = Desc.shaders[i];
+		const nvrhi::rt::PipelineShaderDesc& B = Other.shaders[i];
+		if (A.exportName != B.exportName || A.shader != B.shader || A.bindingLayout != B.bindingLayout)
+			return false;
+	}
+	for (size_t i = 0; i < Desc.hitGroups.size(); ++i)
+	{
+		const nvrhi::rt::PipelineHitGroupDesc& A = Desc.hitGroups[i];
+		const nvrhi::rt::PipelineHitGroupDesc& B = Other.hitGroups[i];
+		if (A.exportName != B.exportName
+			|| A.closestHitShader != B.closestHitShader
+			|| A.anyHitShader != B.anyHitShader
+			|| A.intersectionShader != B.intersectionShader
+			|| A.bindingLayout != B.bindingLayout
+			|| A.isProceduralPrimitive != B.isProceduralPrimitive)
+			return false;
+	}
+	return true;
+}
+
+bool BindingLayoutKey::operator==(const BindingLayoutKey& other) const
+{
+	return Hash == other.Hash && BindingLayoutLookup{ other.Desc, other.Hash }.Matches(*this);
+}
+
+bool BindingLayoutLookup::Matches(const BindingLayoutKey& key) const
+{
+	const nvrhi::BindingLayoutDesc& Other = key.Desc;
+	if (Desc.visibility != Other.visibility
+		|| Desc.registerSpace != Other.registerSpace
+		|| Desc.registerSpaceIsDescriptorSet != Other.registerSpaceIsDescriptorSet
+		|| Desc.bindings.size() != Other.bindings.size()
+		|| Desc.bindingOffsets.shaderResource != Other.bindingOffsets.shaderResource
+		|| Desc.bindingOffsets.sampler != Other.bindingOffsets.sampler
+		|| Desc.bindingOffsets.constantBuffer != Other.bindingOffsets.constantBuffer
+		|| Desc.bindingOffsets.unorderedAccess != Other.bindingOffsets.unorderedAccess)
+		return false;
+	for (size_t i = 0; i < Desc.bindings.size(); ++i)
+	{
+		if (Desc.bindings[i] != Other.bindings[i])
+			return false;
+	}
+	return true;
+}
+
+GraphicsPipelineLookup MakePipelineLookup(const nvrhi::GraphicsPipelineDesc& desc, const nvrhi::FramebufferInfo& framebuffer, ShaderHashCache& shaders)
+{
+	KeyHasher Hasher;
+	Hasher.Add(desc.primType);
+	Hasher.Add(desc.patchControlPoints);
+	AddInputLayout(Hasher, desc.inputLayout);
+	for (nvrhi::IShader* Shader : { desc.VS.Get(), desc.HS.Get(), desc.DS.Get(), desc.GS.Get(), desc.PS.Get() })
+		AddShader(Hasher, Shader, shaders);
+	AddState(Hasher, desc.renderState);
+	Hasher.Add(desc.shadingRateState.enabled);
+	Hasher.Add(desc.shadingRateState.shadingRate);
+	Hasher.Add(desc.shadingRateState.pipelinePrimitiveCombiner);
+	Hasher.Add(desc.shadingRateState.imageCombiner);
+	AddLayouts(Hasher, desc.bindingLayouts);
+	AddFramebuffer(Hasher, framebuffer);
+	return { desc, framebuffer, Hasher.Get() };
+}
+
+ComputePipelineLookup MakePipelineLookup(const nvrhi::ComputePipelineDesc& desc, ShaderHashCache& shaders)
+{
+	KeyHasher Hasher;
+	AddShader(Hasher, desc.CS, shaders);
+	AddLayouts(Hasher, desc.bindingLayouts);
+	return { desc, Hasher.Get() };
+}
+
+MeshletPipelineLookup MakePipelineLookup(const nvrhi::MeshletPipelineDesc& desc, const nvrhi::FramebufferInfo& framebuffer, ShaderHashCache& shaders)
+{
+	KeyHasher Hasher;
+	Hasher.Add(desc.primType);
+	for (nvrhi::IShader* Shader : { desc.AS.Get(), desc.MS.Get(), desc.PS.Get() })
+		AddShader(Hasher, Shader, shaders);
+	AddState(Hasher, desc.renderState);
+	AddLayouts(Hasher, desc.bindingLayouts);
+	AddFramebuffer(Hasher, framebuffer);
+	return { desc, framebuffer, Hasher.Get() };
+}
+
+RaytracePipelineLookup MakePipelineLookup(const nvrhi::rt::PipelineDesc& desc, ShaderHashCache& shaders)
+{
+	KeyHasher Hasher;
+	Hasher.Add(static_cast<uint32_t>(desc.shaders.size()));
+	for (const nvrhi::rt::PipelineShaderDesc& Shader : desc.shaders)
+	{
+		Hasher.Add(Shader.exportName);
+		AddShader(Hasher, Shader.shader, shaders);
+		AddLayout(Hasher, Shader.bindingLayout);
+	}
+	Hasher.Add(static_cast<uint32_t>(desc.hitGroups.size()));
+	for (const nvrhi::rt::PipelineHitGroupDesc& Group : desc.hitGroups)
+	{
+		Hasher.Add(Group.exportName);
+		AddShader(Hasher, Group.closestHitShader, shaders);
+		AddShader(Hasher, Group.anyHitShader, shaders);
+		AddShader(Hasher, Group.intersectionShader, shaders);
+		AddLayout(Hasher, Group.bindingLayout);
+		Hasher.Add(Group.isProceduralPrimitive);
+	}
+	AddLayouts(Hasher, desc.globalBindingLayouts);
+	Hasher.Add(desc.maxPayloadSize);
+	Hasher.Add(desc.maxAttributeSize);
+	Hasher.Add(desc.maxRecursionDepth);
+	Hasher.Add(desc.hlslExtensionsUAV);
+	return { desc, Hasher.Get() };
+}
+
+BindingLayoutLookup MakeBindingLayoutLookup(const nvrhi::BindingLayoutDesc& desc)
+{
+	KeyHasher Hasher;
+	AddLayoutDesc(Hasher, desc);
+	return { desc, Hasher.Get() };
+}
+
+namespace
+{
+	//stand ins for the device objects, the keys only ever look at their descs and bytecode
+	class FakeShader : public nvrhi::RefCounter<nvrhi::IShader>
+	{
+	public:
+		FakeShader(nvrhi::ShaderType type, const std::string& name, std::vector<uint8_t> bytecode) : Bytecode(std::move(bytecode))
+		{
+			Desc.shaderType = type;
+			Desc.debugName = name;
+		}
+		const nvrhi::ShaderDesc& getDesc() const override { return Desc; }
+		void getBytecode(const void** ppBytecode, size_t* pSize) const override
+		{
+			*ppBytecode = Bytecode.data();
+			*pSize = Bytecode.size();
+		}
+
+	private:
+		nvrhi::ShaderDesc Desc;
+		std::vector<uint8_t> Bytecode;
+	};
+
+	class FakeBindingLayout : public nvrhi::RefCounter<nvrhi::IBindingLayout>
+	{
+	public:
+		explicit FakeBindingLayout(const nvrhi::BindingLayoutDesc& desc) : Desc(desc) {}
+		const nvrhi::BindingLayoutDesc* getDesc() const override { return &Desc; }
+		const nvrhi::BindlessLayoutDesc* getBindlessDesc() const override { return nullptr; }
+
+	private:
+		nvrhi::BindingLayoutDesc Desc;
+	};
+
+	//the same seed gives the same bytecode, what compiling an unchanged source twice gives
+	//flipping a byte is what a small edit to the source looks like
+	nvrhi::ShaderHandle MakeFakeShader(nvrhi::ShaderType type, const std::string& name, uint32_t seed, size_t size = 4096, size_t flippedByte = SIZE_MAX)
+	{
+		std::vector<uint8_t> Bytecode(size);
+		std::mt19937 Rng(seed);
+		for (uint8_t& Byte : Bytecode)
+			Byte = static_cast<uint8_t>(Rng());
+		if (flippedByte < size)
+			Bytecode[flippedByte] ^= 1;
+		return nvrhi::ShaderHandle::Create(new FakeShader(type, name, std::move(Bytecode)));
+	}
+
+	nvrhi::BindingLayoutHandle MakeFakeLayout(const nvrhi::BindingLayoutDesc& desc)
+	{
+		return nvrhi::BindingLayoutHandle::Create(new FakeBindingLayout(desc));
+	}
+
+	nvrhi::BindingLayoutDesc MakeLayoutDesc(std::initializer_list<nvrhi::BindingLayoutItem> items)
+	{
+		nvrhi::BindingLayoutDesc Desc;
+		Desc.visibility = nvrhi::ShaderType::All;
+		for (const nvrhi::BindingLayoutItem& Item : items)
+			Desc.bindings.push_back(Item);
+		return Desc;
+	}
+}
+
+bool VerifyPipelineKeys()
+{
+	bool bSuccess = true;
+	auto Check = [&bSuccess](bool bCondition, const std::string& what) {
+		if (!bCondition)
+		{
+			RD_CORE_ERROR("Pipeline key check failed: {}", what);
+			bSuccess = false;
+		}
+	};
+	//every variant has to differ from the base and from every other variant, in the key and in the hash
+	auto CheckVariants = [&Check](const char* kind, const auto& base, const auto& variants) {
+		std::unordered_set<uint64_t> Hashes{ base.Hash };
+		for (const auto& [What, Key] : variants)
+		{
+			Check(!(Key == base), fmt::format("{} {} shares the key of the base", kind, What));
+			Check(Hashes.insert(Key.Hash).second, fmt::format("{} {} shares its hash with another variant", kind, What));
+		}
+		return static_cast<uint32_t>(variants.size());
+	};
+	ShaderHashCache Shaders;
+
+	const nvrhi::ShaderHandle VS = MakeFakeShader(nvrhi::ShaderType::Vertex, "Fullscreen.vs.cso", 1);
+	const nvrhi::ShaderHandle PS = MakeFakeShader(nvrhi::ShaderType::Pixel, "DeferredLight.ps.cso", 2);
+	//what RecompileShaders hands out after an edit, the same name with different bytecode
+	const nvrhi::ShaderHandle PSEdited = MakeFakeShader(nvrhi::ShaderType::Pixel, "DeferredLight.ps.cso", 2, 4096, 100);
+	//and without an edit, the same name and bytecode in a new object
+	const nvrhi::ShaderHandle PSRebuilt = MakeFakeShader(nvrhi::ShaderType::Pixel, "DeferredLight.ps.cso", 2);
+	const nvrhi::BindingLayoutDesc LayoutDesc = MakeLayoutDesc({
+		nvrhi::BindingLayoutItem::ConstantBuffer(1),
+		nvrhi::BindingLayoutItem::Texture_SRV(0),
+		nvrhi::BindingLayoutItem::Texture_SRV(1),
+		nvrhi::BindingLayoutItem::StructuredBuffer_SRV(2) });
+	const nvrhi::BindingLayoutHandle Layout = MakeFakeLayout(LayoutDesc);
+	const nvrhi::BindingLayoutHandle LayoutCopy = MakeFakeLayout(LayoutDesc);
+	const nvrhi::BindingLayoutHandle LayoutMoved = MakeFakeLayout(MakeLayoutDesc({
+		nvrhi::BindingLayoutItem::ConstantBuffer(1),
+		nvrhi::BindingLayoutItem::Texture_SRV(0),
+		nvrhi::BindingLayoutItem::Texture_SRV(1),
+		nvrhi::BindingLayoutItem::StructuredBuffer_SRV(3) }));
+	const nvrhi::BindingLayoutHandle Samplers = MakeFakeLayout(MakeLayoutDesc({ nvrhi::BindingLayoutItem::Sampler(0) }));
+
+	nvrhi::FramebufferInfo Framebuffer;
+	Framebuffer.colorFormats.push_back(nvrhi::Format::RGBA16_FLOAT);
+
+	//graphics
+	uint32_t GraphicsCount = 0;
+	{
+		nvrhi::GraphicsPipelineDesc Base;
+		Base.VS = VS;
+		Base.PS = PS;
+		Base.addBindingLayout(Layout);
+		Base.addBindingLayout(Samplers);
+		Base.renderState.depthStencilState.depthTestEnable = false;
+		Base.renderState.rasterState.cullMode = nvrhi::RasterCullMode::None;
+		const GraphicsPipelineKey BaseKey = MakePipelineKey(Base, Framebuffer, Shaders);
+		Check(BaseKey == MakePipelineKey(Base, Framebuffer, Shaders), "the same graphics desc twice");
+
+		std::vector<std::pair<const char*, GraphicsPipelineKey>> Variants;
+		auto Variant = [&](const char* what, auto&& change) {
+			nvrhi::GraphicsPipelineDesc Desc = Base;
+			nvrhi::FramebufferInfo Info = Framebuffer;
+			change(Desc, Info);
+			Variants.emplace_back(what, MakePipelineKey(Desc, Info, Shaders));
+		};
+		using Desc = nvrhi::GraphicsPipelineDesc;
+		using Info = nvrhi::FramebufferInfo;
+		Variant("edited pixel shader", [&](Desc& d, Info&) { d.PS = PSEdited; });
+		Variant("no pixel shader", [](Desc& d, Info&) { d.PS = nullptr; });
+		Variant("shaders swapped", [&](Desc& d, Info&) { d.VS = PS; d.PS = VS; });
+		Variant("binding slot moved", [&](Desc& d, Info&) { d.bindingLayouts[0] = LayoutMoved; });
+		Variant("binding layouts swapped", [&](Desc& d, Info&) { std::swap(d.bindingLayouts[0], d.bindingLayouts[1]); });
+		Variant("binding layout dropped", [](Desc& d, Info&) { d.bindingLayouts.pop_back(); });
+		Variant("write mask of the last target", [](Desc& d, Info&) { d.renderState.blendState.targets[nvrhi::c_MaxRenderTargets - 1].colorWriteMask = nvrhi::ColorMask::Red; });
+		Variant("blend enabled", [](Desc& d, Info&) { d.renderState.blendState.targets[0].blendEnable = true; });
+		Variant("alpha to coverage", [](Desc& d, Info&) { d.renderState.blendState.alphaToCoverageEnable = true; });
+		Variant("depth func", [](Desc& d, Info&) { d.renderState.depthStencilState.depthFunc = nvrhi::ComparisonFunc::Greater; });
+		Variant("back face stencil pass op", [](Desc& d, Info&) { d.renderState.depthStencilState.backFaceStencil.passOp = nvrhi::StencilOp::Replace; });
+		Variant("stencil write mask", [](Desc& d, Info&) { d.renderState.depthStencilState.stencilWriteMask = 0x7f; });
+		Variant("cull mode", [](Desc& d, Info&) { d.renderState.rasterState.cullMode = nvrhi::RasterCullMode::Front; });
+		Variant("depth bias", [](Desc& d, Info&) { d.renderState.rasterState.depthBias = 1; });
+		Variant("slope scaled depth bias", [](Desc& d, Info&) { d.renderState.rasterState.slopeScaledDepthBias = 0.5f; });
+		Variant("last sample position", [](Desc& d, Info&) { d.renderState.rasterState.samplePositionsY[15] = 1; });
+		Variant("single pass stereo", [](Desc& d, Info&) { d.renderState.singlePassStereo.enabled = true; });
+		Variant("shading rate", [](Desc& d, Info&) { d.shadingRateState.shadingRate = nvrhi::VariableShadingRate::e2x2; });
+		Variant("primitive type", [](Desc& d, Info&) { d.primType = nvrhi::PrimitiveType::TriangleStrip; });
+		Variant("patch control points", [](Desc& d, Info&) { d.patchControlPoints = 3; });
+		Variant("color format", [](Desc&, Info& i) { i.colorFormats[0] = nvrhi::Format::RGBA8_UNORM; });
+		Variant("extra render target", [](Desc&, Info& i) { i.colorFormats.push_back(nvrhi::Format::RGBA16_FLOAT); });
+		Variant("depth format", [](Desc&, Info& i) { i.depthFormat = nvrhi::Format::D32; });
+		Variant("sample count", [](Desc&, Info& i) { i.sampleCount = 4; });
+		GraphicsCount = CheckVariants("graphics", BaseKey, Variants);
+
+		//same content in new objects hashes the same, the hash does not depend on addresses, but the objects still tell the keys apart
+		Desc Rebuilt = Base;
+		Rebuilt.PS = PSRebuilt;
+		Rebuilt.bindingLayouts[0] = LayoutCopy;
+		const GraphicsPipelineKey RebuiltKey = MakePipelineKey(Rebuilt, Framebuffer, Shaders);
+		Check(RebuiltKey.Hash == BaseKey.Hash, "a rebuilt shader and layout with the same content hash the same");
+		Check(!(RebuiltKey == BaseKey), "a rebuilt shader and layout are new objects");
+
+		//a collision only costs a pipeline, both keys keep their own, one bucket so they share a chain as well
+		ConcurrentCache<GraphicsPipelineKey, int> Cache(1);
+		const GraphicsPipelineKey& Other = Variants.front().second;
+		const GraphicsPipelineLookup BaseLookup{ Base, Framebuffer, BaseKey.Hash };
+		const GraphicsPipelineLookup CollidingLookup{ Other.Desc, Other.Framebuffer, BaseKey.Hash };
+		Cache.Get(BaseLookup, []() { return 1; });
+		Cache.Get(CollidingLookup, []() { return 2; });
+		Check(Cache.GetSize() == 2 && Cache.Get(BaseLookup, []() { return 0; }) == 1 && Cache.Get(CollidingLookup, []() { return 0; }) == 2, "colliding hashes keep their own pipelines");
+	}
+
+	//compute
+	uint32_t ComputeCount = 0;
+	{
+		const nvrhi::ShaderHandle CS = MakeFakeShader(nvrhi::ShaderType::Compute, "InstanceCull.cs.cso", 3);
+		nvrhi::ComputePipelineDesc Base;
+		Base.CS = CS;
+		Base.addBindingLayout(Layout);
+		const ComputePipelineKey BaseKey = MakePipelineKey(Base, Shaders);
+		Check(BaseKey == MakePipelineKey(Base, Shaders), "the same compute desc twice");
+
+		std::vector<std::pair<const char*, ComputePipelineKey>> Variants;
+		auto Variant = [&](const char* what, auto&& change) {
+			nvrhi::ComputePipelineDesc Desc = Base;
+			change(Desc);
+			Variants.emplace_back(what, MakePipelineKey(Desc, Shaders));
+		};
+		Variant("edited shader", [](nvrhi::ComputePipelineDesc& d) { d.CS = MakeFakeShader(nvrhi::ShaderType::Compute, "InstanceCull.cs.cso", 3, 4096, 4095); });
+		Variant("binding slot moved", [&](nvrhi::ComputePipelineDesc& d) { d.bindingLayouts[0] = LayoutMoved; });
+		Variant("extra binding layout", [&](nvrhi::ComputePipelineDesc& d) { d.addBindingLayout(Samplers); });
+		Variant("no binding layout", [](nvrhi::ComputePipelineDesc& d) { d.bindingLayouts.pop_back(); });
+		ComputeCount = CheckVariants("compute", BaseKey, Variants);
+	}
+
+	//meshlet
+	uint32_t MeshletCount = 0;
+	{
+		const nvrhi::ShaderHandle MS = MakeFakeShader(nvrhi::ShaderType::Mesh, "Meshlet.ms.cso", 4);
+		nvrhi::MeshletPipelineDesc Base;
+		Base.MS = MS;
+		Base.PS = PS;
+		Base.addBindingLayout(Layout);
+		const MeshletPipelineKey BaseKey = MakePipelineKey(Base, Framebuffer, Shaders);
+		Check(BaseKey == MakePipelineKey(Base, Framebuffer, Shaders), "the same meshlet desc twice");
+
+		std::vector<std::pair<const char*, MeshletPipelineKey>> Variants;
+		auto Variant = [&](const char* what, auto&& change) {
+			nvrhi::MeshletPipelineDesc Desc = Base;
+			nvrhi::FramebufferInfo Info = Framebuffer;
+			change(Desc, Info);
+			Variants.emplace_back(what, MakePipelineKey(Desc, Info, Shaders));
+		};
+		using Desc = nvrhi::MeshletPipelineDesc;
+		using Info = nvrhi::FramebufferInfo;
+		Variant("edited pixel shader", [&](Desc& d, Info&) { d.PS = PSEdited; });
+		Variant("amplification shader", [&](Desc& d, Info&) { d.AS = MakeFakeShader(nvrhi::ShaderType::Amplification, "Meshlet.as.cso", 5); });
+		Variant("cull mode", [](Desc& d, Info&) { d.renderState.rasterState.cullMode = nvrhi::RasterCullMode::None; });
+		Variant("depth write", [](Desc& d, Info&) { d.renderState.depthStencilState.depthWriteEnable = false; });
+		Variant("depth format", [](Desc&, Info& i) { i.depthFormat = nvrhi::Format::D32; });
+		MeshletCount = CheckVariants("meshlet", BaseKey, Variants);
+	}
+
+	//raytrace
+	uint32_t RaytraceCount = 0;
+	{
+		const nvrhi::ShaderHandle RayGen = MakeFakeShader(nvrhi::ShaderType::RayGeneration, "Shadow.lib.cso", 6);
+		const nvrhi::ShaderHandle Miss = MakeFakeShader(nvrhi::ShaderType::Miss, "Shadow.lib.cso", 7);
+		const nvrhi::ShaderHandle Hit = MakeFakeShader(nvrhi::ShaderType::ClosestHit, "Shadow.lib.cso", 8);
+		nvrhi::rt::PipelineDesc Base;
+		Base.shaders = { { "RayGen", RayGen, nullptr }, { "Miss", Miss, nullptr } };
+		Base.hitGroups = { { "HitGroup", Hit, nullptr, nullptr, nullptr, false } };
+		Base.globalBindingLayouts = { Layout, Samplers };
+		Base.maxPayloadSize = 4;
+		const RaytracePipelineKey BaseKey = MakePipelineKey(Base, Shaders);
+		Check(BaseKey == MakePipelineKey(Base, Shaders), "the same raytrace desc twice");
+
+		std::vector<std::pair<const char*, RaytracePipelineKey>> Variants;
+		auto Variant = [&](const char* what, auto&& change) {
+			nvrhi::rt::PipelineDesc Desc = Base;
+			change(Desc);
+			Variants.emplace_back(what, MakePipelineKey(Desc, Shaders));
+		};
+		using Desc = nvrhi::rt::PipelineDesc;
+		Variant("export renamed", [](Desc& d) { d.shaders[1].exportName = "ShadowMiss"; });
+		Variant("shaders swapped", [](Desc& d) { std::swap(d.shaders[0], d.shaders[1]); });
+		Variant("procedural hit group", [](Desc& d) { d.hitGroups[0].isProceduralPrimitive = true; });
+		Variant("any hit shader", [&](Desc& d) { d.hitGroups[0].anyHitShader = Hit; });
+		Variant("local binding layout", [&](Desc& d) { d.shaders[0].bindingLayout = Samplers; });
+		Variant("global binding layouts swapped", [](Desc& d) { std::swap(d.globalBindingLayouts[0], d.globalBindingLayouts[1]); });
+		Variant("payload size", [](Desc& d) { d.maxPayloadSize = 8; });
+		Variant("attribute size", [](Desc& d) { d.maxAttributeSize = 12; });
+		Variant("recursion depth", [](Desc& d) { d.maxRecursionDepth = 2; });
+		RaytraceCount = CheckVariants("raytrace", BaseKey, Variants);
+	}
+
+	//binding layouts
+	uint32_t LayoutCount = 0;
+	{
+		nvrhi::BindingLayoutDesc Base = LayoutDesc;
+		Base.bindings.push_back(nvrhi::BindingLayoutItem::PushConstants(2, 16));
+		const BindingLayoutKey BaseKey = MakeBindingLayoutKey(Base);
+		Check(BaseKey == MakeBindingLayoutKey(Base), "the same binding layout desc twice");
+
+		std::vector<std::pair<const char*, BindingLayoutKey>> Variants;
+		auto Variant = [&](const char* what, auto&& change) {
+			nvrhi::BindingLayoutDesc Desc = Base;
+			change(Desc);
+			Variants.emplace_back(what, MakeBindingLayoutKey(Desc));
+		};
+		using Desc = nvrhi::BindingLayoutDesc;
+		Variant("visibility", [](Desc& d) { d.visibility = nvrhi::ShaderType::Pixel; });
+		Variant("register space", [](Desc& d) { d.registerSpace = 1; });
+		Variant("slot", [](Desc& d) { d.bindings[1].slot = 5; });
+		Variant("resource type", [](Desc& d) { d.bindings[1].type = nvrhi::ResourceType::Texture_UAV; });
+		Variant("push constant size", [](Desc& d) { d.bindings.back().size = 32; });
+		Variant("bindings swapped", [](Desc& d) { std::swap(d.bindings[1], d.bindings[2]); });
+		Variant("binding dropped", [](Desc& d) { d.bindings.pop_back(); });
+		LayoutCount = CheckVariants("binding layout", BaseKey, Variants);
+	}
+
+	if (bSuccess)
+		RD_CORE_INFO("Pipeline key checks passed, {} graphics, {} compute, {} meshlet, {} raytrace and {} binding layout variants each got their own key", GraphicsCount, ComputeCount, MeshletCount, RaytraceCount, LayoutCount);
+	return bSuccess;
+}
+
+namespace
+{
+	//about what a frame of the renderer asks for, every pass builds its descs on the spot and looks them up
+	//a few vertex shaders shared between passes, a pixel shader and a binding layout of their own
+	struct FrameDescs
+	{
+		std::vector<nvrhi::ShaderHandle> Shaders;
+		std::vector<nvrhi::BindingLayoutDesc> LayoutDescs;
+		std::vector<nvrhi::GraphicsPipelineDesc> Descs;
+		nvrhi::FramebufferInfo Framebuffer;
+	};
+
+	FrameDescs MakeFrameDescs(uint32_t pipelineCount)
+	{
+		FrameDescs Frame;
+		constexpr uint32_t VertexShaderCount = 4;
+		for (uint32_t i = 0; i < VertexShaderCount; ++i)
+			Frame.Shaders.push_back(MakeFakeShader(nvrhi::ShaderType::Vertex, fmt::format("Pass{}.vs.cso", i), i, 8 << 10));
+		for (uint32_t i = 0; i < pipelineCount; ++i)
+		{
+			nvrhi::BindingLayoutDesc LayoutDesc = MakeLayoutDesc({ nvrhi::BindingLayoutItem::ConstantBuffer(i) });
+			for (uint32_t Slot = 0; Slot < 2 + i % 6; ++Slot)
+				LayoutDesc.bindings.push_back(nvrhi::BindingLayoutItem::Texture_SRV(Slot));
+			Frame.LayoutDescs.push_back(LayoutDesc);
+
+			nvrhi::GraphicsPipelineDesc Desc;
+			Desc.VS = Frame.Shaders[i % VertexShaderCount];
+			Desc.PS = Frame.Shaders.emplace_back(MakeFakeShader(nvrhi::ShaderType::Pixel, fmt::format("Pass{}.ps.cso", i), 100 + i, 32 << 10));
+			Desc.addBindingLayout(MakeFakeLayout(LayoutDesc));
+			Desc.renderState.rasterState.cullMode = i % 2 ? nvrhi::RasterCullMode::None : nvrhi::RasterCullMode::Back;
+			Desc.renderState.depthStencilState.depthTestEnable = i % 3 != 0;
+			Frame.Descs.push_back(Desc);
+		}
+		Frame.Framebuffer.colorFormats.push_back(nvrhi::Format::RGBA16_FLOAT);
+		Frame.Framebuffer.depthFormat = nvrhi::Format::D32;
+		return Frame;
+	}
+
+	struct KeyHash
+	{
+		template<typename T>
+		size_t operator()(const T& key) const { return static_cast<size_t>(key.Hash); }
+	};
+}
+
+bool VerifyPipelineCache()
+{
+	constexpr uint32_t ThreadCount = 8;
+	constexpr uint32_t PipelineCount = 64;
+	constexpr uint32_t RoundCount = 50;
+	const FrameDescs Frame = MakeFrameDescs(PipelineCount);
+
+	ShaderHashCache Shaders;
+	ConcurrentCache<GraphicsPipelineKey, uint32_t> Pipelines;
+	ConcurrentCache<BindingLayoutKey, uint32_t> Layouts;
+	std::vector<std::atomic<uint32_t>> PipelineCreates(PipelineCount), LayoutCreates(PipelineCount);
+	std::atomic<uint32_t> NextId{ 1 };
+	std::atomic<uint32_t> Mismatches{};
+	//what every thread got for every desc, pipelines first and layouts after
+	std::vector<std::vector<uint32_t>> Seen(ThreadCount, std::vector<uint32_t>(PipelineCount * 2));
+	std::latch Start(ThreadCount);
+
+	std::vector<std::thread> Threads;
+	for (uint32_t t = 0; t < ThreadCount; ++t)
+	{
+		Threads.emplace_back([&, t]() {
+			std::vector<uint32_t> Order(PipelineCount);
+			std::iota(Order.begin(), Order.end(), 0);
+			std::mt19937 Rng(t);
+			Start.arrive_and_wait();
+			for (uint32_t Round = 0; Round < RoundCount; ++Round)
+			{
+				std::shuffle(Order.begin(), Order.end(), Rng);
+				for (uint32_t i : Order)
+				{
+					const uint32_t Layout = Layouts.Get(MakeBindingLayoutLookup(Frame.LayoutDescs[i]), [&]() {
+						LayoutCreates[i].fetch_add(1);
+						return NextId.fetch_add(1);
+					});
+					const uint32_t Pipeline = Pipelines.Get(MakePipelineLookup(Frame.Descs[i], Frame.Framebuffer, Shaders), [&]() {
+						PipelineCreates[i].fetch_add(1);
+						//about what a driver takes for a small pipeline, long enough for the other threads to pile up on it
+						std::this_thread::sleep_for(std::chrono::microseconds(500));
+						return NextId.fetch_add(1);
+					});
+					if (Round == 0)
+					{
+						Seen[t][i] = Pipeline;
+						Seen[t][PipelineCount + i] = Layout;
+					}
+					else if (Seen[t][i] != Pipeline || Seen[t][PipelineCount + i] != Layout)
+						Mismatches.fetch_add(1);
+				}
+			}
+		});
+	}
+	for (std::thread& Thread : Threads)
+		Thread.join();
+
+	bool bSuccess = true;
+	auto Check = [&bSuccess](bool bCondition, const std::string& what) {
+		if (!bCondition)
+		{
+			RD_CORE_ERROR("Pipeline cache check failed: {}", what);
+			bSuccess = false;
+		}
+	};
+	for (uint32_t i = 0; i < PipelineCount; ++i)
+	{
+		Check(PipelineCreates[i] == 1, fmt::format("pipeline {} was created {} times", i, PipelineCreates[i].load()));
+		Check(LayoutCreates[i] == 1, fmt::format("binding layout {} was created {} times", i, LayoutCreates[i].load()));
+	}
+	for (uint32_t t = 1; t < ThreadCount; ++t)
+		Check(Seen[t] == Seen[0], fmt::format("thread {} got other pipelines than thread 0", t));
+	Check(Mismatches == 0, fmt::format("{} lookups returned another pipeline than the first lookup of the same desc", Mismatches.load()));
+	Check(Pipelines.GetSize() == PipelineCount && Layouts.GetSize() == PipelineCount, "the caches hold more than one entry per desc");
+	Check(Shaders.GetSize() == Frame.Shaders.size(), "the shader hashes hold more than one entry per shader");
+
+	//a failed create is not cached, the shader may be fixed and the next lookup has to try again
+	{
+		ConcurrentCache<BindingLayoutKey, std::shared_ptr<uint32_t>> Handles;
+		const BindingLayoutLookup Lookup = MakeBindingLayoutLookup(Frame.LayoutDescs[0]);
+		Check(!Handles.Get(Lookup, []() { return std::shared_ptr<uint32_t>(); }) && Handles.GetSize() == 0, "a null create is cached");
+		Check(Handles.Get(Lookup, []() { return std::make_shared<uint32_t>(1); }) && Handles.GetSize() == 1, "a lookup after a null create does not create again");
+
+		//the waiter has to wake up when the create it waits on throws, and the exception has to reach the creator
+		const BindingLayoutLookup Throwing = MakeBindingLayoutLookup(Frame.LayoutDescs[1]);
+		std::latch Started(2);
+		bool bThrown = false;
+		std::thread Creator([&]() {
+			try
+			{
+				Handles.Get(Throwing, [&]() -> std::shared_ptr<uint32_t> {
+					Started.arrive_and_wait();
+					std::this_thread::sleep_for(std::chrono::milliseconds(20));
+					throw std::runtime_error("compile failed");
+				});
+			}
+			catch (const std::runtime_error&)
+			{
+				bThrown = true;
+			}
+		});
+		Started.arrive_and_wait();
+		//either woken with null by the failure, or late enough to create it itself
+		const std::shared_ptr<uint32_t> Waited = Handles.Get(Throwing, []() { return std::make_shared<uint32_t>(2); });
+		Creator.join();
+		Check(bThrown, "the exception of a create did not reach its caller");
+		Check(!Waited || *Waited == 2, "a lookup waiting on a throwing create got a value");
+		const std::shared_ptr<uint32_t> Retried = Handles.Get(Throwing, []() { return std::make_shared<uint32_t>(3); });
+		Check(Retried && *Retried == (Waited ? 2u : 3u), "a lookup after a throwing create does not create again");
+	}
+	if (bSuccess)
+		RD_CORE_INFO("Pipeline cache checks passed, {} threads made {} lookups and each of the {} pipelines and layouts was created once, {} lookups waited on a creation in flight",
+			ThreadCount, size_t(ThreadCount) * RoundCount * PipelineCount * 2, PipelineCount, Pipelines.GetWaits() + Layouts.GetWaits());
+	return bSuccess;
+}
+
+void BenchmarkPipelineLookup()
+{
+	constexpr uint32_t PipelineCount = 48;
+	constexpr uint32_t FrameCount = 1000;
+	using Clock = std::chrono::high_resolution_clock;
+	const FrameDescs Frame = MakeFrameDescs(PipelineCount);
+
+	ShaderHashCache Shaders;
+	ConcurrentCache<GraphicsPipelineKey, uint32_t> Pipelines;
+	ConcurrentCache<BindingLayoutKey, uint32_t> Layouts;
+	//what the asset manager had before, one map behind its mutex and a desc copied into a key for every lookup
+	std::mutex Mutex;
+	std::unordered_map<GraphicsPipelineKey, uint32_t, KeyHash> LockedPipelines;
+	std::unordered_map<BindingLayoutKey, uint32_t, KeyHash> LockedLayouts;
+
+	//the first frame hashes the bytecode of every shader, GetShader does that when it loads them
+	Clock::time_point Start = Clock::now();
+	for (uint32_t i = 0; i < PipelineCount; ++i)
+	{
+		Layouts.Get(MakeBindingLayoutLookup(Frame.LayoutDescs[i]), [i]() { return i + 1; });
+		Pipelines.Get(MakePipelineLookup(Frame.Descs[i], Frame.Framebuffer, Shaders), [i]() { return i + 1; });
+	}
+	const double FirstMs = std::chrono::duration<double, std::milli>(Clock::now() - Start).count();
+	for (uint32_t i = 0; i < PipelineCount; ++i)
+	{
+		LockedLayouts[MakeBindingLayoutKey(Frame.LayoutDescs[i])] = i + 1;
+		LockedPipelines[MakePipelineKey(Frame.Descs[i], Frame.Framebuffer, Shaders)] = i + 1;
+	}
+
+	//a binding layout and a pipeline per pass, the way every pass asks for them
+	auto LockedFrame = [&]() {
+		uint32_t Hits = 0;
+		for (uint32_t i = 0; i < PipelineCount; ++i)
+		{
+			BindingLayoutKey LayoutKey = MakeBindingLayoutKey(Frame.LayoutDescs[i]);
+			GraphicsPipelineKey PipelineKey = MakePipelineKey(Frame.Descs[i], Frame.Framebuffer, Shaders);
+			std::lock_guard<std::mutex> Lock(Mutex);
+			Hits += LockedLayouts.contains(LayoutKey) ? 1 : 0;
+			Hits += LockedPipelines.contains(PipelineKey) ? 1 : 0;
+		}
+		return Hits;
+	};
+	auto CachedFrame = [&]() {
+		uint32_t Hits = 0;
+		for (uint32_t i = 0; i < PipelineCount; ++i)
+		{
+			Hits += Layouts.Get(MakeBindingLayoutLookup(Frame.LayoutDescs[i]), []() { return 0u; }) != 0 ? 1 : 0;
+			Hits += Pipelines.Get(MakePipelineLookup(Frame.Descs[i], Frame.Framebuffer, Shaders), []() { return 0u; }) != 0 ? 1 : 0;
+		}
+		return Hits;
+	};
+	//lookups a second over every thread
+	auto Run = [&](uint32_t threadCount, auto&& frame) {
+		std::atomic<uint64_t> Hits{};
+		std::latch Ready(threadCount + 1);
+		std::vector<std::thread> Threads;
+		for (uint32_t t = 0; t < threadCount; ++t)
+		{
+			Threads.emplace_back([&]() {
+				Ready.arrive_and_wait();
+				uint64_t ThreadHits = 0;
+				for (uint32_t FrameIndex = 0; FrameIndex < FrameCount; ++FrameIndex)
+					ThreadHits += frame();
+				Hits.fetch_add(ThreadHits);
+			});
+		}
+		Ready.arrive_and_wait();
+		const Clock::time_point RunStart = Clock::now();
+		for (std::thread& Thread : Threads)
+			Thread.join();
+		const double Seconds = std::chrono::duration<double>(Clock::now() - RunStart).count();
+		const uint64_t Lookups = uint64_t(threadCount) * FrameCount * PipelineCount * 2;
+		if (Hits != Lookups)
+			RD_CORE_WARN("Only {} of {} lookups hit", Hits.load(), Lookups);
+		return Lookups / Seconds;
+	};
+
+	RD_CORE_INFO("Pipeline lookup of {} binding layouts and pipelines a frame over {} frames per thread, {} shaders hashed in {:.2f}ms on first use, {} hardware threads",
+		PipelineCount, FrameCount, Shaders.GetSize(), FirstMs, std::thread::hardware_concurrency());
+	for (uint32_t ThreadCount : { 1u, 2u, 4u, 8u, 16u })
+	{
+		const double Locked = Run(ThreadCount, LockedFrame);
+		const double Cached = Run(ThreadCount, CachedFrame);
+		RD_CORE_INFO("  {:>2} threads: locked map {:.2f}M lookups/s, concurrent cache {:.2f}M lookups/s, {:.1f}x, a frame takes {:.1f}us against {:.1f}us",
+			ThreadCount, Locked / 1e6, Cached / 1e6, Cached / Locked, 2e6 * PipelineCount * ThreadCount / Cached, 2e6 * PipelineCount * ThreadCount / Locked);
+	}
+}
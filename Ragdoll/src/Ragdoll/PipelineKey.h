@@ -0,0 +1,135 @@
+#pragma once
+#include <nvrhi/nvrhi.h>
+#include "Ragdoll/ConcurrentCache.h"
+
+//bytecode hashes of the shaders pipelines are made of, so a recompiled shader never matches the pipelines of the one it replaced
+//keeps a reference to every shader it has hashed, an address can not be reused by another shader while it is cached
+class ShaderHashCache
+{
+public:
+	//hashes the bytecode the first time a shader is seen, 0 for no shader
+	uint64_t Get(nvrhi::IShader* shader);
+	//only while nothing is building keys
+	void Clear() { Hashes.Clear(); }
+	//only while nothing is building keys, lets go of the shaders pred is true for
+	template<typename Pred>
+	void EraseIf(Pred&& pred) { Hashes.EraseIf([&pred](const nvrhi::ShaderHandle& shader, uint64_t) { return pred(shader.Get()); }); }
+	size_t GetSize() const { return Hashes.GetSize(); }
+
+private:
+	ConcurrentCache<nvrhi::ShaderHandle, uint64_t> Hashes;
+};
+
+//everything a pipeline is created from, two keys are only equal when both descs would create the same pipeline
+//shaders, binding layouts and input layouts compare by object, render state, formats and values field by field
+//Hash is a 64 bit content hash of the shader bytecode, the states and the layout descs, it does not depend on any address so it is stable across runs
+struct GraphicsPipelineKey
+{
+	nvrhi::GraphicsPipelineDesc Desc;
+	nvrhi::FramebufferInfo Framebuffer;
+	uint64_t Hash{};
+
+	bool operator==(const GraphicsPipelineKey& other) const;
+};
+
+struct ComputePipelineKey
+{
+	nvrhi::ComputePipelineDesc Desc;
+	uint64_t Hash{};
+
+	bool operator==(const ComputePipelineKey& other) const;
+};
+
+struct MeshletPipelineKey
+{
+	nvrhi::MeshletPipelineDesc Desc;
+	nvrhi::FramebufferInfo Framebuffer;
+	uint64_t Hash{};
+
+	bool operator==(const MeshletPipelineKey& other) const;
+};
+
+struct RaytracePipelineKey
+{
+	nvrhi::rt::PipelineDesc Desc;
+	uint64_t Hash{};
+
+	bool operator==(const RaytracePipelineKey& other) const;
+};
+
+//binding layouts compare by their items, there are no objects in them
+struct BindingLayoutKey
+{
+	nvrhi::BindingLayoutDesc Desc;
+	uint64_t Hash{};
+
+	bool operator==(const BindingLayoutKey& other) const;
+};
+
+//a desc as the caller has it, hashed but not copied, a cache hit compares against it directly and only a miss copies it into a key
+//only valid as long as the desc it was made from
+struct GraphicsPipelineLookup
+{
+	const nvrhi::GraphicsPipelineDesc& Desc;
+	const nvrhi::FramebufferInfo& Framebuffer;
+	uint64_t Hash;
+
+	bool Matches(const GraphicsPipelineKey& key) const;
+	GraphicsPipelineKey MakeKey() const { return { Desc, Framebuffer, Hash }; }
+};
+
+struct ComputePipelineLookup
+{
+	const nvrhi::ComputePipelineDesc& Desc;
+	uint64_t Hash;
+
+	bool Matches(const ComputePipelineKey& key) const;
+	ComputePipelineKey MakeKey() const { return { Desc, Hash }; }
+};
+
+struct MeshletPipelineLookup
+{
+	const nvrhi::MeshletPipelineDesc& Desc;
+	const nvrhi::FramebufferInfo& Framebuffer;
+	uint64_t Hash;
+
+	bool Matches(const MeshletPipelineKey& key) const;
+	MeshletPipelineKey MakeKey() const { return { Desc, Framebuffer, Hash }; }
+};
+
+struct RaytracePipelineLookup
+{
+	const nvrhi::rt::PipelineDesc& Desc;
+	uint64_t Hash;
+
+	bool Matches(const RaytracePipelineKey& key) const;
+	RaytracePipelineKey MakeKey() const { return { Desc, Hash }; }
+};
+
+struct BindingLayoutLookup
+{
+	const nvrhi::BindingLayoutDesc& Desc;
+	uint64_t Hash;
+
+	bool Matches(const BindingLayoutKey& key) const;
+	BindingLayoutKey MakeKey() const { return { Desc, Hash }; }
+};
+
+GraphicsPipelineLookup MakePipelineLookup(const nvrhi::GraphicsPipelineDesc& desc, const nvrhi::FramebufferInfo& framebuffer, ShaderHashCache& shaders);
+ComputePipelineLookup MakePipelineLookup(const nvrhi::ComputePipelineDesc& desc, ShaderHashCache& shaders);
+MeshletPipelineLookup MakePipelineLookup(const nvrhi::MeshletPipelineDesc& desc, const nvrhi::FramebufferInfo& framebuffer, ShaderHashCache& shaders);
+RaytracePipelineLookup MakePipelineLookup(const nvrhi::rt::PipelineDesc& desc, ShaderHashCache& shaders);
+BindingLayoutLookup MakeBindingLayoutLookup(const nvrhi::BindingLayoutDesc& desc);
+
+inline GraphicsPipelineKey MakePipelineKey(const nvrhi::GraphicsPipelineDesc& desc, const nvrhi::FramebufferInfo& framebuffer, ShaderHashCache& shaders) { return MakePipelineLookup(desc, framebuffer, shaders).MakeKey(); }
+inline ComputePipelineKey MakePipelineKey(const nvrhi::ComputePipelineDesc& desc, ShaderHashCache& shaders) { return MakePipelineLookup(desc, shaders).MakeKey(); }
+inline MeshletPipelineKey MakePipelineKey(const nvrhi::MeshletPipelineDesc& desc, const nvrhi::FramebufferInfo& framebuffer, ShaderHashCache& shaders) { return MakePipelineLookup(desc, framebuffer, shaders).MakeKey(); }
+inline RaytracePipelineKey MakePipelineKey(const nvrhi::rt::PipelineDesc& desc, ShaderHashCache& shaders) { return MakePipelineLookup(desc, shaders).MakeKey(); }
+inline BindingLayoutKey MakeBindingLayoutKey(const nvrhi::BindingLayoutDesc& desc) { return MakeBindingLayoutLookup(desc).MakeKey(); }
+
+//builds descs that differ from each other by a single field and checks none of them share a key, returns false on any failure, needs no device
+bool VerifyPipelineKeys();
+//hammers one cache from many threads and checks every pipeline was created exactly once and everyone got the same one, needs no device
+bool VerifyPipelineCache();
+//cost of building the keys and finding a frame worth of pipelines, from one thread and then from many against the old locked map, needs no device
+void BenchmarkPipelineLookup();
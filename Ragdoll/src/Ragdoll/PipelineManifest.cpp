@@ -0,0 +1,914 @@
+#include "ragdollpch.h"
+#include "PipelineManifest.h"
+
+#include "Executor.h"
+#include "Profiler.h"
+#include "Ragdoll/Core/Hash.h"
+
+namespace
+{
+	//'RDPM'
+	constexpr uint32_t ManifestMagic = 0x4D504452;
+
+	struct ManifestHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint64_t ParamsKey;
+		uint64_t EntryCount;
+	};
+
+	//every entry is its type, the key hash, the size of its body and then the body
+	constexpr size_t EntryHeaderSize = sizeof(uint8_t) + sizeof(uint64_t) + sizeof(uint32_t);
+
+	//the render states and binding items are written as they are in memory, a build where any of them looks different can not read them
+	uint64_t GetParamsKey()
+	{
+		struct
+		{
+			uint32_t Version;
+			uint32_t RenderStateSize;
+			uint32_t ShadingRateStateSize;
+			uint32_t BindingItemSize;
+			uint32_t BindingOffsetsSize;
+			uint32_t FormatCount;
+		} Params{
+			PipelineManifest::Version,
+			sizeof(nvrhi::RenderState),
+			sizeof(nvrhi::VariableRateShadingState),
+			sizeof(nvrhi::BindingLayoutItem),
+			sizeof(nvrhi::VulkanBindingOffsets),
+			static_cast<uint32_t>(nvrhi::Format::COUNT)
+		};
+		return ragdoll::Hash64(&Params, sizeof(Params));
+	}
+
+	class ManifestWriter
+	{
+	public:
+		template<typename T>
+		void Write(const T& value)
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			const uint8_t* Bytes = reinterpret_cast<const uint8_t*>(&value);
+			Data.insert(Data.end(), Bytes, Bytes + sizeof(T));
+		}
+		void Write(const std::string& value)
+		{
+			Write(static_cast<uint32_t>(value.size()));
+			Data.insert(Data.end(), value.begin(), value.end());
+		}
+
+		std::vector<uint8_t> Data;
+	};
+
+	//reads past the end give zeroes and fail the whole entry
+	class ManifestReader
+	{
+	public:
+		ManifestReader(const uint8_t* data, size_t size) : Data(data), Size(size) {}
+
+		template<typename T>
+		T Read()
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			T Value{};
+			if (!Take(sizeof(T)))
+				return Value;
+			memcpy(&Value, Data + Offset - sizeof(T), sizeof(T));
+			return Value;
+		}
+		std::string ReadString()
+		{
+			const uint32_t Length = Read<uint32_t>();
+			if (!Take(Length))
+				return {};
+			return std::string(reinterpret_cast<const char*>(Data + Offset - Length), Length);
+		}
+		//everything was there and nothing was left over
+		bool IsComplete() const { return !bFailed && Offset == Size; }
+
+	private:
+		bool Take(size_t size)
+		{
+			if (bFailed || Size - Offset < size)
+			{
+				bFailed = true;
+				return false;
+			}
+			Offset += size;
+			return true;
+		}
+
+		const uint8_t* Data;
+		size_t Size;
+		size_t Offset{};
+		bool bFailed{};
+	};
+
+	//by file name, GetShader names every shader after its file, anything else can not be found again
+	bool WriteShader(ManifestWriter& writer, nvrhi::IShader* shader)
+	{
+		if (!shader)
+		{
+			writer.Write(std::string());
+			return true;
+		}
+		const std::string& Name = shader->getDesc().debugName;
+		writer.Write(Name);
+		return !Name.empty();
+	}
+
+	void WriteLayoutDesc(ManifestWriter& writer, const nvrhi::BindingLayoutDesc& desc)
+	{
+		writer.Write(desc.visibility);
+		writer.Write(desc.registerSpace);
+		writer.Write(desc.registerSpaceIsDescriptorSet);
+		writer.Write(desc.bindingOffsets);
+		writer.Write(static_cast<uint32_t>(desc.bindings.size()));
+		for (const nvrhi::BindingLayoutItem& Item : desc.bindings)
+			writer.Write(Item);
+	}
+
+	nvrhi::BindingLayoutDesc ReadLayoutDesc(ManifestReader& reader)
+	{
+		nvrhi::BindingLayoutDesc Desc;
+		Desc.visibility = reader.Read<nvrhi::ShaderType>();
+		Desc.registerSpace = reader.Read<uint32_t>();
+		Desc.registerSpaceIsDescriptorSet = reader.Read<bool>();
+		Desc.bindingOffsets = reader.Read<nvrhi::VulkanBindingOffsets>();
+		const uint32_t Count = reader.Read<uint32_t>();
+		for (uint32_t i = 0; i < Count && Desc.bindings.size() < Desc.bindings.max_size(); ++i)
+			Desc.bindings.push_back(reader.Read<nvrhi::BindingLayoutItem>());
+		return Desc;
+	}
+
+	enum class LayoutKind : uint8_t
+	{
+		Desc,
+		Bindless,
+	};
+
+	bool WriteLayouts(ManifestWriter& writer, const nvrhi::BindingLayoutVector& layouts, nvrhi::IBindingLayout* bindless)
+	{
+		writer.Write(static_cast<uint32_t>(layouts.size()));
+		for (const nvrhi::BindingLayoutHandle& Layout : layouts)
+		{
+			if (const nvrhi::BindingLayoutDesc* Desc = Layout ? Layout->getDesc() : nullptr)
+			{
+				writer.Write(LayoutKind::Desc);
+				WriteLayoutDesc(writer, *Desc);
+			}
+			else if (Layout && Layout == bindless)
+				writer.Write(LayoutKind::Bindless);
+			else
+				return false;
+		}
+		return true;
+	}
+
+	void WriteFramebuffer(ManifestWriter& writer, const nvrhi::FramebufferInfo& framebuffer)
+	{
+		writer.Write(static_cast<uint32_t>(framebuffer.colorFormats.size()));
+		for (nvrhi::Format Format : framebuffer.colorFormats)
+			writer.Write(Format);
+		writer.Write(framebuffer.depthFormat);
+		writer.Write(framebuffer.sampleCount);
+		writer.Write(framebuffer.sampleQuality);
+	}
+
+	nvrhi::FramebufferInfo ReadFramebuffer(ManifestReader& reader)
+	{
+		nvrhi::FramebufferInfo Framebuffer;
+		const uint32_t Count = reader.Read<uint32_t>();
+		for (uint32_t i = 0; i < Count && Framebuffer.colorFormats.size() < Framebuffer.colorFormats.max_size(); ++i)
+			Framebuffer.colorFormats.push_back(reader.Read<nvrhi::Format>());
+		Framebuffer.depthFormat = reader.Read<nvrhi::Format>();
+		Framebuffer.sampleCount = reader.Read<uint32_t>();
+		Framebuffer.sampleQuality = reader.Read<uint32_t>();
+		return Framebuffer;
+	}
+}
+
+void PipelineManifest::Record(const GraphicsPipelineLookup& lookup)
+{
+	const nvrhi::GraphicsPipelineDesc& Desc = lookup.Desc;
+	ManifestWriter Writer;
+	//first so the replay can make the framebuffers without reading the rest
+	WriteFramebuffer(Writer, lookup.Framebuffer);
+	bool bRecordable = !Desc.inputLayout || Desc.inputLayout == ReplayTarget.InputLayout;
+	Writer.Write(Desc.primType);
+	Writer.Write(Desc.patchControlPoints);
+	Writer.Write(Desc.inputLayout != nullptr);
+	for (nvrhi::IShader* Shader : { Desc.VS.Get(), Desc.HS.Get(), Desc.DS.Get(), Desc.GS.Get(), Desc.PS.Get() })
+		bRecordable &= WriteShader(Writer, Shader);
+	Writer.Write(Desc.renderState);
+	Writer.Write(Desc.shadingRateState);
+	bRecordable &= WriteLayouts(Writer, Desc.bindingLayouts, ReplayTarget.BindlessLayout);
+	if (!bRecordable)
+	{
+		Skipped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	AddEntry(EntryType::Graphics, lookup.Hash, Writer.Data);
+}
+
+void PipelineManifest::Record(const ComputePipelineLookup& lookup)
+{
+	ManifestWriter Writer;
+	bool bRecordable = WriteShader(Writer, lookup.Desc.CS);
+	bRecordable &= WriteLayouts(Writer, lookup.Desc.bindingLayouts, ReplayTarget.BindlessLayout);
+	if (!bRecordable)
+	{
+		Skipped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	AddEntry(EntryType::Compute, lookup.Hash, Writer.Data);
+}
+
+void PipelineManifest::Record(const MeshletPipelineLookup& lookup)
+{
+	const nvrhi::MeshletPipelineDesc& Desc = lookup.Desc;
+	ManifestWriter Writer;
+	WriteFramebuffer(Writer, lookup.Framebuffer);
+	bool bRecordable = true;
+	Writer.Write(Desc.primType);
+	for (nvrhi::IShader* Shader : { Desc.AS.Get(), Desc.MS.Get(), Desc.PS.Get() })
+		bRecordable &= WriteShader(Writer, Shader);
+	Writer.Write(Desc.renderState);
+	bRecordable &= WriteLayouts(Writer, Desc.bindingLayouts, ReplayTarget.BindlessLayout);
+	if (!bRecordable)
+	{
+		Skipped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	AddEntry(EntryType::Meshlet, lookup.Hash, Writer.Data);
+}
+
+void PipelineManifest::Record(const BindingLayoutLookup& lookup)
+{
+	ManifestWriter Writer;
+	WriteLayoutDesc(Writer, lookup.Desc);
+	AddEntry(EntryType::BindingLayout, lookup.Hash, Writer.Data);
+}
+
+void PipelineManifest::AddEntry(EntryType type, uint64_t hash, const std::vector<uint8_t>& body)
+{
+	std::lock_guard<std::mutex> LockGuard(Mutex);
+	//the type goes in too, nothing says a layout and a pipeline can not share a hash
+	if (!RecordedHashes.insert(ragdoll::Hash64(&type, sizeof(type), hash)).second)
+		return;
+	ManifestWriter Writer;
+	Writer.Write(type);
+	Writer.Write(hash);
+	Writer.Write(static_cast<uint32_t>(body.size()));
+	Recorded.insert(Recorded.end(), Writer.Data.begin(), Writer.Data.end());
+	Recorded.insert(Recorded.end(), body.begin(), body.end());
+}
+
+size_t PipelineManifest::GetRecordedCount() const
+{
+	std::lock_guard<std::mutex> LockGuard(Mutex);
+	return RecordedHashes.size();
+}
+
+bool PipelineManifest::Load(const std::filesystem::path& path)
+{
+	RD_SCOPE(Load, Pipeline Manifest Load);
+	Loaded.clear();
+	LoadedEntries.clear();
+	std::ifstream In(path, std::ios::binary | std::ios::ate);
+	if (!In)
+		return false;
+	Loaded.resize(static_cast<size_t>(In.tellg()));
+	In.seekg(0);
+	In.read(reinterpret_cast<char*>(Loaded.data()), Loaded.size());
+	if (!In || Loaded.size() < sizeof(ManifestHeader))
+	{
+		RD_CORE_WARN("Pipeline manifest {} is corrupted, pipelines are created on first use", path.string());
+		Loaded.clear();
+		return false;
+	}
+
+	ManifestHeader Header;
+	memcpy(&Header, Loaded.data(), sizeof(ManifestHeader));
+	if (Header.Magic != ManifestMagic || Header.Version != Version || Header.ParamsKey != GetParamsKey())
+	{
+		RD_CORE_WARN("Pipeline manifest {} is from another build, pipelines are created on first use", path.string());
+		Loaded.clear();
+		return false;
+	}
+	//only the entry headers are read here, a body is read when its entry is replayed
+	size_t Offset = sizeof(ManifestHeader);
+	for (uint64_t i = 0; i < Header.EntryCount && Loaded.size() - Offset >= EntryHeaderSize; ++i)
+	{
+		ManifestReader Reader(Loaded.data() + Offset, EntryHeaderSize);
+		LoadedEntry Entry;
+		Entry.Type = Reader.Read<EntryType>();
+		Entry.Hash = Reader.Read<uint64_t>();
+		Entry.Size = Reader.Read<uint32_t>();
+		Entry.Offset = Offset + EntryHeaderSize;
+		if (Entry.Type > EntryType::Meshlet || Loaded.size() - Entry.Offset < Entry.Size)
+			break;
+		Offset = Entry.Offset + Entry.Size;
+		LoadedEntries.push_back(Entry);
+	}
+	if (LoadedEntries.size() != Header.EntryCount || Offset != Loaded.size())
+	{
+		RD_CORE_WARN("Pipeline manifest {} is corrupted, pipelines are created on first use", path.string());
+		Loaded.clear();
+		LoadedEntries.clear();
+		return false;
+	}
+	return true;
+}
+
+bool PipelineManifest::Save(const std::filesystem::path& path) const
+{
+	RD_SCOPE(Load, Pipeline Manifest Save);
+	std::lock_guard<std::mutex> LockGuard(Mutex);
+	ManifestHeader Header;
+	Header.Magic = ManifestMagic;
+	Header.Version = Version;
+	Header.ParamsKey = GetParamsKey();
+	Header.EntryCount = RecordedHashes.size();
+
+	std::error_code ec;
+	std::filesystem::create_directories(path.parent_path(), ec);
+	//write to a temporary file first so a crash halfway never leaves a truncated manifest behind
+	std::filesystem::path TempPath = path;
+	TempPath += ".tmp";
+	{
+		std::ofstream Out(TempPath, std::ios::binary | std::ios::trunc);
+		Out.write(reinterpret_cast<const char*>(&Header), sizeof(ManifestHeader));
+		Out.write(reinterpret_cast<const char*>(Recorded.data()), Recorded.size());
+		if (!Out)
+		{
+			RD_CORE_WARN("Unable to write pipeline manifest {}", path.string());
+			Out.close();
+			std::filesystem::remove(TempPath, ec);
+			return false;
+		}
+	}
+	std::filesystem::rename(TempPath, path, ec);
+	if (ec)
+	{
+		RD_CORE_WARN("Unable to write pipeline manifest {}: {}", path.string(), ec.message());
+		std::filesystem::remove(TempPath, ec);
+		return false;
+	}
+	return true;
+}
+
+void PipelineManifest::BeginReplay(tf::Executor& executor)
+{
+	RD_SCOPE(Load, Pipeline Replay Begin);
+	ReplayStart = std::chrono::high_resolution_clock::now();
+	ReplayEnd = ReplayStart;
+	Replayed = 0;
+	Stale = 0;
+	//the target makes framebuffers from the main thread like every other texture, the pipelines only share them
+	for (const LoadedEntry& Entry : LoadedEntries)
+	{
+		if (Entry.Type != EntryType::Graphics && Entry.Type != EntryType::Meshlet)
+			continue;
+		ManifestReader Reader(Loaded.data() + Entry.Offset, Entry.Size);
+		const nvrhi::FramebufferInfo Info = ReadFramebuffer(Reader);
+		auto Found = std::find_if(ReplayFramebuffers.begin(), ReplayFramebuffers.end(), [&Info](const auto& framebuffer) { return framebuffer.first == Info; });
+		if (Found == ReplayFramebuffers.end())
+			ReplayFramebuffers.emplace_back(Info, ReplayTarget.GetFramebuffer(Info));
+	}
+	{
+		std::lock_guard<std::mutex> LockGuard(Mutex);
+		ReplayRemaining = LoadedEntries.size();
+	}
+	for (const LoadedEntry& Entry : LoadedEntries)
+	{
+		executor.silent_async([this, &Entry]() {
+			RD_SCOPE(Load, Replay Pipeline);
+			(ReplayEntry(Entry) ? Replayed : Stale).fetch_add(1, std::memory_order_relaxed);
+			std::lock_guard<std::mutex> LockGuard(Mutex);
+			if (--ReplayRemaining == 0)
+			{
+				ReplayEnd = std::chrono::high_resolution_clock::now();
+				ReplayCondition.notify_all();
+			}
+		});
+	}
+}
+
+PipelineManifest::ReplayStats PipelineManifest::WaitForReplay()
+{
+	RD_SCOPE(Load, Pipeline Replay Wait);
+	ReplayStats Stats;
+	{
+		std::unique_lock<std::mutex> Lock(Mutex);
+		ReplayCondition.wait(Lock, [this]() { return ReplayRemaining == 0; });
+		Stats.Ms = std::chrono::duration<double, std::milli>(ReplayEnd - ReplayStart).count();
+	}
+	Stats.Entries = LoadedEntries.size();
+	Stats.Replayed = Replayed.load(std::memory_order_relaxed);
+	Stats.Stale = Stale.load(std::memory_order_relaxed);
+	//the pipelines do not hold on to the framebuffers
+	ReplayFramebuffers.clear();
+	LoadedEntries.clear();
+	Loaded.clear();
+	Loaded.shrink_to_fit();
+	return Stats;
+}
+
+bool PipelineManifest::ReplayEntry(const LoadedEntry& entry)
+{
+	ManifestReader Reader(Loaded.data() + entry.Offset, entry.Size);
+	//a shader that is named but can not be loaded anymore leaves a hole, the hash check drops the entry for it
+	auto ReadShader = [&]() -> nvrhi::ShaderHandle {
+		const std::string Name = Reader.ReadString();
+		return Name.empty() ? nullptr : ReplayTarget.GetShader(Name);
+	};
+	auto ReadLayouts = [&](nvrhi::BindingLayoutVector& layouts) {
+		const uint32_t Count = Reader.Read<uint32_t>();
+		for (uint32_t i = 0; i < Count && layouts.size() < layouts.max_size(); ++i)
+		{
+			const LayoutKind Kind = Reader.Read<LayoutKind>();
+			if (Kind == LayoutKind::Desc)
+				layouts.push_back(ReplayTarget.GetBindingLayout(ReadLayoutDesc(Reader)));
+			else
+				layouts.push_back(ReplayTarget.BindlessLayout);
+		}
+	};
+	auto GetFramebuffer = [&](const nvrhi::FramebufferInfo& info) {
+		auto Found = std::find_if(ReplayFramebuffers.begin(), ReplayFramebuffers.end(), [&info](const auto& framebuffer) { return framebuffer.first == info; });
+		return Found != ReplayFramebuffers.end() ? Found->second : nullptr;
+	};
+
+	switch (entry.Type)
+	{
+	case EntryType::BindingLayout:
+	{
+		const nvrhi::BindingLayoutDesc Desc = ReadLayoutDesc(Reader);
+		if (!Reader.IsComplete() || MakeBindingLayoutLookup(Desc).Hash != entry.Hash)
+			return false;
+		ReplayTarget.GetBindingLayout(Desc);
+		return true;
+	}
+	case EntryType::Compute:
+	{
+		nvrhi::ComputePipelineDesc Desc;
+		Desc.CS = ReadShader();
+		ReadLayouts(Desc.bindingLayouts);
+		if (!Reader.IsComplete() || MakePipelineLookup(Desc, *ReplayTarget.ShaderHashes).Hash != entry.Hash)
+			return false;
+		ReplayTarget.CreateComputePipeline(Desc);
+		return true;
+	}
+	case EntryType::Graphics:
+	{
+		const nvrhi::FramebufferInfo Info = ReadFramebuffer(Reader);
+		nvrhi::GraphicsPipelineDesc Desc;
+		Desc.primType = Reader.Read<nvrhi::PrimitiveType>();
+		Desc.patchControlPoints = Reader.Read<uint32_t>();
+		if (Reader.Read<bool>())
+			Desc.inputLayout = ReplayTarget.InputLayout;
+		Desc.VS = ReadShader();
+		Desc.HS = ReadShader();
+		Desc.DS = ReadShader();
+		Desc.GS = ReadShader();
+		Desc.PS = ReadShader();
+		Desc.renderState = Reader.Read<nvrhi::RenderState>();
+		Desc.shadingRateState = Reader.Read<nvrhi::VariableRateShadingState>();
+		ReadLayouts(Desc.bindingLayouts);
+		const nvrhi::FramebufferHandle Framebuffer = GetFramebuffer(Info);
+		if (!Reader.IsComplete() || !Framebuffer || MakePipelineLookup(Desc, Info, *ReplayTarget.ShaderHashes).Hash != entry.Hash)
+			return false;
+		ReplayTarget.CreateGraphicsPipeline(Desc, Framebuffer);
+		return true;
+	}
+	case EntryType::Meshlet:
+	{
+		const nvrhi::FramebufferInfo Info = ReadFramebuffer(Reader);
+		nvrhi::MeshletPipelineDesc Desc;
+		Desc.primType = Reader.Read<nvrhi::PrimitiveType>();
+		Desc.AS = ReadShader();
+		Desc.MS = ReadShader();
+		Desc.PS = ReadShader();
+		Desc.renderState = Reader.Read<nvrhi::RenderState>();
+		ReadLayouts(Desc.bindingLayouts);
+		const nvrhi::FramebufferHandle Framebuffer = GetFramebuffer(Info);
+		if (!Reader.IsComplete() || !Framebuffer || MakePipelineLookup(Desc, Info, *ReplayTarget.ShaderHashes).Hash != entry.Hash)
+			return false;
+		ReplayTarget.CreateMeshletPipeline(Desc, Framebuffer);
+		return true;
+	}
+	}
+	return false;
+}
+
+namespace
+{
+	//stand ins for the device objects, the manifest only ever looks at their descs, names and bytecode
+	class StandInShader : public nvrhi::RefCounter<nvrhi::IShader>
+	{
+	public:
+		StandInShader(nvrhi::ShaderType type, const std::string& name, std::vector<uint8_t> bytecode) : Bytecode(std::move(bytecode))
+		{
+			Desc.shaderType = type;
+			Desc.debugName = name;
+		}
+		const nvrhi::ShaderDesc& getDesc() const override { return Desc; }
+		void getBytecode(const void** ppBytecode, size_t* pSize) const override
+		{
+			*ppBytecode = Bytecode.data();
+			*pSize = Bytecode.size();
+		}
+
+	private:
+		nvrhi::ShaderDesc Desc;
+		std::vector<uint8_t> Bytecode;
+	};
+
+	class StandInBindingLayout : public nvrhi::RefCounter<nvrhi::IBindingLayout>
+	{
+	public:
+		explicit StandInBindingLayout(const nvrhi::BindingLayoutDesc& desc) : Desc(desc) {}
+		explicit StandInBindingLayout(const nvrhi::BindlessLayoutDesc& desc) : BindlessDesc(desc), bBindless(true) {}
+		const nvrhi::BindingLayoutDesc* getDesc() const override { return bBindless ? nullptr : &Desc; }
+		const nvrhi::BindlessLayoutDesc* getBindlessDesc() const override { return bBindless ? &BindlessDesc : nullptr; }
+
+	private:
+		nvrhi::BindingLayoutDesc Desc;
+		nvrhi::BindlessLayoutDesc BindlessDesc;
+		bool bBindless{};
+	};
+
+	class StandInInputLayout : public nvrhi::RefCounter<nvrhi::IInputLayout>
+	{
+	public:
+		explicit StandInInputLayout(std::vector<nvrhi::VertexAttributeDesc> attributes) : Attributes(std::move(attributes)) {}
+		uint32_t getNumAttributes() const override { return static_cast<uint32_t>(Attributes.size()); }
+		const nvrhi::VertexAttributeDesc* getAttributeDesc(uint32_t index) const override { return index < Attributes.size() ? &Attributes[index] : nullptr; }
+
+	private:
+		std::vector<nvrhi::VertexAttributeDesc> Attributes;
+	};
+
+	class StandInFramebuffer : public nvrhi::RefCounter<nvrhi::IFramebuffer>
+	{
+	public:
+		explicit StandInFramebuffer(const nvrhi::FramebufferInfo& info) { static_cast<nvrhi::FramebufferInfo&>(Info) = info; }
+		const nvrhi::FramebufferDesc& getDesc() const override { return Desc; }
+		const nvrhi::FramebufferInfoEx& getFramebufferInfo() const override { return Info; }
+
+	private:
+		nvrhi::FramebufferDesc Desc;
+		nvrhi::FramebufferInfoEx Info;
+	};
+
+	nvrhi::InputLayoutHandle MakeStandInInputLayout(const char* name, nvrhi::Format format)
+	{
+		nvrhi::VertexAttributeDesc Attribute;
+		Attribute.name = name;
+		Attribute.format = format;
+		Attribute.elementStride = 16;
+		return nvrhi::InputLayoutHandle::Create(new StandInInputLayout({ Attribute }));
+	}
+
+	//the shader files on disk, the same name and revision always compile to the same bytecode
+	using ShaderFiles = std::unordered_map<std::string, uint32_t>;
+
+	std::vector<uint8_t> CompileStandInShader(const std::string& name, uint32_t revision)
+	{
+		std::vector<uint8_t> Bytecode(8 << 10);
+		std::mt19937_64 Rng(ragdoll::Hash64(name.data(), name.size(), revision));
+		for (uint8_t& Byte : Bytecode)
+			Byte = static_cast<uint8_t>(Rng());
+		return Bytecode;
+	}
+
+	//the asset manager on a device that takes CompileTime for every pipeline, records misses into its manifest the same way
+	class StandInDevice
+	{
+	public:
+		StandInDevice(ShaderFiles files, std::chrono::microseconds compileTime) : Files(std::move(files)), CompileTime(compileTime)
+		{
+			nvrhi::BindlessLayoutDesc BindlessDesc;
+			BindlessDesc.visibility = nvrhi::ShaderType::All;
+			BindlessDesc.maxCapacity = 1024;
+			BindlessDesc.registerSpaces = { nvrhi::BindingLayoutItem::Texture_SRV(1) };
+			BindlessLayout = nvrhi::BindingLayoutHandle::Create(new StandInBindingLayout(BindlessDesc));
+			InputLayout = MakeStandInInputLayout("POSITION", nvrhi::Format::RGB32_FLOAT);
+
+			PipelineManifest::Target Target;
+			Target.GetShader = [this](const std::string& name) { return GetShader(name); };
+			Target.GetBindingLayout = [this](const nvrhi::BindingLayoutDesc& desc) { return GetBindingLayout(desc); };
+			Target.GetFramebuffer = [](const nvrhi::FramebufferInfo& info) { return nvrhi::FramebufferHandle::Create(new StandInFramebuffer(info)); };
+			Target.CreateGraphicsPipeline = [this](const nvrhi::GraphicsPipelineDesc& desc, const nvrhi::FramebufferHandle& fb) { GetGraphicsPipeline(desc, fb); };
+			Target.CreateComputePipeline = [this](const nvrhi::ComputePipelineDesc& desc) { GetComputePipeline(desc); };
+			Target.CreateMeshletPipeline = [this](const nvrhi::MeshletPipelineDesc& desc, const nvrhi::FramebufferHandle& fb) { GetMeshletPipeline(desc, fb); };
+			Target.BindlessLayout = BindlessLayout;
+			Target.InputLayout = InputLayout;
+			Target.ShaderHashes = &ShaderHashes;
+			Manifest.Init(std::move(Target));
+		}
+
+		nvrhi::ShaderHandle GetShader(const std::string& name)
+		{
+			std::lock_guard<std::mutex> LockGuard(Mutex);
+			if (auto Found = Shaders.find(name); Found != Shaders.end())
+				return Found->second;
+			auto File = Files.find(name);
+			if (File == Files.end())
+				return Shaders[name] = nullptr;
+			const nvrhi::ShaderType Type = name.find(".ps.") != std::string::npos ? nvrhi::ShaderType::Pixel
+				: name.find(".vs.") != std::string::npos ? nvrhi::ShaderType::Vertex
+				: name.find(".ms.") != std::string::npos ? nvrhi::ShaderType::Mesh
+				: name.find(".as.") != std::string::npos ? nvrhi::ShaderType::Amplification
+				: nvrhi::ShaderType::Compute;
+			nvrhi::ShaderHandle Shader = nvrhi::ShaderHandle::Create(new StandInShader(Type, name, CompileStandInShader(name, File->second)));
+			ShaderHashes.Get(Shader);
+			return Shaders[name] = Shader;
+		}
+		nvrhi::BindingLayoutHandle GetBindingLayout(const nvrhi::BindingLayoutDesc& desc)
+		{
+			const BindingLayoutLookup Lookup = MakeBindingLayoutLookup(desc);
+			return BindingLayouts.Get(Lookup, [&]() {
+				Manifest.Record(Lookup);
+				return nvrhi::BindingLayoutHandle::Create(new StandInBindingLayout(desc));
+			});
+		}
+		uint32_t GetGraphicsPipeline(const nvrhi::GraphicsPipelineDesc& desc, const nvrhi::FramebufferHandle& fb)
+		{
+			const GraphicsPipelineLookup Lookup = MakePipelineLookup(desc, fb->getFramebufferInfo(), ShaderHashes);
+			return GPSOs.Get(Lookup, [&]() {
+				Manifest.Record(Lookup);
+				return Compile();
+			});
+		}
+		uint32_t GetComputePipeline(const nvrhi::ComputePipelineDesc& desc)
+		{
+			const ComputePipelineLookup Lookup = MakePipelineLookup(desc, ShaderHashes);
+			return CPSOs.Get(Lookup, [&]() {
+				Manifest.Record(Lookup);
+				return Compile();
+			});
+		}
+		uint32_t GetMeshletPipeline(const nvrhi::MeshletPipelineDesc& desc, const nvrhi::FramebufferHandle& fb)
+		{
+			const MeshletPipelineLookup Lookup = MakePipelineLookup(desc, fb->getFramebufferInfo(), ShaderHashes);
+			return MPSOs.Get(Lookup, [&]() {
+				Manifest.Record(Lookup);
+				return Compile();
+			});
+		}
+
+		uint32_t GetCompiledCount() const { return Compiled.load(); }
+		size_t GetPipelineCount() const { return GPSOs.GetSize() + CPSOs.GetSize() + MPSOs.GetSize(); }
+
+		nvrhi::BindingLayoutHandle BindlessLayout;
+		nvrhi::InputLayoutHandle InputLayout;
+		PipelineManifest Manifest;
+
+	private:
+		uint32_t Compile()
+		{
+			std::this_thread::sleep_for(CompileTime);
+			return Compiled.fetch_add(1) + 1;
+		}
+
+		ShaderFiles Files;
+		std::chrono::microseconds CompileTime;
+		std::atomic<uint32_t> Compiled{};
+		std::mutex Mutex;
+		std::unordered_map<std::string, nvrhi::ShaderHandle> Shaders;
+		ShaderHashCache ShaderHashes;
+		ConcurrentCache<BindingLayoutKey, nvrhi::BindingLayoutHandle> BindingLayouts;
+		ConcurrentCache<GraphicsPipelineKey, uint32_t> GPSOs;
+		ConcurrentCache<ComputePipelineKey, uint32_t> CPSOs;
+		ConcurrentCache<MeshletPipelineKey, uint32_t> MPSOs;
+	};
+
+	//what the passes of the renderer ask for in a frame, every pass builds its desc and looks it up
+	constexpr uint32_t GraphicsPassCount = 24;
+	constexpr uint32_t ComputePassCount = 24;
+	constexpr uint32_t MeshletPassCount = 4;
+
+	ShaderFiles MakeShaderFiles()
+	{
+		ShaderFiles Files;
+		for (uint32_t i = 0; i < 4; ++i)
+			Files[fmt::format("Pass{}.vs.cso", i)] = 0;
+		for (uint32_t i = 0; i < GraphicsPassCount; ++i)
+			Files[fmt::format("Pass{}.ps.cso", i)] = 0;
+		for (uint32_t i = 0; i < ComputePassCount; ++i)
+			Files[fmt::format("Pass{}.cs.cso", i)] = 0;
+		for (uint32_t i = 0; i < MeshletPassCount; ++i)
+		{
+			Files[fmt::format("Meshlet{}.as.cso", i)] = 0;
+			Files[fmt::format("Meshlet{}.ms.cso", i)] = 0;
+		}
+		Files["ImGui.vs.cso"] = 0;
+		Files["ImGui.ps.cso"] = 0;
+		return Files;
+	}
+
+	struct FrameTargets
+	{
+		nvrhi::FramebufferHandle GBuffer;
+		nvrhi::FramebufferHandle Lighting;
+		//ui has its own input layout, the manifest can not bring that back
+		nvrhi::InputLayoutHandle ImGuiInputLayout;
+	};
+
+	FrameTargets MakeFrameTargets()
+	{
+		FrameTargets Targets;
+		nvrhi::FramebufferInfo GBuffer;
+		GBuffer.colorFormats = { nvrhi::Format::RGBA8_UNORM, nvrhi::Format::RG16_FLOAT, nvrhi::Format::RG8_UNORM, nvrhi::Format::RG16_FLOAT };
+		GBuffer.depthFormat = nvrhi::Format::D32;
+		Targets.GBuffer = nvrhi::FramebufferHandle::Create(new StandInFramebuffer(GBuffer));
+		nvrhi::FramebufferInfo Lighting;
+		Lighting.colorFormats = { nvrhi::Format::RGBA16_FLOAT };
+		Targets.Lighting = nvrhi::FramebufferHandle::Create(new StandInFramebuffer(Lighting));
+		Targets.ImGuiInputLayout = MakeStandInInputLayout("TEXCOORD", nvrhi::Format::RG32_FLOAT);
+		return Targets;
+	}
+
+	nvrhi::BindingLayoutDesc MakePassLayoutDesc(uint32_t pass)
+	{
+		nvrhi::BindingLayoutDesc Desc;
+		Desc.visibility = nvrhi::ShaderType::All;
+		Desc.bindings.push_back(nvrhi::BindingLayoutItem::ConstantBuffer(pass));
+		for (uint32_t Slot = 0; Slot < 1 + pass % 5; ++Slot)
+			Desc.bindings.push_back(nvrhi::BindingLayoutItem::Texture_SRV(Slot));
+		if (pass % 2)
+			Desc.bindings.push_back(nvrhi::BindingLayoutItem::Texture_UAV(0));
+		return Desc;
+	}
+
+	//returns the pipelines it got, one per pass
+	std::vector<uint32_t> RunFrame(StandInDevice& device, const FrameTargets& targets)
+	{
+		std::vector<uint32_t> Pipelines;
+		for (uint32_t i = 0; i < GraphicsPassCount; ++i)
+		{
+			nvrhi::GraphicsPipelineDesc Desc;
+			Desc.VS = device.GetShader(fmt::format("Pass{}.vs.cso", i % 4));
+			Desc.PS = device.GetShader(fmt::format("Pass{}.ps.cso", i));
+			Desc.addBindingLayout(device.GetBindingLayout(MakePassLayoutDesc(i)));
+			if (i % 4 == 0)
+				Desc.addBindingLayout(device.BindlessLayout);
+			if (i % 2 == 0)
+				Desc.inputLayout = device.InputLayout;
+			Desc.renderState.rasterState.cullMode = i % 3 ? nvrhi::RasterCullMode::Back : nvrhi::RasterCullMode::None;
+			Desc.renderState.depthStencilState.depthTestEnable = i < GraphicsPassCount / 2;
+			Desc.renderState.blendState.targets[0].blendEnable = i % 5 == 0;
+			Pipelines.push_back(device.GetGraphicsPipeline(Desc, i < GraphicsPassCount / 2 ? targets.GBuffer : targets.Lighting));
+		}
+		for (uint32_t i = 0; i < ComputePassCount; ++i)
+		{
+			nvrhi::ComputePipelineDesc Desc;
+			Desc.CS = device.GetShader(fmt::format("Pass{}.cs.cso", i));
+			Desc.addBindingLayout(device.GetBindingLayout(MakePassLayoutDesc(100 + i)));
+			Pipelines.push_back(device.GetComputePipeline(Desc));
+		}
+		for (uint32_t i = 0; i < MeshletPassCount; ++i)
+		{
+			nvrhi::MeshletPipelineDesc Desc;
+			Desc.AS = device.GetShader(fmt::format("Meshlet{}.as.cso", i));
+			Desc.MS = device.GetShader(fmt::format("Meshlet{}.ms.cso", i));
+			Desc.PS = device.GetShader(fmt::format("Pass{}.ps.cso", i));
+			Desc.addBindingLayout(device.GetBindingLayout(MakePassLayoutDesc(200 + i)));
+			Desc.addBindingLayout(device.BindlessLayout);
+			Desc.renderState.depthStencilState.depthTestEnable = true;
+			Pipelines.push_back(device.GetMeshletPipeline(Desc, targets.GBuffer));
+		}
+		nvrhi::GraphicsPipelineDesc ImGuiDesc;
+		ImGuiDesc.VS = device.GetShader("ImGui.vs.cso");
+		ImGuiDesc.PS = device.GetShader("ImGui.ps.cso");
+		ImGuiDesc.inputLayout = targets.ImGuiInputLayout;
+		ImGuiDesc.renderState.blendState.targets[0].blendEnable = true;
+		Pipelines.push_back(device.GetGraphicsPipeline(ImGuiDesc, targets.Lighting));
+		return Pipelines;
+	}
+
+	constexpr uint32_t FramePipelineCount = GraphicsPassCount + ComputePassCount + MeshletPassCount + 1;
+	//every pass but ui, and a layout for every pass
+	constexpr uint32_t FrameEntryCount = FramePipelineCount - 1 + GraphicsPassCount + ComputePassCount + MeshletPassCount;
+}
+
+bool VerifyPipelineManifest()
+{
+	bool bSuccess = true;
+	auto Check = [&bSuccess](bool bCondition, const std::string& what) {
+		if (!bCondition)
+		{
+			RD_CORE_ERROR("Pipeline manifest check failed: {}", what);
+			bSuccess = false;
+		}
+	};
+	const std::filesystem::path Path = std::filesystem::temp_directory_path() / "ragdoll_verify_pipelines.rdpso";
+	const std::chrono::microseconds CompileTime(200);
+	const FrameTargets Targets = MakeFrameTargets();
+
+	//a cold run records everything it creates
+	{
+		StandInDevice Device(MakeShaderFiles(), CompileTime);
+		RunFrame(Device, Targets);
+		Check(Device.GetCompiledCount() == FramePipelineCount, fmt::format("the cold frame compiled {} pipelines, expected {}", Device.GetCompiledCount(), FramePipelineCount));
+		Check(Device.Manifest.GetRecordedCount() == FrameEntryCount, fmt::format("{} entries were recorded, expected {}", Device.Manifest.GetRecordedCount(), FrameEntryCount));
+		Check(Device.Manifest.GetSkippedCount() == 1, fmt::format("{} pipelines were skipped, only the ui one has a layout the manifest can not bring back", Device.Manifest.GetSkippedCount()));
+		//the second frame is all hits and records nothing new
+		RunFrame(Device, Targets);
+		Check(Device.Manifest.GetRecordedCount() == FrameEntryCount, "a frame of hits recorded entries again");
+		Check(Device.Manifest.Save(Path), "unable to save the manifest");
+		Check(!Device.Manifest.Load(std::filesystem::temp_directory_path() / "ragdoll_missing.rdpso"), "loading a manifest that does not exist did not fail");
+	}
+	//a warm run creates everything before the first frame, which then only compiles what could not be recorded
+	std::vector<uint32_t> WarmPipelines;
+	{
+		StandInDevice Device(MakeShaderFiles(), CompileTime);
+		Check(Device.Manifest.Load(Path), "unable to load the manifest that was just saved");
+		Device.Manifest.BeginReplay(SExecutor::Executor);
+		const PipelineManifest::ReplayStats Stats = Device.Manifest.WaitForReplay();
+		Check(Stats.Entries == FrameEntryCount && Stats.Replayed == FrameEntryCount && Stats.Stale == 0,
+			fmt::format("replayed {} of {} entries with {} stale, expected all {}", Stats.Replayed, Stats.Entries, Stats.Stale, FrameEntryCount));
+		Check(Device.GetCompiledCount() == FramePipelineCount - 1, fmt::format("the replay compiled {} pipelines, expected {}", Device.GetCompiledCount(), FramePipelineCount - 1));
+		WarmPipelines = RunFrame(Device, Targets);
+		Check(Device.GetCompiledCount() == FramePipelineCount, fmt::format("the first frame after the replay compiled {} pipelines, only the ui one was missing", Device.GetCompiledCount() - (FramePipelineCount - 1)));
+		Check(Device.GetPipelineCount() == FramePipelineCount, "the replay created pipelines the frame never asked for");
+		//replayed entries are recorded again, so the next manifest is as complete as this one
+		Check(Device.Manifest.GetRecordedCount() == FrameEntryCount, fmt::format("the warm run recorded {} entries, expected {}", Device.Manifest.GetRecordedCount(), FrameEntryCount));
+	}
+	//recompiling a shader that two pipelines use and deleting one only drops those three entries
+	{
+		ShaderFiles Files = MakeShaderFiles();
+		++Files["Pass1.ps.cso"];
+		Files.erase("Pass3.cs.cso");
+		StandInDevice Device(std::move(Files), CompileTime);
+		Check(Device.Manifest.Load(Path), "unable to load the manifest again");
+		Device.Manifest.BeginReplay(SExecutor::Executor);
+		const PipelineManifest::ReplayStats Stats = Device.Manifest.WaitForReplay();
+		Check(Stats.Stale == 3 && Stats.Replayed == FrameEntryCount - 3, fmt::format("{} entries were stale and {} replayed, expected 3 and {}", Stats.Stale, Stats.Replayed, FrameEntryCount - 3));
+		Check(Device.GetCompiledCount() == FramePipelineCount - 4, fmt::format("the replay compiled {} pipelines, expected {}", Device.GetCompiledCount(), FramePipelineCount - 4));
+	}
+	//a manifest that was cut short or comes from another build is not replayed at all
+	{
+		std::vector<char> Bytes(std::filesystem::file_size(Path));
+		std::ifstream(Path, std::ios::binary).read(Bytes.data(), Bytes.size());
+		auto LoadBytes = [&Path](const std::vector<char>& bytes) {
+			std::ofstream(Path, std::ios::binary | std::ios::trunc).write(bytes.data(), bytes.size());
+			StandInDevice Device(MakeShaderFiles(), std::chrono::microseconds(0));
+			return Device.Manifest.Load(Path);
+		};
+		Check(!LoadBytes(std::vector<char>(Bytes.begin(), Bytes.end() - 5)), "a truncated manifest loaded");
+		std::vector<char> Extended = Bytes;
+		Extended.push_back(0);
+		Check(!LoadBytes(Extended), "a manifest with trailing bytes loaded");
+		std::vector<char> OtherVersion = Bytes;
+		OtherVersion[offsetof(ManifestHeader, Version)] ^= 1;
+		Check(!LoadBytes(OtherVersion), "a manifest of another version loaded");
+		std::vector<char> OtherType = Bytes;
+		OtherType[sizeof(ManifestHeader)] = 0x7f;
+		Check(!LoadBytes(OtherType), "a manifest with an unknown entry type loaded");
+		Check(LoadBytes(Bytes), "the untouched manifest did not load");
+	}
+	std::error_code ec;
+	std::filesystem::remove(Path, ec);
+	if (bSuccess)
+		RD_CORE_INFO("Pipeline manifest checks passed, {} entries came back from disk, stale shaders dropped only their own pipelines and broken manifests were rejected", FrameEntryCount);
+	return bSuccess;
+}
+
+void BenchmarkPipelineWarmup()
+{
+	using Clock = std::chrono::high_resolution_clock;
+	const std::filesystem::path Path = std::filesystem::temp_directory_path() / "ragdoll_bench_pipelines.rdpso";
+	const FrameTargets Targets = MakeFrameTargets();
+	RD_CORE_INFO("Time to first frame of {} pipelines and {} binding layouts on a stand in device, replayed on {} executor workers, {} hardware threads",
+		FramePipelineCount, FrameEntryCount - (FramePipelineCount - 1), SExecutor::Executor.num_workers(), std::thread::hardware_concurrency());
+	//from a small compute pipeline to a big uber shader
+	for (uint32_t CompileUs : { 500u, 2000u, 8000u })
+	{
+		const std::chrono::microseconds CompileTime(CompileUs);
+		double ColdMs = 0.0;
+		{
+			StandInDevice Device(MakeShaderFiles(), CompileTime);
+			const Clock::time_point Start = Clock::now();
+			RunFrame(Device, Targets);
+			ColdMs = std::chrono::duration<double, std::milli>(Clock::now() - Start).count();
+			Device.Manifest.Save(Path);
+		}
+		StandInDevice Device(MakeShaderFiles(), CompileTime);
+		const Clock::time_point Start = Clock::now();
+		Device.Manifest.Load(Path);
+		Device.Manifest.BeginReplay(SExecutor::Executor);
+		const PipelineManifest::ReplayStats Stats = Device.Manifest.WaitForReplay();
+		const Clock::time_point FrameStart = Clock::now();
+		RunFrame(Device, Targets);
+		const double FrameMs = std::chrono::duration<double, std::milli>(Clock::now() - FrameStart).count();
+		const double WarmMs = std::chrono::duration<double, std::milli>(Clock::now() - Start).count();
+		RD_CORE_INFO("  {:>5.1f}ms a pipeline: first frame {:.1f}ms without pre-warm, {:.1f}ms with it ({:.1f}ms replaying {} entries, then {:.1f}ms for the frame and the ui pipeline it could not record), {:.1f}x",
+			CompileUs / 1000.0, ColdMs, WarmMs, Stats.Ms, Stats.Replayed, FrameMs, ColdMs / WarmMs);
+	}
+	std::error_code ec;
+	std::filesystem::remove(Path, ec);
+}
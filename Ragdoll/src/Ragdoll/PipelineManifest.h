@@ -0,0 +1,108 @@
+#pragma once
+#include "Ragdoll/PipelineKey.h"
+
+namespace tf {
+	class Executor;
+}
+
+//every pipeline and binding layout the renderer created, saved on shutdown and replayed on the next start so the first frames do not stall on pipeline compiles
+//an entry is its desc with the shaders by file name and the layouts by desc, plus the key hash it was created under
+//the key hash covers the shader bytecode, an entry whose shaders were recompiled since rebuilds to another hash and is dropped instead of replayed
+//raytracing pipelines are not recorded, their exports only exist as objects
+class PipelineManifest
+{
+public:
+	//bump whenever the layout of the file or of any struct written as is changes
+	static constexpr uint32_t Version = 1;
+
+	//what the entries are recorded against and replayed with, the asset manager in the engine
+	struct Target
+	{
+		std::function<nvrhi::ShaderHandle(const std::string&)> GetShader;
+		std::function<nvrhi::BindingLayoutHandle(const nvrhi::BindingLayoutDesc&)> GetBindingLayout;
+		//any framebuffer with the formats, pipelines never look at the textures
+		std::function<nvrhi::FramebufferHandle(const nvrhi::FramebufferInfo&)> GetFramebuffer;
+		std::function<void(const nvrhi::GraphicsPipelineDesc&, const nvrhi::FramebufferHandle&)> CreateGraphicsPipeline;
+		std::function<void(const nvrhi::ComputePipelineDesc&)> CreateComputePipeline;
+		std::function<void(const nvrhi::MeshletPipelineDesc&, const nvrhi::FramebufferHandle&)> CreateMeshletPipeline;
+		//the only layouts that are not made from a desc, a pipeline with any other one of these is not recorded
+		nvrhi::BindingLayoutHandle BindlessLayout;
+		nvrhi::InputLayoutHandle InputLayout;
+		ShaderHashCache* ShaderHashes{};
+	};
+
+	struct ReplayStats
+	{
+		size_t Entries{};
+		size_t Replayed{};
+		//entries that no longer rebuild to what they were recorded as, mostly shaders that were recompiled or removed
+		size_t Stale{};
+		double Ms{};
+	};
+
+	void Init(Target target) { ReplayTarget = std::move(target); }
+
+	//called on a cache miss, once per key, from any thread
+	void Record(const GraphicsPipelineLookup& lookup);
+	void Record(const ComputePipelineLookup& lookup);
+	void Record(const MeshletPipelineLookup& lookup);
+	void Record(const BindingLayoutLookup& lookup);
+
+	//reads the entries of the last run, false if there is no manifest or it is not from this build
+	bool Load(const std::filesystem::path& path);
+	//writes everything recorded this run, replayed entries are recorded again as they are created
+	bool Save(const std::filesystem::path& path) const;
+
+	//creates every loaded entry on the executor, the framebuffers are made on the calling thread first
+	void BeginReplay(tf::Executor& executor);
+	//blocks until the replay is done, returns right away if there was none
+	ReplayStats WaitForReplay();
+
+	size_t GetRecordedCount() const;
+	//pipelines that could not be recorded, their shaders have no name or they use a layout the target does not know
+	size_t GetSkippedCount() const { return Skipped.load(std::memory_order_relaxed); }
+
+private:
+	enum class EntryType : uint8_t
+	{
+		BindingLayout,
+		Compute,
+		Graphics,
+		Meshlet,
+	};
+
+	struct LoadedEntry
+	{
+		EntryType Type;
+		uint64_t Hash;
+		size_t Offset;
+		size_t Size;
+	};
+
+	void AddEntry(EntryType type, uint64_t hash, const std::vector<uint8_t>& body);
+	//rebuilds the desc of an entry and creates it if it still has the hash it was recorded with
+	bool ReplayEntry(const LoadedEntry& entry);
+
+	Target ReplayTarget;
+
+	mutable std::mutex Mutex;
+	std::vector<uint8_t> Recorded;
+	std::unordered_set<uint64_t> RecordedHashes;
+	std::atomic<size_t> Skipped{};
+
+	std::vector<uint8_t> Loaded;
+	std::vector<LoadedEntry> LoadedEntries;
+	std::vector<std::pair<nvrhi::FramebufferInfo, nvrhi::FramebufferHandle>> ReplayFramebuffers;
+	//guarded by Mutex, the last entry to finish signals under it so the manifest can go away as soon as the wait returns
+	size_t ReplayRemaining{};
+	std::condition_variable ReplayCondition;
+	std::atomic<size_t> Replayed{};
+	std::atomic<size_t> Stale{};
+	std::chrono::high_resolution_clock::time_point ReplayStart;
+	std::chrono::high_resolution_clock::time_point ReplayEnd;
+};
+
+//records pipelines against a stand in device, saves, replays into a fresh one and checks every entry comes back once, stale ones are dropped and broken files are rejected
+bool VerifyPipelineManifest();
+//time to first frame against a stand in device that takes a while to compile, with every pipeline created on first use and with the manifest replayed first
+void BenchmarkPipelineWarmup();
@@ -19,6 +19,11 @@ struct ProfileScope {
 		MicroProfileEnter(Token);
 	}
 
+	//for tokens looked up once up front, like the tasks of a job graph
+	ProfileScope(MicroProfileToken token) : Token(token) {
+		MicroProfileEnter(Token);
+	}
+
 	~ProfileScope() {
 		// Manually end profiling when the object is destructed
 		MicroProfileLeave();
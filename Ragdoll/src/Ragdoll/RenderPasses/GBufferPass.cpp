@@ -139,6 +139,10 @@ void GBufferPass::DrawAllInstances(
 		nvrhi::BindingSetItem::StructuredBuffer_SRV(0, GPUScene->InstanceBuffer),
 		nvrhi::BindingSetItem::StructuredBuffer_SRV(1, GPUScene->MaterialBuffer),
 	};
+	//packed positions are relative to the mesh box
+	const bool bQuantizedVertices = AssetManager::GetInstance()->bQuantizedVertices;
+	if (bQuantizedVertices)
+		BindingSetDesc.addItem(nvrhi::BindingSetItem::StructuredBuffer_SRV(2, GPUScene->MeshBuffer));
 	for (int i = 0; i < (int)SamplerTypes::COUNT; ++i)
 	{
 		BindingSetDesc.addItem(nvrhi::BindingSetItem::Sampler(i, AssetManager::GetInstance()->Samplers[i]));
@@ -151,7 +155,7 @@ void GBufferPass::DrawAllInstances(
 	nvrhi::GraphicsPipelineDesc PipelineDesc;
 	PipelineDesc.addBindingLayout(BindingLayoutHandle);
 	PipelineDesc.addBindingLayout(AssetManager::GetInstance()->BindlessLayoutHandle);
-	nvrhi::ShaderHandle VertexShader = AssetManager::GetInstance()->GetShader("GBufferShader.vs.cso");
+	nvrhi::ShaderHandle VertexShader = AssetManager::GetInstance()->GetShader(bQuantizedVertices ? "GBufferShaderQuantized.vs.cso" : "GBufferShader.vs.cso");
 	nvrhi::ShaderHandle PixelShader;
 	if (opaquePass)
 	{
@@ -359,7 +363,7 @@ void GBufferPass::DispatchMeshlets(
 	PipelineDesc.addBindingLayout(BindingLayoutHandle);
 	PipelineDesc.addBindingLayout(AssetManager::GetInstance()->BindlessLayoutHandle);
 	nvrhi::ShaderHandle AmpShader = AssetManager::GetInstance()->GetShader("Meshlet.as.cso");
-	nvrhi::ShaderHandle MeshShader = AssetManager::GetInstance()->GetShader("Meshlet.ms.cso");
+	nvrhi::ShaderHandle MeshShader = AssetManager::GetInstance()->GetShader(AssetManager::GetInstance()->bQuantizedVertices ? "MeshletQuantized.ms.cso" : "Meshlet.ms.cso");
 	nvrhi::ShaderHandle PixelShader = AssetManager::GetInstance()->GetShader("Meshlet.ps.cso");
 	PipelineDesc.setAmplificationShader(AmpShader);
 	PipelineDesc.setMeshShader(MeshShader);
@@ -124,7 +124,7 @@ void ShadowMaskPass::RaytraceShadowMask(const ragdoll::SceneInformation& sceneIn
 
 	if (!sceneInfo.bInlineRaytrace)
 	{
-		nvrhi::ShaderLibraryHandle ShaderLibrary = AssetManager::GetInstance()->GetShaderLibrary("RaytraceShadow.lib.cso");
+		nvrhi::ShaderLibraryHandle ShaderLibrary = AssetManager::GetInstance()->GetShaderLibrary(AssetManager::GetInstance()->bQuantizedVertices ? "RaytraceShadowQuantized.lib.cso" : "RaytraceShadow.lib.cso");
 		nvrhi::rt::PipelineDesc PipelineDesc;
 		PipelineDesc.globalBindingLayouts = { BindingLayoutHandle, AssetManager::GetInstance()->BindlessLayoutHandle };
 		PipelineDesc.shaders = {
@@ -162,7 +162,7 @@ void ShadowMaskPass::RaytraceShadowMask(const ragdoll::SceneInformation& sceneIn
 		//inline raytrace with compute
 		nvrhi::ComputePipelineDesc PipelineDesc;
 		PipelineDesc.bindingLayouts = { BindingLayoutHandle, AssetManager::GetInstance()->BindlessLayoutHandle };
-		nvrhi::ShaderHandle RaytraceShader = AssetManager::GetInstance()->GetShader("RaytraceShadow.cs.cso");
+		nvrhi::ShaderHandle RaytraceShader = AssetManager::GetInstance()->GetShader(AssetManager::GetInstance()->bQuantizedVertices ? "RaytraceShadowQuantized.cs.cso" : "RaytraceShadow.cs.cso");
 		PipelineDesc.CS = RaytraceShader;
 		nvrhi::ComputeState State;
 		State.pipeline = AssetManager::GetInstance()->GetComputePipeline(PipelineDesc);
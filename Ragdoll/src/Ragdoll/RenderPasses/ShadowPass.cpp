@@ -43,12 +43,16 @@ void ShadowPass::DrawAllInstances(
 		nvrhi::BindingSetItem::ConstantBuffer(0, ConstantBufferHandle),
 		nvrhi::BindingSetItem::StructuredBuffer_SRV(0, GPUScene->InstanceBuffer),
 	};
+	//packed positions are relative to the mesh box
+	const bool bQuantizedVertices = AssetManager::GetInstance()->bQuantizedVertices;
+	if (bQuantizedVertices)
+		BindingSetDesc.addItem(nvrhi::BindingSetItem::StructuredBuffer_SRV(1, GPUScene->MeshBuffer));
 	nvrhi::BindingLayoutHandle BindingLayoutHandle = AssetManager::GetInstance()->GetBindingLayout(BindingSetDesc);
 	nvrhi::BindingSetHandle BindingSetHandle = DirectXDevice::GetInstance()->CreateBindingSet(BindingSetDesc, BindingLayoutHandle);
 
 	nvrhi::GraphicsPipelineDesc PipelineDesc;
 	PipelineDesc.addBindingLayout(BindingLayoutHandle);
-	nvrhi::ShaderHandle VertexShader = AssetManager::GetInstance()->GetShader("DirectionalShadow.vs.cso");
+	nvrhi::ShaderHandle VertexShader = AssetManager::GetInstance()->GetShader(bQuantizedVertices ? "DirectionalShadowQuantized.vs.cso" : "DirectionalShadow.vs.cso");
 	PipelineDesc.setVertexShader(VertexShader);
 
 	PipelineDesc.renderState.depthStencilState.depthTestEnable = true;
@@ -14,6 +14,7 @@
 #include "Graphics/Window/Window.h"
 #include "NVSDK.h"
 #include "GPUScene.h"
+#include "LodSelection.h"
 
 ragdoll::Scene::Scene(Application* app)
 {
@@ -146,7 +147,7 @@ void ragdoll::Scene::Update(float _dt)
 		CreateRenderTargets();
 	}
 
-	GPUScene->Update(this);
+	GPUScene->Update(this, SelectProxyLods());
 	DeferredRenderer->Render(this, GPUScene.get(), _dt, ImguiInterface);
 
 	DirectXDevice::GetInstance()->Present();
@@ -655,7 +656,7 @@ void ragdoll::Scene::PopulateStaticProxies()
 			Proxy.ModelToWorld = tComp->m_ModelToWorld;
 			Proxy.PrevWorldMatrix = tComp->m_PrevModelToWorld;
 			Proxy.MaterialIndex = submesh.MaterialIndex;
-			Proxy.MeshIndex = submesh.VertexBufferIndex;
+			Proxy.MeshIndex = Proxy.BaseMeshIndex = submesh.VertexBufferIndex;
 			AssetManager::GetInstance()->VertexBufferInfos[Proxy.MeshIndex].BestFitBox.Transform(Proxy.BoundingBox, tComp->m_ModelToWorld);
 
 			//add meshlet count for debuf
@@ -668,6 +669,48 @@ void ragdoll::Scene::PopulateStaticProxies()
 	}
 }
 
+bool ragdoll::Scene::SelectProxyLods()
+{
+	RD_SCOPE(Render, Select Lods);
+	const std::vector<VertexBufferInfo>& Infos = AssetManager::GetInstance()->VertexBufferInfos;
+	//follow the frozen camera so the lods can be inspected from elsewhere
+	const Vector3 CameraPosition = DebugInfo.bFreezeFrustumCulling ? DebugInfo.FrozenCameraPosition : SceneInfo.MainCameraPosition;
+	const Matrix& Projection = DebugInfo.bFreezeFrustumCulling ? DebugInfo.FrozenProjection : SceneInfo.MainCameraProj;
+	const float ProjScale = 0.5f * SceneInfo.RenderHeight * Projection.m[1][1];
+	bool bChanged = false;
+	std::vector<float> LodErrors;
+	DebugInfo.LodTriangleCount = DebugInfo.FullDetailTriangleCount = 0;
+	for (Proxy& Proxy : StaticProxies)
+	{
+		const VertexBufferInfo& Base = Infos[Proxy.BaseMeshIndex];
+		uint32_t Lod = 0;
+		if (SceneInfo.bEnableLod && Base.LodCount > 0)
+		{
+			//errors are in mesh space, scale them by the largest axis of the transform
+			const float WorldScale = std::max({ Proxy.ModelToWorld.Right().Length(), Proxy.ModelToWorld.Up().Length(), Proxy.ModelToWorld.Backward().Length() });
+			LodErrors.resize(Base.LodCount + 1);
+			LodErrors[0] = 0.f;
+			for (uint32_t i = 0; i < Base.LodCount; ++i)
+				LodErrors[i + 1] = Infos[Base.FirstLodIndex + i].LodError * WorldScale;
+			//closest point of the bounds, errors anywhere on the mesh can be that close
+			const Vector3 Center = Proxy.BoundingBox.Center;
+			const Vector3 Extents = Proxy.BoundingBox.Extents;
+			Vector3 Offset = CameraPosition - Center;
+			Offset = Vector3::Max(Vector3(fabsf(Offset.x), fabsf(Offset.y), fabsf(Offset.z)) - Extents, Vector3::Zero);
+			Lod = SelectLod(LodErrors.data(), Base.LodCount + 1, Offset.Length(), ProjScale, SceneInfo.LodPixelError);
+		}
+		const uint32_t MeshIndex = Lod == 0 ? Proxy.BaseMeshIndex : Base.FirstLodIndex + Lod - 1;
+		if (Proxy.MeshIndex != MeshIndex)
+		{
+			Proxy.MeshIndex = MeshIndex;
+			bChanged = true;
+		}
+		DebugInfo.LodTriangleCount += Infos[MeshIndex].IndicesCount / 3;
+		DebugInfo.FullDetailTriangleCount += Base.IndicesCount / 3;
+	}
+	return bChanged;
+}
+
 float ComputeLightRange(float intensity, float k1, float k2, float minIntensity)
 {
 	// Compute the constant C for the quadratic equation
@@ -35,7 +35,10 @@ namespace ragdoll {
 	struct Proxy {
 		Matrix ModelToWorld;
 		Matrix PrevWorldMatrix;
+		//vertex buffer the proxy draws, one of the lods of BaseMeshIndex
 		uint32_t MeshIndex;
+		//full detail vertex buffer of the submesh
+		uint32_t BaseMeshIndex;
 		uint32_t MaterialIndex;
 		DirectX::BoundingBox BoundingBox;
 	};
@@ -82,6 +85,9 @@ namespace ragdoll {
 		uint32_t MeshletFrustumCullCount{};
 		uint32_t MeshletOcclusion1CullCount{};
 		uint32_t MeshletOcclusion2CullCount{};
+		//triangles of every proxy with the selected lods and with the full detail meshes
+		uint32_t LodTriangleCount{};
+		uint32_t FullDetailTriangleCount{};
 	};
 
 	struct SceneConfig {
@@ -156,6 +162,9 @@ namespace ragdoll {
 		bool bEnableMeshletOcclusionCulling{ true };
 		bool bEnableMeshletColors{ false };
 		bool bEnableInstanceColors{ false };
+		bool bEnableLod{ true };
+		//how far a lod may stray from the full detail mesh on screen
+		float LodPixelError{ 1.f };
 		float SunSize = 0.1f;
 		uint32_t RenderWidth = 1920;
 		uint32_t RenderHeight = 1080;
@@ -310,6 +319,8 @@ namespace ragdoll {
 		nvrhi::BufferHandle LineBufferHandle;	//contains all the lines to draw
 
 		void PopulateStaticProxies();
+		//picks the lod of every static proxy from the main camera, returns true if any of them changed
+		bool SelectProxyLods();
 		void PopulateLightProxies();
 		void BuildDebugInstances(std::vector<InstanceData>& instances);
 
@@ -0,0 +1,799 @@
+#include "ragdollpch.h"
+#include "ShaderBuild.h"
+
+#include "Executor.h"
+#include "Profiler.h"
+#include "Ragdoll/Core/Hash.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <dlfcn.h>
+#endif
+#include <dxcapi.h>
+#include <nvrhi/nvrhi.h>
+
+namespace
+{
+	//'RDSB'
+	constexpr uint32_t IndexMagic = 0x42534452;
+
+	struct IndexHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint64_t EntryCount;
+	};
+
+	//options of dxc that take the next argument as their value
+	bool TakesValue(const std::string& option)
+	{
+		static const std::unordered_set<std::string> Options = { "-T", "-E", "-D", "-I", "-Fo", "-Fd", "-Fe", "-Fh", "-Fc", "-Vn", "-HV" };
+		return Options.contains(option);
+	}
+
+	//splits a line on whitespace, quoted arguments keep their spaces and lose their quotes
+	std::vector<std::string> SplitArguments(const std::string& line)
+	{
+		std::vector<std::string> Arguments;
+		std::string Current;
+		bool bQuoted{ false };
+		bool bInArgument{ false };
+		for (char Char : line)
+		{
+			if (Char == '"')
+			{
+				bQuoted = !bQuoted;
+				bInArgument = true;
+			}
+			else if (!bQuoted && std::isspace(static_cast<unsigned char>(Char)))
+			{
+				if (bInArgument)
+					Arguments.push_back(std::move(Current));
+				Current.clear();
+				bInArgument = false;
+			}
+			else
+			{
+				Current += Char;
+				bInArgument = true;
+			}
+		}
+		if (bInArgument)
+			Arguments.push_back(std::move(Current));
+		return Arguments;
+	}
+
+	bool ReadWholeFile(const std::filesystem::path& path, std::vector<uint8_t>& data)
+	{
+		std::ifstream In(path, std::ios::binary | std::ios::ate);
+		if (!In)
+			return false;
+		data.resize(static_cast<size_t>(In.tellg()));
+		In.seekg(0);
+		In.read(reinterpret_cast<char*>(data.data()), data.size());
+		return static_cast<bool>(In);
+	}
+
+	//write to a temporary file first so a crash or a failed write never leaves a truncated file behind
+	bool WriteWholeFile(const std::filesystem::path& path, const uint8_t* data, size_t size)
+	{
+		std::filesystem::path TempPath = path;
+		TempPath += ".tmp";
+		{
+			std::ofstream Out(TempPath, std::ios::binary | std::ios::trunc);
+			if (!Out)
+				return false;
+			Out.write(reinterpret_cast<const char*>(data), size);
+			if (!Out)
+				return false;
+		}
+		std::error_code ec;
+		std::filesystem::rename(TempPath, path, ec);
+		if (ec)
+		{
+			std::filesystem::remove(TempPath, ec);
+			return false;
+		}
+		return true;
+	}
+
+	uint64_t HashString(const std::string& value, uint64_t seed)
+	{
+		const uint64_t Size = value.size();
+		return ragdoll::Hash64(value.data(), value.size(), ragdoll::Hash64(&Size, sizeof(Size), seed));
+	}
+
+	struct ScannedInclude
+	{
+		std::string Name;
+		bool bQuoted;
+	};
+
+	//the #include lines, conditional ones too, an include that is never taken only costs a compile too many
+	std::vector<ScannedInclude> ScanIncludes(const std::vector<uint8_t>& data)
+	{
+		std::vector<ScannedInclude> Includes;
+		const char* Current = reinterpret_cast<const char*>(data.data());
+		const char* End = Current + data.size();
+		auto SkipBlanks = [&]() {
+			while (Current < End && (*Current == ' ' || *Current == '\t'))
+				++Current;
+		};
+		while (Current < End)
+		{
+			SkipBlanks();
+			if (Current < End && *Current == '#')
+			{
+				++Current;
+				SkipBlanks();
+				static constexpr std::string_view Include = "include";
+				if (static_cast<size_t>(End - Current) > Include.size() && std::string_view(Current, Include.size()) == Include)
+				{
+					Current += Include.size();
+					SkipBlanks();
+					if (Current < End && (*Current == '"' || *Current == '<'))
+					{
+						const char Close = *Current == '"' ? '"' : '>';
+						const char* NameBegin = ++Current;
+						while (Current < End && *Current != Close && *Current != '\n')
+							++Current;
+						if (Current < End && *Current == Close)
+							Includes.push_back({ std::string(NameBegin, Current), Close == '"' });
+					}
+				}
+			}
+			while (Current < End && *Current != '\n')
+				++Current;
+			if (Current < End)
+				++Current;
+		}
+		return Includes;
+	}
+
+	class DxcLibraryCompiler final : public ShaderCompiler
+	{
+	public:
+		~DxcLibraryCompiler() override
+		{
+			if (!Library)
+				return;
+#ifdef _WIN32
+			FreeLibrary(static_cast<HMODULE>(Library));
+#else
+			dlclose(Library);
+#endif
+		}
+
+		bool Load()
+		{
+#ifdef _WIN32
+			Library = LoadLibraryW(L"dxcompiler.dll");
+			//where the old compile script ran dxc from
+			if (!Library)
+				Library = LoadLibraryW(L"C:\\Program Files (x86)\\Windows Kits\\10\\bin\\10.0.22621.0\\x64\\dxcompiler.dll");
+			if (Library)
+				CreateInstance = reinterpret_cast<DxcCreateInstanceProc>(GetProcAddress(static_cast<HMODULE>(Library), "DxcCreateInstance"));
+#else
+			Library = dlopen("libdxcompiler.so", RTLD_NOW | RTLD_LOCAL);
+			if (Library)
+				CreateInstance = reinterpret_cast<DxcCreateInstanceProc>(dlsym(Library, "DxcCreateInstance"));
+#endif
+			if (!CreateInstance)
+				return false;
+			nvrhi::RefCountPtr<IDxcCompiler3> Compiler;
+			if (FAILED(CreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&Compiler))))
+				return false;
+			uint32_t Major{}, Minor{};
+			nvrhi::RefCountPtr<IDxcVersionInfo> VersionInfo;
+			if (SUCCEEDED(Compiler->QueryInterface(IID_PPV_ARGS(&VersionInfo))))
+				VersionInfo->GetVersion(&Major, &Minor);
+			Version = "dxc " + std::to_string(Major) + "." + std::to_string(Minor);
+			nvrhi::RefCountPtr<IDxcVersionInfo2> CommitInfo;
+			uint32_t CommitCount{};
+			char* CommitHash{};
+			if (SUCCEEDED(Compiler->QueryInterface(IID_PPV_ARGS(&CommitInfo))) && SUCCEEDED(CommitInfo->GetCommitInfo(&CommitCount, &CommitHash)) && CommitHash)
+			{
+				Version += std::string(" ") + CommitHash;
+				CoTaskMemFree(CommitHash);
+			}
+			return true;
+		}
+
+		const std::string& GetVersion() const override { return Version; }
+
+		bool Compile(const ShaderPermutation& permutation, std::vector<uint8_t>& bytecode, std::string& errors) override
+		{
+			//a compiler instance is not thread safe, one per compile costs nothing next to the compile itself
+			nvrhi::RefCountPtr<IDxcUtils> Utils;
+			nvrhi::RefCountPtr<IDxcCompiler3> Compiler;
+			nvrhi::RefCountPtr<IDxcIncludeHandler> IncludeHandler;
+			if (FAILED(CreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(&Utils))) || FAILED(CreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&Compiler)))
+				|| FAILED(Utils->CreateDefaultIncludeHandler(&IncludeHandler)))
+			{
+				errors = "dxc could not be instanced";
+				return false;
+			}
+			std::vector<uint8_t> Source;
+			if (!ReadWholeFile(permutation.Source, Source))
+			{
+				errors = "could not read " + permutation.Source.string();
+				return false;
+			}
+			//the source goes in by its absolute path, dxc looks for quoted includes next to it
+			std::vector<std::wstring> Arguments;
+			Arguments.push_back(permutation.Source.wstring());
+			for (const std::string& Argument : permutation.Arguments)
+				Arguments.push_back(std::filesystem::path(Argument).wstring());
+			std::vector<LPCWSTR> ArgumentPointers;
+			for (const std::wstring& Argument : Arguments)
+				ArgumentPointers.push_back(Argument.c_str());
+
+			DxcBuffer Buffer{ Source.data(), Source.size(), DXC_CP_ACP };
+			nvrhi::RefCountPtr<IDxcResult> Result;
+			if (FAILED(Compiler->Compile(&Buffer, ArgumentPointers.data(), static_cast<uint32_t>(ArgumentPointers.size()), IncludeHandler, IID_PPV_ARGS(&Result))))
+			{
+				errors = "dxc failed to run";
+				return false;
+			}
+			nvrhi::RefCountPtr<IDxcBlobUtf8> Errors;
+			if (SUCCEEDED(Result->GetOutput(DXC_OUT_ERRORS, IID_PPV_ARGS(&Errors), nullptr)) && Errors && Errors->GetStringLength())
+				errors.assign(Errors->GetStringPointer(), Errors->GetStringLength());
+			HRESULT Status{};
+			Result->GetStatus(&Status);
+			nvrhi::RefCountPtr<IDxcBlob> Object;
+			if (FAILED(Status) || FAILED(Result->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(&Object), nullptr)) || !Object)
+				return false;
+			const uint8_t* Data = static_cast<const uint8_t*>(Object->GetBufferPointer());
+			bytecode.assign(Data, Data + Object->GetBufferSize());
+			return true;
+		}
+
+	private:
+		void* Library{};
+		DxcCreateInstanceProc CreateInstance{};
+		std::string Version;
+	};
+}
+
+std::unique_ptr<ShaderCompiler> ShaderCompiler::CreateDxc()
+{
+	std::unique_ptr<DxcLibraryCompiler> Compiler = std::make_unique<DxcLibraryCompiler>();
+	if (!Compiler->Load())
+		return nullptr;
+	return Compiler;
+}
+
+ShaderBuild::ShaderBuild(std::filesystem::path configPath, std::filesystem::path outputDir, std::filesystem::path storeDir)
+	: ConfigPath(std::move(configPath)), OutputDir(std::move(outputDir)), StoreDir(std::move(storeDir))
+{
+}
+
+bool ShaderBuild::LoadConfig()
+{
+	std::ifstream In(ConfigPath);
+	if (!In)
+	{
+		RD_CORE_ERROR("Shader config {} could not be opened", ConfigPath.string());
+		return false;
+	}
+	Permutations.clear();
+	const std::filesystem::path ConfigDir = std::filesystem::absolute(ConfigPath).parent_path();
+	std::string Line;
+	size_t LineNumber{};
+	while (std::getline(In, Line))
+	{
+		++LineNumber;
+		const std::vector<std::string> Arguments = SplitArguments(Line);
+		if (Arguments.empty())
+			continue;
+		ShaderPermutation Permutation;
+		for (size_t i = 0; i < Arguments.size(); ++i)
+		{
+			const std::string& Argument = Arguments[i];
+			const bool bHasValue = TakesValue(Argument) && i + 1 < Arguments.size();
+			if (Argument == "-Fo" && bHasValue)
+				Permutation.Output = std::filesystem::path(Arguments[++i]).filename().string();
+			else if (Argument == "-I" && bHasValue)
+			{
+				Permutation.IncludeDirs.push_back((ConfigDir / Arguments[++i]).lexically_normal());
+				Permutation.Arguments.push_back(Argument);
+				Permutation.Arguments.push_back(Permutation.IncludeDirs.back().string());
+			}
+			else if (bHasValue)
+			{
+				Permutation.Arguments.push_back(Argument);
+				Permutation.Arguments.push_back(Arguments[++i]);
+			}
+			else if (Argument[0] == '-' || !Permutation.Source.empty())
+				Permutation.Arguments.push_back(Argument);
+			else
+				Permutation.Source = (ConfigDir / Argument).lexically_normal();
+		}
+		if (Permutation.Source.empty() || Permutation.Output.empty())
+		{
+			RD_CORE_ERROR("{}:{} has no source or no -Fo output, skipped", ConfigPath.string(), LineNumber);
+			continue;
+		}
+		Permutations.push_back(std::move(Permutation));
+	}
+	LoadIndex();
+	return true;
+}
+
+uint32_t ShaderBuild::GetFile(const std::filesystem::path& path)
+{
+	auto [It, bInserted] = FileIndices.try_emplace(path.generic_string(), static_cast<uint32_t>(Files.size()));
+	if (!bInserted)
+		return It->second;
+	SourceFile& File = Files.emplace_back();
+	File.Path = path;
+	std::vector<uint8_t> Data;
+	if (std::filesystem::is_regular_file(path) && ReadWholeFile(path, Data))
+	{
+		File.bFound = true;
+		File.Hash = ragdoll::Hash64(Data.data(), Data.size());
+		for (ScannedInclude& Scanned : ScanIncludes(Data))
+			File.Includes.push_back({ std::move(Scanned.Name), Scanned.bQuoted });
+	}
+	return It->second;
+}
+
+void ShaderBuild::Scan(const std::string& compilerVersion)
+{
+	RD_SCOPE(Shaders, Scan);
+	//contents can have changed since the last build, everything is read again
+	Files.clear();
+	FileIndices.clear();
+	const std::filesystem::path ConfigDir = std::filesystem::absolute(ConfigPath).parent_path();
+	for (ShaderPermutation& Permutation : Permutations)
+	{
+		//every path an include was looked for at, up to where it was found
+		//a file that shows up earlier in the search order later on changes what is included, so the misses go into the key as well
+		std::vector<uint32_t> Searched;
+		std::vector<uint32_t> Pending{ GetFile(Permutation.Source) };
+		std::unordered_set<uint32_t> Visited{ Pending.back() };
+		while (!Pending.empty())
+		{
+			const uint32_t Index = Pending.back();
+			Pending.pop_back();
+			Searched.push_back(Index);
+			if (!Files[Index].bFound)
+				continue;
+			const std::filesystem::path Directory = Files[Index].Path.parent_path();
+			//GetFile can grow Files, no references into it across the lookups
+			const std::vector<Include> Includes = Files[Index].Includes;
+			for (const Include& Included : Includes)
+			{
+				std::vector<std::filesystem::path> Candidates;
+				if (Included.bQuoted)
+					Candidates.push_back((Directory / Included.Name).lexically_normal());
+				for (const std::filesystem::path& IncludeDir : Permutation.IncludeDirs)
+					Candidates.push_back((IncludeDir / Included.Name).lexically_normal());
+				for (const std::filesystem::path& Candidate : Candidates)
+				{
+					const uint32_t CandidateIndex = GetFile(Candidate);
+					if (Visited.insert(CandidateIndex).second)
+					{
+						if (Files[CandidateIndex].bFound)
+							Pending.push_back(CandidateIndex);
+						else
+							Searched.push_back(CandidateIndex);
+					}
+					if (Files[CandidateIndex].bFound)
+						break;
+				}
+			}
+		}
+		std::sort(Searched.begin(), Searched.end(), [this](uint32_t a, uint32_t b) { return Files[a].Path < Files[b].Path; });
+
+		uint64_t Key = ragdoll::Hash64(&Version, sizeof(Version));
+		Key = HashString(compilerVersion, Key);
+		for (size_t i = 0; i < Permutation.Arguments.size(); ++i)
+		{
+			//where the includes came from is covered by the dependencies, the tree can move without invalidating anything
+			if (Permutation.Arguments[i] == "-I")
+			{
+				++i;
+				continue;
+			}
+			Key = HashString(Permutation.Arguments[i], Key);
+		}
+		Permutation.Dependencies.clear();
+		for (uint32_t Index : Searched)
+		{
+			const SourceFile& File = Files[Index];
+			Key = HashString(File.Path.lexically_relative(ConfigDir).generic_string(), Key);
+			Key = ragdoll::Hash64(&File.bFound, sizeof(File.bFound), Key);
+			Key = ragdoll::Hash64(&File.Hash, sizeof(File.Hash), Key);
+			if (File.bFound)
+				Permutation.Dependencies.push_back(File.Path);
+		}
+		Permutation.Key = Key;
+	}
+}
+
+std::filesystem::path ShaderBuild::GetStorePath(uint64_t key) const
+{
+	return StoreDir / fmt::format("{:016x}.cso", key);
+}
+
+std::vector<size_t> ShaderBuild::GetDependents(const std::filesystem::path& file) const
+{
+	const std::filesystem::path Path = std::filesystem::absolute(file).lexically_normal();
+	std::vector<size_t> Dependents;
+	for (size_t i = 0; i < Permutations.size(); ++i)
+	{
+		const std::vector<std::filesystem::path>& Dependencies = Permutations[i].Dependencies;
+		if (std::find(Dependencies.begin(), Dependencies.end(), Path) != Dependencies.end())
+			Dependents.push_back(i);
+	}
+	return Dependents;
+}
+
+ShaderBuild::Result ShaderBuild::Build(ShaderCompiler& compiler, bool bParallel)
+{
+	RD_SCOPE(Shaders, Build);
+	Result BuildResult;
+	BuildResult.Permutations = Permutations.size();
+	auto Start = std::chrono::high_resolution_clock::now();
+	std::error_code ec;
+	std::filesystem::create_directories(OutputDir, ec);
+	std::filesystem::create_directories(StoreDir, ec);
+
+	Scan(compiler.GetVersion());
+	auto ScanEnd = std::chrono::high_resolution_clock::now();
+	BuildResult.ScanMs = std::chrono::duration<double, std::milli>(ScanEnd - Start).count();
+
+	//permutations with the same arguments and sources share a key and are compiled once
+	std::vector<size_t> ToCompile;
+	std::unordered_set<uint64_t> Queued;
+	for (size_t i = 0; i < Permutations.size(); ++i)
+	{
+		if (!std::filesystem::exists(GetStorePath(Permutations[i].Key)) && Queued.insert(Permutations[i].Key).second)
+			ToCompile.push_back(i);
+	}
+	std::vector<uint8_t> Succeeded(ToCompile.size());
+	auto CompileOne = [&](size_t i) {
+		const ShaderPermutation& Permutation = Permutations[ToCompile[i]];
+		std::vector<uint8_t> Bytecode;
+		std::string Errors;
+		if (!compiler.Compile(Permutation, Bytecode, Errors))
+		{
+			RD_CORE_ERROR("Shader {} failed to compile\n{}", Permutation.Output, Errors);
+			return;
+		}
+		if (!Errors.empty())
+			RD_CORE_WARN("Shader {}\n{}", Permutation.Output, Errors);
+		if (!WriteWholeFile(GetStorePath(Permutation.Key), Bytecode.data(), Bytecode.size()))
+		{
+			RD_CORE_ERROR("Shader {} could not be written to the store", Permutation.Output);
+			return;
+		}
+		Succeeded[i] = true;
+	};
+	if (bParallel)
+	{
+		tf::Taskflow Taskflow;
+		for (size_t i = 0; i < ToCompile.size(); ++i)
+			Taskflow.emplace([&CompileOne, i]() { CompileOne(i); });
+		SExecutor::Run(Taskflow);
+	}
+	else
+	{
+		for (size_t i = 0; i < ToCompile.size(); ++i)
+			CompileOne(i);
+	}
+	std::unordered_set<uint64_t> FailedKeys;
+	for (size_t i = 0; i < ToCompile.size(); ++i)
+	{
+		if (Succeeded[i])
+			++BuildResult.Compiled;
+		else
+			FailedKeys.insert(Permutations[ToCompile[i]].Key);
+	}
+	auto CompileEnd = std::chrono::high_resolution_clock::now();
+	BuildResult.CompileMs = std::chrono::duration<double, std::milli>(CompileEnd - ScanEnd).count();
+
+	for (const ShaderPermutation& Permutation : Permutations)
+	{
+		if (FailedKeys.contains(Permutation.Key))
+		{
+			++BuildResult.Failed;
+			continue;
+		}
+		const std::filesystem::path OutputPath = OutputDir / Permutation.Output;
+		auto It = Installed.find(Permutation.Output);
+		if (It != Installed.end() && It->second == Permutation.Key && std::filesystem::exists(OutputPath))
+			continue;
+		if (!Queued.contains(Permutation.Key))
+			++BuildResult.Reused;
+		std::vector<uint8_t> Bytecode;
+		std::vector<uint8_t> Current;
+		if (!ReadWholeFile(GetStorePath(Permutation.Key), Bytecode))
+		{
+			RD_CORE_ERROR("Shader {} is missing from the store", Permutation.Output);
+			++BuildResult.Failed;
+			continue;
+		}
+		//an edit that does not change the bytecode, like a comment, leaves the loaded shader and its pipelines alone
+		const bool bChanged = !ReadWholeFile(OutputPath, Current) || Current != Bytecode;
+		if (bChanged && !WriteWholeFile(OutputPath, Bytecode.data(), Bytecode.size()))
+		{
+			RD_CORE_ERROR("Shader {} could not be written", OutputPath.string());
+			++BuildResult.Failed;
+			continue;
+		}
+		Installed[Permutation.Output] = Permutation.Key;
+		if (bChanged)
+			BuildResult.Changed.push_back(Permutation.Output);
+	}
+	SaveIndex();
+	BuildResult.TotalMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - Start).count();
+	return BuildResult;
+}
+
+void ShaderBuild::LoadIndex()
+{
+	Installed.clear();
+	std::vector<uint8_t> Data;
+	if (!ReadWholeFile(StoreDir / "index.rdsb", Data) || Data.size() < sizeof(IndexHeader))
+		return;
+	IndexHeader Header;
+	memcpy(&Header, Data.data(), sizeof(Header));
+	if (Header.Magic != IndexMagic || Header.Version != Version)
+		return;
+	//every entry is the length of the output name, the name and the key installed under it
+	size_t Offset = sizeof(Header);
+	std::unordered_map<std::string, uint64_t> Entries;
+	for (uint64_t i = 0; i < Header.EntryCount; ++i)
+	{
+		uint32_t NameSize;
+		if (Data.size() - Offset < sizeof(NameSize))
+			return;
+		memcpy(&NameSize, Data.data() + Offset, sizeof(NameSize));
+		Offset += sizeof(NameSize);
+		uint64_t Key;
+		if (Data.size() - Offset < static_cast<size_t>(NameSize) + sizeof(Key))
+			return;
+		std::string Name(reinterpret_cast<const char*>(Data.data() + Offset), NameSize);
+		Offset += NameSize;
+		memcpy(&Key, Data.data() + Offset, sizeof(Key));
+		Offset += sizeof(Key);
+		Entries[std::move(Name)] = Key;
+	}
+	if (Offset == Data.size())
+		Installed = std::move(Entries);
+}
+
+void ShaderBuild::SaveIndex() const
+{
+	std::vector<uint8_t> Data(sizeof(IndexHeader));
+	const IndexHeader Header{ IndexMagic, Version, Installed.size() };
+	memcpy(Data.data(), &Header, sizeof(Header));
+	auto Append = [&Data](const void* bytes, size_t size) {
+		Data.insert(Data.end(), static_cast<const uint8_t*>(bytes), static_cast<const uint8_t*>(bytes) + size);
+	};
+	for (const auto& [Name, Key] : Installed)
+	{
+		const uint32_t NameSize = static_cast<uint32_t>(Name.size());
+		Append(&NameSize, sizeof(NameSize));
+		Append(Name.data(), Name.size());
+		Append(&Key, sizeof(Key));
+	}
+	if (!WriteWholeFile(StoreDir / "index.rdsb", Data.data(), Data.size()))
+		RD_CORE_ERROR("Shader build index {} could not be written", (StoreDir / "index.rdsb").string());
+}
+
+namespace
+{
+	//compiles to a hash of the arguments and of every dependency, fails on any dependency with a stand in error in it
+	//just as deterministic as dxc, so the store and the changed list behave the same
+	class StandInCompiler final : public ShaderCompiler
+	{
+	public:
+		//not #error, real headers have those behind their #ifs
+		static constexpr std::string_view ErrorMarker = "#stand_in_error";
+
+		explicit StandInCompiler(std::chrono::microseconds cost) : Cost(cost) {}
+
+		const std::string& GetVersion() const override { return Version; }
+
+		bool Compile(const ShaderPermutation& permutation, std::vector<uint8_t>& bytecode, std::string& errors) override
+		{
+			Calls.fetch_add(1, std::memory_order_relaxed);
+			std::this_thread::sleep_for(Cost);
+			uint64_t Hash{};
+			for (const std::string& Argument : permutation.Arguments)
+				Hash = HashString(Argument, Hash);
+			for (const std::filesystem::path& Dependency : permutation.Dependencies)
+			{
+				std::vector<uint8_t> Data;
+				ReadWholeFile(Dependency, Data);
+				if (std::string_view(reinterpret_cast<const char*>(Data.data()), Data.size()).find(ErrorMarker) != std::string_view::npos)
+				{
+					errors = Dependency.filename().string() + ": stand in error";
+					return false;
+				}
+				Hash = ragdoll::Hash64(Data.data(), Data.size(), Hash);
+			}
+			bytecode.resize(64);
+			for (size_t i = 0; i < bytecode.size(); i += sizeof(Hash))
+			{
+				memcpy(bytecode.data() + i, &Hash, sizeof(Hash));
+				Hash = ragdoll::Hash64(&Hash, sizeof(Hash));
+			}
+			return true;
+		}
+
+		size_t GetCalls() const { return Calls.load(std::memory_order_relaxed); }
+
+	private:
+		std::chrono::microseconds Cost;
+		std::string Version{ "stand in 1" };
+		std::atomic<size_t> Calls{};
+	};
+
+	void WriteText(const std::filesystem::path& path, const std::string& text)
+	{
+		std::filesystem::create_directories(path.parent_path());
+		std::ofstream(path, std::ios::binary | std::ios::trunc) << text;
+	}
+
+	std::vector<std::string> Sorted(std::vector<std::string> names)
+	{
+		std::sort(names.begin(), names.end());
+		return names;
+	}
+}
+
+bool VerifyShaderBuild()
+{
+	const std::filesystem::path Root = std::filesystem::temp_directory_path() / "ragdoll_shader_build_verify";
+	std::error_code ec;
+	std::filesystem::remove_all(Root, ec);
+
+	WriteText(Root / "Utils.hlsli", "float Square(float x) { return x * x; }\n");
+	WriteText(Root / "Common.hlsli", "#pragma once\n#include \"Utils.hlsli\"\n");
+	WriteText(Root / "inc" / "Lighting.hlsli", "float Light() { return 1; }\n");
+	WriteText(Root / "A.hlsl", "#include \"Common.hlsli\"\n  #  include \"Utils.hlsli\"\nfloat4 main_vs() : SV_Position { return Square(2); }\n");
+	WriteText(Root / "B.hlsl", "#include \"Lighting.hlsli\"\nfloat4 main_ps() : SV_Target { return Light(); }\n");
+	WriteText(Root / "C.hlsl", "[numthreads(8, 8, 1)] void main() {}\n");
+	WriteText(Root / "shaders.cfg",
+		"A.hlsl -T vs_6_0 -E main_vs -Fo \"cso/A.vs.cso\" -Zpr\n"
+		"A.hlsl -T ps_6_0 -E main_ps -Fo \"cso/A.ps.cso\" -Zpr\n"
+		"A.hlsl -T ps_6_0 -E main_ps -D \"NON_OPAQUE\" -Fo \"cso/AAlpha.ps.cso\" -Zpr\n"
+		"\n"
+		"B.hlsl -I \"inc\" -T ps_6_0 -E main_ps -Fo \"cso/B.ps.cso\" -Zpr\n"
+		"C.hlsl -T cs_6_0 -E main -Fo \"cso/C.cs.cso\" -Zpr\n"
+		"C.hlsl -T cs_6_0 -E main -Fo \"cso/CCopy.cs.cso\" -Zpr\n");
+	const std::vector<std::string> AOutputs = { "A.ps.cso", "A.vs.cso", "AAlpha.ps.cso" };
+
+	bool bPassed = true;
+	auto Check = [&bPassed](bool bCondition, const std::string& what) {
+		if (!bCondition)
+		{
+			RD_CORE_ERROR("Shader build check failed: {}", what);
+			bPassed = false;
+		}
+	};
+	auto ReadOutput = [&Root](const std::string& name) {
+		std::vector<uint8_t> Data;
+		ReadWholeFile(Root / "cso" / name, Data);
+		return Data;
+	};
+	StandInCompiler Compiler{ std::chrono::microseconds(0) };
+	//a fresh build object every time, like a new run of the engine, everything it knows comes from the index
+	auto Run = [&](bool bParallel = true) {
+		ShaderBuild Build(Root / "shaders.cfg", Root / "cso", Root / "cache" / "shaders");
+		Check(Build.LoadConfig(), "config loads");
+		ShaderBuild::Result Result = Build.Build(Compiler, bParallel);
+		Result.Changed = Sorted(Result.Changed);
+		return std::make_pair(std::move(Build), std::move(Result));
+	};
+
+	{
+		auto [Build, Result] = Run();
+		Check(Result.Permutations == 6, "blank lines are skipped");
+		Check(Result.Compiled == 5 && Compiler.GetCalls() == 5, "identical permutations compile once");
+		Check(Result.Failed == 0 && Result.Changed.size() == 6, "a cold build installs everything");
+		Check(ReadOutput("C.cs.cso") == ReadOutput("CCopy.cs.cso") && !ReadOutput("C.cs.cso").empty(), "shared keys install the same bytecode");
+		Check(Build.GetPermutations()[0].Dependencies.size() == 3, "includes are followed through headers and counted once");
+		Check(Build.GetDependents(Root / "inc" / "Lighting.hlsli") == std::vector<size_t>{ 3 }, "includes resolve through the include directories");
+	}
+	{
+		auto [Build, Result] = Run();
+		Check(Result.Compiled == 0 && Result.Reused == 0 && Result.Changed.empty(), "nothing changed, nothing is built");
+	}
+	const std::vector<uint8_t> OldA = ReadOutput("A.vs.cso");
+	WriteText(Root / "Utils.hlsli", "float Square(float x) { return x * x * 1; }\n");
+	{
+		auto [Build, Result] = Run();
+		Check(Result.Compiled == 3 && Result.Changed == AOutputs, "an edited header only rebuilds what includes it");
+		Check(Build.GetDependents(Root / "Utils.hlsli") == std::vector<size_t>{ 0, 1, 2 }, "dependents of an edited header");
+		Check(ReadOutput("A.vs.cso") != OldA, "the rebuilt output is installed");
+	}
+	WriteText(Root / "Utils.hlsli", "float Square(float x) { return x * x; }\n");
+	{
+		const size_t Calls = Compiler.GetCalls();
+		auto [Build, Result] = Run();
+		Check(Compiler.GetCalls() == Calls && Result.Reused == 3 && Result.Changed == AOutputs, "a reverted edit comes back out of the store");
+		Check(ReadOutput("A.vs.cso") == OldA, "the reverted output is the old bytecode");
+	}
+	const std::vector<uint8_t> OldB = ReadOutput("B.ps.cso");
+	WriteText(Root / "inc" / "Lighting.hlsli", std::string(StandInCompiler::ErrorMarker) + "\n");
+	{
+		auto [Build, Result] = Run(false);
+		Check(Result.Failed == 1 && Result.Changed.empty(), "a failed compile changes nothing");
+		Check(ReadOutput("B.ps.cso") == OldB, "a failed compile keeps the old output");
+	}
+	WriteText(Root / "inc" / "Lighting.hlsli", "float Light() { return 1; }\n");
+	{
+		const size_t Calls = Compiler.GetCalls();
+		auto [Build, Result] = Run();
+		Check(Compiler.GetCalls() == Calls && Result.Failed == 0 && Result.Changed.empty(), "a fixed compile comes back out of the store unchanged");
+	}
+	//quoted includes look next to the including file before the include directories
+	WriteText(Root / "Lighting.hlsli", "float Light() { return 2; }\n");
+	{
+		auto [Build, Result] = Run();
+		Check(Result.Compiled == 1 && Result.Changed == std::vector<std::string>{ "B.ps.cso" }, "a header that now shadows an include rebuilds its users");
+		Check(Build.GetDependents(Root / "inc" / "Lighting.hlsli").empty(), "the shadowed header is no longer a dependency");
+	}
+	std::filesystem::remove(Root / "cso" / "C.cs.cso", ec);
+	{
+		auto [Build, Result] = Run();
+		Check(Result.Compiled == 0 && Result.Changed == std::vector<std::string>{ "C.cs.cso" }, "a deleted output is installed again");
+	}
+
+	std::filesystem::remove_all(Root, ec);
+	if (bPassed)
+		RD_CORE_INFO("Shader build checks passed");
+	return bPassed;
+}
+
+void BenchmarkShaderBuild(const std::filesystem::path& assetRoot)
+{
+	const std::filesystem::path Scratch = std::filesystem::temp_directory_path() / "ragdoll_shader_build_bench";
+	std::error_code ec;
+	std::filesystem::remove_all(Scratch, ec);
+
+	std::unique_ptr<ShaderCompiler> Compiler = ShaderCompiler::CreateDxc();
+	if (!Compiler)
+	{
+		RD_CORE_WARN("dxcompiler could not be loaded, timing a stand in compiler that takes 20ms per permutation");
+		Compiler = std::make_unique<StandInCompiler>(std::chrono::milliseconds(20));
+	}
+	RD_CORE_INFO("Shader build of {} with {} on {} workers", (assetRoot / "shaders.cfg").string(), Compiler->GetVersion(), SExecutor::Executor.num_workers());
+
+	auto Report = [](const char* what, const ShaderBuild::Result& result) {
+		RD_CORE_INFO("{:<36} {:>8.1f}ms, scan {:.1f}ms, {} compiled, {} from the store, {} failed, {} changed",
+			what, result.TotalMs, result.ScanMs, result.Compiled, result.Reused, result.Failed, result.Changed.size());
+	};
+	auto MakeBuild = [&]() {
+		ShaderBuild Build(assetRoot / "shaders.cfg", Scratch / "cso", Scratch / "store");
+		Build.LoadConfig();
+		return Build;
+	};
+
+	{
+		//one permutation after the other, what the compile script did
+		ShaderBuild Build = MakeBuild();
+		Report("full, serial", Build.Build(*Compiler, false));
+	}
+	std::filesystem::remove_all(Scratch, ec);
+	ShaderBuild Build = MakeBuild();
+	Report("full, parallel", Build.Build(*Compiler));
+	Report("nothing changed", MakeBuild().Build(*Compiler));
+
+	//an edit to a header throws away the store entries of what includes it, the same work as a real edit without touching the tree
+	for (const char* Header : { "BasePassCommons.hlsli", "Utils.hlsli", "ShadingModel.hlsli" })
+	{
+		const std::vector<size_t> Dependents = Build.GetDependents(assetRoot / Header);
+		for (size_t i : Dependents)
+			std::filesystem::remove(Build.GetStorePath(Build.GetPermutations()[i].Key), ec);
+		const std::string What = fmt::format("{} edited, {} users", Header, Dependents.size());
+		Report(What.c_str(), MakeBuild().Build(*Compiler));
+	}
+	std::filesystem::remove_all(Scratch, ec);
+}
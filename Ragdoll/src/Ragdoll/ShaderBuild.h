@@ -0,0 +1,104 @@
+#pragma once
+
+//one line of shaders.cfg, a source compiled with one set of arguments into one cso
+struct ShaderPermutation
+{
+	std::filesystem::path Source;
+	//file name under cso/, what the asset manager looks the shader up by
+	std::string Output;
+	//every argument but the source and -Fo, include directories are made absolute
+	std::vector<std::string> Arguments;
+	std::vector<std::filesystem::path> IncludeDirs;
+	//the source and every file it includes, directly or not
+	std::vector<std::filesystem::path> Dependencies;
+	//content hash of the compiler, the arguments and every dependency, the name of the output in the store
+	uint64_t Key{};
+};
+
+//turns one permutation into bytecode, called from many threads at once
+class ShaderCompiler
+{
+public:
+	virtual ~ShaderCompiler() = default;
+	//goes into every key, output of another compiler version is never reused
+	virtual const std::string& GetVersion() const = 0;
+	virtual bool Compile(const ShaderPermutation& permutation, std::vector<uint8_t>& bytecode, std::string& errors) = 0;
+
+	//dxcompiler loaded at runtime, the dll next to the exe or in the windows sdk, libdxcompiler.so elsewhere, null if there is none
+	static std::unique_ptr<ShaderCompiler> CreateDxc();
+};
+
+//builds the permutations of shaders.cfg into cso/ without leaving the process
+//every include is followed so a permutation is only compiled again when something it is made of changed
+//compiled bytecode is kept in a store named by key, going back to an earlier version of a file installs the old output without compiling
+class ShaderBuild
+{
+public:
+	//bump whenever the layout of the index or what goes into a key changes
+	static constexpr uint32_t Version = 1;
+
+	struct Result
+	{
+		size_t Permutations{};
+		size_t Compiled{};
+		//found in the store, compiled by an earlier build
+		size_t Reused{};
+		size_t Failed{};
+		double ScanMs{};
+		double CompileMs{};
+		double TotalMs{};
+		//outputs whose bytecode is different from what was installed before, only their shaders and pipelines have to go
+		std::vector<std::string> Changed;
+	};
+
+	//the arguments in the config are relative to its directory, as dxc was run from there
+	ShaderBuild(std::filesystem::path configPath, std::filesystem::path outputDir, std::filesystem::path storeDir);
+
+	//false if the config can not be read, lines without a source or an output are skipped with an error
+	bool LoadConfig();
+	//compiles every permutation whose key is not in the store and installs every output that changed
+	//a failed permutation keeps its old output and is tried again by the next build
+	Result Build(ShaderCompiler& compiler, bool bParallel = true);
+
+	const std::vector<ShaderPermutation>& GetPermutations() const { return Permutations; }
+	//permutations that depend on the file, valid after a build
+	std::vector<size_t> GetDependents(const std::filesystem::path& file) const;
+	std::filesystem::path GetStorePath(uint64_t key) const;
+
+private:
+	struct Include
+	{
+		std::string Name;
+		//quoted includes are looked for next to the including file first, angled ones only in the include directories
+		bool bQuoted{};
+	};
+
+	struct SourceFile
+	{
+		std::filesystem::path Path;
+		uint64_t Hash{};
+		bool bFound{};
+		//includes as written, resolved per permutation as the include directories differ
+		std::vector<Include> Includes;
+	};
+
+	//reads and hashes every file the permutations reach and fills in their dependencies and keys
+	void Scan(const std::string& compilerVersion);
+	uint32_t GetFile(const std::filesystem::path& path);
+	void LoadIndex();
+	void SaveIndex() const;
+
+	std::filesystem::path ConfigPath;
+	std::filesystem::path OutputDir;
+	std::filesystem::path StoreDir;
+	std::vector<ShaderPermutation> Permutations;
+	std::vector<SourceFile> Files;
+	std::unordered_map<std::string, uint32_t> FileIndices;
+	//output name to the key of what is installed under it
+	std::unordered_map<std::string, uint64_t> Installed;
+};
+
+//builds a small shader tree with a stand in compiler and checks edits only recompile what includes them, the store, failures and the changed list, needs no device or dxc
+bool VerifyShaderBuild();
+//full and incremental build times of the asset tree with dxc, or with a stand in compiler when there is no dxc, serial and in parallel, never touches the real cso/
+void BenchmarkShaderBuild(const std::filesystem::path& assetRoot);
@@ -0,0 +1,302 @@
+#include "ragdollpch.h"
+#include "TangentSpace.h"
+
+#include "Executor.h"
+#include "Profiler.h"
+
+namespace
+{
+	//sum of the corners on one side of a vertex, the bitangent is only kept for the sign
+	struct TangentFrame
+	{
+		Vector3 Tangent;
+		Vector3 Bitangent;
+		float Weight{};
+	};
+
+	//any unit vector perpendicular to the normal, used when the uvs give nothing to go on
+	Vector3 GetPerpendicular(const Vector3& normal)
+	{
+		Vector3 Axis = fabsf(normal.x) < 0.9f ? Vector3(1.f, 0.f, 0.f) : Vector3(0.f, 1.f, 0.f);
+		Vector3 Tangent = Axis - normal * normal.Dot(Axis);
+		if (Tangent.LengthSquared() <= 0.f)
+			return Axis;
+		Tangent.Normalize();
+		return Tangent;
+	}
+
+	//projects v onto the plane of the normal and normalizes it, zero if nothing is left
+	Vector3 Orthonormalize(const Vector3& v, const Vector3& normal)
+	{
+		Vector3 Result = v - normal * normal.Dot(v);
+		const float LengthSqred = Result.LengthSquared();
+		return LengthSqred > 0.f ? Result / sqrtf(LengthSqred) : Vector3::Zero;
+	}
+
+	Vector4 ResolveFrame(const TangentFrame& frame, const Vector3& normal)
+	{
+		Vector3 Tangent = Orthonormalize(frame.Tangent, normal);
+		if (frame.Weight <= 0.f || Tangent.LengthSquared() <= 0.f)
+		{
+			const Vector3 Perpendicular = GetPerpendicular(normal);
+			return Vector4(Perpendicular.x, Perpendicular.y, Perpendicular.z, 1.f);
+		}
+		const float Sign = normal.Cross(Tangent).Dot(frame.Bitangent) < 0.f ? -1.f : 1.f;
+		return Vector4(Tangent.x, Tangent.y, Tangent.z, Sign);
+	}
+
+	//what the loader and the geometry builder did before, one face tangent per triangle and the last triangle wins
+	void GenerateFaceTangents(std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+	{
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			Vertex& v0 = vertices[indices[i]];
+			Vertex& v1 = vertices[indices[i + 1]];
+			Vertex& v2 = vertices[indices[i + 2]];
+			Vector3 Edge1 = v1.position - v0.position;
+			Vector3 Edge2 = v2.position - v0.position;
+			Vector2 DeltaUV1 = v1.texcoord - v0.texcoord;
+			Vector2 DeltaUV2 = v2.texcoord - v0.texcoord;
+			float f = 1.0f / (DeltaUV1.x * DeltaUV2.y - DeltaUV2.x * DeltaUV1.y);
+			Vector3 Tangent = (Edge1 * DeltaUV2.y - Edge2 * DeltaUV1.y) * f;
+			Tangent.Normalize();
+			v0.tangent = v1.tangent = v2.tangent = Vector4(Tangent.x, Tangent.y, Tangent.z, 1.f);
+		}
+	}
+}
+
+void GenerateTangents(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	RD_SCOPE(Load, Generate Tangents);
+	const size_t VertexCount = vertices.size();
+	//two frames per vertex, the corners of faces with positive and with negative uv area
+	std::vector<TangentFrame> Frames(VertexCount * 2);
+	std::vector<int8_t> FaceSigns(indices.size() / 3);
+	for (size_t f = 0; f < FaceSigns.size(); ++f)
+	{
+		const uint32_t* Face = &indices[f * 3];
+		const Vertex& v0 = vertices[Face[0]];
+		const Vertex& v1 = vertices[Face[1]];
+		const Vertex& v2 = vertices[Face[2]];
+		const Vector3 Edge1 = v1.position - v0.position;
+		const Vector3 Edge2 = v2.position - v0.position;
+		const Vector2 DeltaUV1 = v1.texcoord - v0.texcoord;
+		const Vector2 DeltaUV2 = v2.texcoord - v0.texcoord;
+		const float Area = DeltaUV1.x * DeltaUV2.y - DeltaUV2.x * DeltaUV1.y;
+		//faces without uv area say nothing about the tangents, their corners take whatever the vertex ends up with
+		//written so nans end up here too
+		if (!(fabsf(Area) > std::numeric_limits<float>::min()))
+			continue;
+		//dp/du and dp/dv scaled by the area, only their directions are used
+		const float Sign = Area > 0.f ? 1.f : -1.f;
+		const Vector3 Tangent = (Edge1 * DeltaUV2.y - Edge2 * DeltaUV1.y) * Sign;
+		const Vector3 Bitangent = (Edge2 * DeltaUV1.x - Edge1 * DeltaUV2.x) * Sign;
+		FaceSigns[f] = static_cast<int8_t>(Sign);
+		for (uint32_t k = 0; k < 3; ++k)
+		{
+			const Vertex& v = vertices[Face[k]];
+			//corner angle weighting keeps the result independent of how the surface is triangulated
+			Vector3 A = vertices[Face[(k + 1) % 3]].position - v.position;
+			Vector3 B = vertices[Face[(k + 2) % 3]].position - v.position;
+			const float LengthSqred = A.LengthSquared() * B.LengthSquared();
+			if (!(LengthSqred > 0.f))
+				continue;
+			const float Angle = acosf(std::clamp(A.Dot(B) / sqrtf(LengthSqred), -1.f, 1.f));
+			TangentFrame& Frame = Frames[Face[k] * 2 + (Sign > 0.f ? 0 : 1)];
+			//normals are optional, without one the face vectors go in as they are
+			const bool bHasNormal = v.normal.LengthSquared() > 0.f;
+			Vector3 T = bHasNormal ? Orthonormalize(Tangent, v.normal) : Tangent;
+			Vector3 Bt = bHasNormal ? Orthonormalize(Bitangent, v.normal) : Bitangent;
+			T.Normalize();
+			Bt.Normalize();
+			Frame.Tangent += T * Angle;
+			Frame.Bitangent += Bt * Angle;
+			Frame.Weight += Angle;
+		}
+	}
+
+	//vertices used from both sides of a mirror seam get a copy for the negative side
+	std::vector<uint32_t> Copies(VertexCount, ~0u);
+	uint32_t CopyCount{};
+	for (size_t i = 0; i < VertexCount; ++i)
+	{
+		if (Frames[i * 2].Weight > 0.f && Frames[i * 2 + 1].Weight > 0.f)
+			Copies[i] = static_cast<uint32_t>(VertexCount) + CopyCount++;
+	}
+	vertices.resize(VertexCount + CopyCount);
+	for (size_t i = 0; i < VertexCount; ++i)
+	{
+		if (Copies[i] != ~0u)
+			vertices[Copies[i]] = vertices[i];
+	}
+	for (size_t f = 0; f < FaceSigns.size(); ++f)
+	{
+		if (FaceSigns[f] >= 0)
+			continue;
+		for (uint32_t k = 0; k < 3; ++k)
+		{
+			uint32_t& Index = indices[f * 3 + k];
+			if (Copies[Index] != ~0u)
+				Index = Copies[Index];
+		}
+	}
+	for (size_t i = 0; i < VertexCount; ++i)
+	{
+		Vertex& v = vertices[i];
+		const TangentFrame& Positive = Frames[i * 2];
+		const TangentFrame& Negative = Frames[i * 2 + 1];
+		v.tangent = ResolveFrame(Positive.Weight > 0.f ? Positive : Negative, v.normal);
+		if (Copies[i] != ~0u)
+			vertices[Copies[i]].tangent = ResolveFrame(Negative, v.normal);
+	}
+}
+
+bool VerifyTangents()
+{
+	RD_SCOPE(Load, Verify Tangents);
+	//flat grid facing +z with u mirrored at x = 0, the seam vertices are shared by both halves
+	constexpr uint32_t Columns = 8, Rows = 4;
+	std::vector<Vertex> Vertices;
+	std::vector<uint32_t> Indices;
+	for (uint32_t y = 0; y <= Rows; ++y)
+	{
+		for (uint32_t x = 0; x <= Columns; ++x)
+		{
+			Vertex& v = Vertices.emplace_back();
+			v.position = Vector3(float(x) - Columns / 2, float(y), 0.f);
+			v.normal = Vector3(0.f, 0.f, 1.f);
+			v.texcoord = Vector2(fabsf(v.position.x), v.position.y);
+		}
+	}
+	for (uint32_t y = 0; y < Rows; ++y)
+	{
+		for (uint32_t x = 0; x < Columns; ++x)
+		{
+			const uint32_t i = y * (Columns + 1) + x;
+			Indices.insert(Indices.end(), { i, i + 1, i + Columns + 2, i, i + Columns + 2, i + Columns + 1 });
+		}
+	}
+	const size_t SourceVertexCount = Vertices.size();
+	//one triangle without uv area off to the side, it still needs a valid tangent
+	const uint32_t DegenerateStart = static_cast<uint32_t>(Vertices.size());
+	for (uint32_t k = 0; k < 3; ++k)
+	{
+		Vertex& v = Vertices.emplace_back();
+		v.position = Vector3(float(k % 2), 10.f + float(k / 2), 0.f);
+		v.normal = Vector3(0.f, 0.f, 1.f);
+	}
+	Indices.insert(Indices.end(), { DegenerateStart, DegenerateStart + 1, DegenerateStart + 2 });
+
+	GenerateTangents(Vertices, Indices);
+
+	uint32_t Failures{};
+	//the seam column is the only one used from both sides
+	if (Vertices.size() != SourceVertexCount + 3 + Rows + 1)
+	{
+		RD_CORE_ERROR("Tangents: expected {} seam vertices to be split, got {}", Rows + 1, Vertices.size() - SourceVertexCount - 3);
+		++Failures;
+	}
+	for (const Vertex& v : Vertices)
+	{
+		const Vector3 Tangent(v.tangent.x, v.tangent.y, v.tangent.z);
+		if (fabsf(Tangent.Length() - 1.f) > 1e-4f || fabsf(Tangent.Dot(v.normal)) > 1e-4f || fabsf(v.tangent.w) != 1.f)
+			++Failures;
+	}
+	//dp/du points away from the seam on both sides and dp/dv is always +y, so the left half is the mirrored one
+	for (size_t i = 0; i + 3 < Indices.size(); i += 3)
+	{
+		const float CenterX = (Vertices[Indices[i]].position.x + Vertices[Indices[i + 1]].position.x + Vertices[Indices[i + 2]].position.x) / 3.f;
+		const Vector4 Expected = CenterX > 0.f ? Vector4(1.f, 0.f, 0.f, 1.f) : Vector4(-1.f, 0.f, 0.f, -1.f);
+		for (uint32_t k = 0; k < 3; ++k)
+		{
+			if (Vector4::DistanceSquared(Vertices[Indices[i + k]].tangent, Expected) > 1e-6f)
+				++Failures;
+		}
+	}
+	if (Failures)
+		RD_CORE_ERROR("Tangents: {} failures on the mirrored uv grid", Failures);
+	else
+		RD_CORE_INFO("Tangents: mirrored uv grid passed");
+	return Failures == 0;
+}
+
+void BenchmarkTangents(const AssetManager& assets)
+{
+	RD_SCOPE(Load, Benchmark Tangents);
+	//the lods share the vertices of their base mesh
+	std::vector<bool> IsLod(assets.VertexBufferInfos.size());
+	for (const VertexBufferInfo& Info : assets.VertexBufferInfos)
+	{
+		for (uint32_t i = 0; i < Info.LodCount; ++i)
+			IsLod[Info.FirstLodIndex + i] = true;
+	}
+	std::vector<size_t> Meshes;
+	size_t Largest{}, TotalTriangles{};
+	for (size_t i = 0; i < assets.VertexBufferInfos.size(); ++i)
+	{
+		if (IsLod[i] || assets.VertexBufferInfos[i].IndicesCount == 0)
+			continue;
+		if (Meshes.empty() || assets.VertexBufferInfos[i].IndicesCount > assets.VertexBufferInfos[Largest].IndicesCount)
+			Largest = i;
+		Meshes.emplace_back(i);
+		TotalTriangles += assets.VertexBufferInfos[i].IndicesCount / 3;
+	}
+	if (Meshes.empty())
+		return;
+
+	//fresh copies every run since the generator can add vertices
+	auto Copy = [&assets](size_t index, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) {
+		const VertexBufferInfo& Info = assets.VertexBufferInfos[index];
+		vertices.assign(assets.Vertices.begin() + Info.VerticesOffset, assets.Vertices.begin() + Info.VerticesOffset + Info.VerticesCount);
+		indices.assign(assets.Indices.begin() + Info.IndicesOffset, assets.Indices.begin() + Info.IndicesOffset + Info.IndicesCount);
+	};
+	constexpr uint32_t RunCount = 5;
+	auto Time = [&](auto&& method) {
+		double Best = std::numeric_limits<double>::max();
+		for (uint32_t Run = 0; Run < RunCount; ++Run)
+		{
+			std::chrono::duration<double> Duration = method();
+			Best = std::min(Best, Duration.count());
+		}
+		return Best;
+	};
+	std::vector<Vertex> Vertices;
+	std::vector<uint32_t> Indices;
+	auto TimeLargest = [&](auto&& generate) {
+		return Time([&]() {
+			Copy(Largest, Vertices, Indices);
+			auto Start = std::chrono::high_resolution_clock::now();
+			generate(Vertices, Indices);
+			return std::chrono::high_resolution_clock::now() - Start;
+		});
+	};
+	const double FaceTime = TimeLargest([](std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) { GenerateFaceTangents(vertices, indices); });
+	const double VertexTime = TimeLargest([](std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) { GenerateTangents(vertices, indices); });
+	const size_t SplitCount = Vertices.size() - assets.VertexBufferInfos[Largest].VerticesCount;
+
+	//every mesh on its own task, the same way the loader runs it
+	std::vector<std::vector<Vertex>> MeshVertices(Meshes.size());
+	std::vector<std::vector<uint32_t>> MeshIndices(Meshes.size());
+	const double ParallelTime = Time([&]() {
+		for (size_t i = 0; i < Meshes.size(); ++i)
+			Copy(Meshes[i], MeshVertices[i], MeshIndices[i]);
+		auto Start = std::chrono::high_resolution_clock::now();
+		tf::Taskflow TaskFlow;
+		for (size_t i = 0; i < Meshes.size(); ++i)
+		{
+			TaskFlow.emplace([&MeshVertices, &MeshIndices, i]() {
+				GenerateTangents(MeshVertices[i], MeshIndices[i]);
+			});
+		}
+		SExecutor::Executor.run(TaskFlow).wait();
+		return std::chrono::high_resolution_clock::now() - Start;
+	});
+
+	const size_t LargestTriangles = assets.VertexBufferInfos[Largest].IndicesCount / 3;
+	RD_CORE_INFO("Tangents: largest mesh has {} triangles and {} vertices, {} vertices split on mirror seams",
+		LargestTriangles, assets.VertexBufferInfos[Largest].VerticesCount, SplitCount);
+	RD_CORE_INFO("Tangents: per vertex {:.2f}ms ({:.2f}M triangles/s), old face tangents {:.2f}ms ({:.2f}M triangles/s)",
+		VertexTime * 1000.0, LargestTriangles / VertexTime / 1e6, FaceTime * 1000.0, LargestTriangles / FaceTime / 1e6);
+	RD_CORE_INFO("Tangents: {} meshes in parallel {:.2f}ms ({:.2f}M triangles/s)",
+		Meshes.size(), ParallelTime * 1000.0, TotalTriangles / ParallelTime / 1e6);
+}
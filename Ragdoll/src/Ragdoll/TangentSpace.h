@@ -0,0 +1,13 @@
+#pragma once
+#include "Ragdoll/AssetManager.h"
+
+//per vertex tangents in the spirit of mikktspace, every corner adds its face tangent and bitangent projected onto the vertex normal
+//and weighted by the corner angle, the sum is orthonormalized against the normal and the bitangent sign goes into tangent.w
+//a vertex shared by faces with mirrored uvs is split so each side keeps its own frame, indices are remapped to the copies
+//vertices without any usable uvs get an arbitrary tangent perpendicular to the normal
+void GenerateTangents(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+//generates tangents for a mirrored uv grid and checks the sign, direction and the seam split, returns false on any failure
+bool VerifyTangents();
+//times the generator against the old face tangents on the largest loaded mesh and on every mesh in parallel
+void BenchmarkTangents(const AssetManager& assets);
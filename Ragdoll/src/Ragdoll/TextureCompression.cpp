@@ -0,0 +1,1220 @@
+#include "ragdollpch.h"
+#include "TextureCompression.h"
+
+#include "stb_image.h"
+
+#include "Executor.h"
+#include "Profiler.h"
+#include "Ragdoll/Core/Hash.h"
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define RD_BLOCK_COMPRESSION_SSE 1
+#include <immintrin.h>
+#endif
+
+namespace
+{
+	//16 texels of a block, one channel after the other so 4 texels fit a register
+	struct alignas(16) BlockTexels
+	{
+		float Channels[4][16];
+	};
+
+	//squared error of every texel to every palette entry, the index of the closest one per texel and the summed error
+	//channels point at 16 texels each, palette entries have one value per channel
+	float FitIndices(const float* const* channels, uint32_t channelCount, const float (*palette)[4], uint32_t paletteSize, uint8_t* indices)
+	{
+		float Error = 0.f;
+#if RD_BLOCK_COMPRESSION_SSE
+		for (uint32_t i = 0; i < 16; i += 4)
+		{
+			__m128 Texels[4];
+			for (uint32_t c = 0; c < channelCount; ++c)
+				Texels[c] = _mm_load_ps(channels[c] + i);
+			__m128 Best = _mm_set1_ps(FLT_MAX);
+			__m128i BestIndex = _mm_setzero_si128();
+			for (uint32_t k = 0; k < paletteSize; ++k)
+			{
+				__m128 Distance = _mm_setzero_ps();
+				for (uint32_t c = 0; c < channelCount; ++c)
+				{
+					const __m128 Delta = _mm_sub_ps(Texels[c], _mm_set1_ps(palette[k][c]));
+					Distance = _mm_add_ps(Distance, _mm_mul_ps(Delta, Delta));
+				}
+				//first entry wins ties, same as the scalar loop
+				const __m128i Closer = _mm_castps_si128(_mm_cmplt_ps(Distance, Best));
+				BestIndex = _mm_or_si128(_mm_and_si128(Closer, _mm_set1_epi32(k)), _mm_andnot_si128(Closer, BestIndex));
+				Best = _mm_min_ps(Distance, Best);
+			}
+			alignas(16) int32_t Lanes[4];
+			alignas(16) float Errors[4];
+			_mm_store_si128(reinterpret_cast<__m128i*>(Lanes), BestIndex);
+			_mm_store_ps(Errors, Best);
+			for (uint32_t j = 0; j < 4; ++j)
+			{
+				indices[i + j] = static_cast<uint8_t>(Lanes[j]);
+				Error += Errors[j];
+			}
+		}
+#else
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			float Best = FLT_MAX;
+			uint8_t BestIndex = 0;
+			for (uint32_t k = 0; k < paletteSize; ++k)
+			{
+				float Distance = 0.f;
+				for (uint32_t c = 0; c < channelCount; ++c)
+				{
+					const float Delta = channels[c][i] - palette[k][c];
+					Distance += Delta * Delta;
+				}
+				if (Distance < Best)
+				{
+					Best = Distance;
+					BestIndex = static_cast<uint8_t>(k);
+				}
+			}
+			indices[i] = BestIndex;
+			Error += Best;
+		}
+#endif
+		return Error;
+	}
+
+	//mean and the direction the texels spread the most along, by power iteration on the covariance
+	void PrincipalAxis(const float* const* channels, uint32_t channelCount, float mean[4], float axis[4])
+	{
+		float Min[4], Max[4];
+		for (uint32_t c = 0; c < channelCount; ++c)
+		{
+			float Sum = 0.f;
+			Min[c] = FLT_MAX;
+			Max[c] = -FLT_MAX;
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				Sum += channels[c][i];
+				Min[c] = std::min(Min[c], channels[c][i]);
+				Max[c] = std::max(Max[c], channels[c][i]);
+			}
+			mean[c] = Sum / 16.f;
+		}
+		float Covariance[4][4]{};
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			float Delta[4];
+			for (uint32_t c = 0; c < channelCount; ++c)
+				Delta[c] = channels[c][i] - mean[c];
+			for (uint32_t a = 0; a < channelCount; ++a)
+				for (uint32_t b = a; b < channelCount; ++b)
+					Covariance[a][b] += Delta[a] * Delta[b];
+		}
+		for (uint32_t a = 0; a < channelCount; ++a)
+			for (uint32_t b = 0; b < a; ++b)
+				Covariance[a][b] = Covariance[b][a];
+		//the bounding box diagonal is a good start and never orthogonal to the answer for real images
+		for (uint32_t c = 0; c < channelCount; ++c)
+			axis[c] = Max[c] - Min[c];
+		for (uint32_t Iteration = 0; Iteration < 8; ++Iteration)
+		{
+			float Next[4]{};
+			float Length = 0.f;
+			for (uint32_t a = 0; a < channelCount; ++a)
+			{
+				for (uint32_t b = 0; b < channelCount; ++b)
+					Next[a] += Covariance[a][b] * axis[b];
+				Length = std::max(Length, fabsf(Next[a]));
+			}
+			if (Length < 1e-6f)
+				break;
+			for (uint32_t c = 0; c < channelCount; ++c)
+				axis[c] = Next[c] / Length;
+		}
+		float Length = 0.f;
+		for (uint32_t c = 0; c < channelCount; ++c)
+			Length += axis[c] * axis[c];
+		Length = sqrtf(Length);
+		for (uint32_t c = 0; c < channelCount; ++c)
+			axis[c] = Length > 0.f ? axis[c] / Length : 0.f;
+	}
+
+	//the extremes of the texels projected onto the axis
+	void AxisEndpoints(const float* const* channels, uint32_t channelCount, const float mean[4], const float axis[4], float e0[4], float e1[4])
+	{
+		float MinT = FLT_MAX, MaxT = -FLT_MAX;
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			float t = 0.f;
+			for (uint32_t c = 0; c < channelCount; ++c)
+				t += (channels[c][i] - mean[c]) * axis[c];
+			MinT = std::min(MinT, t);
+			MaxT = std::max(MaxT, t);
+		}
+		for (uint32_t c = 0; c < channelCount; ++c)
+		{
+			e0[c] = std::clamp(mean[c] + MinT * axis[c], 0.f, 255.f);
+			e1[c] = std::clamp(mean[c] + MaxT * axis[c], 0.f, 255.f);
+		}
+	}
+
+	//least squares endpoints for the chosen indices, weights are where each palette entry sits between e0 and e1
+	bool SolveEndpoints(const float* const* channels, uint32_t channelCount, const uint8_t* indices, const float* weights, float e0[4], float e1[4])
+	{
+		float A = 0.f, B = 0.f, C = 0.f;
+		float X[4]{}, Y[4]{};
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			const float w = weights[indices[i]];
+			A += (1.f - w) * (1.f - w);
+			B += (1.f - w) * w;
+			C += w * w;
+			for (uint32_t c = 0; c < channelCount; ++c)
+			{
+				X[c] += (1.f - w) * channels[c][i];
+				Y[c] += w * channels[c][i];
+			}
+		}
+		const float Determinant = A * C - B * B;
+		if (fabsf(Determinant) < 1e-6f)
+			return false;
+		for (uint32_t c = 0; c < channelCount; ++c)
+		{
+			e0[c] = std::clamp((C * X[c] - B * Y[c]) / Determinant, 0.f, 255.f);
+			e1[c] = std::clamp((A * Y[c] - B * X[c]) / Determinant, 0.f, 255.f);
+		}
+		return true;
+	}
+
+	//little endian bit stream of one 128 bit block
+	struct BlockBits
+	{
+		uint64_t Words[2]{};
+		uint32_t Position{};
+
+		void Write(uint32_t value, uint32_t bits)
+		{
+			for (uint32_t i = 0; i < bits; ++i, ++Position)
+				Words[Position >> 6] |= uint64_t((value >> i) & 1) << (Position & 63);
+		}
+		uint32_t Read(uint32_t bits)
+		{
+			uint32_t Value = 0;
+			for (uint32_t i = 0; i < bits; ++i, ++Position)
+				Value |= uint32_t((Words[Position >> 6] >> (Position & 63)) & 1) << i;
+			return Value;
+		}
+	};
+
+	uint16_t Pack565(const float color[4])
+	{
+		const uint32_t r = static_cast<uint32_t>(color[0] * (31.f / 255.f) + 0.5f);
+		const uint32_t g = static_cast<uint32_t>(color[1] * (63.f / 255.f) + 0.5f);
+		const uint32_t b = static_cast<uint32_t>(color[2] * (31.f / 255.f) + 0.5f);
+		return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+	}
+
+	void Unpack565(uint16_t packed, uint32_t color[3])
+	{
+		const uint32_t r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+		color[0] = (r << 3) | (r >> 2);
+		color[1] = (g << 2) | (g >> 4);
+		color[2] = (b << 3) | (b >> 2);
+	}
+
+	//the 4 colour palette, what the hardware interpolates between the two 565 endpoints
+	void Bc1Palette(uint16_t c0, uint16_t c1, uint32_t palette[4][3])
+	{
+		Unpack565(c0, palette[0]);
+		Unpack565(c1, palette[1]);
+		for (uint32_t c = 0; c < 3; ++c)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+		}
+	}
+
+	//always the 4 colour mode, the 3 colour mode would punch holes into bc3
+	void EncodeBc1(const BlockTexels& block, uint8_t* out)
+	{
+		static constexpr float Weights[4] = { 0.f, 1.f, 1.f / 3.f, 2.f / 3.f };
+		const float* Channels[3] = { block.Channels[0], block.Channels[1], block.Channels[2] };
+		float Mean[4], Axis[4], E0[4], E1[4];
+		PrincipalAxis(Channels, 3, Mean, Axis);
+		AxisEndpoints(Channels, 3, Mean, Axis, E0, E1);
+
+		uint16_t Best0 = 0, Best1 = 0;
+		uint8_t BestIndices[16]{};
+		float BestError = FLT_MAX;
+		for (uint32_t Iteration = 0; Iteration < 3; ++Iteration)
+		{
+			uint16_t c0 = Pack565(E0), c1 = Pack565(E1);
+			//4 colour mode needs the first endpoint to be the larger one
+			if (c0 < c1)
+				std::swap(c0, c1);
+			uint32_t Palette[4][3];
+			Bc1Palette(c0, c1, Palette);
+			float PaletteF[4][4];
+			for (uint32_t k = 0; k < 4; ++k)
+				for (uint32_t c = 0; c < 3; ++c)
+					PaletteF[k][c] = static_cast<float>(Palette[k][c]);
+			uint8_t Indices[16];
+			//equal endpoints would be the 3 colour mode, index 0 is the only safe one
+			const float Error = FitIndices(Channels, 3, PaletteF, c0 == c1 ? 1 : 4, Indices);
+			if (Error < BestError)
+			{
+				BestError = Error;
+				Best0 = c0;
+				Best1 = c1;
+				memcpy(BestIndices, Indices, 16);
+			}
+			if (BestError == 0.f || !SolveEndpoints(Channels, 3, Indices, Weights, E0, E1))
+				break;
+		}
+		uint32_t IndexBits = 0;
+		for (uint32_t i = 0; i < 16; ++i)
+			IndexBits |= uint32_t(BestIndices[i]) << (i * 2);
+		memcpy(out, &Best0, 2);
+		memcpy(out + 2, &Best1, 2);
+		memcpy(out + 4, &IndexBits, 4);
+	}
+
+	void DecodeBc1(const uint8_t* in, uint8_t texels[16][4])
+	{
+		uint16_t c0, c1;
+		uint32_t IndexBits;
+		memcpy(&c0, in, 2);
+		memcpy(&c1, in + 2, 2);
+		memcpy(&IndexBits, in + 4, 4);
+		uint32_t Palette[4][3];
+		Bc1Palette(c0, c1, Palette);
+		uint8_t Alpha[4] = { 255, 255, 255, 255 };
+		if (c0 <= c1)
+		{
+			//3 colour mode, only ever read from dds files
+			for (uint32_t c = 0; c < 3; ++c)
+			{
+				Palette[2][c] = (Palette[0][c] + Palette[1][c]) / 2;
+				Palette[3][c] = 0;
+			}
+			Alpha[3] = 0;
+		}
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			const uint32_t Index = (IndexBits >> (i * 2)) & 3;
+			for (uint32_t c = 0; c < 3; ++c)
+				texels[i][c] = static_cast<uint8_t>(Palette[Index][c]);
+			texels[i][3] = Alpha[Index];
+		}
+	}
+
+	//the 8 value palette, a0 > a1
+	void Bc4Palette(uint32_t a0, uint32_t a1, float palette[8][4])
+	{
+		palette[0][0] = static_cast<float>(a0);
+		palette[1][0] = static_cast<float>(a1);
+		for (uint32_t k = 2; k < 8; ++k)
+			palette[k][0] = static_cast<float>(((8 - k) * a0 + (k - 1) * a1) / 7);
+	}
+
+	//one channel, always the 8 value mode
+	void EncodeBc4(const float* values, uint8_t* out)
+	{
+		static constexpr float Weights[8] = { 0.f, 1.f, 1.f / 7.f, 2.f / 7.f, 3.f / 7.f, 4.f / 7.f, 5.f / 7.f, 6.f / 7.f };
+		float Min = FLT_MAX, Max = -FLT_MAX;
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			Min = std::min(Min, values[i]);
+			Max = std::max(Max, values[i]);
+		}
+		uint32_t a0 = static_cast<uint32_t>(Max + 0.5f), a1 = static_cast<uint32_t>(Min + 0.5f);
+		uint8_t BestIndices[16]{};
+		uint32_t Best0 = a0, Best1 = a1;
+		if (a0 > a1)
+		{
+			float BestError = FLT_MAX;
+			for (uint32_t Iteration = 0; Iteration < 2; ++Iteration)
+			{
+				float Palette[8][4];
+				Bc4Palette(a0, a1, Palette);
+				uint8_t Indices[16];
+				const float Error = FitIndices(&values, 1, Palette, 8, Indices);
+				if (Error < BestError)
+				{
+					BestError = Error;
+					Best0 = a0;
+					Best1 = a1;
+					memcpy(BestIndices, Indices, 16);
+				}
+				float E0[4], E1[4];
+				if (BestError == 0.f || !SolveEndpoints(&values, 1, Indices, Weights, E0, E1))
+					break;
+				a0 = static_cast<uint32_t>(E0[0] + 0.5f);
+				a1 = static_cast<uint32_t>(E1[0] + 0.5f);
+				if (a0 < a1)
+					std::swap(a0, a1);
+				if (a0 == a1)
+					break;
+			}
+		}
+		uint64_t IndexBits = 0;
+		for (uint32_t i = 0; i < 16; ++i)
+			IndexBits |= uint64_t(BestIndices[i]) << (i * 3);
+		out[0] = static_cast<uint8_t>(Best0);
+		out[1] = static_cast<uint8_t>(Best1);
+		memcpy(out + 2, &IndexBits, 6);
+	}
+
+	void DecodeBc4(const uint8_t* in, uint8_t texels[16][4], uint32_t channel)
+	{
+		const uint32_t a0 = in[0], a1 = in[1];
+		uint32_t Palette[8] = { a0, a1 };
+		if (a0 > a1)
+		{
+			for (uint32_t k = 2; k < 8; ++k)
+				Palette[k] = ((8 - k) * a0 + (k - 1) * a1) / 7;
+		}
+		else
+		{
+			for (uint32_t k = 2; k < 6; ++k)
+				Palette[k] = ((6 - k) * a0 + (k - 1) * a1) / 5;
+			Palette[6] = 0;
+			Palette[7] = 255;
+		}
+		uint64_t IndexBits = 0;
+		memcpy(&IndexBits, in + 2, 6);
+		for (uint32_t i = 0; i < 16; ++i)
+			texels[i][channel] = static_cast<uint8_t>(Palette[(IndexBits >> (i * 3)) & 7]);
+	}
+
+	constexpr uint32_t Bc7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	//7 bits per channel plus a p bit shared by the whole endpoint, the p bit with the smaller error wins
+	void QuantizeBc7Endpoint(const float endpoint[4], uint32_t quantized[4], uint32_t& pBit)
+	{
+		float BestError = FLT_MAX;
+		for (uint32_t p = 0; p < 2; ++p)
+		{
+			uint32_t Candidate[4];
+			float Error = 0.f;
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				Candidate[c] = static_cast<uint32_t>(std::clamp((endpoint[c] - p) * 0.5f + 0.5f, 0.f, 127.f));
+				const float Delta = float(Candidate[c] * 2 + p) - endpoint[c];
+				Error += Delta * Delta;
+			}
+			if (Error < BestError)
+			{
+				BestError = Error;
+				pBit = p;
+				memcpy(quantized, Candidate, sizeof(Candidate));
+			}
+		}
+	}
+
+	void Bc7Palette(const uint32_t v0[4], const uint32_t v1[4], float palette[16][4])
+	{
+		for (uint32_t k = 0; k < 16; ++k)
+			for (uint32_t c = 0; c < 4; ++c)
+				palette[k][c] = static_cast<float>(((64 - Bc7Weights4[k]) * v0[c] + Bc7Weights4[k] * v1[c] + 32) >> 6);
+	}
+
+	//mode 6 only, one subset of rgba with 4 bit indices
+	//a single line through rgba does well on the smooth content of most material textures and keeps the encode fast enough to run on load
+	void EncodeBc7(const BlockTexels& block, uint8_t* out)
+	{
+		static const float* Weights = [] {
+			static float w[16];
+			for (uint32_t k = 0; k < 16; ++k)
+				w[k] = Bc7Weights4[k] / 64.f;
+			return w;
+		}();
+		const float* Channels[4] = { block.Channels[0], block.Channels[1], block.Channels[2], block.Channels[3] };
+		float Mean[4], Axis[4], E0[4], E1[4];
+		PrincipalAxis(Channels, 4, Mean, Axis);
+		AxisEndpoints(Channels, 4, Mean, Axis, E0, E1);
+
+		uint32_t Best0[4]{}, Best1[4]{}, BestP0 = 0, BestP1 = 0;
+		uint8_t BestIndices[16]{};
+		float BestError = FLT_MAX;
+		for (uint32_t Iteration = 0; Iteration < 3; ++Iteration)
+		{
+			uint32_t q0[4], q1[4], p0, p1;
+			QuantizeBc7Endpoint(E0, q0, p0);
+			QuantizeBc7Endpoint(E1, q1, p1);
+			uint32_t v0[4], v1[4];
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				v0[c] = q0[c] * 2 + p0;
+				v1[c] = q1[c] * 2 + p1;
+			}
+			float Palette[16][4];
+			Bc7Palette(v0, v1, Palette);
+			uint8_t Indices[16];
+			const float Error = FitIndices(Channels, 4, Palette, 16, Indices);
+			if (Error < BestError)
+			{
+				BestError = Error;
+				memcpy(Best0, q0, sizeof(q0));
+				memcpy(Best1, q1, sizeof(q1));
+				BestP0 = p0;
+				BestP1 = p1;
+				memcpy(BestIndices, Indices, 16);
+			}
+			if (BestError == 0.f || !SolveEndpoints(Channels, 4, Indices, Weights, E0, E1))
+				break;
+		}
+		//the first index has an implied zero top bit, flip the line if it would need it
+		if (BestIndices[0] & 8)
+		{
+			std::swap(Best0, Best1);
+			std::swap(BestP0, BestP1);
+			for (uint8_t& Index : BestIndices)
+				Index = 15 - Index;
+		}
+		BlockBits Bits;
+		Bits.Write(1 << 6, 7);
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			Bits.Write(Best0[c], 7);
+			Bits.Write(Best1[c], 7);
+		}
+		Bits.Write(BestP0, 1);
+		Bits.Write(BestP1, 1);
+		Bits.Write(BestIndices[0], 3);
+		for (uint32_t i = 1; i < 16; ++i)
+			Bits.Write(BestIndices[i], 4);
+		memcpy(out, Bits.Words, 16);
+	}
+
+	bool DecodeBc7(const uint8_t* in, uint8_t texels[16][4])
+	{
+		BlockBits Bits;
+		memcpy(Bits.Words, in, 16);
+		if (Bits.Read(7) != (1 << 6))
+		{
+			//not mode 6, magenta so it stands out
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				texels[i][0] = 255; texels[i][1] = 0; texels[i][2] = 255; texels[i][3] = 255;
+			}
+			return false;
+		}
+		uint32_t q0[4], q1[4];
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			q0[c] = Bits.Read(7);
+			q1[c] = Bits.Read(7);
+		}
+		const uint32_t p0 = Bits.Read(1), p1 = Bits.Read(1);
+		uint32_t v0[4], v1[4];
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			v0[c] = q0[c] * 2 + p0;
+			v1[c] = q1[c] * 2 + p1;
+		}
+		float Palette[16][4];
+		Bc7Palette(v0, v1, Palette);
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			const uint32_t Index = Bits.Read(i == 0 ? 3 : 4);
+			for (uint32_t c = 0; c < 4; ++c)
+				texels[i][c] = static_cast<uint8_t>(Palette[Index][c]);
+		}
+		return true;
+	}
+
+	//gathers a 4x4 block, texels past the edge repeat the last row and column
+	void LoadBlock(const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY, BlockTexels& block)
+	{
+		for (uint32_t y = 0; y < 4; ++y)
+		{
+			const uint32_t SrcY = std::min(blockY * 4 + y, height - 1);
+			for (uint32_t x = 0; x < 4; ++x)
+			{
+				const uint8_t* Texel = rgba + (size_t(SrcY) * width + std::min(blockX * 4 + x, width - 1)) * 4;
+				for (uint32_t c = 0; c < 4; ++c)
+					block.Channels[c][y * 4 + x] = Texel[c];
+			}
+		}
+	}
+
+	void EncodeBlock(const BlockTexels& block, nvrhi::Format format, uint8_t* out)
+	{
+		switch (format)
+		{
+		case nvrhi::Format::BC1_UNORM:
+			EncodeBc1(block, out);
+			break;
+		case nvrhi::Format::BC3_UNORM:
+			EncodeBc4(block.Channels[3], out);
+			EncodeBc1(block, out + 8);
+			break;
+		case nvrhi::Format::BC5_UNORM:
+			EncodeBc4(block.Channels[0], out);
+			EncodeBc4(block.Channels[1], out + 8);
+			break;
+		case nvrhi::Format::BC7_UNORM:
+			EncodeBc7(block, out);
+			break;
+		default:
+			RD_ASSERT(true, "Unsupported block format {}", static_cast<uint32_t>(format));
+		}
+	}
+
+	void CompressRows(const uint8_t* rgba, uint32_t width, uint32_t height, nvrhi::Format format, uint8_t* blocks, uint32_t firstRow, uint32_t lastRow)
+	{
+		const uint32_t BlockBytes = GetBlockBytes(format);
+		const uint32_t BlocksX = (width + 3) / 4;
+		BlockTexels Block;
+		for (uint32_t by = firstRow; by < lastRow; ++by)
+		{
+			for (uint32_t bx = 0; bx < BlocksX; ++bx)
+			{
+				LoadBlock(rgba, width, height, bx, by, Block);
+				EncodeBlock(Block, format, blocks + (size_t(by) * BlocksX + bx) * BlockBytes);
+			}
+		}
+	}
+
+	float SrgbToLinear(float value)
+	{
+		return value <= 0.04045f ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f);
+	}
+
+	float LinearToSrgb(float value)
+	{
+		return value <= 0.0031308f ? value * 12.92f : 1.055f * powf(value, 1.f / 2.4f) - 0.055f;
+	}
+
+	//linear to 8 bit srgb, fine enough that every 8 bit value round trips
+	struct SrgbTables
+	{
+		float ToLinear[256];
+		uint8_t ToSrgb[4096];
+
+		SrgbTables()
+		{
+			for (uint32_t i = 0; i < 256; ++i)
+				ToLinear[i] = SrgbToLinear(i / 255.f);
+			for (uint32_t i = 0; i < 4096; ++i)
+				ToSrgb[i] = static_cast<uint8_t>(LinearToSrgb(i / 4095.f) * 255.f + 0.5f);
+		}
+		uint8_t Encode(float linear) const
+		{
+			return ToSrgb[static_cast<uint32_t>(std::clamp(linear, 0.f, 1.f) * 4095.f + 0.5f)];
+		}
+	};
+	const SrgbTables& GetSrgbTables()
+	{
+		static const SrgbTables Tables;
+		return Tables;
+	}
+
+	//texels into the space they are filtered in
+	void ToFilterSpace(const uint8_t* rgba, size_t pixelCount, TextureUsage usage, float* texels)
+	{
+		const SrgbTables& Tables = GetSrgbTables();
+		for (size_t i = 0; i < pixelCount; ++i)
+		{
+			const uint8_t* Src = rgba + i * 4;
+			float* Dst = texels + i * 4;
+			switch (usage)
+			{
+			case TextureUsage::Color:
+				for (uint32_t c = 0; c < 3; ++c)
+					Dst[c] = Tables.ToLinear[Src[c]];
+				break;
+			case TextureUsage::Normal:
+				for (uint32_t c = 0; c < 3; ++c)
+					Dst[c] = Src[c] / 127.5f - 1.f;
+				break;
+			case TextureUsage::Linear:
+				for (uint32_t c = 0; c < 3; ++c)
+					Dst[c] = Src[c] / 255.f;
+				break;
+			}
+			Dst[3] = Src[3] / 255.f;
+		}
+	}
+
+	void FromFilterSpace(const float* texels, size_t pixelCount, TextureUsage usage, uint8_t* rgba)
+	{
+		const SrgbTables& Tables = GetSrgbTables();
+		for (size_t i = 0; i < pixelCount; ++i)
+		{
+			const float* Src = texels + i * 4;
+			uint8_t* Dst = rgba + i * 4;
+			switch (usage)
+			{
+			case TextureUsage::Color:
+				for (uint32_t c = 0; c < 3; ++c)
+					Dst[c] = Tables.Encode(Src[c]);
+				break;
+			case TextureUsage::Normal:
+				for (uint32_t c = 0; c < 3; ++c)
+					Dst[c] = static_cast<uint8_t>(std::clamp(Src[c] * 127.5f + 127.5f + 0.5f, 0.f, 255.f));
+				break;
+			case TextureUsage::Linear:
+				for (uint32_t c = 0; c < 3; ++c)
+					Dst[c] = static_cast<uint8_t>(std::clamp(Src[c] * 255.f + 0.5f, 0.f, 255.f));
+				break;
+			}
+			Dst[3] = static_cast<uint8_t>(std::clamp(Src[3] * 255.f + 0.5f, 0.f, 255.f));
+		}
+	}
+
+	const char* GetFormatName(nvrhi::Format format)
+	{
+		switch (format)
+		{
+		case nvrhi::Format::BC1_UNORM: return "BC1";
+		case nvrhi::Format::BC3_UNORM: return "BC3";
+		case nvrhi::Format::BC5_UNORM: return "BC5";
+		case nvrhi::Format::BC7_UNORM: return "BC7";
+		default: return "?";
+		}
+	}
+}
+
+nvrhi::Format GetBlockFormat(TextureUsage usage, bool bHasAlpha, TextureEncodeQuality quality)
+{
+	if (usage == TextureUsage::Normal)
+		return nvrhi::Format::BC5_UNORM;
+	if (quality == TextureEncodeQuality::High)
+		return nvrhi::Format::BC7_UNORM;
+	return bHasAlpha ? nvrhi::Format::BC3_UNORM : nvrhi::Format::BC1_UNORM;
+}
+
+bool HasAlpha(const uint8_t* rgba, size_t pixelCount)
+{
+	for (size_t i = 0; i < pixelCount; ++i)
+		if (rgba[i * 4 + 3] != 255)
+			return true;
+	return false;
+}
+
+bool CanBlockCompress(uint32_t width, uint32_t height)
+{
+	return width % 4 == 0 && height % 4 == 0;
+}
+
+void GenerateMipChain(const uint8_t* rgba, uint32_t width, uint32_t height, TextureUsage usage, TextureMipChain& chain)
+{
+	RD_SCOPE(Load, Generate Mips);
+	const uint32_t MipCount = static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
+	chain.Width = width;
+	chain.Height = height;
+	chain.MipOffsets.clear();
+	size_t Offset = 0;
+	for (uint32_t Mip = 0; Mip < MipCount; ++Mip)
+	{
+		chain.MipOffsets.push_back(Offset);
+		Offset += size_t(std::max(width >> Mip, 1u)) * std::max(height >> Mip, 1u) * 4;
+	}
+	chain.Pixels.resize(Offset);
+	memcpy(chain.Pixels.data(), rgba, size_t(width) * height * 4);
+
+	//every mip comes from the filtered floats of the one above so the 8 bit rounding does not add up down the chain
+	//the top mip is converted a row pair at a time, a float copy of it would be 4 times the size of the whole 8 bit chain
+	DecodeScratch::Vector<float> Src, Dst, TopRows(size_t(width) * 2 * 4);
+	for (uint32_t Mip = 1; Mip < MipCount; ++Mip)
+	{
+		const uint32_t SrcWidth = std::max(width >> (Mip - 1), 1u), SrcHeight = std::max(height >> (Mip - 1), 1u);
+		const uint32_t DstWidth = std::max(width >> Mip, 1u), DstHeight = std::max(height >> Mip, 1u);
+		Dst.resize(size_t(DstWidth) * DstHeight * 4);
+		for (uint32_t y = 0; y < DstHeight; ++y)
+		{
+			const uint32_t y0 = std::min(y * 2, SrcHeight - 1), y1 = std::min(y * 2 + 1, SrcHeight - 1);
+			const float* Row0;
+			const float* Row1;
+			if (Mip == 1)
+			{
+				ToFilterSpace(rgba + size_t(y0) * SrcWidth * 4, SrcWidth, usage, TopRows.data());
+				ToFilterSpace(rgba + size_t(y1) * SrcWidth * 4, SrcWidth, usage, TopRows.data() + size_t(SrcWidth) * 4);
+				Row0 = TopRows.data();
+				Row1 = TopRows.data() + size_t(SrcWidth) * 4;
+			}
+			else
+			{
+				Row0 = Src.data() + size_t(y0) * SrcWidth * 4;
+				Row1 = Src.data() + size_t(y1) * SrcWidth * 4;
+			}
+			for (uint32_t x = 0; x < DstWidth; ++x)
+			{
+				const uint32_t x0 = std::min(x * 2, SrcWidth - 1) * 4, x1 = std::min(x * 2 + 1, SrcWidth - 1) * 4;
+				float* Texel = Dst.data() + (size_t(y) * DstWidth + x) * 4;
+				for (uint32_t c = 0; c < 4; ++c)
+					Texel[c] = (Row0[x0 + c] + Row0[x1 + c] + Row1[x0 + c] + Row1[x1 + c]) * 0.25f;
+				if (usage == TextureUsage::Normal)
+				{
+					const float Length = sqrtf(Texel[0] * Texel[0] + Texel[1] * Texel[1] + Texel[2] * Texel[2]);
+					if (Length > 1e-6f)
+						for (uint32_t c = 0; c < 3; ++c)
+							Texel[c] /= Length;
+				}
+			}
+		}
+		FromFilterSpace(Dst.data(), size_t(DstWidth) * DstHeight, usage, chain.Pixels.data() + chain.MipOffsets[Mip]);
+		std::swap(Src, Dst);
+	}
+}
+
+uint32_t GetBlockBytes(nvrhi::Format format)
+{
+	switch (format)
+	{
+	case nvrhi::Format::BC1_UNORM:
+		return 8;
+	case nvrhi::Format::BC3_UNORM:
+	case nvrhi::Format::BC5_UNORM:
+	case nvrhi::Format::BC7_UNORM:
+		return 16;
+	default:
+		return 0;
+	}
+}
+
+void CompressImage(const uint8_t* rgba, uint32_t width, uint32_t height, nvrhi::Format format, uint8_t* blocks)
+{
+	CompressRows(rgba, width, height, format, blocks, 0, (height + 3) / 4);
+}
+
+void DecompressImage(const uint8_t* blocks, uint32_t width, uint32_t height, nvrhi::Format format, uint8_t* rgba)
+{
+	const uint32_t BlockBytes = GetBlockBytes(format);
+	const uint32_t BlocksX = (width + 3) / 4, BlocksY = (height + 3) / 4;
+	for (uint32_t by = 0; by < BlocksY; ++by)
+	{
+		for (uint32_t bx = 0; bx < BlocksX; ++bx)
+		{
+			const uint8_t* Block = blocks + (size_t(by) * BlocksX + bx) * BlockBytes;
+			uint8_t Texels[16][4];
+			switch (format)
+			{
+			case nvrhi::Format::BC1_UNORM:
+				DecodeBc1(Block, Texels);
+				break;
+			case nvrhi::Format::BC3_UNORM:
+				DecodeBc1(Block + 8, Texels);
+				DecodeBc4(Block, Texels, 3);
+				break;
+			case nvrhi::Format::BC5_UNORM:
+				DecodeBc4(Block, Texels, 0);
+				DecodeBc4(Block + 8, Texels, 1);
+				for (uint32_t i = 0; i < 16; ++i)
+				{
+					Texels[i][2] = 0;
+					Texels[i][3] = 255;
+				}
+				break;
+			case nvrhi::Format::BC7_UNORM:
+				DecodeBc7(Block, Texels);
+				break;
+			default:
+				RD_ASSERT(true, "Unsupported block format {}", static_cast<uint32_t>(format));
+			}
+			for (uint32_t y = 0; y < 4 && by * 4 + y < height; ++y)
+				for (uint32_t x = 0; x < 4 && bx * 4 + x < width; ++x)
+					memcpy(rgba + ((size_t(by) * 4 + y) * width + bx * 4 + x) * 4, Texels[y * 4 + x], 4);
+		}
+	}
+}
+
+double ComputePSNR(const uint8_t* reference, const uint8_t* decoded, size_t pixelCount, nvrhi::Format format)
+{
+	uint32_t FirstChannel = 0, ChannelCount = 4;
+	if (format == nvrhi::Format::BC1_UNORM)
+		ChannelCount = 3;
+	else if (format == nvrhi::Format::BC5_UNORM)
+		ChannelCount = 2;
+	double SquaredError = 0.0;
+	for (size_t i = 0; i < pixelCount; ++i)
+	{
+		for (uint32_t c = FirstChannel; c < FirstChannel + ChannelCount; ++c)
+		{
+			const double Delta = double(reference[i * 4 + c]) - double(decoded[i * 4 + c]);
+			SquaredError += Delta * Delta;
+		}
+	}
+	const double MeanSquaredError = SquaredError / (double(pixelCount) * ChannelCount);
+	if (MeanSquaredError <= 0.0)
+		return 99.0;
+	return 10.0 * log10(255.0 * 255.0 / MeanSquaredError);
+}
+
+void CompressTexture(const uint8_t* rgba, uint32_t width, uint32_t height, TextureUsage usage, TextureEncodeQuality quality, CompressedTexture& texture)
+{
+	RD_SCOPE(Load, Compress Texture);
+	TextureMipChain Chain;
+	GenerateMipChain(rgba, width, height, usage, Chain);
+
+	texture.Format = GetBlockFormat(usage, HasAlpha(rgba, size_t(width) * height), quality);
+	texture.Width = width;
+	texture.Height = height;
+	texture.MipOffsets.clear();
+	texture.RowPitches.clear();
+	texture.SlicePitches.clear();
+	const uint32_t BlockBytes = GetBlockBytes(texture.Format);
+	size_t Offset = 0;
+	for (size_t Mip = 0; Mip < Chain.MipOffsets.size(); ++Mip)
+	{
+		const uint32_t BlocksX = (std::max(width >> Mip, 1u) + 3) / 4, BlocksY = (std::max(height >> Mip, 1u) + 3) / 4;
+		texture.MipOffsets.push_back(Offset);
+		texture.RowPitches.push_back(size_t(BlocksX) * BlockBytes);
+		texture.SlicePitches.push_back(texture.RowPitches.back() * BlocksY);
+		Offset += texture.SlicePitches.back();
+	}
+	texture.Data.resize(Offset);
+
+	//split every mip into runs of block rows of roughly the same work so the top mip does not end up on one thread
+	constexpr uint32_t BlocksPerTask = 4096;
+	tf::Taskflow Taskflow;
+	for (uint32_t Mip = 0; Mip < Chain.MipOffsets.size(); ++Mip)
+	{
+		const uint32_t MipWidth = std::max(width >> Mip, 1u), MipHeight = std::max(height >> Mip, 1u);
+		const uint32_t BlocksX = (MipWidth + 3) / 4, BlocksY = (MipHeight + 3) / 4;
+		const uint32_t RowsPerTask = std::max(BlocksPerTask / BlocksX, 1u);
+		const uint8_t* Src = Chain.Pixels.data() + Chain.MipOffsets[Mip];
+		uint8_t* Dst = texture.Data.data() + texture.MipOffsets[Mip];
+		const nvrhi::Format Format = texture.Format;
+		for (uint32_t Row = 0; Row < BlocksY; Row += RowsPerTask)
+		{
+			const uint32_t LastRow = std::min(Row + RowsPerTask, BlocksY);
+			Taskflow.emplace([=]() { CompressRows(Src, MipWidth, MipHeight, Format, Dst, Row, LastRow); });
+		}
+	}
+	SExecutor::Run(Taskflow);
+}
+
+namespace
+{
+	//'RDTC'
+	constexpr uint32_t TextureCacheMagic = 0x43544452;
+
+	struct TextureCacheHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint64_t Key;
+		uint32_t Format;
+		uint32_t Width;
+		uint32_t Height;
+		uint32_t MipCount;
+	};
+
+	//mip layout of a block compressed texture, the same on load and save
+	size_t LayoutMips(CompressedTexture& texture, uint32_t mipCount, size_t offset)
+	{
+		const uint32_t BlockBytes = GetBlockBytes(texture.Format);
+		texture.MipOffsets.clear();
+		texture.RowPitches.clear();
+		texture.SlicePitches.clear();
+		for (uint32_t Mip = 0; Mip < mipCount; ++Mip)
+		{
+			const uint32_t BlocksX = (std::max(texture.Width >> Mip, 1u) + 3) / 4, BlocksY = (std::max(texture.Height >> Mip, 1u) + 3) / 4;
+			texture.MipOffsets.push_back(offset);
+			texture.RowPitches.push_back(size_t(BlocksX) * BlockBytes);
+			texture.SlicePitches.push_back(texture.RowPitches.back() * BlocksY);
+			offset += texture.SlicePitches.back();
+		}
+		return offset;
+	}
+}
+
+uint64_t TextureCache::GetKey(const uint8_t* source, size_t size, TextureUsage usage, TextureEncodeQuality quality)
+{
+	struct
+	{
+		uint32_t Version;
+		uint32_t Usage;
+		uint32_t Quality;
+	} Params{ Version, static_cast<uint32_t>(usage), static_cast<uint32_t>(quality) };
+	return ragdoll::Hash64(source, size, ragdoll::Hash64(&Params, sizeof(Params)));
+}
+
+std::filesystem::path TextureCache::GetCachePath(const std::filesystem::path& cacheRoot, const std::string& name, uint64_t key)
+{
+	//names can be uris with folders in them or empty for embedded images
+	std::string Stem = std::filesystem::path(name).stem().string();
+	if (Stem.empty())
+		Stem = "image";
+	return cacheRoot / fmt::format("{}_{:016x}.rdtex", Stem, key);
+}
+
+bool TextureCache::Load(const std::filesystem::path& cachePath, uint64_t key, ragdoll::MappedFile& file, CompressedTexture& texture)
+{
+	RD_SCOPE(Load, Texture Cache Load);
+	if (!std::filesystem::exists(cachePath))
+		return false;
+	if (!file.Open(cachePath) || file.GetSize() < sizeof(TextureCacheHeader))
+		return false;
+	TextureCacheHeader Header;
+	memcpy(&Header, file.GetData(), sizeof(TextureCacheHeader));
+	texture.Format = static_cast<nvrhi::Format>(Header.Format);
+	texture.Width = Header.Width;
+	texture.Height = Header.Height;
+	texture.Data.clear();
+	if (Header.Magic != TextureCacheMagic || Header.Version != Version || Header.Key != key || GetBlockBytes(texture.Format) == 0
+		|| LayoutMips(texture, Header.MipCount, sizeof(TextureCacheHeader)) != file.GetSize())
+	{
+		file = ragdoll::MappedFile();
+		return false;
+	}
+	return true;
+}
+
+bool TextureCache::Save(const std::filesystem::path& cachePath, uint64_t key, const CompressedTexture& texture)
+{
+	RD_SCOPE(Load, Texture Cache Save);
+	TextureCacheHeader Header{};
+	Header.Magic = TextureCacheMagic;
+	Header.Version = Version;
+	Header.Key = key;
+	Header.Format = static_cast<uint32_t>(texture.Format);
+	Header.Width = texture.Width;
+	Header.Height = texture.Height;
+	Header.MipCount = static_cast<uint32_t>(texture.MipOffsets.size());
+
+	std::error_code ec;
+	std::filesystem::create_directories(cachePath.parent_path(), ec);
+	//write to a temporary file first so a crash halfway never leaves a truncated entry behind
+	//decodes of the same image from two models can race here, the rename keeps whichever lands last
+	std::filesystem::path TempPath = cachePath;
+	TempPath += fmt::format(".{:x}.tmp", std::hash<std::thread::id>()(std::this_thread::get_id()));
+	{
+		std::ofstream Out(TempPath, std::ios::binary | std::ios::trunc);
+		if (!Out)
+		{
+			RD_CORE_WARN("Unable to write texture cache {}", cachePath.string());
+			return false;
+		}
+		Out.write(reinterpret_cast<const char*>(&Header), sizeof(TextureCacheHeader));
+		Out.write(reinterpret_cast<const char*>(texture.Data.data()), texture.Data.size());
+		if (!Out)
+		{
+			RD_CORE_WARN("Unable to write texture cache {}", cachePath.string());
+			Out.close();
+			std::filesystem::remove(TempPath, ec);
+			return false;
+		}
+	}
+	std::filesystem::rename(TempPath, cachePath, ec);
+	if (ec)
+	{
+		RD_CORE_WARN("Unable to write texture cache {}: {}", cachePath.string(), ec.message());
+		std::filesystem::remove(TempPath, ec);
+		return false;
+	}
+	return true;
+}
+
+bool VerifyBlockCompression()
+{
+	bool bSuccess = true;
+	auto Check = [&bSuccess](bool bCondition, const char* what) {
+		if (!bCondition)
+		{
+			RD_CORE_ERROR("Block compression check failed: {}", what);
+			bSuccess = false;
+		}
+	};
+	auto RoundTrip = [](const std::vector<uint8_t>& rgba, uint32_t width, uint32_t height, nvrhi::Format format) {
+		std::vector<uint8_t> Blocks(size_t((width + 3) / 4) * ((height + 3) / 4) * GetBlockBytes(format));
+		std::vector<uint8_t> Decoded(rgba.size());
+		CompressImage(rgba.data(), width, height, format, Blocks.data());
+		DecompressImage(Blocks.data(), width, height, format, Decoded.data());
+		return ComputePSNR(rgba.data(), Decoded.data(), size_t(width) * height, format);
+	};
+	const nvrhi::Format Formats[] = { nvrhi::Format::BC1_UNORM, nvrhi::Format::BC3_UNORM, nvrhi::Format::BC5_UNORM, nvrhi::Format::BC7_UNORM };
+
+	//a flat colour every format can hit up to its endpoint precision
+	{
+		std::vector<uint8_t> Flat(16 * 16 * 4);
+		for (size_t i = 0; i < Flat.size(); i += 4)
+		{
+			Flat[i] = 200; Flat[i + 1] = 100; Flat[i + 2] = 50; Flat[i + 3] = 255;
+		}
+		for (nvrhi::Format Format : Formats)
+			Check(RoundTrip(Flat, 16, 16, Format) > 40.0, GetFormatName(Format));
+	}
+	//two colours per block lie on a line, every format should place them almost exactly
+	{
+		std::vector<uint8_t> TwoTone(8 * 8 * 4);
+		for (uint32_t i = 0; i < 64; ++i)
+		{
+			const bool bOn = ((i % 8) + (i / 8)) & 1;
+			TwoTone[i * 4] = bOn ? 248 : 8;
+			TwoTone[i * 4 + 1] = bOn ? 252 : 4;
+			TwoTone[i * 4 + 2] = bOn ? 248 : 8;
+			TwoTone[i * 4 + 3] = bOn ? 255 : 0;
+		}
+		for (nvrhi::Format Format : Formats)
+			Check(RoundTrip(TwoTone, 8, 8, Format) > 40.0, GetFormatName(Format));
+	}
+	//smooth gradients with noise, the typical material texture, plus a size that is not whole blocks
+	{
+		std::mt19937 Rng(7);
+		std::uniform_int_distribution<int> Noise(-6, 6);
+		const uint32_t Width = 70, Height = 38;
+		std::vector<uint8_t> Gradient(size_t(Width) * Height * 4);
+		for (uint32_t y = 0; y < Height; ++y)
+		{
+			for (uint32_t x = 0; x < Width; ++x)
+			{
+				uint8_t* Texel = Gradient.data() + (size_t(y) * Width + x) * 4;
+				Texel[0] = static_cast<uint8_t>(std::clamp(int(x * 255 / Width) + Noise(Rng), 0, 255));
+				Texel[1] = static_cast<uint8_t>(std::clamp(int(y * 255 / Height) + Noise(Rng), 0, 255));
+				Texel[2] = static_cast<uint8_t>(std::clamp(128 + Noise(Rng), 0, 255));
+				Texel[3] = static_cast<uint8_t>(std::clamp(int((x + y) * 255 / (Width + Height)), 0, 255));
+			}
+		}
+		const double Bc1 = RoundTrip(Gradient, Width, Height, nvrhi::Format::BC1_UNORM);
+		const double Bc3 = RoundTrip(Gradient, Width, Height, nvrhi::Format::BC3_UNORM);
+		const double Bc5 = RoundTrip(Gradient, Width, Height, nvrhi::Format::BC5_UNORM);
+		const double Bc7 = RoundTrip(Gradient, Width, Height, nvrhi::Format::BC7_UNORM);
+		Check(Bc1 > 32.0, "BC1 gradient");
+		Check(Bc3 > 32.0, "BC3 gradient");
+		Check(Bc5 > 36.0, "BC5 gradient");
+		Check(Bc7 > 36.0, "BC7 gradient");
+		//bc7 has more endpoint and index precision than bc1 on the same colours
+		Check(Bc7 > Bc1, "BC7 beats BC1");
+		RD_CORE_INFO("Block compression gradient psnr: BC1 {:.2f}dB, BC3 {:.2f}dB, BC5 {:.2f}dB, BC7 {:.2f}dB", Bc1, Bc3, Bc5, Bc7);
+	}
+	//mips filter colour in linear space, a black and white checker averages to linear grey which is srgb 188 and not 128
+	{
+		std::vector<uint8_t> Checker(4 * 4 * 4);
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			const uint8_t Value = ((i % 4) + (i / 4)) & 1 ? 255 : 0;
+			Checker[i * 4] = Checker[i * 4 + 1] = Checker[i * 4 + 2] = Value;
+			Checker[i * 4 + 3] = 255;
+		}
+		TextureMipChain Chain;
+		GenerateMipChain(Checker.data(), 4, 4, TextureUsage::Color, Chain);
+		Check(Chain.MipOffsets.size() == 3, "mip count");
+		const uint8_t* Last = Chain.Pixels.data() + Chain.MipOffsets.back();
+		Check(abs(int(Last[0]) - 188) <= 1 && Last[3] == 255, "linear colour filtering");
+		GenerateMipChain(Checker.data(), 4, 4, TextureUsage::Linear, Chain);
+		Last = Chain.Pixels.data() + Chain.MipOffsets.back();
+		Check(abs(int(Last[0]) - 128) <= 1, "linear data filtering");
+	}
+	//two normals tilted apart average to a unit normal and not a shortened one
+	{
+		std::vector<uint8_t> Normals(2 * 2 * 4);
+		for (uint32_t i = 0; i < 4; ++i)
+		{
+			const float x = (i & 1) ? 0.6f : -0.6f;
+			Normals[i * 4] = static_cast<uint8_t>(x * 127.5f + 127.5f + 0.5f);
+			Normals[i * 4 + 1] = 128;
+			Normals[i * 4 + 2] = static_cast<uint8_t>(0.8f * 127.5f + 127.5f + 0.5f);
+			Normals[i * 4 + 3] = 255;
+		}
+		TextureMipChain Chain;
+		GenerateMipChain(Normals.data(), 2, 2, TextureUsage::Normal, Chain);
+		const uint8_t* Last = Chain.Pixels.data() + Chain.MipOffsets.back();
+		Check(Last[2] >= 254, "normal renormalization");
+	}
+	//the gpu only reads what the encoder writes, check the block layouts against hand decoded values
+	{
+		std::vector<uint8_t> Opaque(4 * 4 * 4, 255);
+		uint8_t Block[16];
+		CompressImage(Opaque.data(), 4, 4, nvrhi::Format::BC7_UNORM, Block);
+		Check((Block[0] & 0x7f) == 0x40, "BC7 mode 6 header");
+		CompressImage(Opaque.data(), 4, 4, nvrhi::Format::BC1_UNORM, Block);
+		Check(Block[0] == 0xff && Block[1] == 0xff, "BC1 white endpoint");
+	}
+	if (bSuccess)
+		RD_CORE_INFO("Block compression checks passed");
+	return bSuccess;
+}
+
+void ReportTextureCompression(const std::filesystem::path& path)
+{
+	std::vector<std::filesystem::path> Files;
+	auto IsImage = [](const std::filesystem::path& file) {
+		std::string Extension = file.extension().string();
+		std::transform(Extension.begin(), Extension.end(), Extension.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+		return Extension == ".png" || Extension == ".jpg" || Extension == ".jpeg";
+	};
+	std::error_code ec;
+	if (std::filesystem::is_directory(path, ec))
+	{
+		for (const auto& Entry : std::filesystem::recursive_directory_iterator(path, ec))
+			if (Entry.is_regular_file() && IsImage(Entry.path()))
+				Files.push_back(Entry.path());
+	}
+	else if (IsImage(path))
+		Files.push_back(path);
+	if (Files.empty())
+	{
+		RD_CORE_WARN("No png or jpg images under {}", path.string());
+		return;
+	}
+	std::sort(Files.begin(), Files.end());
+
+	VerifyBlockCompression();
+	const nvrhi::Format Formats[] = { nvrhi::Format::BC1_UNORM, nvrhi::Format::BC3_UNORM, nvrhi::Format::BC5_UNORM, nvrhi::Format::BC7_UNORM };
+	struct FormatTotals
+	{
+		double Seconds{};
+		double PsnrSum{};
+		double MinPsnr{ 99.0 };
+		size_t Texels{};
+		uint32_t Images{};
+	} Totals[4];
+	double MipSeconds = 0.0;
+	size_t MipTexels = 0;
+	for (const std::filesystem::path& File : Files)
+	{
+		int w = 0, h = 0, comp = 0;
+		uint8_t* Raw = stbi_load(File.string().c_str(), &w, &h, &comp, 4);
+		if (!Raw)
+		{
+			RD_CORE_WARN("stb unable to read image {}", File.string());
+			continue;
+		}
+		const uint32_t Width = static_cast<uint32_t>(w), Height = static_cast<uint32_t>(h);
+		TextureMipChain Chain;
+		auto Start = std::chrono::high_resolution_clock::now();
+		GenerateMipChain(Raw, Width, Height, TextureUsage::Color, Chain);
+		MipSeconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - Start).count();
+		MipTexels += size_t(Width) * Height;
+
+		std::vector<uint8_t> Blocks(size_t((Width + 3) / 4) * ((Height + 3) / 4) * 16), Decoded(size_t(Width) * Height * 4);
+		std::string Line = fmt::format("{} {}x{}:", File.filename().string(), Width, Height);
+		for (uint32_t f = 0; f < 4; ++f)
+		{
+			//block rows spread over the executor, the same way CompressTexture runs
+			const uint32_t BlocksX = (Width + 3) / 4, BlocksY = (Height + 3) / 4;
+			const uint32_t RowsPerTask = std::max(4096u / BlocksX, 1u);
+			tf::Taskflow Taskflow;
+			for (uint32_t Row = 0; Row < BlocksY; Row += RowsPerTask)
+			{
+				const uint32_t LastRow = std::min(Row + RowsPerTask, BlocksY);
+				Taskflow.emplace([&, Row, LastRow]() { CompressRows(Raw, Width, Height, Formats[f], Blocks.data(), Row, LastRow); });
+			}
+			Start = std::chrono::high_resolution_clock::now();
+			SExecutor::Run(Taskflow);
+			Totals[f].Seconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - Start).count();
+			DecompressImage(Blocks.data(), Width, Height, Formats[f], Decoded.data());
+			const double Psnr = ComputePSNR(Raw, Decoded.data(), size_t(Width) * Height, Formats[f]);
+			Totals[f].PsnrSum += Psnr;
+			Totals[f].MinPsnr = std::min(Totals[f].MinPsnr, Psnr);
+			Totals[f].Texels += size_t(Width) * Height;
+			++Totals[f].Images;
+			Line += fmt::format(" {} {:.2f}dB", GetFormatName(Formats[f]), Psnr);
+		}
+		RD_CORE_INFO("{}", Line);
+		stbi_image_free(Raw);
+	}
+	RD_CORE_INFO("Texture compression over {} images on {} threads, mips {:.1f}MTexels/s:", Totals[0].Images, SExecutor::Executor.num_workers(),
+		MipTexels / std::max(MipSeconds, 1e-9) / 1e6);
+	for (uint32_t f = 0; f < 4; ++f)
+	{
+		if (Totals[f].Images == 0)
+			continue;
+		RD_CORE_INFO("  {}: mean {:.2f}dB, worst {:.2f}dB, {:.1f}MTexels/s, {:.1f}MB/s of rgba8", GetFormatName(Formats[f]),
+			Totals[f].PsnrSum / Totals[f].Images, Totals[f].MinPsnr, Totals[f].Texels / std::max(Totals[f].Seconds, 1e-9) / 1e6,
+			Totals[f].Texels * 4.0 / std::max(Totals[f].Seconds, 1e-9) / (1024.0 * 1024.0));
+	}
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include "Ragdoll/DecodeScratch.h"
+#include "Ragdoll/File/MappedFile.h"
+#include <nvrhi/nvrhi.h>
+
+//what the texels of a texture mean, decides how its mips are filtered and which block format it is encoded to
+enum class TextureUsage : uint8_t
+{
+	//srgb encoded colour, albedo and emissive
+	Color,
+	//tangent space normal in rgb, only xy survives the encode and z is rebuilt in the shader
+	Normal,
+	//occlusion, roughness, metallic or anything else that is filtered as is
+	Linear,
+};
+
+enum class TextureEncodeQuality : uint8_t
+{
+	//bc1, bc3 if there is alpha
+	Fast,
+	//bc7
+	High,
+};
+
+//rgba8 mips, finest first and tightly packed
+struct TextureMipChain
+{
+	uint32_t Width{};
+	uint32_t Height{};
+	DecodeScratch::Vector<uint8_t> Pixels;
+	std::vector<size_t> MipOffsets;
+};
+
+//block compressed mips ready to be uploaded, Data is empty when the mips live in a mapped cache file
+struct CompressedTexture
+{
+	nvrhi::Format Format{ nvrhi::Format::UNKNOWN };
+	uint32_t Width{};
+	uint32_t Height{};
+	DecodeScratch::Vector<uint8_t> Data;
+	std::vector<size_t> MipOffsets;
+	std::vector<size_t> RowPitches;
+	std::vector<size_t> SlicePitches;
+};
+
+//the block format an rgba8 image is encoded to, bc5 for normals whatever the quality
+nvrhi::Format GetBlockFormat(TextureUsage usage, bool bHasAlpha, TextureEncodeQuality quality);
+//any texel with alpha below 255
+bool HasAlpha(const uint8_t* rgba, size_t pixelCount);
+//d3d12 wants the top mip of a block compressed texture in whole blocks
+bool CanBlockCompress(uint32_t width, uint32_t height);
+
+//builds every mip down to 1x1 from the rgba8 top mip, a 2x2 box in linear space for colour and renormalized for normals
+//odd sizes repeat their last row and column
+void GenerateMipChain(const uint8_t* rgba, uint32_t width, uint32_t height, TextureUsage usage, TextureMipChain& chain);
+
+//bytes of one 4x4 block, 0 if the format is not one of bc1, bc3, bc5 or bc7
+uint32_t GetBlockBytes(nvrhi::Format format);
+//encodes one rgba8 image, blocks past the edge repeat the last row and column
+void CompressImage(const uint8_t* rgba, uint32_t width, uint32_t height, nvrhi::Format format, uint8_t* blocks);
+//decodes back to rgba8, bc5 fills blue with 0 and alpha with 255, bc7 only knows mode 6 which is the only one CompressImage writes
+void DecompressImage(const uint8_t* blocks, uint32_t width, uint32_t height, nvrhi::Format format, uint8_t* rgba);
+//over the channels the format keeps, rgb for bc1, rgba for bc3 and bc7, rg for bc5
+double ComputePSNR(const uint8_t* reference, const uint8_t* decoded, size_t pixelCount, nvrhi::Format format);
+
+//mip chain and encode of one image, the blocks are spread over the executor
+void CompressTexture(const uint8_t* rgba, uint32_t width, uint32_t height, TextureUsage usage, TextureEncodeQuality quality, CompressedTexture& texture);
+
+//compressed textures cooked to disk, keyed on the encoded source bytes and everything that changes the encode
+struct TextureCache
+{
+	//bump whenever the file layout or the encoder output changes
+	static constexpr uint32_t Version = 1;
+
+	static uint64_t GetKey(const uint8_t* source, size_t size, TextureUsage usage, TextureEncodeQuality quality);
+	static std::filesystem::path GetCachePath(const std::filesystem::path& cacheRoot, const std::string& name, uint64_t key);
+	//maps the cache file, the mip offsets of the texture index into the mapping
+	static bool Load(const std::filesystem::path& cachePath, uint64_t key, ragdoll::MappedFile& file, CompressedTexture& texture);
+	static bool Save(const std::filesystem::path& cachePath, uint64_t key, const CompressedTexture& texture);
+};
+
+//round trips hand made blocks through every encoder and checks the error bounds, returns false on any failure
+bool VerifyBlockCompression();
+//encodes every png and jpg under the path to each format and logs the psnr and throughput, needs no device
+void ReportTextureCompression(const std::filesystem::path& path);
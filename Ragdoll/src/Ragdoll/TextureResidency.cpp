@@ -0,0 +1,477 @@
+#include "ragdollpch.h"
+#include "TextureResidency.h"
+
+#include "Profiler.h"
+
+uint32_t TextureResidencyScheduler::AddTexture(uint32_t width, uint32_t height, const std::vector<size_t>& mipBytes, float priority)
+{
+	RD_ASSERT(mipBytes.empty(), "Texture without mips");
+	TextureState& State = Textures.emplace_back();
+	State.MipBytes = mipBytes;
+	State.Priority = priority;
+	const uint32_t MipCount = static_cast<uint32_t>(mipBytes.size());
+	//the first mip small enough, a texture with a short chain has its coarsest mip as the tail no matter the size
+	State.TailMip = MipCount - 1;
+	for (uint32_t Mip = 0; Mip < MipCount; ++Mip)
+	{
+		if (std::max(width >> Mip, 1u) <= Config.TailSize && std::max(height >> Mip, 1u) <= Config.TailSize)
+		{
+			State.TailMip = Mip;
+			break;
+		}
+	}
+	State.ResidentMip = MipCount;
+	State.WantedMip = 0;
+	++PendingTails;
+	bLastScheduleEmpty = false;
+	return static_cast<uint32_t>(Textures.size() - 1);
+}
+
+void TextureResidencyScheduler::SetPriority(uint32_t texture, float priority)
+{
+	Textures[texture].Priority = priority;
+	bLastScheduleEmpty = false;
+}
+
+void TextureResidencyScheduler::SetWantedMip(uint32_t texture, uint32_t mip)
+{
+	Textures[texture].WantedMip = std::min(mip, GetMipCount(texture) - 1);
+	bLastScheduleEmpty = false;
+}
+
+size_t TextureResidencyScheduler::GetBytes(uint32_t texture, uint32_t mip) const
+{
+	const std::vector<size_t>& MipBytes = Textures[texture].MipBytes;
+	size_t Bytes{};
+	for (size_t i = mip; i < MipBytes.size(); ++i)
+		Bytes += MipBytes[i];
+	return Bytes;
+}
+
+void TextureResidencyScheduler::Evict(uint32_t texture, uint32_t mip, std::vector<Eviction>& evictions)
+{
+	TextureState& State = Textures[texture];
+	for (uint32_t Mip = State.ResidentMip; Mip < mip; ++Mip)
+	{
+		ResidentBytes -= State.MipBytes[Mip];
+		Counters.EvictedBytes += State.MipBytes[Mip];
+	}
+	State.ResidentMip = mip;
+	++Counters.Evictions;
+	//one entry per texture, the caller only cares where it ends up
+	if (!evictions.empty() && evictions.back().Texture == texture)
+		evictions.back().Mip = mip;
+	else
+		evictions.push_back({ texture, mip });
+}
+
+bool TextureResidencyScheduler::EvictOne(float belowPriority, std::vector<Eviction>& evictions)
+{
+	//Order is highest priority first, victims come from the back
+	while (VictimCursor < Order.size())
+	{
+		const uint32_t Victim = Order[Order.size() - 1 - VictimCursor];
+		const TextureState& State = Textures[Victim];
+		if (State.Priority >= belowPriority)
+			return false;
+		if (!State.bInFlight && State.ResidentMip < State.TailMip)
+		{
+			Evict(Victim, State.ResidentMip + 1, evictions);
+			return true;
+		}
+		++VictimCursor;
+	}
+	return false;
+}
+
+void TextureResidencyScheduler::Schedule(std::vector<Request>& requests, std::vector<Eviction>& evictions)
+{
+	requests.clear();
+	evictions.clear();
+
+	//mips that are not wanted anymore go first, that memory can be handed out right away
+	for (uint32_t i = 0; i < Textures.size(); ++i)
+	{
+		const TextureState& State = Textures[i];
+		const uint32_t Keep = std::min(State.WantedMip, State.TailMip);
+		if (!State.bInFlight && State.ResidentMip < Keep)
+			Evict(i, Keep, evictions);
+	}
+
+	Order.resize(Textures.size());
+	std::iota(Order.begin(), Order.end(), 0u);
+	std::stable_sort(Order.begin(), Order.end(), [this](uint32_t a, uint32_t b) { return Textures[a].Priority > Textures[b].Priority; });
+	VictimCursor = 0;
+
+	//a lowered budget strips the lowest priorities until it fits again
+	while (ResidentBytes + InFlightBytes > Config.BudgetBytes && EvictOne(std::numeric_limits<float>::infinity(), evictions));
+
+	auto Issue = [&](uint32_t texture, uint32_t mip, bool bTail, size_t bytes) {
+		Textures[texture].bInFlight = true;
+		InFlightBytes += bytes;
+		requests.push_back({ texture, mip, bTail });
+		++Counters.Requests;
+	};
+	//the first request always goes out, even if it alone is over the in flight limit
+	auto CanIssue = [&](size_t bytes) { return InFlightBytes == 0 || InFlightBytes + bytes <= Config.MaxInFlightBytes; };
+
+	//tails ignore the budget, without them there is nothing to sample at all
+	if (PendingTails > 0)
+	{
+		for (uint32_t Texture : Order)
+		{
+			const TextureState& State = Textures[Texture];
+			if (State.bInFlight || State.ResidentMip <= State.TailMip)
+				continue;
+			const size_t Bytes = GetBytes(Texture, State.TailMip);
+			if (!CanIssue(Bytes))
+				break;
+			Issue(Texture, State.TailMip, true, Bytes);
+		}
+		Counters.PeakCommittedBytes = std::max(Counters.PeakCommittedBytes, ResidentBytes + InFlightBytes);
+		bLastScheduleEmpty = requests.empty() && evictions.empty();
+		//the rest waits for every tail, so the first frames have all the textures at low resolution before any of them gets sharp
+		return;
+	}
+
+	//what every priority could free up, so a mip that can never fit does not evict anything
+	Evictable.clear();
+	size_t EvictableBytes{};
+	for (auto it = Order.rbegin(); it != Order.rend(); ++it)
+	{
+		const TextureState& State = Textures[*it];
+		if (!State.bInFlight)
+		{
+			for (uint32_t Mip = State.ResidentMip; Mip < State.TailMip; ++Mip)
+				EvictableBytes += State.MipBytes[Mip];
+		}
+		Evictable.emplace_back(State.Priority, EvictableBytes);
+	}
+	size_t EvictedBytes{};
+
+	for (uint32_t Texture : Order)
+	{
+		const TextureState& State = Textures[Texture];
+		if (State.bInFlight || State.ResidentMip > State.TailMip || State.ResidentMip <= State.WantedMip)
+			continue;
+		const uint32_t Mip = State.ResidentMip - 1;
+		const size_t Bytes = State.MipBytes[Mip];
+		if (!CanIssue(Bytes))
+			break;
+		if (ResidentBytes + InFlightBytes + Bytes > Config.BudgetBytes)
+		{
+			//only strictly lower priorities can be evicted so two textures never keep evicting each other
+			auto Below = std::lower_bound(Evictable.begin(), Evictable.end(), State.Priority,
+				[](const std::pair<float, size_t>& entry, float priority) { return entry.first < priority; });
+			const size_t Available = Below == Evictable.begin() ? 0 : (Below - 1)->second;
+			const size_t Needed = ResidentBytes + InFlightBytes + Bytes - Config.BudgetBytes;
+			if (Available < EvictedBytes + Needed)
+				continue;
+			const size_t ResidentBefore = ResidentBytes;
+			while (ResidentBytes + InFlightBytes + Bytes > Config.BudgetBytes && EvictOne(State.Priority, evictions));
+			EvictedBytes += ResidentBefore - ResidentBytes;
+			if (ResidentBytes + InFlightBytes + Bytes > Config.BudgetBytes)
+				continue;
+		}
+		Issue(Texture, Mip, false, Bytes);
+	}
+	Counters.PeakCommittedBytes = std::max(Counters.PeakCommittedBytes, ResidentBytes + InFlightBytes);
+	bLastScheduleEmpty = requests.empty() && evictions.empty();
+}
+
+void TextureResidencyScheduler::OnLoaded(const Request& request)
+{
+	TextureState& State = Textures[request.Texture];
+	const size_t Bytes = request.bTail ? GetBytes(request.Texture, State.TailMip) : State.MipBytes[request.Mip];
+	State.bInFlight = false;
+	InFlightBytes -= Bytes;
+	ResidentBytes += Bytes;
+	State.ResidentMip = request.Mip;
+	if (request.bTail)
+		--PendingTails;
+	bLastScheduleEmpty = false;
+}
+
+void TextureResidencyScheduler::OnFailed(const Request& request)
+{
+	TextureState& State = Textures[request.Texture];
+	const size_t Bytes = request.bTail ? GetBytes(request.Texture, State.TailMip) : State.MipBytes[request.Mip];
+	State.bInFlight = false;
+	InFlightBytes -= Bytes;
+	bLastScheduleEmpty = false;
+}
+
+namespace
+{
+	//a full rgba8 mip chain
+	std::vector<size_t> GetMipBytes(uint32_t width, uint32_t height, uint32_t bytesPerPixel = 4)
+	{
+		std::vector<size_t> MipBytes;
+		for (uint32_t Mip = 0; (width >> Mip) || (height >> Mip); ++Mip)
+			MipBytes.push_back(size_t(std::max(width >> Mip, 1u)) * std::max(height >> Mip, 1u) * bytesPerPixel);
+		return MipBytes;
+	}
+
+	//loads everything handed out until nothing is left, checking the budget after every schedule
+	//returns the number of schedules or 0 if the budget was broken
+	uint32_t RunToSettled(TextureResidencyScheduler& scheduler, size_t tailBytes)
+	{
+		std::vector<TextureResidencyScheduler::Request> Requests;
+		std::vector<TextureResidencyScheduler::Eviction> Evictions;
+		for (uint32_t Iteration = 1; Iteration < 100000; ++Iteration)
+		{
+			scheduler.Schedule(Requests, Evictions);
+			if (scheduler.GetResidentBytes() + scheduler.GetInFlightBytes() > std::max(scheduler.GetSettings().BudgetBytes, tailBytes))
+				return 0;
+			for (const TextureResidencyScheduler::Request& Request : Requests)
+				scheduler.OnLoaded(Request);
+			if (scheduler.IsSettled())
+				return Iteration;
+		}
+		return 0;
+	}
+}
+
+bool VerifyTextureResidency()
+{
+	RD_SCOPE(Load, Verify Texture Residency);
+	uint32_t Failures{};
+	auto Check = [&Failures](bool bPassed, const char* what) {
+		if (!bPassed)
+		{
+			RD_CORE_ERROR("Texture residency: {}", what);
+			++Failures;
+		}
+	};
+	std::vector<TextureResidencyScheduler::Request> Requests;
+	std::vector<TextureResidencyScheduler::Eviction> Evictions;
+	const std::vector<size_t> Mips1k = GetMipBytes(1024, 1024);
+	const size_t Size1k = std::accumulate(Mips1k.begin(), Mips1k.end(), size_t(0));
+
+	//tails go out first and alone, then one mip per texture from the highest priority down
+	{
+		TextureResidencyScheduler Scheduler;
+		for (float Priority : { 1.f, 3.f, 2.f })
+			Scheduler.AddTexture(1024, 1024, Mips1k, Priority);
+		Check(Scheduler.GetTailMip(0) == 4, "the tail of a 1024 texture should start at the 64 mip");
+		Scheduler.Schedule(Requests, Evictions);
+		Check(Requests.size() == 3 && std::all_of(Requests.begin(), Requests.end(), [](const auto& r) { return r.bTail; }), "the first schedule should only hand out the three tails");
+		Scheduler.OnLoaded(Requests[0]);
+		Scheduler.Schedule(Requests, Evictions);
+		Check(Requests.empty(), "nothing above the tails should go out while a tail is still loading");
+		Scheduler.Schedule(Requests, Evictions);
+		Scheduler.OnLoaded({ 0, 4, true });
+		Scheduler.OnLoaded({ 2, 4, true });
+		Check(Scheduler.AreTailsResident() && Scheduler.GetResidentBytes() == 3 * Scheduler.GetBytes(0, 4), "the tails should be resident");
+		Scheduler.Schedule(Requests, Evictions);
+		Check(Requests.size() == 3 && Requests[0].Texture == 1 && Requests[1].Texture == 2 && Requests[2].Texture == 0, "mips should go out by priority");
+		Check(std::all_of(Requests.begin(), Requests.end(), [](const auto& r) { return !r.bTail && r.Mip == 3; }), "the first mip above the tail should be next");
+	}
+
+	//the in flight limit hands out one mip at a time, but never zero
+	{
+		TextureResidencyScheduler Scheduler;
+		Scheduler.Init({ Size1k * 4, Mips1k[3], 64 });
+		Scheduler.AddTexture(1024, 1024, Mips1k, 1.f);
+		Scheduler.AddTexture(1024, 1024, Mips1k, 2.f);
+		Scheduler.Schedule(Requests, Evictions);
+		for (const auto& Request : Requests)
+			Scheduler.OnLoaded(Request);
+		uint32_t Handed{};
+		for (uint32_t i = 0; i < 64 && !Scheduler.IsSettled(); ++i)
+		{
+			Scheduler.Schedule(Requests, Evictions);
+			Check(Requests.size() <= 1, "the in flight limit should let one mip out at a time");
+			for (const auto& Request : Requests)
+			{
+				Check(Request.Texture == 1 || Scheduler.GetResidentMip(1) == 0, "a lower priority mip went out before the higher priority texture was done");
+				Scheduler.OnLoaded(Request);
+				++Handed;
+			}
+		}
+		Check(Scheduler.GetResidentMip(0) == 0 && Scheduler.GetResidentMip(1) == 0 && Handed == 8, "both textures should end up fully resident one mip at a time");
+		Check(Scheduler.GetStats().Evictions == 0, "nothing should be evicted with enough budget");
+	}
+
+	//a tight budget keeps the budget and the priorities, whatever order the textures come in
+	{
+		std::mt19937 Random(7);
+		std::uniform_int_distribution<uint32_t> SizeShift(6, 11);
+		std::uniform_real_distribution<float> PriorityDistribution(0.f, 1.f);
+		TextureResidencyScheduler Scheduler;
+		size_t TotalBytes{}, TailBytes{};
+		std::vector<float> Priorities;
+		for (uint32_t i = 0; i < 40; ++i)
+		{
+			const uint32_t Width = 1u << SizeShift(Random), Height = 1u << SizeShift(Random);
+			const std::vector<size_t> Mips = GetMipBytes(Width, Height);
+			TotalBytes += std::accumulate(Mips.begin(), Mips.end(), size_t(0));
+			Priorities.push_back(PriorityDistribution(Random));
+			const uint32_t Texture = Scheduler.AddTexture(Width, Height, Mips, Priorities.back());
+			TailBytes += Scheduler.GetBytes(Texture, Scheduler.GetTailMip(Texture));
+		}
+		Scheduler.SetBudget(TotalBytes / 3);
+		Check(RunToSettled(Scheduler, TailBytes) != 0, "the budget was broken or it never settled");
+		//a texture short of its wanted mip has to be held back by the budget, even with every lower priority texture down to its tail
+		auto CheckPriorities = [&](const char* what) {
+			for (uint32_t a = 0; a < Scheduler.GetTextureCount(); ++a)
+			{
+				const uint32_t Resident = Scheduler.GetResidentMip(a);
+				if (Resident <= Scheduler.GetWantedMip(a))
+					continue;
+				size_t Evictable{};
+				for (uint32_t b = 0; b < Scheduler.GetTextureCount(); ++b)
+				{
+					if (Priorities[b] < Priorities[a] && Scheduler.GetResidentMip(b) < Scheduler.GetTailMip(b))
+						Evictable += Scheduler.GetBytes(b, Scheduler.GetResidentMip(b)) - Scheduler.GetBytes(b, Scheduler.GetTailMip(b));
+				}
+				const size_t NextMipBytes = Scheduler.GetBytes(a, Resident - 1) - Scheduler.GetBytes(a, Resident);
+				if (Scheduler.GetResidentBytes() + NextMipBytes <= Scheduler.GetSettings().BudgetBytes + Evictable)
+				{
+					Check(false, what);
+					return;
+				}
+			}
+		};
+		CheckPriorities("a texture was left short while lower priority mips could have made room");
+
+		//reversing the priorities moves the budget over to the other textures
+		for (uint32_t i = 0; i < Scheduler.GetTextureCount(); ++i)
+		{
+			Priorities[i] = 1.f - Priorities[i];
+			Scheduler.SetPriority(i, Priorities[i]);
+		}
+		const size_t EvictionsBefore = Scheduler.GetStats().Evictions;
+		Check(RunToSettled(Scheduler, TailBytes) != 0, "the budget was broken or it never settled after the priorities changed");
+		CheckPriorities("a texture was left short after the priorities changed");
+		Check(Scheduler.GetStats().Evictions > EvictionsBefore, "the new priorities should have evicted the old ones");
+		uint32_t HighestPriority = 0;
+		for (uint32_t i = 0; i < Scheduler.GetTextureCount(); ++i)
+			HighestPriority = Priorities[i] > Priorities[HighestPriority] ? i : HighestPriority;
+		Check(Scheduler.GetResidentMip(HighestPriority) == 0, "the new highest priority texture should be fully resident");
+
+		//halving the budget strips the lowest priorities straight away
+		Scheduler.SetBudget(TotalBytes / 6);
+		Check(RunToSettled(Scheduler, TailBytes) != 0, "the budget was broken after it got lowered");
+	}
+
+	//textures of the same priority never evict each other
+	{
+		TextureResidencyScheduler Scheduler;
+		Scheduler.Init({ Size1k + Size1k / 2, size_t(64) << 20, 64 });
+		Scheduler.AddTexture(1024, 1024, Mips1k, 1.f);
+		Scheduler.AddTexture(1024, 1024, Mips1k, 1.f);
+		Check(RunToSettled(Scheduler, 0) != 0, "the budget was broken or it never settled with equal priorities");
+		Check(Scheduler.GetStats().Evictions == 0, "textures of the same priority evicted each other");
+	}
+
+	//a coarser wanted mip gives its memory back, a finer one brings it back in
+	{
+		TextureResidencyScheduler Scheduler;
+		Scheduler.AddTexture(1024, 1024, Mips1k, 1.f);
+		RunToSettled(Scheduler, 0);
+		Check(Scheduler.GetResidentMip(0) == 0 && Scheduler.GetResidentBytes() == Size1k, "the texture should be fully resident");
+		Scheduler.SetWantedMip(0, 2);
+		Scheduler.Schedule(Requests, Evictions);
+		Check(Evictions.size() == 1 && Evictions[0].Mip == 2 && Scheduler.GetResidentBytes() == Scheduler.GetBytes(0, 2), "the mips finer than the wanted one should be evicted");
+		Scheduler.SetWantedMip(0, 0);
+		RunToSettled(Scheduler, 0);
+		Check(Scheduler.GetResidentMip(0) == 0, "the mips should come back once they are wanted again");
+		//a failed request goes out again
+		Scheduler.SetWantedMip(0, 1);
+		Scheduler.Schedule(Requests, Evictions);
+		Scheduler.SetWantedMip(0, 0);
+		Scheduler.Schedule(Requests, Evictions);
+		Check(Requests.size() == 1 && Requests[0].Mip == 0, "mip 0 should be requested");
+		Scheduler.OnFailed(Requests[0]);
+		Check(Scheduler.GetInFlightBytes() == 0, "a failed request should release its bytes");
+		Scheduler.Schedule(Requests, Evictions);
+		Check(Requests.size() == 1 && Requests[0].Mip == 0, "a failed request should be handed out again");
+	}
+
+	if (Failures)
+		RD_CORE_ERROR("Texture residency: {} checks failed", Failures);
+	else
+		RD_CORE_INFO("Texture residency: all checks passed");
+	return Failures == 0;
+}
+
+void BenchmarkTextureResidency()
+{
+	RD_SCOPE(Load, Benchmark Texture Residency);
+	//a large scene worth of rgba8 textures spread along a line the camera flies down
+	constexpr uint32_t TextureCount = 2000;
+	constexpr uint32_t FrameCount = 1200;
+	//frames between a request going out and its upload landing
+	constexpr uint32_t LatencyFrames = 2;
+	constexpr double MB = 1024.0 * 1024.0;
+	std::mt19937 Random(42);
+	std::uniform_int_distribution<uint32_t> SizeShift(8, 12);
+	std::uniform_real_distribution<float> PositionDistribution(0.f, 1000.f);
+
+	TextureResidencyScheduler Scheduler;
+	TextureResidencyScheduler::Settings Settings;
+	Settings.BudgetBytes = size_t(1) << 30;
+	Settings.MaxInFlightBytes = size_t(64) << 20;
+	Scheduler.Init(Settings);
+	std::vector<float> Positions(TextureCount);
+	size_t TotalBytes{};
+	for (uint32_t i = 0; i < TextureCount; ++i)
+	{
+		const uint32_t Size = 1u << SizeShift(Random);
+		const std::vector<size_t> Mips = GetMipBytes(Size, Size);
+		TotalBytes += std::accumulate(Mips.begin(), Mips.end(), size_t(0));
+		Positions[i] = PositionDistribution(Random);
+		Scheduler.AddTexture(Size, Size, Mips, 0.f);
+	}
+
+	std::vector<TextureResidencyScheduler::Request> Requests;
+	std::vector<TextureResidencyScheduler::Eviction> Evictions;
+	std::vector<std::vector<TextureResidencyScheduler::Request>> InFlight(LatencyFrames);
+	uint32_t TailsFrame{}, SettledFrame{};
+	double TotalScheduleMs{}, MaxScheduleMs{};
+	size_t MaxRequestsPerFrame{};
+	size_t FlyThroughSharp{};
+	for (uint32_t Frame = 0; Frame < FrameCount; ++Frame)
+	{
+		//the camera sits still for the first half so the scene can settle, then flies through it
+		const float Camera = Frame < FrameCount / 2 ? 0.f : (Frame - FrameCount / 2) * (1000.f / (FrameCount / 2));
+		for (uint32_t i = 0; i < TextureCount; ++i)
+		{
+			const float Distance = std::abs(Positions[i] - Camera);
+			Scheduler.SetPriority(i, 1.f / (1.f + Distance));
+			//one mip coarser every time the distance doubles past 25 units
+			Scheduler.SetWantedMip(i, Distance < 25.f ? 0 : static_cast<uint32_t>(std::log2(Distance / 25.f)) + 1);
+		}
+		//uploads land at the start of the frame they were due
+		for (const TextureResidencyScheduler::Request& Request : InFlight[Frame % LatencyFrames])
+			Scheduler.OnLoaded(Request);
+		auto Start = std::chrono::high_resolution_clock::now();
+		Scheduler.Schedule(Requests, Evictions);
+		std::chrono::duration<double, std::milli> Duration = std::chrono::high_resolution_clock::now() - Start;
+		TotalScheduleMs += Duration.count();
+		MaxScheduleMs = std::max(MaxScheduleMs, Duration.count());
+		MaxRequestsPerFrame = std::max(MaxRequestsPerFrame, Requests.size());
+
+		InFlight[Frame % LatencyFrames] = Requests;
+		if (!TailsFrame && Scheduler.AreTailsResident())
+			TailsFrame = Frame;
+		if (!SettledFrame && Frame < FrameCount / 2 && Scheduler.IsSettled())
+			SettledFrame = Frame;
+		if (Frame >= FrameCount / 2)
+		{
+			for (uint32_t i = 0; i < TextureCount; ++i)
+				FlyThroughSharp += Scheduler.GetResidentMip(i) <= Scheduler.GetWantedMip(i);
+		}
+	}
+
+	const TextureResidencyScheduler::Stats& Stats = Scheduler.GetStats();
+	RD_CORE_INFO("Texture residency: {} textures, {:.0f}MB in total, {:.0f}MB budget, {:.0f}MB in flight per frame, {} frame latency",
+		TextureCount, TotalBytes / MB, Settings.BudgetBytes / MB, Settings.MaxInFlightBytes / MB, LatencyFrames);
+	RD_CORE_INFO("Texture residency: tails resident by frame {}, settled by frame {}, peak {:.0f}MB committed",
+		TailsFrame, SettledFrame ? std::to_string(SettledFrame) : std::string("never"), Stats.PeakCommittedBytes / MB);
+	RD_CORE_INFO("Texture residency: {:.1f}% of the textures at their wanted mip during the fly through",
+		100.0 * FlyThroughSharp / (double(TextureCount) * (FrameCount - FrameCount / 2)));
+	RD_CORE_INFO("Texture residency: {} requests, {} evictions of {:.0f}MB, at most {} requests in a frame, schedule {:.3f}ms average {:.3f}ms max",
+		Stats.Requests, Stats.Evictions, Stats.EvictedBytes / MB, MaxRequestsPerFrame, TotalScheduleMs / FrameCount, MaxScheduleMs);
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+//decides which mips of which textures should be on the gpu, knows nothing about the gpu itself
+//every texture has a mip tail, the coarsest mips up to TailSize, which goes first and is never evicted
+//above the tail mips stream in one at a time from coarse to fine, highest priority first, within the byte budget
+//a texture that does not fit evicts the finest mips of textures with a lower priority
+class TextureResidencyScheduler
+{
+public:
+	struct Settings
+	{
+		//resident and in flight bytes of every texture, tails included
+		size_t BudgetBytes{ size_t(1) << 30 };
+		//bytes requested but not loaded yet, bounds the decode and upload work handed out per schedule
+		size_t MaxInFlightBytes{ size_t(64) << 20 };
+		//mips with both sides at or below this are part of the tail
+		uint32_t TailSize{ 64 };
+	};
+	//load mips [Mip, FirstMip) where FirstMip is the resident mip at the time of the request, the whole tail for a tail request
+	struct Request
+	{
+		uint32_t Texture{};
+		uint32_t Mip{};
+		bool bTail{};
+	};
+	//the texture keeps only mips [Mip, MipCount)
+	struct Eviction
+	{
+		uint32_t Texture{};
+		uint32_t Mip{};
+	};
+	struct Stats
+	{
+		size_t Requests{};
+		size_t Evictions{};
+		size_t EvictedBytes{};
+		size_t PeakCommittedBytes{};
+	};
+
+	void Init(const Settings& settings) { Config = settings; }
+	const Settings& GetSettings() const { return Config; }
+	void SetBudget(size_t budgetBytes) { Config.BudgetBytes = budgetBytes; }
+
+	//mipBytes is the size of every mip, finest first, returns the index of the texture
+	uint32_t AddTexture(uint32_t width, uint32_t height, const std::vector<size_t>& mipBytes, float priority);
+	void SetPriority(uint32_t texture, float priority);
+	//finest mip worth having, anything finer that is resident gets evicted on the next schedule
+	void SetWantedMip(uint32_t texture, uint32_t mip);
+
+	//hands out the next requests and applies the evictions needed for them, both have to be carried out by the caller
+	void Schedule(std::vector<Request>& requests, std::vector<Eviction>& evictions);
+	//a request is done, its mips are resident
+	void OnLoaded(const Request& request);
+	//a request could not be carried out, its bytes are released and it will be handed out again
+	void OnFailed(const Request& request);
+
+	uint32_t GetTextureCount() const { return static_cast<uint32_t>(Textures.size()); }
+	uint32_t GetMipCount(uint32_t texture) const { return static_cast<uint32_t>(Textures[texture].MipBytes.size()); }
+	uint32_t GetTailMip(uint32_t texture) const { return Textures[texture].TailMip; }
+	//finest resident mip, the mip count if nothing is resident yet
+	uint32_t GetResidentMip(uint32_t texture) const { return Textures[texture].ResidentMip; }
+	uint32_t GetWantedMip(uint32_t texture) const { return Textures[texture].WantedMip; }
+	bool IsInFlight(uint32_t texture) const { return Textures[texture].bInFlight; }
+	//every texture has its tail resident
+	bool AreTailsResident() const { return PendingTails == 0; }
+	//nothing in flight and the last schedule had nothing left to hand out, every texture is at its wanted mip or held back by the budget
+	bool IsSettled() const { return InFlightBytes == 0 && bLastScheduleEmpty; }
+	size_t GetResidentBytes() const { return ResidentBytes; }
+	size_t GetInFlightBytes() const { return InFlightBytes; }
+	const Stats& GetStats() const { return Counters; }
+	//bytes of mips [mip, MipCount)
+	size_t GetBytes(uint32_t texture, uint32_t mip) const;
+
+private:
+	struct TextureState
+	{
+		std::vector<size_t> MipBytes;
+		float Priority{};
+		uint32_t TailMip{};
+		uint32_t ResidentMip{};
+		uint32_t WantedMip{};
+		bool bInFlight{};
+	};
+	//evicts the finest resident mip of the lowest priority texture below the priority, false if there is nothing to evict
+	//walks Order from the back with VictimCursor, so it only works between the sort and the end of a schedule
+	bool EvictOne(float belowPriority, std::vector<Eviction>& evictions);
+	void Evict(uint32_t texture, uint32_t mip, std::vector<Eviction>& evictions);
+
+	Settings Config;
+	std::vector<TextureState> Textures;
+	uint32_t PendingTails{};
+	size_t ResidentBytes{};
+	size_t InFlightBytes{};
+	Stats Counters;
+	bool bLastScheduleEmpty{};
+	//reused between schedules
+	std::vector<uint32_t> Order;
+	//ascending priority with the running total of the bytes that could be evicted up to that texture
+	std::vector<std::pair<float, size_t>> Evictable;
+	size_t VictimCursor{};
+};
+
+//checks the tail first ordering, priorities, budget, eviction and convergence on small hand made cases, returns false on any failure
+bool VerifyTextureResidency();
+//simulates a scene worth of textures streaming under a budget with changing priorities and logs how fast it settles
+void BenchmarkTextureResidency();
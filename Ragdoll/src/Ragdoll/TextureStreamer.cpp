@@ -0,0 +1,838 @@
+#include "ragdollpch.h"
+#include "TextureStreamer.h"
+
+#include <nvrhi/common/dxgi-format.h>
+#include "DirectXTex.h"
+#include "stb_image.h"
+
+#include "AssetManager.h"
+#include "DirectXDevice.h"
+#include "Executor.h"
+#include "Profiler.h"
+#include "TextureCompression.h"
+#include <Psapi.h>
+
+struct DDS_HEADER {
+	DWORD           dwSize;
+	DWORD           dwFlags;
+	DWORD           dwHeight;
+	DWORD           dwWidth;
+	DWORD           dwPitchOrLinearSize;
+	DWORD           dwDepth;
+	DWORD           dwMipMapCount;
+	DWORD           dwReserved1[11];
+	struct DDS_PIXELFORMAT {
+		DWORD dwSize;
+		DWORD dwFlags;
+		DWORD dwFourCC;
+		DWORD dwRGBBitCount;
+		DWORD dwRBitMask;
+		DWORD dwGBitMask;
+		DWORD dwBBitMask;
+		DWORD dwABitMask;
+	} ddspf;
+	DWORD           dwCaps;
+	DWORD           dwCaps2;
+	DWORD           dwCaps3;
+	DWORD           dwCaps4;
+	DWORD           dwReserved2;
+};
+
+struct DDS_HEADER_DXT10 {
+	uint32_t dxgiFormat;
+	uint32_t resourceDimension;
+	uint32_t miscFlag;
+	uint32_t arraySize;
+	uint32_t miscFlags2;
+};
+
+nvrhi::Format SearchForFormat(uint32_t flag)
+{
+	for (int i = 0; i < (int)nvrhi::Format::COUNT; ++i)
+	{
+		nvrhi::DxgiFormatMapping mapping = nvrhi::getDxgiFormatMapping((nvrhi::Format)i);
+		if (mapping.resourceFormat == flag)
+			return mapping.abstractFormat;
+		if (mapping.rtvFormat == flag)
+			return mapping.abstractFormat;
+		if (mapping.srvFormat == flag)
+			return mapping.abstractFormat;
+	}
+	return nvrhi::Format::UNKNOWN;
+}
+
+namespace
+{
+	//the finest mip a texture can be cut down to, block compressed textures need their top mip to be whole blocks
+	uint32_t GetLastFirstMip(const nvrhi::TextureDesc& desc)
+	{
+		if (desc.dimension != nvrhi::TextureDimension::Texture2D)
+			return 0;
+		const uint32_t BlockSize = nvrhi::getFormatInfo(desc.format).blockSize;
+		uint32_t Mip = 0;
+		while (Mip + 1 < desc.mipLevels && (desc.width >> (Mip + 1)) % BlockSize == 0 && (desc.height >> (Mip + 1)) % BlockSize == 0
+			&& (desc.width >> (Mip + 1)) > 0 && (desc.height >> (Mip + 1)) > 0)
+			++Mip;
+		return Mip;
+	}
+}
+
+TextureStreamer* TextureStreamer::GetInstance()
+{
+	if (!s_Instance)
+	{
+		s_Instance = std::make_unique<TextureStreamer>();
+	}
+	return s_Instance.get();
+}
+
+void TextureStreamer::Release()
+{
+	if (!s_Instance)
+		return;
+	//the decodes write into the instance, let them land first
+	SExecutor::WaitForBackground();
+	SExecutor::Executor.wait_for_all();
+	s_Instance.reset();
+	s_Instance = nullptr;
+	DecodeScratch::Trim();
+}
+
+void TextureStreamer::Init(const Settings& settings)
+{
+	Config = settings;
+	DecodeScratch::SetCacheLimit(Config.ScratchCacheBytesPerWorker);
+	TextureResidencyScheduler::Settings SchedulerSettings;
+	SchedulerSettings.BudgetBytes = Config.GpuBudgetBytes;
+	SchedulerSettings.MaxInFlightBytes = Config.MaxUploadBytesPerFrame;
+	SchedulerSettings.TailSize = Config.TailSize;
+	Scheduler.Init(SchedulerSettings);
+	CommandList = DirectXDevice::GetNativeDevice()->createCommandList(nvrhi::CommandListParameters().setEnableImmediateExecution(false));
+}
+
+void TextureStreamer::AddImage(uint32_t imageIndex, TextureStreamSource source, float priority)
+{
+	const uint32_t Streamed = static_cast<uint32_t>(Images.size());
+	StreamedImage& Image = Images.emplace_back();
+	Image.ImageIndex = imageIndex;
+	Image.Source = std::move(source);
+	Image.Priority = priority;
+	ImageIndexToStreamed[imageIndex] = Streamed;
+	AssetManager::GetInstance()->Images[imageIndex].bIsDDS = Image.Source.bIsDDS;
+	//nothing is ever read from an empty slot
+	Image.Texture = AssetManager::GetInstance()->DefaultTex;
+	DirectXDevice::GetInstance()->m_NvrhiDevice->writeDescriptorTable(AssetManager::GetInstance()->DescriptorTable, nvrhi::BindingSetItem::Texture_SRV(imageIndex, Image.Texture));
+	Image.Bound = Image.Texture;
+	QueueDecode(Streamed);
+	StartDecodes();
+}
+
+void TextureStreamer::SetPriority(uint32_t imageIndex, float priority)
+{
+	auto it = ImageIndexToStreamed.find(imageIndex);
+	if (it == ImageIndexToStreamed.end())
+		return;
+	StreamedImage& Image = Images[it->second];
+	Image.Priority = priority;
+	if (Image.SchedulerIndex != UINT32_MAX)
+		Scheduler.SetPriority(Image.SchedulerIndex, priority);
+}
+
+void TextureStreamer::Decode(const TextureStreamSource& source, const Settings& settings, DecodedImage& decoded)
+{
+	RD_SCOPE(Load, Decode Texture);
+	DecodeScratch::Vector<uint8_t> FileData;
+	ragdoll::MappedFile MappedFile;
+	const uint8_t* Data = source.Embedded.data();
+	size_t Size = source.Embedded.size();
+	if (source.Embedded.empty())
+	{
+		RD_SCOPE(Load, Load File);
+		if (source.bMapFile)
+		{
+			if (!MappedFile.Open(source.Path))
+			{
+				RD_CORE_ERROR("Unable to map file {}", source.Path.string());
+				return;
+			}
+			Data = MappedFile.GetData();
+			Size = MappedFile.GetSize();
+		}
+		else
+		{
+			//load raw bytes, do not use stbi load
+			std::ifstream File(source.Path, std::ios::binary | std::ios::ate);
+			if (!File)
+			{
+				RD_CORE_ERROR("Unable to open file {}:{}", strerror(errno), source.Path.string());
+				return;
+			}
+			Size = static_cast<size_t>(File.tellg());
+			File.seekg(0, std::ios::beg);
+			FileData.resize(Size);
+			if (!File.read((char*)FileData.data(), Size))
+			{
+				RD_CORE_ERROR("Failed to read file {}", source.Path.string());
+				return;
+			}
+			Data = FileData.data();
+		}
+	}
+
+	nvrhi::TextureDesc& Desc = decoded.Desc;
+	Desc.dimension = nvrhi::TextureDimension::Texture2D;
+	Desc.debugName = source.Name;
+	Desc.initialState = nvrhi::ResourceStates::ShaderResource;
+	Desc.isRenderTarget = false;
+	Desc.keepInitialState = true;
+	if (!source.bIsDDS)
+	{
+		//a cooked entry skips the decode, the mip chain and the encode, its blocks are uploaded straight from the mapping
+		uint64_t CacheKey = 0;
+		std::filesystem::path CachePath;
+		if (settings.bCompress && !settings.CacheRoot.empty())
+		{
+			CacheKey = TextureCache::GetKey(Data, Size, source.Usage, settings.Quality);
+			CachePath = TextureCache::GetCachePath(settings.CacheRoot, source.Name, CacheKey);
+			CompressedTexture Cached;
+			if (TextureCache::Load(CachePath, CacheKey, decoded.Mapped, Cached))
+			{
+				Desc.format = Cached.Format;
+				Desc.width = Cached.Width;
+				Desc.height = Cached.Height;
+				Desc.mipLevels = static_cast<uint32_t>(Cached.MipOffsets.size());
+				decoded.MipOffsets = std::move(Cached.MipOffsets);
+				decoded.RowPitches = std::move(Cached.RowPitches);
+				decoded.SlicePitches = std::move(Cached.SlicePitches);
+				decoded.Data = decoded.Mapped.GetData();
+				decoded.bCacheHit = true;
+				decoded.bSuccess = true;
+				return;
+			}
+		}
+
+		RD_SCOPE(Load, STB Load);
+		//always rgba, single channel orm maps are read from g and b too
+		int w = -1, h = -1, comp = -1;
+		uint8_t* Raw = stbi_load_from_memory(Data, static_cast<int>(Size), &w, &h, &comp, 4);
+		if (!Raw)
+		{
+			RD_CORE_ERROR("stb unable to read image {}: {}", source.Name, stbi_failure_reason());
+			return;
+		}
+		Desc.width = w;
+		Desc.height = h;
+		//stb images come without mips, the whole chain is built here so there is something to stream
+		if (settings.bCompress && CanBlockCompress(Desc.width, Desc.height))
+		{
+			auto CompressStart = std::chrono::high_resolution_clock::now();
+			CompressedTexture Compressed;
+			CompressTexture(Raw, Desc.width, Desc.height, source.Usage, settings.Quality, Compressed);
+			decoded.CompressMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - CompressStart).count();
+			if (!CachePath.empty())
+				TextureCache::Save(CachePath, CacheKey, Compressed);
+			Desc.format = Compressed.Format;
+			decoded.MipOffsets = std::move(Compressed.MipOffsets);
+			decoded.RowPitches = std::move(Compressed.RowPitches);
+			decoded.SlicePitches = std::move(Compressed.SlicePitches);
+			decoded.Owned = std::move(Compressed.Data);
+		}
+		else
+		{
+			//d3d12 wants block compressed textures in whole blocks, anything else stays rgba8 with the same filtered mips
+			TextureMipChain Chain;
+			GenerateMipChain(Raw, Desc.width, Desc.height, source.Usage, Chain);
+			Desc.format = nvrhi::Format::RGBA8_UNORM;
+			for (uint32_t Mip = 0; Mip < Chain.MipOffsets.size(); ++Mip)
+			{
+				decoded.MipOffsets.push_back(Chain.MipOffsets[Mip]);
+				decoded.RowPitches.push_back(size_t(std::max(Desc.width >> Mip, 1u)) * 4);
+				decoded.SlicePitches.push_back(decoded.RowPitches.back() * std::max(Desc.height >> Mip, 1u));
+			}
+			decoded.Owned = std::move(Chain.Pixels);
+		}
+		stbi_image_free(Raw);
+		Desc.mipLevels = static_cast<uint32_t>(decoded.MipOffsets.size());
+		decoded.Data = decoded.Owned.data();
+	}
+	else
+	{
+		RD_SCOPE(Load, DDS Load);
+		// Validate DDS header
+		if (Size < sizeof(uint32_t) + sizeof(DDS_HEADER) || reinterpret_cast<const uint32_t*>(Data)[0] != ' SDD') // DDS Magic Number
+		{
+			RD_CORE_ERROR("Invalid DDS header for {}", source.Name);
+			return;
+		}
+		const DDS_HEADER* Header = reinterpret_cast<const DDS_HEADER*>(Data + sizeof(uint32_t)); // Skip magic number
+		bool bHasDXT10Header = (Header->ddspf.dwFourCC == '01XD'); // DX10 extension
+		const DDS_HEADER_DXT10* Dxt10Header = bHasDXT10Header ? reinterpret_cast<const DDS_HEADER_DXT10*>(Data + sizeof(uint32_t) + sizeof(DDS_HEADER)) : nullptr;
+
+		nvrhi::Format Format{ nvrhi::Format::UNKNOWN };
+		if (bHasDXT10Header)
+			Format = SearchForFormat(Dxt10Header->dxgiFormat);
+		else
+		{
+			if (Header->ddspf.dwFourCC == '1TXD')
+				Format = nvrhi::Format::BC1_UNORM;  // DXT1
+			if (Header->ddspf.dwFourCC == '3TXD')
+				Format = nvrhi::Format::BC2_UNORM;  // DXT3
+			if (Header->ddspf.dwFourCC == '5TXD')
+				Format = nvrhi::Format::BC3_UNORM;  // DXT5
+			if (Header->ddspf.dwFourCC == 'U4ET')
+				Format = nvrhi::Format::BC4_UNORM;  // ATI1 / BC4
+			if (Header->ddspf.dwFourCC == '2ITA')
+				Format = nvrhi::Format::BC5_UNORM;  // ATI2 / BC5
+		}
+		if (Format == nvrhi::Format::UNKNOWN)
+		{
+			RD_CORE_ERROR("Unsupported DDS format for {}", source.Name);
+			return;
+		}
+		Desc.width = Header->dwWidth;
+		Desc.height = Header->dwHeight;
+		Desc.mipLevels = Header->dwMipMapCount > 0 ? Header->dwMipMapCount : 1;
+		Desc.dimension = (Header->dwDepth > 1) ? nvrhi::TextureDimension::Texture3D : nvrhi::TextureDimension::Texture2D;
+		Desc.format = Format;
+
+		// Determine the start of pixel data in DDS file
+		size_t Offset = sizeof(uint32_t) + sizeof(DDS_HEADER) + (bHasDXT10Header ? sizeof(DDS_HEADER_DXT10) : 0);
+		for (uint32_t Mip = 0; Mip < Desc.mipLevels; ++Mip)
+		{
+			size_t RowPitch, SlicePitch;
+			DirectX::ComputePitch(bHasDXT10Header ? (DXGI_FORMAT)Dxt10Header->dxgiFormat : nvrhi::getDxgiFormatMapping(Format).resourceFormat,
+				std::max(1u, Desc.width >> Mip), std::max(1u, Desc.height >> Mip), RowPitch, SlicePitch);
+			decoded.MipOffsets.push_back(Offset);
+			decoded.RowPitches.push_back(RowPitch);
+			decoded.SlicePitches.push_back(SlicePitch);
+			Offset += SlicePitch; // Move to next mip level data
+		}
+		if (Offset > Size)
+		{
+			RD_CORE_ERROR("DDS {} is shorter than its mips", source.Name);
+			return;
+		}
+		//already in the gpu format, a mapped file is uploaded straight from the mapping
+		if (MappedFile.IsOpen())
+		{
+			decoded.Mapped = std::move(MappedFile);
+			decoded.Data = decoded.Mapped.GetData();
+		}
+		else
+		{
+			//the file was read whole, its bytes already are the mips
+			if (!FileData.empty())
+				decoded.Owned = std::move(FileData);
+			else
+				decoded.Owned.assign(Data, Data + Size);
+			decoded.Data = decoded.Owned.data();
+		}
+	}
+	decoded.bSuccess = true;
+}
+
+size_t TextureStreamer::EstimateDecodeBytes(const TextureStreamSource& source, const Settings& settings)
+{
+	//only the header is read, a mapping is the cheapest way to get at it
+	ragdoll::MappedFile MappedFile;
+	const uint8_t* Data = source.Embedded.data();
+	size_t Size = source.Embedded.size();
+	if (source.Embedded.empty())
+	{
+		if (!MappedFile.Open(source.Path))
+			return 1;
+		Data = MappedFile.GetData();
+		Size = MappedFile.GetSize();
+	}
+	//read whole into memory unless it is mapped or already there
+	const size_t FileBytes = (source.Embedded.empty() && !source.bMapFile) ? Size : 0;
+	if (source.bIsDDS)
+		return std::max<size_t>(Size, 1);
+	int w = 0, h = 0, comp = 0;
+	if (!stbi_info_from_memory(Data, static_cast<int>(Size), &w, &h, &comp))
+		return FileBytes + Size * 4;
+	//per texel: stb output 4, stb inflate or component buffers up to 4, the rgba8 mip chain 4/3,
+	//the float rows of mips 1 and 2 alive together 5 and the compressed chain 4/3
+	const size_t Texels = size_t(w) * h;
+	return FileBytes + Texels * (settings.bCompress ? 16 : 15);
+}
+
+void TextureStreamer::QueueDecode(uint32_t streamed)
+{
+	StreamedImage& Image = Images[streamed];
+	if (Image.bDecoding || Image.bQueued)
+		return;
+	Image.bQueued = true;
+	DecodeQueue.push_back(streamed);
+}
+
+void TextureStreamer::StartDecodes()
+{
+	while (!DecodeQueue.empty() && DecodesInFlight < SExecutor::Executor.num_workers())
+	{
+		auto Next = std::max_element(DecodeQueue.begin(), DecodeQueue.end(), [this](uint32_t a, uint32_t b) { return Images[a].Priority < Images[b].Priority; });
+		const uint32_t Streamed = *Next;
+		StreamedImage& Image = Images[Streamed];
+		if (Image.DecodeBytes == 0)
+			Image.DecodeBytes = EstimateDecodeBytes(Image.Source, Config);
+		//decodes in flight and the decoded pixels share the cpu budget, a decode that does not fit waits unless nothing else runs
+		if (DecodesInFlight > 0 && CpuBytes + DecodeBytesInFlight + Image.DecodeBytes > Config.CpuBudgetBytes)
+			break;
+		DecodeQueue.erase(Next);
+		Image.bQueued = false;
+		Image.bDecoding = true;
+		++DecodesInFlight;
+		DecodeBytesInFlight += Image.DecodeBytes;
+		if (Image.SchedulerIndex == UINT32_MAX)
+			++Counters.Decodes;
+		else
+			++Counters.Redecodes;
+
+		DecodedImage* Decoded = new DecodedImage();
+		Decoded->Image = Streamed;
+		const TextureStreamSource* Source = &Image.Source;
+		//decodes are streaming work, they make way for the frame
+		SExecutor::Background([this, Source, Decoded]() {
+			Decode(*Source, Config, *Decoded);
+			std::lock_guard<std::mutex> Lock(FinishedMutex);
+			Finished.emplace_back(Decoded);
+		});
+	}
+}
+
+bool TextureStreamer::Rebuild(uint32_t streamed, uint32_t firstMip)
+{
+	StreamedImage& image = Images[streamed];
+	nvrhi::TextureDesc Desc = image.Desc;
+	Desc.width = std::max(Desc.width >> firstMip, 1u);
+	Desc.height = std::max(Desc.height >> firstMip, 1u);
+	Desc.mipLevels = image.Desc.mipLevels - firstMip;
+	nvrhi::TextureHandle Texture = DirectXDevice::GetNativeDevice()->createTexture(Desc);
+	if (!Texture)
+	{
+		RD_CORE_ERROR("Issue creating texture handle: {}", image.Source.Name);
+		return false;
+	}
+	if (!bCommandListOpen)
+	{
+		CommandList->open();
+		bCommandListOpen = true;
+	}
+	//whatever the old texture has is copied on the gpu, only the mips it does not have come from the cpu
+	const bool bHasOld = image.Texture && image.Texture != AssetManager::GetInstance()->DefaultTex;
+	for (uint32_t Mip = firstMip; Mip < image.Desc.mipLevels; ++Mip)
+	{
+		if (bHasOld && Mip >= image.FirstMip)
+		{
+			CommandList->copyTexture(Texture, nvrhi::TextureSlice().setMipLevel(Mip - firstMip), image.Texture, nvrhi::TextureSlice().setMipLevel(Mip - image.FirstMip));
+		}
+		else
+		{
+			RD_ASSERT(!image.Pixels, "Uploading mip {} of {} without its pixels", Mip, image.Source.Name);
+			const DecodedImage& Pixels = *image.Pixels;
+			CommandList->writeTexture(Texture, 0, Mip - firstMip, Pixels.Data + Pixels.MipOffsets[Mip], Pixels.RowPitches[Mip], Pixels.SlicePitches[Mip]);
+			Counters.UploadedBytes += Pixels.SlicePitches[Mip];
+		}
+	}
+	image.Texture = Texture;
+	image.FirstMip = firstMip;
+	QueueRebind(streamed);
+	return true;
+}
+
+void TextureStreamer::QueueRebind(uint32_t streamed)
+{
+	StreamedImage& Image = Images[streamed];
+	if (Image.bRebindPending)
+		return;
+	Image.bRebindPending = true;
+	PendingRebinds.push_back(streamed);
+}
+
+void TextureStreamer::Load(uint32_t streamed, const TextureResidencyScheduler::Request& request)
+{
+	if (Rebuild(streamed, request.Mip))
+	{
+		Scheduler.OnLoaded(request);
+		return;
+	}
+	Scheduler.OnFailed(request);
+	//a tail is tried again, without it the scheduler would hold every other texture back
+	if (!request.bTail)
+		Scheduler.SetWantedMip(request.Texture, Scheduler.GetResidentMip(request.Texture));
+}
+
+void TextureStreamer::ReleasePixels(StreamedImage& image)
+{
+	if (!image.Pixels)
+		return;
+	CpuBytes -= image.Pixels->Owned.size();
+	image.Pixels.reset();
+}
+
+nvrhi::EventQueryHandle TextureStreamer::AcquireQuery()
+{
+	if (FreeQueries.empty())
+		return DirectXDevice::GetNativeDevice()->createEventQuery();
+	nvrhi::EventQueryHandle Query = std::move(FreeQueries.back());
+	FreeQueries.pop_back();
+	DirectXDevice::GetNativeDevice()->resetEventQuery(Query);
+	return Query;
+}
+
+void TextureStreamer::FlushRebinds()
+{
+	nvrhi::DeviceHandle Device = DirectXDevice::GetNativeDevice();
+	while (!Retired.empty() && Device->pollEventQuery(Retired.front().Unused))
+	{
+		FreeQueries.push_back(std::move(Retired.front().Unused));
+		Retired.pop_front();
+	}
+	//the query passes once everything submitted so far is done, the uploads of this update included
+	if (!PendingRebinds.empty())
+	{
+		RebindBatch& Batch = RebindBatches.emplace_back();
+		Batch.Uploaded = AcquireQuery();
+		Device->setEventQuery(Batch.Uploaded, nvrhi::CommandQueue::Graphics);
+		for (uint32_t Streamed : PendingRebinds)
+		{
+			StreamedImage& Image = Images[Streamed];
+			//a later rebuild replaces Texture, the batch has to write the one its upload filled
+			Batch.Textures.emplace_back(Streamed, Image.Texture);
+			Image.bRebindPending = false;
+			++Image.RebindsInFlight;
+		}
+		PendingRebinds.clear();
+	}
+	if (RebindBatches.empty() || !Device->pollEventQuery(RebindBatches.front().Uploaded))
+		return;
+
+	RD_SCOPE(Load, Texture Rebinds);
+	RetiredTextures& Replaced = Retired.emplace_back();
+	while (!RebindBatches.empty() && Device->pollEventQuery(RebindBatches.front().Uploaded))
+	{
+		RebindBatch& Batch = RebindBatches.front();
+		for (auto& [Streamed, Texture] : Batch.Textures)
+		{
+			StreamedImage& Image = Images[Streamed];
+			Device->writeDescriptorTable(AssetManager::GetInstance()->DescriptorTable, nvrhi::BindingSetItem::Texture_SRV(Image.ImageIndex, Texture));
+			AssetManager::GetInstance()->Images[Image.ImageIndex].TextureHandle = Texture;
+			Replaced.Textures.emplace_back(std::move(Image.Bound));
+			Image.Bound = std::move(Texture);
+			--Image.RebindsInFlight;
+			++Counters.Rebinds;
+		}
+		FreeQueries.push_back(std::move(Batch.Uploaded));
+		RebindBatches.pop_front();
+	}
+	//the bindless range is volatile and both textures stay alive and readable, a frame in flight sees one or the other
+	//the old ones go once the work submitted before these writes is done
+	Replaced.Unused = AcquireQuery();
+	Device->setEventQuery(Replaced.Unused, nvrhi::CommandQueue::Graphics);
+}
+
+void TextureStreamer::Update()
+{
+	RD_SCOPE(Load, Texture Streaming);
+	//finished decodes, the first one of every image tells the scheduler how large it is
+	std::vector<std::unique_ptr<DecodedImage>> Decoded;
+	{
+		std::lock_guard<std::mutex> Lock(FinishedMutex);
+		Decoded.swap(Finished);
+	}
+	for (std::unique_ptr<DecodedImage>& It : Decoded)
+	{
+		const uint32_t Streamed = It->Image;
+		StreamedImage& Image = Images[Streamed];
+		Image.bDecoding = false;
+		--DecodesInFlight;
+		DecodeBytesInFlight -= Image.DecodeBytes;
+		if (!It->bSuccess)
+		{
+			++Counters.FailedDecodes;
+			if (Image.SchedulerIndex == UINT32_MAX)
+			{
+				//never streams, the slot shows the error texture
+				Image.bFailed = true;
+				Image.Texture = AssetManager::GetInstance()->ErrorTex;
+				QueueRebind(Streamed);
+			}
+			else
+			{
+				//keep what is on the gpu and stop asking for more
+				for (const TextureResidencyScheduler::Request& Request : Image.PendingRequests)
+					Scheduler.OnFailed(Request);
+				Image.PendingRequests.clear();
+				Scheduler.SetWantedMip(Image.SchedulerIndex, Scheduler.GetResidentMip(Image.SchedulerIndex));
+			}
+			continue;
+		}
+		if (It->bCacheHit)
+			++Counters.CacheHits;
+		if (It->CompressMs > 0.0)
+		{
+			++Counters.Compressed;
+			Counters.CompressMs += It->CompressMs;
+		}
+		CpuBytes += It->Owned.size();
+		Counters.PeakCpuBytes = std::max(Counters.PeakCpuBytes, CpuBytes + DecodeBytesInFlight);
+		if (Image.SchedulerIndex == UINT32_MAX)
+		{
+			Image.Desc = It->Desc;
+			//mips past the last one a texture can start at are always kept together with it
+			const uint32_t LastFirstMip = GetLastFirstMip(Image.Desc);
+			std::vector<size_t> MipBytes(LastFirstMip + 1);
+			for (uint32_t Mip = 0; Mip < Image.Desc.mipLevels; ++Mip)
+				MipBytes[std::min(Mip, LastFirstMip)] += It->SlicePitches[Mip];
+			const bool bVolume = Image.Desc.dimension != nvrhi::TextureDimension::Texture2D;
+			Image.SchedulerIndex = Scheduler.AddTexture(bVolume ? 1 : Image.Desc.width, bVolume ? 1 : Image.Desc.height, MipBytes, Image.Priority);
+			SchedulerToImage.push_back(Streamed);
+		}
+		Image.Pixels = std::move(It);
+		for (const TextureResidencyScheduler::Request& Request : Image.PendingRequests)
+			Load(Streamed, Request);
+		Image.PendingRequests.clear();
+	}
+
+	Scheduler.Schedule(Requests, Evictions);
+	for (const TextureResidencyScheduler::Eviction& Eviction : Evictions)
+		Rebuild(SchedulerToImage[Eviction.Texture], Eviction.Mip);
+	for (const TextureResidencyScheduler::Request& Request : Requests)
+	{
+		const uint32_t Streamed = SchedulerToImage[Request.Texture];
+		if (!Images[Streamed].Pixels)
+		{
+			//the pixels were dropped, decode again and carry the request out once they are back
+			Images[Streamed].PendingRequests.push_back(Request);
+			QueueDecode(Streamed);
+		}
+		else
+			Load(Streamed, Request);
+	}
+
+	//pixels are only kept for mips that still have to go up, or until the cpu budget runs out
+	for (StreamedImage& Image : Images)
+	{
+		if (!Image.Pixels || Scheduler.IsInFlight(Image.SchedulerIndex) || !Image.PendingRequests.empty())
+			continue;
+		const uint32_t Resident = Scheduler.GetResidentMip(Image.SchedulerIndex);
+		if (Resident > Scheduler.GetTailMip(Image.SchedulerIndex))
+			continue;
+		if (Resident <= Scheduler.GetWantedMip(Image.SchedulerIndex) || CpuBytes > Config.CpuBudgetBytes)
+			ReleasePixels(Image);
+	}
+	StartDecodes();
+	//the worker caches only help while images decode, hand them back once streaming goes quiet
+	if (DecodesInFlight == 0 && DecodeScratch::GetStats().CachedBytes > 0)
+		DecodeScratch::Trim();
+
+	if (bCommandListOpen)
+	{
+		CommandList->close();
+		DirectXDevice::GetNativeDevice()->executeCommandList(CommandList);
+		bCommandListOpen = false;
+	}
+	FlushRebinds();
+}
+
+bool TextureStreamer::AreTailsResident() const
+{
+	for (const StreamedImage& Image : Images)
+	{
+		if (Image.bFailed)
+			continue;
+		if (Image.SchedulerIndex == UINT32_MAX || Scheduler.GetResidentMip(Image.SchedulerIndex) > Scheduler.GetTailMip(Image.SchedulerIndex) || Image.bRebindPending || Image.RebindsInFlight > 0)
+			return false;
+	}
+	return true;
+}
+
+bool TextureStreamer::IsSettled() const
+{
+	return DecodesInFlight == 0 && DecodeQueue.empty() && PendingRebinds.empty() && RebindBatches.empty() && AreTailsResident() && Scheduler.IsSettled();
+}
+
+bool TextureStreamer::WaitForTails(double timeoutMs)
+{
+	RD_SCOPE(Load, Wait For Texture Tails);
+	auto Start = std::chrono::high_resolution_clock::now();
+	while (!AreTailsResident())
+	{
+		Update();
+		std::chrono::duration<double, std::milli> Elapsed = std::chrono::high_resolution_clock::now() - Start;
+		if (Elapsed.count() > timeoutMs)
+			return AreTailsResident();
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	return true;
+}
+
+void TextureStreamer::WaitForSettled()
+{
+	RD_SCOPE(Load, Wait For Texture Streaming);
+	while (!IsSettled())
+	{
+		Update();
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+namespace
+{
+	//polls the working set on its own thread, the os peak can not be reset between two passes
+	class WorkingSetSampler
+	{
+	public:
+		WorkingSetSampler()
+		{
+			Baseline = Peak = GetWorkingSet();
+			Thread = std::thread([this]() {
+				while (!bStop.load(std::memory_order_relaxed))
+				{
+					Peak = std::max(Peak.load(std::memory_order_relaxed), GetWorkingSet());
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				}
+			});
+		}
+		~WorkingSetSampler() { Stop(); }
+
+		void Stop()
+		{
+			if (!Thread.joinable())
+				return;
+			bStop = true;
+			Thread.join();
+			Peak = std::max(Peak.load(), GetWorkingSet());
+		}
+		size_t GetBaseline() const { return Baseline; }
+		size_t GetPeak() const { return Peak; }
+
+		static size_t GetWorkingSet()
+		{
+			PROCESS_MEMORY_COUNTERS Counters{};
+			GetProcessMemoryInfo(GetCurrentProcess(), &Counters, sizeof(Counters));
+			return Counters.WorkingSetSize;
+		}
+
+	private:
+		size_t Baseline{};
+		std::atomic<size_t> Peak{};
+		std::atomic<bool> bStop{};
+		std::thread Thread;
+	};
+}
+
+void TextureStreamer::BenchmarkDecodeMemory(const std::filesystem::path& path, const Settings& settings)
+{
+	std::vector<TextureStreamSource> Sources;
+	std::error_code ec;
+	auto AddFile = [&Sources](const std::filesystem::path& file) {
+		std::string Extension = file.extension().string();
+		std::transform(Extension.begin(), Extension.end(), Extension.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+		if (Extension != ".png" && Extension != ".jpg" && Extension != ".jpeg" && Extension != ".dds")
+			return;
+		TextureStreamSource& Source = Sources.emplace_back();
+		Source.Path = file;
+		Source.Name = file.filename().string();
+		Source.bIsDDS = Extension == ".dds";
+	};
+	if (std::filesystem::is_directory(path, ec))
+	{
+		for (const auto& Entry : std::filesystem::recursive_directory_iterator(path, ec))
+			if (Entry.is_regular_file())
+				AddFile(Entry.path());
+	}
+	else
+		AddFile(path);
+	if (Sources.empty())
+	{
+		RD_CORE_WARN("No images under {}", path.string());
+		return;
+	}
+	//both passes have to decode for real
+	Settings Config = settings;
+	Config.CacheRoot.clear();
+	DecodeScratch::SetCacheLimit(Config.ScratchCacheBytesPerWorker);
+
+	struct Pass
+	{
+		size_t Baseline{};
+		size_t Peak{};
+		double Ms{};
+		DecodeScratch::Stats Scratch;
+	};
+	auto Run = [&](bool bBudgeted) {
+		Pass Result;
+		DecodeScratch::SetPooling(bBudgeted);
+		DecodeScratch::ResetPeak();
+		auto Start = std::chrono::high_resolution_clock::now();
+		WorkingSetSampler Sampler;
+		if (!bBudgeted)
+		{
+			//every image at once and every result alive until the end
+			std::vector<DecodedImage> Decoded(Sources.size());
+			tf::Taskflow Taskflow;
+			for (size_t i = 0; i < Sources.size(); ++i)
+				Taskflow.emplace([&, i]() { Decode(Sources[i], Config, Decoded[i]); });
+			SExecutor::Executor.run(Taskflow).wait();
+			Sampler.Stop();
+		}
+		else
+		{
+			//the admission of StartDecodes, a result is dropped as soon as it lands the way ReleasePixels does after the upload
+			std::mutex Mutex;
+			std::condition_variable Landed;
+			std::vector<size_t> Finished;
+			size_t Next = 0, InFlight = 0, InFlightBytes = 0;
+			std::vector<size_t> Estimates(Sources.size());
+			while (Next < Sources.size() || InFlight > 0)
+			{
+				while (Next < Sources.size() && InFlight < SExecutor::Executor.num_workers())
+				{
+					if (Estimates[Next] == 0)
+						Estimates[Next] = EstimateDecodeBytes(Sources[Next], Config);
+					if (InFlight > 0 && InFlightBytes + Estimates[Next] > Config.CpuBudgetBytes)
+						break;
+					InFlightBytes += Estimates[Next];
+					++InFlight;
+					SExecutor::Executor.silent_async([&, i = Next]() {
+						{
+							DecodedImage Decoded;
+							Decode(Sources[i], Config, Decoded);
+						}
+						std::lock_guard<std::mutex> Lock(Mutex);
+						Finished.push_back(i);
+						Landed.notify_one();
+					});
+					++Next;
+				}
+				std::unique_lock<std::mutex> Lock(Mutex);
+				Landed.wait(Lock, [&Finished]() { return !Finished.empty(); });
+				for (size_t i : Finished)
+				{
+					InFlightBytes -= Estimates[i];
+					--InFlight;
+				}
+				Finished.clear();
+			}
+			Sampler.Stop();
+		}
+		Result.Ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - Start).count();
+		Result.Baseline = Sampler.GetBaseline();
+		Result.Peak = Sampler.GetPeak();
+		Result.Scratch = DecodeScratch::GetStats();
+		DecodeScratch::Trim();
+		return Result;
+	};
+	const Pass Before = Run(false);
+	const Pass After = Run(true);
+	DecodeScratch::SetPooling(true);
+
+	constexpr double MB = 1024.0 * 1024.0;
+	RD_CORE_INFO("Decode memory benchmark over {} images on {} threads, cpu budget {:.0f}MB", Sources.size(), SExecutor::Executor.num_workers(), Config.CpuBudgetBytes / MB);
+	RD_CORE_INFO("  unbounded: peak working set {:.2f}MB ({:+.2f}MB), peak scratch {:.2f}MB, {:.2f}ms",
+		Before.Peak / MB, (double(Before.Peak) - double(Before.Baseline)) / MB, Before.Scratch.PeakLiveBytes / MB, Before.Ms);
+	RD_CORE_INFO("  budgeted and pooled: peak working set {:.2f}MB ({:+.2f}MB), peak scratch {:.2f}MB, {:.2f}ms, {} of {} scratch allocations from the worker caches",
+		After.Peak / MB, (double(After.Peak) - double(After.Baseline)) / MB, After.Scratch.PeakLiveBytes / MB, After.Ms,
+		After.Scratch.Reuses, After.Scratch.Allocations);
+}
@@ -0,0 +1,187 @@
+#pragma once
+#include "Ragdoll/TextureResidency.h"
+#include "Ragdoll/TextureCompression.h"
+#include "Ragdoll/File/MappedFile.h"
+#include <nvrhi/nvrhi.h>
+
+//where the encoded bytes of a streamed image come from
+//embedded images are copied out, the model buffers are gone once the load is done but the image may have to be decoded again
+struct TextureStreamSource
+{
+	std::filesystem::path Path;
+	std::vector<uint8_t> Embedded;
+	std::string Name;
+	bool bIsDDS{ false };
+	//picks the mip filter and block format of png and jpg images, dds files are used as they are
+	TextureUsage Usage{ TextureUsage::Color };
+	//map the file instead of reading it into memory
+	bool bMapFile{ true };
+};
+
+//streams the images of the loaded models into their slots of the bindless descriptor table
+//a slot starts out on the default texture, gets the mip tail once the image is decoded and finer mips as the residency scheduler allows
+//decodes run on the executor, the uploads and descriptor writes happen in Update on the main thread
+class TextureStreamer
+{
+public:
+	struct Settings
+	{
+		//gpu memory of every streamed texture
+		size_t GpuBudgetBytes{ size_t(1) << 30 };
+		//decoded pixels kept on the cpu for the mips that are not uploaded yet plus the scratch of the decodes in flight,
+		//decodes wait while it is full
+		size_t CpuBudgetBytes{ size_t(512) << 20 };
+		//freed decode scratch every worker keeps for its next decode
+		size_t ScratchCacheBytesPerWorker{ size_t(32) << 20 };
+		size_t MaxUploadBytesPerFrame{ size_t(64) << 20 };
+		uint32_t TailSize{ 64 };
+		//png and jpg images are block compressed on decode, cooked into CacheRoot if it is set
+		bool bCompress{ true };
+		TextureEncodeQuality Quality{ TextureEncodeQuality::High };
+		std::filesystem::path CacheRoot;
+	};
+	struct Stats
+	{
+		uint32_t Decodes{};
+		//decodes of images whose pixels were dropped and that needed finer mips again
+		uint32_t Redecodes{};
+		uint32_t FailedDecodes{};
+		size_t UploadedBytes{};
+		size_t PeakCpuBytes{};
+		//descriptor writes, each one after the upload of its texture finished on the gpu
+		uint32_t Rebinds{};
+		uint32_t CacheHits{};
+		//images block compressed on decode and their encode times added up
+		uint32_t Compressed{};
+		double CompressMs{};
+	};
+
+	static TextureStreamer* GetInstance();
+	static void Release();
+
+	void Init(const Settings& settings);
+	//starts streaming the image into the descriptor table slot, the slot gets the default texture until the tail is up
+	void AddImage(uint32_t imageIndex, TextureStreamSource source, float priority);
+	void SetPriority(uint32_t imageIndex, float priority);
+	//once per frame, hands finished decodes to the scheduler, records its uploads and evictions and writes the descriptors
+	void Update();
+	//pumps Update until every image has its tail on the gpu, false if that took longer than the timeout
+	bool WaitForTails(double timeoutMs);
+	//pumps Update until there is nothing left to stream within the budgets
+	void WaitForSettled();
+	//every image has its tail up
+	bool AreTailsResident() const;
+	bool IsSettled() const;
+
+	const TextureResidencyScheduler& GetScheduler() const { return Scheduler; }
+	const Stats& GetStats() const { return Counters; }
+	size_t GetCpuBytes() const { return CpuBytes; }
+
+	//decodes every image under the path twice without a device, all at once with every result kept to the end like the old loader,
+	//then through the cpu budget with pooled scratch and every result dropped as soon as it lands, and logs the peak working set of both
+	static void BenchmarkDecodeMemory(const std::filesystem::path& path, const Settings& settings);
+
+private:
+	//pixels of every mip, finest first, either decoded into Owned or straight out of the mapped dds or cache entry
+	struct DecodedImage
+	{
+		uint32_t Image{};
+		nvrhi::TextureDesc Desc;
+		DecodeScratch::Vector<uint8_t> Owned;
+		ragdoll::MappedFile Mapped;
+		const uint8_t* Data{};
+		std::vector<size_t> MipOffsets;
+		std::vector<size_t> RowPitches;
+		std::vector<size_t> SlicePitches;
+		bool bCacheHit{};
+		double CompressMs{};
+		bool bSuccess{};
+	};
+	struct StreamedImage
+	{
+		uint32_t ImageIndex{};
+		TextureStreamSource Source;
+		float Priority{};
+		//index in the scheduler, only once the first decode told us the size
+		uint32_t SchedulerIndex{ UINT32_MAX };
+		//full size description from the first decode
+		nvrhi::TextureDesc Desc;
+		std::unique_ptr<DecodedImage> Pixels;
+		bool bDecoding{};
+		bool bQueued{};
+		bool bFailed{};
+		//queued for the rebind batch of this update
+		bool bRebindPending{};
+		//rebind batches waiting on their uploads with this image in them
+		uint32_t RebindsInFlight{};
+		//requests that came in while the pixels were not there
+		std::vector<TextureResidencyScheduler::Request> PendingRequests;
+		//the texture with mips [FirstMip, MipCount) and the one the descriptor table points at
+		nvrhi::TextureHandle Texture;
+		nvrhi::TextureHandle Bound;
+		uint32_t FirstMip{};
+		//estimated peak memory of one decode, 0 until the header was looked at
+		size_t DecodeBytes{};
+	};
+
+	//runs on the executor, reads and decodes the source and lays out the mips
+	static void Decode(const TextureStreamSource& source, const Settings& settings, DecodedImage& decoded);
+	//file bytes, stb output and scratch of one decode, from the image header
+	static size_t EstimateDecodeBytes(const TextureStreamSource& source, const Settings& settings);
+	void QueueDecode(uint32_t streamed);
+	void StartDecodes();
+	//replaces the texture of an image with one holding mips [firstMip, MipCount), copying what is already on the gpu and uploading the rest
+	bool Rebuild(uint32_t streamed, uint32_t firstMip);
+	void QueueRebind(uint32_t streamed);
+	//carries out a request once the pixels are there, a failed mip above the tail is not asked for again
+	void Load(uint32_t streamed, const TextureResidencyScheduler::Request& request);
+	void ReleasePixels(StreamedImage& image);
+	//rebinds of one update and the textures they had when the update was done
+	struct RebindBatch
+	{
+		nvrhi::EventQueryHandle Uploaded;
+		std::vector<std::pair<uint32_t, nvrhi::TextureHandle>> Textures;
+	};
+	//textures rebinds replaced, the work submitted before the descriptor writes may still read them
+	struct RetiredTextures
+	{
+		nvrhi::EventQueryHandle Unused;
+		std::vector<nvrhi::TextureHandle> Textures;
+	};
+
+	//writes the new textures into the descriptor table once their uploads are done on the gpu,
+	//and drops the textures they replaced once the frames that could read them are done
+	void FlushRebinds();
+	//an event query whose fence was passed already, or a new one
+	nvrhi::EventQueryHandle AcquireQuery();
+
+	Settings Config;
+	TextureResidencyScheduler Scheduler;
+	//a deque so the decodes can hold on to the sources while images get added
+	std::deque<StreamedImage> Images;
+	//scheduler index to streamed image
+	std::vector<uint32_t> SchedulerToImage;
+	std::unordered_map<uint32_t, uint32_t> ImageIndexToStreamed;
+	std::vector<uint32_t> DecodeQueue;
+	uint32_t DecodesInFlight{};
+	//decoded pixels waiting for upload and the estimated memory of the decodes still running
+	size_t CpuBytes{};
+	size_t DecodeBytesInFlight{};
+	std::vector<uint32_t> PendingRebinds;
+	//fences pass in submission order, so both only ever pop from the front
+	std::deque<RebindBatch> RebindBatches;
+	std::deque<RetiredTextures> Retired;
+	std::vector<nvrhi::EventQueryHandle> FreeQueries;
+	Stats Counters;
+
+	//decodes hand their results back through here
+	std::mutex FinishedMutex;
+	std::vector<std::unique_ptr<DecodedImage>> Finished;
+
+	nvrhi::CommandListHandle CommandList;
+	bool bCommandListOpen{};
+	std::vector<TextureResidencyScheduler::Request> Requests;
+	std::vector<TextureResidencyScheduler::Eviction> Evictions;
+
+	inline static std::unique_ptr<TextureStreamer> s_Instance;
+};
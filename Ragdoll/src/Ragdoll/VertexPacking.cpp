@@ -0,0 +1,204 @@
+#include "ragdollpch.h"
+#include "VertexPacking.h"
+
+#include "Profiler.h"
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+namespace
+{
+	//projects a unit vector onto the octahedron and unfolds it into [-1, 1]^2, the lower hemisphere is folded over the diagonals
+	inline XMVECTOR XM_CALLCONV OctahedralEncode(FXMVECTOR n)
+	{
+		XMVECTOR l1 = XMVector3Dot(XMVectorAbs(n), g_XMOne);
+		//zero length vectors end up at (0, 0) which decodes to +z
+		l1 = XMVectorMax(l1, XMVectorReplicate(1e-20f));
+		XMVECTOR p = XMVectorDivide(n, l1);
+		XMVECTOR signP = XMVectorSelect(g_XMNegativeOne, g_XMOne, XMVectorGreaterOrEqual(p, XMVectorZero()));
+		XMVECTOR folded = XMVectorMultiply(XMVectorSubtract(g_XMOne, XMVectorAbs(XMVectorSwizzle<1, 0, 2, 3>(p))), signP);
+		return XMVectorSelect(p, folded, XMVectorLess(XMVectorSplatZ(p), XMVectorZero()));
+	}
+
+	inline XMVECTOR XM_CALLCONV OctahedralDecode(FXMVECTOR e)
+	{
+		XMVECTOR absE = XMVectorAbs(e);
+		XMVECTOR z = XMVectorSubtract(g_XMOne, XMVectorAdd(XMVectorSplatX(absE), XMVectorSplatY(absE)));
+		//unfold the lower hemisphere
+		XMVECTOR t = XMVectorSaturate(XMVectorNegate(z));
+		XMVECTOR xy = XMVectorAdd(e, XMVectorSelect(t, XMVectorNegate(t), XMVectorGreaterOrEqual(e, XMVectorZero())));
+		XMVECTOR n = XMVectorSelect(xy, z, XMVectorSelectControl(0, 0, 1, 0));
+		return XMVector3Normalize(n);
+	}
+
+	struct QuantizationBox
+	{
+		XMVECTOR Min;
+		XMVECTOR Size;
+		XMVECTOR InvSize;
+	};
+
+	inline QuantizationBox XM_CALLCONV GetQuantizationBox(const DirectX::BoundingBox& box)
+	{
+		QuantizationBox q;
+		XMVECTOR extents = XMLoadFloat3(&box.Extents);
+		q.Min = XMVectorSubtract(XMLoadFloat3(&box.Center), extents);
+		q.Size = XMVectorAdd(extents, extents);
+		//flat axes would divide by zero, everything on that axis sits on the min instead
+		q.InvSize = XMVectorSelect(XMVectorReciprocal(q.Size), XMVectorZero(), XMVectorLessOrEqual(q.Size, XMVectorZero()));
+		return q;
+	}
+}
+
+void PackVertices(const Vertex* src, size_t count, const DirectX::BoundingBox& box, PackedVertex* dst)
+{
+	const QuantizationBox q = GetQuantizationBox(box);
+	for (size_t i = 0; i < count; ++i)
+	{
+		const Vertex& v = src[i];
+		PackedVertex& p = dst[i];
+
+		XMVECTOR position = XMVectorMultiply(XMVectorSubtract(XMLoadFloat3(&v.position), q.Min), q.InvSize);
+		//the spare w of the position carries the bitangent sign
+		position = XMVectorSetW(position, v.tangent.w < 0.f ? 0.f : 1.f);
+		XMUSHORTN4 packedPosition;
+		XMStoreUShortN4(&packedPosition, XMVectorSaturate(position));
+		XMSHORTN2 packedNormal;
+		XMStoreShortN2(&packedNormal, OctahedralEncode(XMLoadFloat3(&v.normal)));
+		XMSHORTN2 packedTangent;
+		XMStoreShortN2(&packedTangent, OctahedralEncode(XMVectorSetW(XMLoadFloat4(&v.tangent), 0.f)));
+		XMHALF2 packedTexcoord;
+		XMStoreHalf2(&packedTexcoord, XMLoadFloat2(&v.texcoord));
+
+		memcpy(p.position, &packedPosition, sizeof(p.position));
+		memcpy(p.normal, &packedNormal, sizeof(p.normal));
+		memcpy(p.tangent, &packedTangent, sizeof(p.tangent));
+		memcpy(p.texcoord, &packedTexcoord, sizeof(p.texcoord));
+	}
+}
+
+void UnpackVertices(const PackedVertex* src, size_t count, const DirectX::BoundingBox& box, Vertex* dst)
+{
+	const QuantizationBox q = GetQuantizationBox(box);
+	for (size_t i = 0; i < count; ++i)
+	{
+		const PackedVertex& p = src[i];
+		Vertex& v = dst[i];
+
+		XMUSHORTN4 packedPosition;
+		memcpy(&packedPosition, p.position, sizeof(p.position));
+		XMSHORTN2 packedNormal;
+		memcpy(&packedNormal, p.normal, sizeof(p.normal));
+		XMSHORTN2 packedTangent;
+		memcpy(&packedTangent, p.tangent, sizeof(p.tangent));
+		XMHALF2 packedTexcoord;
+		memcpy(&packedTexcoord, p.texcoord, sizeof(p.texcoord));
+
+		XMStoreFloat3(&v.position, XMVectorMultiplyAdd(XMLoadUShortN4(&packedPosition), q.Size, q.Min));
+		XMStoreFloat3(&v.normal, OctahedralDecode(XMLoadShortN2(&packedNormal)));
+		XMStoreFloat4(&v.tangent, XMVectorSetW(OctahedralDecode(XMLoadShortN2(&packedTangent)), packedPosition.w >= 0x8000 ? 1.f : -1.f));
+		XMStoreFloat2(&v.texcoord, XMLoadHalf2(&packedTexcoord));
+	}
+}
+
+bool BenchmarkVertexPacking(const std::vector<Vertex>& vertices, const std::vector<VertexBufferInfo>& infos)
+{
+	RD_SCOPE(Load, Benchmark Vertex Packing);
+	//rounding to the nearest unorm16 step is off by half a step of the box
+	constexpr float MaxPositionSteps = 0.5f / 65535.f;
+	//half a snorm16 step on both octahedral axes comes out under 0.004 degrees
+	constexpr float MaxVectorDegrees = 0.01f;
+	//half keeps 11 significant bits, rounding is off by half of the last one, relative to the value
+	constexpr float MaxTexcoordError = 1.f / 2048.f * 1.01f;
+	if (vertices.empty())
+		return true;
+	std::vector<PackedVertex> packed(vertices.size());
+	std::vector<Vertex> unpacked(vertices.size());
+
+	//lods point back at the vertices of their mesh and have boxes of their own, pack every vertex once like the upload does
+	std::vector<const VertexBufferInfo*> packedInfos;
+	size_t nextVertexOffset = 0;
+	for (const VertexBufferInfo& info : infos)
+	{
+		if (info.VerticesOffset < nextVertexOffset || info.VerticesCount == 0)
+			continue;
+		nextVertexOffset = info.VerticesOffset + info.VerticesCount;
+		packedInfos.push_back(&info);
+	}
+
+	//time the whole set in one go, same as an upload would
+	auto encodeStart = std::chrono::high_resolution_clock::now();
+	for (const VertexBufferInfo* info : packedInfos)
+		PackVertices(vertices.data() + info->VerticesOffset, info->VerticesCount, info->BestFitBox, packed.data() + info->VerticesOffset);
+	auto encodeEnd = std::chrono::high_resolution_clock::now();
+	for (const VertexBufferInfo* info : packedInfos)
+		UnpackVertices(packed.data() + info->VerticesOffset, info->VerticesCount, info->BestFitBox, unpacked.data() + info->VerticesOffset);
+	auto decodeEnd = std::chrono::high_resolution_clock::now();
+
+	//atan2 of the cross and dot keeps its precision for tiny angles, acos of a dot close to 1 does not
+	auto angleBetween = [](const Vector3& a, const Vector3& b) { return atan2f(a.Cross(b).Length(), a.Dot(b)); };
+	//plus the float rounding of the positions themselves, which is what is left for a small box far from the origin
+	auto isPositionOff = [](float error, float position, float size) { return fabsf(error) > MaxPositionSteps * size + 4.f * FLT_EPSILON * (fabsf(position) + size); };
+	float maxPositionError{}, maxNormalAngle{}, maxTangentAngle{}, maxTexcoordError{};
+	size_t flippedSigns{}, positionsOff{};
+	for (const VertexBufferInfo* packedInfo : packedInfos)
+	{
+		const VertexBufferInfo& info = *packedInfo;
+		Vector3 size = Vector3(info.BestFitBox.Extents) * 2.f;
+		for (uint32_t i = info.VerticesOffset; i < info.VerticesOffset + info.VerticesCount; ++i)
+		{
+			const Vertex& a = vertices[i];
+			const Vertex& b = unpacked[i];
+			Vector3 error = a.position - b.position;
+			if (size.x > 0.f) maxPositionError = std::max(maxPositionError, fabsf(error.x) / size.x);
+			if (size.y > 0.f) maxPositionError = std::max(maxPositionError, fabsf(error.y) / size.y);
+			if (size.z > 0.f) maxPositionError = std::max(maxPositionError, fabsf(error.z) / size.z);
+			positionsOff += isPositionOff(error.x, a.position.x, size.x) || isPositionOff(error.y, a.position.y, size.y) || isPositionOff(error.z, a.position.z, size.z);
+			//only unit vectors survive the octahedral mapping, skip the degenerate ones
+			if (a.normal.LengthSquared() > 0.f)
+			{
+				Vector3 n = a.normal;
+				n.Normalize();
+				maxNormalAngle = std::max(maxNormalAngle, angleBetween(n, b.normal));
+			}
+			Vector3 tangentA(a.tangent.x, a.tangent.y, a.tangent.z);
+			if (tangentA.LengthSquared() > 0.f)
+			{
+				tangentA.Normalize();
+				maxTangentAngle = std::max(maxTangentAngle, angleBetween(tangentA, Vector3(b.tangent.x, b.tangent.y, b.tangent.z)));
+			}
+			flippedSigns += (a.tangent.w < 0.f) != (b.tangent.w < 0.f);
+			//below the smallest normal half the steps stop shrinking
+			maxTexcoordError = std::max({ maxTexcoordError,
+				fabsf(a.texcoord.x - b.texcoord.x) / std::max(fabsf(a.texcoord.x), 1.f / 16384.f),
+				fabsf(a.texcoord.y - b.texcoord.y) / std::max(fabsf(a.texcoord.y), 1.f / 16384.f) });
+		}
+	}
+
+	std::chrono::duration<double> encodeTime = encodeEnd - encodeStart;
+	std::chrono::duration<double> decodeTime = decodeEnd - encodeEnd;
+	const double sourceMB = vertices.size() * sizeof(Vertex) / (1024.0 * 1024.0);
+	const double packedMB = vertices.size() * sizeof(PackedVertex) / (1024.0 * 1024.0);
+	RD_CORE_INFO("Vertex packing: {} vertices, {:.2f}MB -> {:.2f}MB", vertices.size(), sourceMB, packedMB);
+	RD_CORE_INFO("Vertex packing: encode {:.2f}ms ({:.0f}MB/s), decode {:.2f}ms ({:.0f}MB/s)",
+		encodeTime.count() * 1000.0, sourceMB / encodeTime.count(), decodeTime.count() * 1000.0, sourceMB / decodeTime.count());
+	RD_CORE_INFO("Vertex packing: max position error {:.7f} of the box, normal {:.4f} deg, tangent {:.4f} deg, texcoord {:.6f} of the value, {} flipped bitangent signs",
+		maxPositionError, XMConvertToDegrees(maxNormalAngle), XMConvertToDegrees(maxTangentAngle), maxTexcoordError, flippedSigns);
+
+	bool bSuccess = true;
+	auto Check = [&bSuccess](bool bCondition, const std::string& what) {
+		if (!bCondition)
+		{
+			RD_CORE_ERROR("Vertex packing check failed: {}", what);
+			bSuccess = false;
+		}
+	};
+	Check(positionsOff == 0, fmt::format("{} positions are off by more than {:.7f} of their box", positionsOff, MaxPositionSteps));
+	Check(XMConvertToDegrees(maxNormalAngle) <= MaxVectorDegrees, fmt::format("normal error {:.4f} deg is above {:.4f}", XMConvertToDegrees(maxNormalAngle), MaxVectorDegrees));
+	Check(XMConvertToDegrees(maxTangentAngle) <= MaxVectorDegrees, fmt::format("tangent error {:.4f} deg is above {:.4f}", XMConvertToDegrees(maxTangentAngle), MaxVectorDegrees));
+	Check(maxTexcoordError <= MaxTexcoordError, fmt::format("texcoord error {:.6f} of the value is above {:.6f}", maxTexcoordError, MaxTexcoordError));
+	Check(flippedSigns == 0, fmt::format("{} bitangent signs flipped", flippedSigns));
+	if (bSuccess)
+		RD_CORE_INFO("Vertex packing checks passed");
+	return bSuccess;
+}
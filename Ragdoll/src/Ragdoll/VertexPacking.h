@@ -0,0 +1,10 @@
+#pragma once
+#include "Ragdoll/AssetManager.h"
+
+//encode and decode between Vertex and PackedVertex, the box is the one the positions are quantized against
+void PackVertices(const Vertex* src, size_t count, const DirectX::BoundingBox& box, PackedVertex* dst);
+void UnpackVertices(const PackedVertex* src, size_t count, const DirectX::BoundingBox& box, Vertex* dst);
+
+//round trips every vertex buffer through the packed layout, logs the worst error of every attribute and the encode/decode throughput
+//false if an attribute came back further off than its format allows
+bool BenchmarkVertexPacking(const std::vector<Vertex>& vertices, const std::vector<VertexBufferInfo>& infos);
@@ -166,6 +166,10 @@ namespace nvrhi::d3d12
 
         // The cache does not own the RS objects, so store weak references
         std::unordered_map<size_t, RootSignature*> rootsigCache;
+        // Pipelines may be created from several threads at once, they all look up and insert root signatures here.
+        // Releasing a cached RS takes it too, so its count can not drop to zero between a lookup and the AddRef.
+        // Recursive as references released while the lock is held take it again.
+        std::recursive_mutex rootsigCacheMutex;
 
         explicit DeviceResources(const Context& context, const DeviceDesc& desc);
 
@@ -461,6 +465,7 @@ namespace nvrhi::d3d12
         { }
 
         ~RootSignature() override;
+        unsigned long Release() override;
         Object getNativeObject(ObjectType objectType) override;
 
     private:
@@ -722,6 +722,11 @@ namespace nvrhi::d3d12
             hash_combine(hash, pipelineLayout.Get());
         
         hash_combine(hash, allowInputLayout ? 1u : 0u);
+
+        // Held while building too, so two threads asking for the same new RS do not both build it.
+        // The cache only holds weak references, RootSignature::Release takes the same lock so an RS
+        // found here can not be on its way out.
+        std::lock_guard<std::recursive_mutex> lockGuard(m_Resources.rootsigCacheMutex);
         
         // Get a cached RS and AddRef it (if it exists)
         RefCountPtr<RootSignature> rootsig = m_Resources.rootsigCache[hash];
@@ -739,9 +744,19 @@ namespace nvrhi::d3d12
         return rootsig;
     }
 
+    unsigned long RootSignature::Release()
+    {
+        // The last reference going away and the RS leaving the cache happen under one lock,
+        // getRootSignature can not AddRef it in between. The resources outlive the RS, so the
+        // lock is still valid after the RS deletes itself.
+        std::lock_guard<std::recursive_mutex> lockGuard(m_Resources.rootsigCacheMutex);
+        return RefCounter<IRootSignature>::Release();
+    }
+
     RootSignature::~RootSignature()
     {
         // Remove the root signature from the cache
+        std::lock_guard<std::recursive_mutex> lockGuard(m_Resources.rootsigCacheMutex);
         const auto it = m_Resources.rootsigCache.find(hash);
         if (it != m_Resources.rootsigCache.end())
             m_Resources.rootsigCache.erase(it);
@@ -24,7 +24,7 @@ struct FVertex
 {
     float3 position;
     float3 normal;
-    float3 tangent;
+    float4 tangent;     //w is the bitangent sign
     float2 texcoord;
 };
 
@@ -45,6 +45,70 @@ struct FMeshData
     float3 Extents;
 };
 
+#ifdef QUANTIZED_VERTICES
+//matches PackedVertex, 20 bytes
+struct FPackedVertex
+{
+    uint2 position;     //unorm16 xyz within the mesh box, w is the bitangent sign as 0 or 1
+    uint normal;        //octahedral snorm16 xy
+    uint tangent;       //octahedral snorm16 xy
+    uint texcoord;      //half xy
+};
+#define FVertexStorage FPackedVertex
+#else
+#define FVertexStorage FVertex
+#endif
+
+float3 OctahedralDecode(float2 e)
+{
+    float3 n = float3(e, 1.f - abs(e.x) - abs(e.y));
+    //unfold the lower hemisphere
+    float t = saturate(-n.z);
+    n.xy -= (step(0.f, n.xy) * 2.f - 1.f) * t;
+    return normalize(n);
+}
+
+float2 UnpackSnorm2x16(uint v)
+{
+    int2 s = asint(uint2(v << 16, v)) >> 16;
+    return max(float2(s) / 32767.f, -1.f);
+}
+
+float2 UnpackUnorm2x16(uint v)
+{
+    return float2(v & 0xffff, v >> 16) / 65535.f;
+}
+
+//q is the unorm position in [0, 1] over the mesh bounding box
+float3 DequantizePosition(float3 q, FMeshData mesh)
+{
+    return mesh.Center + (q * 2.f - 1.f) * mesh.Extents;
+}
+
+//turns whatever is in the global vertex buffer back into a full vertex
+FVertex DecodeVertex(FVertexStorage v, FMeshData mesh)
+{
+#ifdef QUANTIZED_VERTICES
+    FVertex result;
+    result.position = DequantizePosition(float3(UnpackUnorm2x16(v.position.x), UnpackUnorm2x16(v.position.y).x), mesh);
+    result.normal = OctahedralDecode(UnpackSnorm2x16(v.normal));
+    result.tangent = float4(OctahedralDecode(UnpackSnorm2x16(v.tangent)), UnpackUnorm2x16(v.position.y).y * 2.f - 1.f);
+    result.texcoord = f16tof32(uint2(v.texcoord, v.texcoord >> 16));
+    return result;
+#else
+    return v;
+#endif
+}
+
+float2 GetVertexTexcoord(FVertexStorage v)
+{
+#ifdef QUANTIZED_VERTICES
+    return f16tof32(uint2(v.texcoord, v.texcoord >> 16));
+#else
+    return v.texcoord;
+#endif
+}
+
 struct FInstanceData
 {
     float4x4 ModelToWorld;
@@ -15,15 +15,24 @@ cbuffer g_Const : register(b0) {
 
 StructuredBuffer<FInstanceData> InstanceDatas : register(t0);
 StructuredBuffer<FMaterialData> MaterialDatas : register(t1);
+#ifdef QUANTIZED_VERTICES
+StructuredBuffer<FMeshData> MeshDatas : register(t2);
+#endif
 
 Texture2D Textures[] : register(t0, space1);
 
 sampler Samplers[9] : register(s0);
 
 void gbuffer_vs(
+#ifdef QUANTIZED_VERTICES
+	in float4 inPackedPos : POSITION,
+	in float2 inPackedNormal : NORMAL,
+	in float2 inPackedTangent : TANGENT,
+#else
 	in float3 inPos : POSITION,
 	in float3 inNormal : NORMAL,
-	in float3 inTangent : TANGENT,
+	in float4 inTangent : TANGENT,	//w is the bitangent sign
+#endif
 	in float2 inTexcoord : TEXCOORD,
 	in int inInstanceId : INSTANCEID,
 	out float4 outPos : SV_Position,
@@ -37,15 +46,21 @@ void gbuffer_vs(
 )
 {
     FInstanceData data = InstanceDatas[inInstanceId];
+#ifdef QUANTIZED_VERTICES
+    float3 inPos = DequantizePosition(inPackedPos.xyz, MeshDatas[data.MeshIndex]);
+    float3 inNormal = OctahedralDecode(inPackedNormal);
+    //the bitangent sign rides in the spare w of the position as 0 or 1
+    float4 inTangent = float4(OctahedralDecode(inPackedTangent), inPackedPos.w * 2.f - 1.f);
+#endif
 	outFragPos = mul(float4(inPos, 1), data.ModelToWorld); 
 	outPrevFragPos = mul(float4(inPos, 1), data.PrevModelToWorld);
 	outPos = mul(outFragPos, viewProjMatrixWithAA);
 
-	float binormalSign = inNormal.x > 0.0f ? -1.0f : 1.0f;
     float3x3 AdjugateMatrix = Adjugate(data.ModelToWorld);
     outNormal = normalize(mul(inNormal, AdjugateMatrix));
-    outTangent = normalize(mul(inTangent, AdjugateMatrix));
-	outBinormal = normalize(cross(outTangent, outNormal)) * binormalSign;
+    outTangent = normalize(mul(inTangent.xyz, AdjugateMatrix));
+    //same convention as gltf and the meshlet path, the sign flips the bitangent of mirrored uvs
+	outBinormal = normalize(cross(outNormal, outTangent)) * inTangent.w;
     outTexcoord = float2(inTexcoord.x, inTexcoord.y);
     outInstanceId = inInstanceId;
 }
@@ -92,7 +107,7 @@ void gbuffer_ps(
 	// Sample normal map and leave it in model space, the deferred lighting will calculate this instead
 	float3 N = inNormal;
 	if(materialData.NormalIndex != -1){
-        float3 normalMapValue = normalize(Textures[materialData.NormalIndex].Sample(Samplers[materialData.NormalSamplerIndex], inTexcoord).xyz * 2.0f - 1.0f);
+        float3 normalMapValue = DecodeNormalMap(Textures[materialData.NormalIndex].Sample(Samplers[materialData.NormalSamplerIndex], inTexcoord).xy);
 		float3x3 TBN = float3x3(inTangent, inBinormal, inNormal);
 		N = normalize(mul(normalMapValue, TBN));
 	}
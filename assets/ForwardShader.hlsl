@@ -37,7 +37,7 @@ Texture2D Textures[] : register(t0, space1);
 void main_vs(
 	in float3 inPos : POSITION,
 	in float3 inNormal : NORMAL,
-	in float3 inTangent : TANGENT,
+	in float4 inTangent : TANGENT,	//w is the bitangent sign
 	in float2 inTexcoord : TEXCOORD,
 	in uint inInstanceId : SV_INSTANCEID,
 	out float4 outPos : SV_Position,
@@ -53,10 +53,10 @@ void main_vs(
 	outFragPos = mul(float4(inPos, 1), data.worldMatrix);
 	outPos = mul(outFragPos, viewProjMatrix);
 
-	float binormalSign = inNormal.x > 0.0f ? -1.0f : 1.0f;
 	outNormal = normalize(mul(inNormal, transpose((float3x3)data.invWorldMatrix)));
-	outTangent = normalize(mul(inTangent, transpose((float3x3)data.invWorldMatrix)));
-	outBinormal = cross(outTangent, outNormal) * binormalSign;
+	outTangent = normalize(mul(inTangent.xyz, transpose((float3x3)data.invWorldMatrix)));
+	//same convention as gltf and the meshlet path, the sign flips the bitangent of mirrored uvs
+	outBinormal = normalize(cross(outNormal, outTangent)) * inTangent.w;
 	outTexcoord = inTexcoord;
 	outInstanceId = inInstanceId;
 }
@@ -133,7 +133,7 @@ void main_ps(
 		// Sample normal map and transform to world space
 		float3 N = inNormal;
 		if(data.normalIndex != -1){
-			float3 normalMapValue = normalize(Textures[data.normalIndex].Sample(Samplers[data.normalSamplerIndex], inTexcoord).xyz * 2.0f - 1.0f);
+			float3 normalMapValue = DecodeNormalMap(Textures[data.normalIndex].Sample(Samplers[data.normalSamplerIndex], inTexcoord).xy);
 			float3x3 TBN = float3x3(inTangent, inBinormal, inNormal);
 			N = normalize(mul(normalMapValue, TBN));
 		}
@@ -46,7 +46,7 @@ struct PayloadStruct
 
 StructuredBuffer<FInstanceData> InstanceDatas : register(t0);
 StructuredBuffer<FMaterialData> MaterialDatas : register(t1);
-StructuredBuffer<FVertex> Vertices : register(t2);
+StructuredBuffer<FVertexStorage> Vertices : register(t2);
 StructuredBuffer<FMeshlet> Meshlets : register(t3);
 StructuredBuffer<uint> VertexIndices : register(t4);
 StructuredBuffer<uint> TriangleIndices : register(t5);
@@ -273,18 +273,18 @@ uint GetVertexIndex(FMeshlet m, FMeshData MeshData, uint index)
 
 VertexOutput GetVertexOutput(uint outInstanceId, FMeshData MeshData, uint vertexIndex, uint meshletIndex)
 {
-    FVertex v = Vertices[vertexIndex + MeshData.VertexOffset];
+    FVertex v = DecodeVertex(Vertices[vertexIndex + MeshData.VertexOffset], MeshData);
     FInstanceData data = InstanceDatas[outInstanceId];
     VertexOutput vout;
     vout.outFragPos = mul(float4(v.position, 1), data.ModelToWorld);
     vout.outPrevFragPos = mul(float4(v.position, 1), data.PrevModelToWorld);
     vout.outPos = mul(vout.outFragPos, viewProjMatrixWithAA);
 
-    float binormalSign = v.normal.x > 0.0f ? -1.0f : 1.0f;
     float3x3 AdjugateMatrix = Adjugate(data.ModelToWorld);
     vout.outNormal = normalize(mul(v.normal, AdjugateMatrix));
-    vout.outTangent = normalize(mul(v.tangent, AdjugateMatrix));
-    vout.outBinormal = normalize(cross(vout.outTangent, vout.outNormal)) * binormalSign;
+    vout.outTangent = normalize(mul(v.tangent.xyz, AdjugateMatrix));
+    //same convention as gltf, the sign flips the bitangent of mirrored uvs
+    vout.outBinormal = normalize(cross(vout.outNormal, vout.outTangent)) * v.tangent.w;
     vout.outTexcoord = float2(v.texcoord.x, v.texcoord.y);
     vout.outInstanceId = outInstanceId;
     vout.outMeshletIndex = meshletIndex;
@@ -360,7 +360,7 @@ void MeshletPS(
     float3 N = inNormal;
     if (materialData.NormalIndex != -1)
     {
-        float3 normalMapValue = normalize(Textures[materialData.NormalIndex].Sample(Samplers[materialData.NormalSamplerIndex], inTexcoord).xyz * 2.0f - 1.0f);
+        float3 normalMapValue = DecodeNormalMap(Textures[materialData.NormalIndex].Sample(Samplers[materialData.NormalSamplerIndex], inTexcoord).xy);
         float3x3 TBN = float3x3(inTangent, inBinormal, inNormal);
         N = normalize(mul(normalMapValue, TBN));
     }
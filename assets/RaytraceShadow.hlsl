@@ -18,7 +18,7 @@ Texture2D t_GBufferDepth : register(t1);
 StructuredBuffer<FInstanceData> InstanceBuffer : register(t2);
 StructuredBuffer<FMaterialData> MaterialBuffer : register(t3);
 StructuredBuffer<FMeshData> MeshDataBuffer : register(t4);
-StructuredBuffer<FVertex> VertexBuffer : register(t5);
+StructuredBuffer<FVertexStorage> VertexBuffer : register(t5);
 StructuredBuffer<uint> IndexBuffer : register(t6);
 Texture2D<float4> Noise : register(t7);
 
@@ -111,9 +111,9 @@ void AnyHit(inout HitInfo payload : SV_RayPayload, in BuiltInTriangleIntersectio
     }
     FMeshData Mesh = MeshDataBuffer[Instance.MeshIndex];
     float3 Barycentric = float3(1.f - attr.barycentrics.x - attr.barycentrics.y, attr.barycentrics.x, attr.barycentrics.y);
-    float2 v0 = VertexBuffer[IndexBuffer[Mesh.IndexOffset + PrimitiveIndex() * 3 + 0] + Mesh.VertexOffset].texcoord;
-    float2 v1 = VertexBuffer[IndexBuffer[Mesh.IndexOffset + PrimitiveIndex() * 3 + 1] + Mesh.VertexOffset].texcoord;
-    float2 v2 = VertexBuffer[IndexBuffer[Mesh.IndexOffset + PrimitiveIndex() * 3 + 2] + Mesh.VertexOffset].texcoord;
+    float2 v0 = GetVertexTexcoord(VertexBuffer[IndexBuffer[Mesh.IndexOffset + PrimitiveIndex() * 3 + 0] + Mesh.VertexOffset]);
+    float2 v1 = GetVertexTexcoord(VertexBuffer[IndexBuffer[Mesh.IndexOffset + PrimitiveIndex() * 3 + 1] + Mesh.VertexOffset]);
+    float2 v2 = GetVertexTexcoord(VertexBuffer[IndexBuffer[Mesh.IndexOffset + PrimitiveIndex() * 3 + 2] + Mesh.VertexOffset]);
     float2 uv = v0 * Barycentric.x + v1 * Barycentric.y + v2 * Barycentric.z;
     float4 color = Textures[Material.AlbedoIndex].SampleLevel(Samplers[Material.AlbedoSamplerIndex], uv, 0);
     color.a *= Material.AlbedoFactor.a;
@@ -155,9 +155,9 @@ bool TestAlpha(uint InstanceId, float2 Bary, uint PrimitiveIndex)
     }
     FMeshData Mesh = MeshDataBuffer[Instance.MeshIndex];
     float3 Barycentric = float3(1.f - Bary.x - Bary.y, Bary.x, Bary.y);
-    float2 v0 = VertexBuffer[IndexBuffer[Mesh.IndexOffset + PrimitiveIndex * 3 + 0] + Mesh.VertexOffset].texcoord;
-    float2 v1 = VertexBuffer[IndexBuffer[Mesh.IndexOffset + PrimitiveIndex * 3 + 1] + Mesh.VertexOffset].texcoord;
-    float2 v2 = VertexBuffer[IndexBuffer[Mesh.IndexOffset + PrimitiveIndex * 3 + 2] + Mesh.VertexOffset].texcoord;
+    float2 v0 = GetVertexTexcoord(VertexBuffer[IndexBuffer[Mesh.IndexOffset + PrimitiveIndex * 3 + 0] + Mesh.VertexOffset]);
+    float2 v1 = GetVertexTexcoord(VertexBuffer[IndexBuffer[Mesh.IndexOffset + PrimitiveIndex * 3 + 1] + Mesh.VertexOffset]);
+    float2 v2 = GetVertexTexcoord(VertexBuffer[IndexBuffer[Mesh.IndexOffset + PrimitiveIndex * 3 + 2] + Mesh.VertexOffset]);
     float2 uv = v0 * Barycentric.x + v1 * Barycentric.y + v2 * Barycentric.z;
     float4 color = Textures[Material.AlbedoIndex].SampleLevel(Samplers[Material.AlbedoSamplerIndex], uv, 0);
     color.a *= Material.AlbedoFactor.a;
@@ -8,16 +8,28 @@ cbuffer g_Const : register(b0) {
 };
 
 StructuredBuffer<FInstanceData> InstanceDatas : register(t0);
+#ifdef QUANTIZED_VERTICES
+StructuredBuffer<FMeshData> MeshDatas : register(t1);
+#endif
 void directional_vs(
+#ifdef QUANTIZED_VERTICES
+	in float4 inPackedPos : POSITION,
+	in float2 inNormal : NORMAL,
+	in float2 inTangent : TANGENT,
+#else
 	in float3 inPos : POSITION,
 	in float3 inNormal : NORMAL,
-	in float3 inTangent : TANGENT,
+	in float4 inTangent : TANGENT,
+#endif
 	in float2 inTexcoord : TEXCOORD,
 	in int inInstanceId : INSTANCEID,
 	out float4 outPos : SV_Position
 )
 {
     FInstanceData data = InstanceDatas[inInstanceId];
+#ifdef QUANTIZED_VERTICES
+    float3 inPos = DequantizePosition(inPackedPos.xyz, MeshDatas[data.MeshIndex]);
+#endif
 	float4 worldPos = mul(float4(inPos, 1), data.ModelToWorld);
 	outPos = mul(worldPos, LightViewProj);
 }
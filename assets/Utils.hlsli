@@ -31,6 +31,13 @@ float3 Decode(float2 f)
     return normalize(n);
 }
 
+// Tangent space normal from a normal map, z is rebuilt from xy since bc5 normal maps only store those
+float3 DecodeNormalMap(float2 xy)
+{
+    xy = xy * 2.0f - 1.0f;
+    return float3(xy, sqrt(saturate(1.0f - dot(xy, xy))));
+}
+
 // Maps standard viewport UV to screen position.
 float2 ViewportUVToScreenPos(float2 ViewportUV)
 {